@@ -114,6 +114,33 @@ VOID __GetTsc(__U64* lpResult)
 #endif
 }
 
+//Return TSC cycles per micro second,calibrated by system clock at the first
+//call since CPU frequency is not measured.
+DWORD __GetTscCyclesPerUs()
+{
+	static DWORD dwCycles = 0;
+	__U64 start, end;
+	DWORD dwTick;
+
+	if (dwCycles)
+	{
+		return dwCycles;
+	}
+	dwTick = System.dwClockTickCounter;
+	while (dwTick == System.dwClockTickCounter);  //Align to tick boundary.
+	__GetTsc(&start);
+	dwTick = System.dwClockTickCounter;
+	while (System.dwClockTickCounter - dwTick < 10);
+	__GetTsc(&end);
+	dwCycles = (DWORD)(((((unsigned long long)end.dwHighPart << 32) + end.dwLowPart) -
+		(((unsigned long long)start.dwHighPart << 32) + start.dwLowPart)) / (10 * SYSTEM_TIME_SLICE * 1000));
+	if (0 == dwCycles)
+	{
+		dwCycles = 1;
+	}
+	return dwCycles;
+}
+
 
 #define CLOCK_PER_MICROSECOND 1024  //Assume the CPU's clock is 1G Hz.
 
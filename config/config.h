@@ -148,6 +148,10 @@
 //Include IDE driver in OS.
 //#define __CFG_DRV_IDE
 
+//Include AHCI controller support in IDE driver,it takes effect only when
+//the IDE driver is included.
+#define __CFG_DRV_AHCI
+
 //Include COM driver in OS.
 #define __CFG_DRV_COM
 
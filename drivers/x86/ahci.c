@@ -0,0 +1,667 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : ahci.c
+//    Module Funciton           :
+//                                AHCI host controller driver.Each disk has one
+//                                command list with up to 32 command slots,native
+//                                command queuing is used if both HBA and disk
+//                                support it,so concurrent requests from different
+//                                threads are served by the disk in its own order.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#ifndef __STDAFX_H__
+#include "StdAfx.h"
+#endif
+
+#include "kapi.h"
+#include "pci_drv.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "ahci.h"
+
+#if defined(__CFG_SYS_DDF) && defined(__CFG_DRV_IDE) && defined(__CFG_DRV_AHCI)
+
+#define AHCI_READ(base,off)       (*(volatile DWORD*)((BYTE*)(base) + (off)))
+#define AHCI_WRITE(base,off,val)  (*(volatile DWORD*)((BYTE*)(base) + (off)) = (DWORD)(val))
+
+#ifdef __CFG_SYS_VMM
+#define AHCI_VIRT_TO_PHYS(va) \
+	((DWORD)lpVirtualMemoryMgr->GetPhysicalAddress((__COMMON_OBJECT*)lpVirtualMemoryMgr,(LPVOID)(va)))
+#else
+#define AHCI_VIRT_TO_PHYS(va) ((DWORD)(va))
+#endif
+
+//Command list,received FIS area and command tables of one port.
+#define AHCI_RECV_FIS_OFFSET      1024
+#define AHCI_CMD_TABLE_OFFSET     4096
+#define AHCI_PORT_MEM_SIZE        (AHCI_CMD_TABLE_OFFSET + sizeof(__AHCI_CMD_TABLE) * 32)
+
+//One disk attached to AHCI controller.
+typedef struct{
+	LPVOID              pPort;           //Port register base.
+	int                 nPort;
+	__AHCI_CMD_HEADER*  pCmdList;
+	BYTE*               pRecvFis;
+	__AHCI_CMD_TABLE*   pCmdTable;
+	DWORD               dwSlotNum;       //Usable command slots.
+	BOOL                bNcq;
+	DWORD               dwTotalSectors;
+	volatile DWORD      dwBusySlots;     //Allocated to requests.
+	volatile DWORD      dwIssuedSlots;   //Issued to HBA and not completed yet.
+	volatile DWORD      dwErrorSlots;    //Completed with error.
+	HANDLE              hSlotEvent[32];
+}__AHCI_DISK;
+
+static struct{
+	LPVOID              pAbar;           //HBA register base.
+	DWORD               dwCap;
+	UCHAR               ucVector;
+	BOOL                bIntMode;
+	HANDLE              hInterrupt;
+	int                 nDiskNum;
+	__AHCI_DISK         Disks[AHCI_MAX_DISKS];
+}AhciHba = { 0 };
+
+//Stop command engine of a port.
+static VOID AhciStopPort(LPVOID pPort)
+{
+	int cnt = 0x100000;
+
+	AHCI_WRITE(pPort,AHCI_PxCMD,AHCI_READ(pPort,AHCI_PxCMD) & ~(AHCI_PxCMD_ST | AHCI_PxCMD_FRE));
+	while(cnt --)
+	{
+		if(!(AHCI_READ(pPort,AHCI_PxCMD) & (AHCI_PxCMD_CR | AHCI_PxCMD_FR)))
+		{
+			break;
+		}
+	}
+}
+
+//Start command engine of a port,errors are cleared first.
+static VOID AhciStartPort(LPVOID pPort)
+{
+	int cnt = 0x100000;
+
+	AHCI_WRITE(pPort,AHCI_PxSERR,0xFFFFFFFF);
+	AHCI_WRITE(pPort,AHCI_PxIS,0xFFFFFFFF);
+	AHCI_WRITE(pPort,AHCI_PxCMD,AHCI_READ(pPort,AHCI_PxCMD) | AHCI_PxCMD_FRE);
+	while(cnt --)
+	{
+		if(!(AHCI_READ(pPort,AHCI_PxTFD) & (AHCI_TFD_BSY | AHCI_TFD_DRQ)))
+		{
+			break;
+		}
+	}
+	AHCI_WRITE(pPort,AHCI_PxCMD,AHCI_READ(pPort,AHCI_PxCMD) | AHCI_PxCMD_ST);
+}
+
+//Collect completed command slots of a disk,must be called with interrupt
+//disabled.An error aborts all outstanding commands of the port.
+static VOID AhciReapSlots(__AHCI_DISK* pDisk)
+{
+	DWORD dwIs      = AHCI_READ(pDisk->pPort,AHCI_PxIS);
+	DWORD dwPending = 0;
+	DWORD dwDone    = 0;
+	int   i;
+
+	AHCI_WRITE(pDisk->pPort,AHCI_PxIS,dwIs);
+	if(dwIs & AHCI_PxIS_ERROR)
+	{
+		dwDone = pDisk->dwIssuedSlots;
+		pDisk->dwErrorSlots |= dwDone;
+	}
+	else
+	{
+		dwPending = AHCI_READ(pDisk->pPort,AHCI_PxCI);
+		if(pDisk->bNcq)
+		{
+			dwPending |= AHCI_READ(pDisk->pPort,AHCI_PxSACT);
+		}
+		dwDone = pDisk->dwIssuedSlots & ~dwPending;
+	}
+	pDisk->dwIssuedSlots &= ~dwDone;
+	if(!AhciHba.bIntMode)
+	{
+		return;
+	}
+	for(i = 0;dwDone;i ++)
+	{
+		if(dwDone & (1 << i))
+		{
+			SetEvent(pDisk->hSlotEvent[i]);
+			dwDone &= ~(1 << i);
+		}
+	}
+}
+
+//Restart a port after error or timeout,all outstanding commands are failed.
+static VOID AhciRecoverPort(__AHCI_DISK* pDisk)
+{
+	DWORD dwFlags;
+	DWORD dwAborted;
+	int   i;
+
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	AhciStopPort(pDisk->pPort);
+	AhciStartPort(pDisk->pPort);
+	dwAborted = pDisk->dwIssuedSlots;
+	pDisk->dwErrorSlots  |= dwAborted;
+	pDisk->dwIssuedSlots  = 0;
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+
+	for(i = 0;dwAborted && AhciHba.bIntMode;i ++)
+	{
+		if(dwAborted & (1 << i))
+		{
+			SetEvent(pDisk->hSlotEvent[i]);
+			dwAborted &= ~(1 << i);
+		}
+	}
+}
+
+//Allocate a free command slot,wait if all are in use.
+static int AhciAllocSlot(__AHCI_DISK* pDisk)
+{
+	DWORD dwFlags;
+	DWORD i;
+
+	while(TRUE)
+	{
+		__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+		for(i = 0;i < pDisk->dwSlotNum;i ++)
+		{
+			if(!(pDisk->dwBusySlots & (1 << i)))
+			{
+				pDisk->dwBusySlots |= (1 << i);
+				__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+				return (int)i;
+			}
+		}
+		__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+		if(!AhciHba.bIntMode)  //Can not happen in single thread.
+		{
+			return -1;
+		}
+		Sleep(SYSTEM_TIME_SLICE);
+	}
+}
+
+static VOID AhciFreeSlot(__AHCI_DISK* pDisk,int nSlot)
+{
+	DWORD dwFlags;
+
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pDisk->dwBusySlots  &= ~(1 << nSlot);
+	pDisk->dwErrorSlots &= ~(1 << nSlot);
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+}
+
+//Build PRD table of a command,buffer is split at page boundary and physically
+//continuous pages are merged.Returns entries used,0 if too many.
+static DWORD AhciBuildPrdt(__AHCI_CMD_TABLE* pTable,BYTE* pBuffer,DWORD dwLength)
+{
+	__AHCI_PRD*  pPrd     = &pTable->Prdt[0];
+	int          nIndex   = -1;
+	DWORD        dwPhys;
+	DWORD        dwChunk;
+
+	while(dwLength)
+	{
+		dwChunk = 4096 - ((DWORD)pBuffer & 4095);
+		if(dwChunk > dwLength)
+		{
+			dwChunk = dwLength;
+		}
+		dwPhys = AHCI_VIRT_TO_PHYS(pBuffer);
+		if((nIndex >= 0) && (pPrd[nIndex].dwDba + pPrd[nIndex].dwDbc + 1 == dwPhys))
+		{
+			pPrd[nIndex].dwDbc += dwChunk;
+		}
+		else
+		{
+			nIndex ++;
+			if(nIndex >= AHCI_PRDT_NUM)
+			{
+				return 0;
+			}
+			pPrd[nIndex].dwDba      = dwPhys;
+			pPrd[nIndex].dwDbau     = 0;
+			pPrd[nIndex].dwReserved = 0;
+			pPrd[nIndex].dwDbc      = dwChunk - 1;
+		}
+		pBuffer  += dwChunk;
+		dwLength -= dwChunk;
+	}
+	pPrd[nIndex].dwDbc |= (1 << 31);  //Interrupt on completion.
+	return (DWORD)(nIndex + 1);
+}
+
+//Issue one ATA command through a command slot and wait it to finish.
+static BOOL AhciExecute(__AHCI_DISK* pDisk,UCHAR ucCommand,BOOL bWrite,
+						DWORD dwLba,DWORD dwCount,BYTE* pBuffer,DWORD dwLength)
+{
+	__AHCI_CMD_HEADER*  pHeader  = NULL;
+	__AHCI_CMD_TABLE*   pTable   = NULL;
+	BYTE*               pFis     = NULL;
+	DWORD               dwPrdtl  = 0;
+	DWORD               dwFlags;
+	DWORD               dwTag;
+	BOOL                bNcq     = FALSE;
+	BOOL                bResult  = FALSE;
+	int                 nSlot    = -1;
+	int                 cnt      = 0x1000000;
+
+	nSlot = AhciAllocSlot(pDisk);
+	if(nSlot < 0)
+	{
+		goto __TERMINAL;
+	}
+	dwTag   = (DWORD)nSlot;
+	pHeader = &pDisk->pCmdList[nSlot];
+	pTable  = &pDisk->pCmdTable[nSlot];
+
+	dwPrdtl = AhciBuildPrdt(pTable,pBuffer,dwLength);
+	if(0 == dwPrdtl)
+	{
+		goto __TERMINAL;
+	}
+
+	//Register host to device FIS.
+	pFis = &pTable->Cfis[0];
+	memset(pFis,0,64);
+	pFis[0] = AHCI_FIS_TYPE_H2D;
+	pFis[1] = 0x80;  //Command,not control.
+	pFis[2] = ucCommand;
+	pFis[4] = (BYTE)dwLba;
+	pFis[5] = (BYTE)(dwLba >> 8);
+	pFis[6] = (BYTE)(dwLba >> 16);
+	pFis[7] = 0x40;  //LBA mode.
+	pFis[8] = (BYTE)(dwLba >> 24);
+	bNcq = (AHCI_CMD_READ_FPDMA == ucCommand) || (AHCI_CMD_WRITE_FPDMA == ucCommand);
+	if(bNcq)
+	{
+		pFis[3]  = (BYTE)dwCount;         //Count in feature register.
+		pFis[11] = (BYTE)(dwCount >> 8);
+		pFis[12] = (BYTE)(dwTag << 3);    //Tag in count register.
+	}
+	else
+	{
+		pFis[12] = (BYTE)dwCount;
+		pFis[13] = (BYTE)(dwCount >> 8);
+	}
+
+	pHeader->dwFlags = 5 | (bWrite ? AHCI_CMDHDR_WRITE : 0) | (dwPrdtl << 16);  //FIS is 5 DWORDs.
+	pHeader->dwPrdbc = 0;
+	pHeader->dwCtba  = AHCI_VIRT_TO_PHYS(pTable);
+	pHeader->dwCtbau = 0;
+
+	if(AhciHba.bIntMode)
+	{
+		ResetEvent(pDisk->hSlotEvent[nSlot]);
+	}
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pDisk->dwIssuedSlots |= (1 << nSlot);
+	if(bNcq)
+	{
+		AHCI_WRITE(pDisk->pPort,AHCI_PxSACT,1 << nSlot);
+	}
+	AHCI_WRITE(pDisk->pPort,AHCI_PxCI,1 << nSlot);
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+
+	if(AhciHba.bIntMode)
+	{
+		WaitForThisObjectEx(pDisk->hSlotEvent[nSlot],AHCI_COMMAND_TIMEOUT);
+	}
+	//Reap by polling,also covers the timeout of interrupt mode.
+	while(TRUE)
+	{
+		__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+		AhciReapSlots(pDisk);
+		if(!(pDisk->dwIssuedSlots & (1 << nSlot)))
+		{
+			bResult = (pDisk->dwErrorSlots & (1 << nSlot)) ? FALSE : TRUE;
+			__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+			break;
+		}
+		__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+		if((0 == cnt --) || AhciHba.bIntMode)  //Timeout.
+		{
+			AhciRecoverPort(pDisk);
+			bResult = FALSE;
+			break;
+		}
+	}
+	if((!bResult) && (AHCI_READ(pDisk->pPort,AHCI_PxCMD) & AHCI_PxCMD_ST) &&
+	   (AHCI_READ(pDisk->pPort,AHCI_PxTFD) & (AHCI_TFD_ERR | AHCI_TFD_BSY)))
+	{
+		AhciRecoverPort(pDisk);  //Port stays halted after error until restarted.
+	}
+
+__TERMINAL:
+	if(nSlot >= 0)
+	{
+		AhciFreeSlot(pDisk,nSlot);
+	}
+	return bResult;
+}
+
+//Allocate command list and tables of a port and start it.
+static BOOL AhciInitPort(__AHCI_DISK* pDisk)
+{
+	BYTE*    pMem   = NULL;
+	WORD*    pIdent = NULL;
+	DWORD    dwQueueDepth;
+
+#ifdef __CFG_SYS_VMM
+	pMem = (BYTE*)VirtualAlloc(NULL,AHCI_PORT_MEM_SIZE,
+		VIRTUAL_AREA_ALLOCATE_IOCOMMIT,
+		VIRTUAL_AREA_ACCESS_RW,
+		"AHCI_PORT");
+#else
+	pMem = (BYTE*)_hx_aligned_malloc(AHCI_PORT_MEM_SIZE,4096);
+#endif
+	if(NULL == pMem)
+	{
+		return FALSE;
+	}
+	memset(pMem,0,AHCI_PORT_MEM_SIZE);
+	pDisk->pCmdList  = (__AHCI_CMD_HEADER*)pMem;
+	pDisk->pRecvFis  = pMem + AHCI_RECV_FIS_OFFSET;
+	pDisk->pCmdTable = (__AHCI_CMD_TABLE*)(pMem + AHCI_CMD_TABLE_OFFSET);
+
+	AhciStopPort(pDisk->pPort);
+	AHCI_WRITE(pDisk->pPort,AHCI_PxCLB,AHCI_VIRT_TO_PHYS(pDisk->pCmdList));
+	AHCI_WRITE(pDisk->pPort,AHCI_PxCLBU,0);
+	AHCI_WRITE(pDisk->pPort,AHCI_PxFB,AHCI_VIRT_TO_PHYS(pDisk->pRecvFis));
+	AHCI_WRITE(pDisk->pPort,AHCI_PxFBU,0);
+	AHCI_WRITE(pDisk->pPort,AHCI_PxIE,0);
+	AhciStartPort(pDisk->pPort);
+
+	//Identify the disk,in single slot mode.
+	pDisk->dwSlotNum = 1;
+	pIdent = (WORD*)_hx_aligned_malloc(512,16);
+	if(NULL == pIdent)
+	{
+		goto __TERMINAL;
+	}
+	if(!AhciExecute(pDisk,AHCI_CMD_IDENTIFY,FALSE,0,0,(BYTE*)pIdent,512))
+	{
+		goto __TERMINAL;
+	}
+	if(pIdent[83] & 0x400)  //48 bits LBA,sectors beyond 32 bits are not used.
+	{
+		pDisk->dwTotalSectors = pIdent[100] + ((DWORD)pIdent[101] << 16);
+		if(pIdent[102] || pIdent[103])
+		{
+			pDisk->dwTotalSectors = 0xFFFFFFFF;
+		}
+	}
+	else
+	{
+		pDisk->dwTotalSectors = pIdent[60] + ((DWORD)pIdent[61] << 16);
+	}
+	//Commands can be outstanding at the same time only with NCQ.
+	if((AhciHba.dwCap & AHCI_CAP_SNCQ) && (pIdent[76] & 0x100))
+	{
+		pDisk->bNcq  = TRUE;
+		dwQueueDepth = (pIdent[75] & 0x1F) + 1;
+		pDisk->dwSlotNum = AHCI_CAP_NCS(AhciHba.dwCap);
+		if(pDisk->dwSlotNum > dwQueueDepth)
+		{
+			pDisk->dwSlotNum = dwQueueDepth;
+		}
+	}
+	_hx_free(pIdent);
+	_hx_printf("AHCI: Disk on port %d,%u sectors,%s,%d slot(s).\r\n",
+		pDisk->nPort,
+		pDisk->dwTotalSectors,
+		pDisk->bNcq ? "NCQ" : "no NCQ",
+		pDisk->dwSlotNum);
+	return TRUE;
+
+__TERMINAL:
+	if(pIdent)
+	{
+		_hx_free(pIdent);
+	}
+	AhciStopPort(pDisk->pPort);
+#ifdef __CFG_SYS_VMM
+	VirtualFree(pMem);
+#else
+	_hx_free(pMem);
+#endif
+	return FALSE;
+}
+
+//Probe AHCI controller and the disks attached to it.
+BOOL AhciInitialize(void)
+{
+	__PHYSICAL_DEVICE*   pDev   = NULL;
+	__IDENTIFIER         devId;
+	__AHCI_DISK*         pDisk  = NULL;
+	DWORD                dwBase = 0;
+	DWORD                dwCmd  = 0;
+	DWORD                dwPi   = 0;
+	LPVOID               pPort  = NULL;
+	int                  nPort;
+
+	devId.dwBusType = BUS_TYPE_PCI;
+	devId.Bus_ID.PCI_Identifier.ucMask  = PCI_IDENTIFIER_MASK_CLASS;
+	devId.Bus_ID.PCI_Identifier.dwClass = (AHCI_PCI_CLASS << 8);
+	pDev = DeviceManager.GetDevice(&DeviceManager,BUS_TYPE_PCI,&devId,NULL);
+	if(NULL == pDev)
+	{
+		return FALSE;
+	}
+
+	//ABAR is in BAR5.
+	dwBase = pDev->ReadDeviceConfig(pDev,PCI_CONFIG_OFFSET_BASE6,4);
+	dwBase &= ~0x0F;
+#ifdef __CFG_SYS_VMM
+	AhciHba.pAbar = VirtualAlloc((LPVOID)dwBase,0x1100,VIRTUAL_AREA_ALLOCATE_IO,
+		VIRTUAL_AREA_ACCESS_RW,
+		"AHCI Regs");
+	if(dwBase != (DWORD)AhciHba.pAbar)
+	{
+		_hx_printf("AHCI: Can not map registers at 0x%X.\r\n",dwBase);
+		if(AhciHba.pAbar)
+		{
+			VirtualFree(AhciHba.pAbar);
+		}
+		AhciHba.pAbar = NULL;
+		return FALSE;
+	}
+#else
+	AhciHba.pAbar = (LPVOID)dwBase;
+#endif
+	AhciHba.ucVector = (UCHAR)pDev->ReadDeviceConfig(pDev,PCI_CONFIG_OFFSET_INTLINE,1);
+
+	//Memory space and bus master.
+	dwCmd = pDev->ReadDeviceConfig(pDev,PCI_CONFIG_OFFSET_COMMAND,2);
+	dwCmd |= 0x06;
+	pDev->WriteDeviceConfig(pDev,PCI_CONFIG_OFFSET_COMMAND,dwCmd,2);
+
+	AHCI_WRITE(AhciHba.pAbar,AHCI_HBA_GHC,
+		(AHCI_READ(AhciHba.pAbar,AHCI_HBA_GHC) | AHCI_GHC_AE) & ~AHCI_GHC_IE);
+	AhciHba.dwCap = AHCI_READ(AhciHba.pAbar,AHCI_HBA_CAP);
+	dwPi = AHCI_READ(AhciHba.pAbar,AHCI_HBA_PI);
+
+	for(nPort = 0;(nPort < 32) && (AhciHba.nDiskNum < AHCI_MAX_DISKS);nPort ++)
+	{
+		if(!(dwPi & (1 << nPort)))
+		{
+			continue;
+		}
+		pPort = (BYTE*)AhciHba.pAbar + AHCI_PORT_BASE(nPort);
+		if((AHCI_READ(pPort,AHCI_PxSSTS) & 0x0F) != AHCI_SSTS_DET_PRESENT)
+		{
+			continue;
+		}
+		if(AHCI_READ(pPort,AHCI_PxSIG) != AHCI_SIG_ATA)  //ATAPI or port multiplier.
+		{
+			continue;
+		}
+		pDisk = &AhciHba.Disks[AhciHba.nDiskNum];
+		memset(pDisk,0,sizeof(__AHCI_DISK));
+		pDisk->pPort = pPort;
+		pDisk->nPort = nPort;
+		if(AhciInitPort(pDisk))
+		{
+			AhciHba.nDiskNum ++;
+		}
+	}
+	return (AhciHba.nDiskNum > 0) ? TRUE : FALSE;
+}
+
+int AhciGetDiskNum(void)
+{
+	return AhciHba.nDiskNum;
+}
+
+//Read or write sectors of one disk,the request is split into commands of
+//AHCI_MAX_SECTORS sectors.
+BOOL AhciTransfer(int nDisk,BOOL bWrite,DWORD dwStartSector,DWORD dwSectorNum,BYTE* pBuffer)
+{
+	__AHCI_DISK*  pDisk     = NULL;
+	BYTE*         pBounce   = NULL;
+	BYTE*         pData     = NULL;
+	UCHAR         ucCommand;
+	DWORD         dwCount;
+	BOOL          bResult   = TRUE;
+
+	if((nDisk < 0) || (nDisk >= AhciHba.nDiskNum))
+	{
+		return FALSE;
+	}
+	pDisk = &AhciHba.Disks[nDisk];
+	if(pDisk->bNcq)
+	{
+		ucCommand = bWrite ? AHCI_CMD_WRITE_FPDMA : AHCI_CMD_READ_FPDMA;
+	}
+	else
+	{
+		ucCommand = bWrite ? AHCI_CMD_WRITE_DMA_EXT : AHCI_CMD_READ_DMA_EXT;
+	}
+
+	//Data buffer must be WORD aligned.
+	if((DWORD)pBuffer & 1)
+	{
+		pBounce = (BYTE*)_hx_aligned_malloc(AHCI_MAX_SECTORS * 512,4096);
+		if(NULL == pBounce)
+		{
+			return FALSE;
+		}
+	}
+	while(dwSectorNum && bResult)
+	{
+		dwCount = (dwSectorNum > AHCI_MAX_SECTORS) ? AHCI_MAX_SECTORS : dwSectorNum;
+		pData   = pBounce ? pBounce : pBuffer;
+		if(pBounce && bWrite)
+		{
+			memcpy(pBounce,pBuffer,dwCount * 512);
+		}
+		bResult = AhciExecute(pDisk,ucCommand,bWrite,dwStartSector,dwCount,pData,dwCount * 512);
+		if(!bResult)  //Retry once,the command may be aborted by other's error.
+		{
+			bResult = AhciExecute(pDisk,ucCommand,bWrite,dwStartSector,dwCount,pData,dwCount * 512);
+		}
+		if(bResult && pBounce && !bWrite)
+		{
+			memcpy(pBuffer,pBounce,dwCount * 512);
+		}
+		dwStartSector += dwCount;
+		dwSectorNum   -= dwCount;
+		pBuffer       += dwCount * 512;
+	}
+	if(pBounce)
+	{
+		_hx_free(pBounce);
+	}
+	return bResult;
+}
+
+//Interrupt handler of the HBA,completes slots of all ports that raised it.
+static BOOL AhciIntHandler(LPVOID lpEsp,LPVOID lpParam)
+{
+	DWORD dwIs = AHCI_READ(AhciHba.pAbar,AHCI_HBA_IS);
+	int   i;
+
+	if(0 == dwIs)  //Shared interrupt raised by other device.
+	{
+		return FALSE;
+	}
+	for(i = 0;i < AhciHba.nDiskNum;i ++)
+	{
+		if(dwIs & (1 << AhciHba.Disks[i].nPort))
+		{
+			AhciReapSlots(&AhciHba.Disks[i]);
+		}
+	}
+	AHCI_WRITE(AhciHba.pAbar,AHCI_HBA_IS,dwIs);
+	return TRUE;
+}
+
+//Switch command completion from polling to interrupt.
+VOID AhciEnableInterrupt(void)
+{
+	__AHCI_DISK*  pDisk = NULL;
+	DWORD         i;
+	int           nDisk;
+
+	if(0 == AhciHba.nDiskNum)
+	{
+		return;
+	}
+	for(nDisk = 0;nDisk < AhciHba.nDiskNum;nDisk ++)
+	{
+		pDisk = &AhciHba.Disks[nDisk];
+		for(i = 0;i < pDisk->dwSlotNum;i ++)
+		{
+			pDisk->hSlotEvent[i] = CreateEvent(FALSE);
+			if(NULL == pDisk->hSlotEvent[i])
+			{
+				goto __TERMINAL;
+			}
+		}
+	}
+	AhciHba.hInterrupt = ConnectInterrupt(AhciIntHandler,NULL,
+		AhciHba.ucVector + INTERRUPT_VECTOR_BASE);
+	if(NULL == AhciHba.hInterrupt)
+	{
+		goto __TERMINAL;
+	}
+	for(nDisk = 0;nDisk < AhciHba.nDiskNum;nDisk ++)
+	{
+		AHCI_WRITE(AhciHba.Disks[nDisk].pPort,AHCI_PxIS,0xFFFFFFFF);
+		AHCI_WRITE(AhciHba.Disks[nDisk].pPort,AHCI_PxIE,AHCI_PxIE_DEFAULT);
+	}
+	AHCI_WRITE(AhciHba.pAbar,AHCI_HBA_IS,0xFFFFFFFF);
+	AhciHba.bIntMode = TRUE;
+	AHCI_WRITE(AhciHba.pAbar,AHCI_HBA_GHC,AHCI_READ(AhciHba.pAbar,AHCI_HBA_GHC) | AHCI_GHC_IE);
+	return;
+
+__TERMINAL:  //Stay in polling mode.
+	for(nDisk = 0;nDisk < AhciHba.nDiskNum;nDisk ++)
+	{
+		pDisk = &AhciHba.Disks[nDisk];
+		for(i = 0;i < 32;i ++)
+		{
+			if(pDisk->hSlotEvent[i])
+			{
+				DestroyEvent(pDisk->hSlotEvent[i]);
+				pDisk->hSlotEvent[i] = NULL;
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,139 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : ahci.h
+//    Module Funciton           :
+//                                AHCI(Serial ATA) host controller driver,
+//                                disks attached to AHCI controller are served
+//                                by IDE hard disk driver through it.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#ifndef __AHCI_H__
+#define __AHCI_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Class code of AHCI controller,class,sub-class and programming interface.
+#define AHCI_PCI_CLASS              0x010601
+
+//Generic host control registers.
+#define AHCI_HBA_CAP                0x00
+#define AHCI_HBA_GHC                0x04
+#define AHCI_HBA_IS                 0x08
+#define AHCI_HBA_PI                 0x0C
+
+#define AHCI_CAP_SNCQ               (1 << 30)   //Native command queuing.
+#define AHCI_CAP_NCS(cap)           ((((cap) >> 8) & 0x1F) + 1)  //Command slots.
+#define AHCI_GHC_IE                 (1 << 1)
+#define AHCI_GHC_AE                 (1 << 31)
+
+//Port registers,port x's registers start at 0x100 + x * 0x80.
+#define AHCI_PORT_BASE(port)        (0x100 + (port) * 0x80)
+#define AHCI_PxCLB                  0x00
+#define AHCI_PxCLBU                 0x04
+#define AHCI_PxFB                   0x08
+#define AHCI_PxFBU                  0x0C
+#define AHCI_PxIS                   0x10
+#define AHCI_PxIE                   0x14
+#define AHCI_PxCMD                  0x18
+#define AHCI_PxTFD                  0x20
+#define AHCI_PxSIG                  0x24
+#define AHCI_PxSSTS                 0x28
+#define AHCI_PxSERR                 0x30
+#define AHCI_PxSACT                 0x34
+#define AHCI_PxCI                   0x38
+
+#define AHCI_PxCMD_ST               (1 << 0)
+#define AHCI_PxCMD_FRE              (1 << 4)
+#define AHCI_PxCMD_FR               (1 << 14)
+#define AHCI_PxCMD_CR               (1 << 15)
+
+//Interrupt status bits of port,the error bits abort all outstanding commands.
+#define AHCI_PxIS_DHRS              (1 << 0)
+#define AHCI_PxIS_PSS               (1 << 1)
+#define AHCI_PxIS_DSS               (1 << 2)
+#define AHCI_PxIS_SDBS              (1 << 3)
+#define AHCI_PxIS_DPS               (1 << 5)
+#define AHCI_PxIS_IFS               (1 << 27)
+#define AHCI_PxIS_HBDS              (1 << 28)
+#define AHCI_PxIS_HBFS              (1 << 29)
+#define AHCI_PxIS_TFES              (1 << 30)
+#define AHCI_PxIS_ERROR             (AHCI_PxIS_IFS | AHCI_PxIS_HBDS | AHCI_PxIS_HBFS | AHCI_PxIS_TFES)
+#define AHCI_PxIE_DEFAULT           (AHCI_PxIS_DHRS | AHCI_PxIS_PSS | AHCI_PxIS_DSS | \
+	AHCI_PxIS_SDBS | AHCI_PxIS_DPS | AHCI_PxIS_ERROR)
+
+#define AHCI_TFD_ERR                0x01
+#define AHCI_TFD_DRQ                0x08
+#define AHCI_TFD_BSY                0x80
+
+#define AHCI_SSTS_DET_PRESENT       3           //Device present and PHY established.
+#define AHCI_SIG_ATA                0x00000101
+
+//ATA commands used.
+#define AHCI_CMD_IDENTIFY           0xEC
+#define AHCI_CMD_READ_DMA_EXT       0x25
+#define AHCI_CMD_WRITE_DMA_EXT      0x35
+#define AHCI_CMD_READ_FPDMA         0x60        //NCQ read.
+#define AHCI_CMD_WRITE_FPDMA        0x61        //NCQ write.
+
+#define AHCI_FIS_TYPE_H2D           0x27
+
+//Limitations of this driver.
+#define AHCI_MAX_DISKS              4
+#define AHCI_MAX_SECTORS            128         //Sectors one command carries.
+#define AHCI_PRDT_NUM               17          //64K buffer spans 17 pages at most.
+#define AHCI_COMMAND_TIMEOUT        5000        //In million second.
+
+//Command header in command list.
+typedef struct AHCI_CMD_HEADER{
+	DWORD      dwFlags;             //CFL in bit 0-4,W in bit 6,PRDTL in bit 16-31.
+	DWORD      dwPrdbc;             //Bytes transferred.
+	DWORD      dwCtba;              //Command table's physical address.
+	DWORD      dwCtbau;
+	DWORD      dwReserved[4];
+}__AHCI_CMD_HEADER;
+
+#define AHCI_CMDHDR_WRITE           (1 << 6)
+
+//Physical region descriptor.
+typedef struct AHCI_PRD{
+	DWORD      dwDba;
+	DWORD      dwDbau;
+	DWORD      dwReserved;
+	DWORD      dwDbc;               //Byte count - 1,bit 31 requests interrupt.
+}__AHCI_PRD;
+
+//Command table,padded to 512 bytes so an array of them keeps 128 alignment.
+typedef struct AHCI_CMD_TABLE{
+	BYTE       Cfis[64];
+	BYTE       Acmd[16];
+	BYTE       Reserved[48];
+	__AHCI_PRD Prdt[AHCI_PRDT_NUM];
+	BYTE       Pad[512 - 128 - sizeof(__AHCI_PRD) * AHCI_PRDT_NUM];
+}__AHCI_CMD_TABLE;
+
+//Probe AHCI controller and the disks attached to it.
+BOOL AhciInitialize(void);
+
+//How many disks are found.
+int AhciGetDiskNum(void);
+
+//Read or write sectors of one disk.
+BOOL AhciTransfer(int nDisk,BOOL bWrite,DWORD dwStartSector,DWORD dwSectorNum,BYTE* pBuffer);
+
+//Switch command completion from polling to interrupt.
+VOID AhciEnableInterrupt(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__AHCI_H__
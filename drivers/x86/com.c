@@ -110,16 +110,26 @@ static VOID WBIntHandler(__COM_CONTROL_BLOCK* pCtrlBlock)
          {
                    if(pCtrlBlock->nWrittingPtr == pCtrlBlock->nWrittingSize)  //Send over.
                    {
-                            //Mark the DRCB is processed successfully.
-                            pCtrlBlock->pCurrWritting->dwStatus = DRCB_STATUS_SUCCESS;
                             //Delete this DRCB from pending writting queue.
                             pCtrlBlock->pWrittingList = pCtrlBlock->pWrittingList->lpNext;
                             if(NULL == pCtrlBlock->pWrittingList)  //No pending DRCB object.
                             {
                                      pCtrlBlock->pWrittingListTail = NULL;
                             }
-                            //Wake up the kernel thread that is waiting for writting completion.
-                            pCtrlBlock->pCurrWritting->OnCompletion((__COMMON_OBJECT*)(pCtrlBlock->pCurrWritting));
+                            if(pCtrlBlock->pCurrWritting->dwDrcbFlags & DRCB_FLAG_ASYNC)
+                            {
+                                     //Overlapped request,nobody is waiting in ComDeviceWrite,
+                                     //complete it through I/O manager.
+                                     IOCompleteRequest(pCtrlBlock->pCurrWritting,DRCB_STATUS_SUCCESS,
+                                              pCtrlBlock->pCurrWritting->dwInputLen);
+                            }
+                            else
+                            {
+                                     //Mark the DRCB is processed successfully.
+                                     pCtrlBlock->pCurrWritting->dwStatus = DRCB_STATUS_SUCCESS;
+                                     //Wake up the kernel thread that is waiting for writting completion.
+                                     pCtrlBlock->pCurrWritting->OnCompletion((__COMMON_OBJECT*)(pCtrlBlock->pCurrWritting));
+                            }
                    }
                    else
                    {
@@ -396,6 +406,11 @@ static DWORD ComDeviceWrite(__COMMON_OBJECT* lpDriver,__COMMON_OBJECT* lpDevice,
          {
                    goto __TERMINAL;
          }
+         //Overlapped request is pended and completed by WBE interrupt handler.
+         if(lpDrcb->dwDrcbFlags & DRCB_FLAG_ASYNC)
+         {
+                   lpDrcb->dwStatus = DRCB_STATUS_PENDING;
+         }
          //Queue the request.
          __ENTER_CRITICAL_SECTION(NULL,dwFlags);
          if(NULL == pCtrlBlock->pWrittingListTail)  //The first DRCB.
@@ -423,6 +438,10 @@ static DWORD ComDeviceWrite(__COMMON_OBJECT* lpDriver,__COMMON_OBJECT* lpDevice,
                    lpDrcb->lpNext = NULL;
          }
 		 __LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+         if(lpDrcb->dwDrcbFlags & DRCB_FLAG_ASYNC)  //Caller does not wait.
+         {
+                   goto __TERMINAL;
+         }
          //Wait for the operation to finish.
          switch(lpDrcb->WaitForCompletion((__COMMON_OBJECT*)lpDrcb))
          {
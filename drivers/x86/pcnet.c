@@ -101,20 +101,22 @@ static void pcnet_enable_rint(pcnet_priv_t* dev, BOOL bEnable)
 
 	if (bEnable)
 	{
-		csr0 = pcnet_read_csr(dev, 0);
-		//Set IENA bits of CSR0,to enable interrupt.
-		csr0 |= (1 << 6);
+		//Set IENA bits of CSR0,to enable interrupt.Other bits are not written
+		//back,since it would clear pending interrupts.
+		csr0 = (1 << 6);
 		pcnet_write_csr(dev, 0, csr0);
 		//Clear RINTM bit in interrupt mask register.
 		csr3 = pcnet_read_csr(dev, 3);
 		csr3 &= (~(1 << 10));
 		pcnet_write_csr(dev, 3, csr3);
+		dev->rx_masked = 0;
 	}
 	else  //Shoud disable the RINT interrupt.
 	{
 		csr3 = pcnet_read_csr(dev, 3);
 		csr3 |= (1 << 10);
 		pcnet_write_csr(dev, 3,csr3);
+		dev->rx_masked = 1;
 	}
 	return;
 }
@@ -169,31 +171,32 @@ static void pcnet_enable_idint(pcnet_priv_t* dev, BOOL bEnable)
 	return;
 }
 
-//Acknowledge rint interrupt.
-static void pcnet_ack_rint(pcnet_priv_t* dev)
+//Acknowledge one interrupt bit of CSR0.Interrupt bits are write-1-to-clear,so
+//only the bit acknowledged is written besides IENA,writting back other bits
+//would clear pending interrupts,and clearing IENA disables all interrupts.
+static void pcnet_ack_csr0(pcnet_priv_t* dev, __U16 bit)
 {
 	__U16 csr0 = 0;
 	csr0 = pcnet_read_csr(dev, 0);
-	csr0 |= (1 << 10);
-	pcnet_write_csr(dev, 0, csr0);
+	pcnet_write_csr(dev, 0, (csr0 & 0x0040) | bit);
+}
+
+//Acknowledge rint interrupt.
+static void pcnet_ack_rint(pcnet_priv_t* dev)
+{
+	pcnet_ack_csr0(dev, (1 << 10));
 }
 
 //Acknowledge sint interrupt.
 static void pcnet_ack_sint(pcnet_priv_t* dev)
 {
-	__U16 csr0 = 0;
-	csr0 = pcnet_read_csr(dev, 0);
-	csr0 |= (1 << 9);
-	pcnet_write_csr(dev, 0, csr0);
+	pcnet_ack_csr0(dev, (1 << 9));
 }
 
 //Acknowledge idint interrupt.
 static void pcnet_ack_idint(pcnet_priv_t* dev)
 {
-	__U16 csr0 = 0;
-	csr0 = pcnet_read_csr(dev, 0);
-	csr0 |= (1 << 8);
-	pcnet_write_csr(dev, 0, csr0);
+	pcnet_ack_csr0(dev, (1 << 8));
 }
 
 //Enable all PCNet NIC's interrupt,only rint,sint,idint are enavbled.This function
@@ -398,50 +401,37 @@ static BOOL ProbePCNetNICs()
 	return bResult;
 }
 
-static unsigned char* pcnet_recv(pcnet_priv_t *dev, int* pPktLen);
+static __ETHERNET_BUFFER* pcnet_recv(pcnet_priv_t *dev);
+static void pcnet_tx_reclaim(pcnet_priv_t* dev);
 
-//Handle the Rx interrupt.It requests a ethernet buffer object,copy the
-//received data into it,and post it to Ethernet Core Thread.
+//Handle the Rx interrupt.Rx interrupt is masked and the ethernet core thread
+//is scheduled to poll Rx ring,it's enabled again after the ring is drained,
+//so only one interrupt is raised for a burst of frames.
 static VOID RxInterruptHandler(pcnet_priv_t* priv)
 {
 	__ETHERNET_BUFFER* pEthBuff = NULL;
-	int            len = 0;
 	__ETHERNET_INTERFACE* pEthInt = priv->pEthInt;
-	unsigned char* buf = NULL;
 
 	if (NULL == pEthInt)
 	{
 		BUG();
 	}
 
-	buf = pcnet_recv(priv, &len);
-	if (!buf)  //No packet received.
+	pcnet_enable_rint(priv, FALSE);
+	if (EthernetManager.ScheduleRxPoll(pEthInt))
 	{
 		return;
 	}
 
-	//Received a pakcet,post to kernel.
-	if (len > 0)
+	//Fetch all received frames and post them to Ethernet Core Thread,if
+	//can not schedule polling.
+	while (TRUE)
 	{
-		pEthBuff = EthernetManager.CreateEthernetBuffer(len);
-		if (NULL == pEthBuff)
+		pEthBuff = pcnet_recv(priv);
+		if (NULL == pEthBuff)  //No packet received.
 		{
-			_hx_printf("  %s: create ethernet buffer failed.\r\n", __func__);
 			return;
 		}
-		else  //Copy the received data to Ethernet Buffer object.
-		{
-			memcpy(pEthBuff->Buffer, buf, len);
-			pEthBuff->act_length = len;
-			//Fill the MAC addresses and packet types.
-			memcpy(pEthBuff->dstMAC, buf, ETH_MAC_LEN);
-			buf += ETH_MAC_LEN;
-			memcpy(pEthBuff->srcMAC, buf, ETH_MAC_LEN);
-			buf += ETH_MAC_LEN;
-			pEthBuff->frame_type = _hx_ntohs(*(__u16*)buf);
-			pEthBuff->pEthernetInterface = pEthInt;
-			pEthBuff->buff_status = ETHERNET_BUFFER_STATUS_INITIALIZED;
-		}
 		if (!EthernetManager.PostFrame(pEthInt, pEthBuff))
 		{
 			//Must destroy the ethernet buffer object,since it may lead memory leak.
@@ -468,8 +458,19 @@ static BOOL PCNetInterrupt(LPVOID lpESP, LPVOID lpParam)
 		if (csr0 & (1 << 9)) //TINT.
 		{
 			pcnet_ack_sint(dev);
+			pcnet_tx_reclaim(dev);
+			//Send the frames deferred since Tx ring was full.
+			if (dev->pEthInt)
+			{
+				EthernetManager.TxWakeup(dev->pEthInt);
+			}
 			continue;
 		}
+		//RINT is left pending when masked,so it's raised once enabled again.
+		if (dev->rx_masked)
+		{
+			csr0 &= ~(1 << 10);
+		}
 		if (csr0 & (1 << 10)) //RINT.
 		{
 			//Notify the ethernet core thread to launch a polling immediately.
@@ -478,8 +479,8 @@ static BOOL PCNetInterrupt(LPVOID lpESP, LPVOID lpParam)
 			pcnet_ack_rint(dev);
 			continue;
 		}
-		//Acknowledge all other interrupts.
-		pcnet_write_csr(dev, 0, csr0);
+		//Acknowledge all other interrupts,BABL,CERR,MISS and MERR.
+		pcnet_ack_csr0(dev, csr0 & 0x7800);
 		_hx_printf("Warning: Unhandled interrupt in PCNet NIC driver,CSR0 = 0x%X.\r\n", csr0);
 	}
 	return bResult;
@@ -616,7 +617,8 @@ static BOOL InitPCNetNIC(pcnet_priv_t* dev)
 	*/
 	dev->cur_rx = 0;
 	for (i = 0; i < RX_RING_SIZE; i++) {
-		uc->rx_ring[i].base = (__U32)PCI_TO_MEM_LE(dev, (*dev->rx_buf)[i]);
+		dev->rx_slot[i] = (*dev->rx_buf)[i];
+		uc->rx_ring[i].base = (__U32)PCI_TO_MEM_LE(dev, dev->rx_slot[i]);
 		uc->rx_ring[i].buf_length = cpu_to_le16(-PKT_BUF_SZ);
 		uc->rx_ring[i].status = cpu_to_le16(0x8000);
 #ifdef __PCNET_DEBUG
@@ -626,14 +628,25 @@ static BOOL InitPCNetNIC(pcnet_priv_t* dev)
 #endif
 	}
 	
+	dev->rx_spare_num = 0;
+	for (i = RX_RING_SIZE; i < RX_BUF_NUM; i++) {
+		dev->rx_spare[dev->rx_spare_num++] = (*dev->rx_buf)[i];
+	}
+
 	/*
 	* Initialize the Tx ring. The Tx buffer address is filled in as
 	* needed, but we do need to clear the upper ownership bit.
 	*/
 	dev->cur_tx = 0;
+	dev->dirty_tx = 0;
+	dev->tx_free = TX_RING_SIZE;
+	dev->tx_sendbuf_busy = 0;
+	dev->rx_masked = 0;
 	for (i = 0; i < TX_RING_SIZE; i++) {
 		uc->tx_ring[i].base = 0;
 		uc->tx_ring[i].status = 0;
+		dev->tx_done[i] = NULL;
+		dev->tx_param[i] = NULL;
 	}
 
 	/*
@@ -728,64 +741,152 @@ static BOOL InitPCNetNICs()
 	return bResult;
 }
 
-//Send a packet through the PCNet NIC.
-static int pcnet_send(pcnet_priv_t *dev, void *packet, int pkt_len)
+//Reclaim the Tx descriptors NIC has finished,and notify the owner of
+//each frame sent out.Must be called with interrupt disabled.
+static void pcnet_tx_reclaim(pcnet_priv_t* dev)
 {
-	int i, status;
-	__U16 csr0;
-	struct pcnet_tx_head *entry = &dev->uc->tx_ring[dev->cur_tx];
-
-#ifdef __PCNET_DEBUG
-	_hx_printf("Tx%d: %d bytes from 0x%p.\r\n", dev->cur_tx, pkt_len,packet);
-#endif
-
-	//Synchronize cache to memory.
-	__FLUSH_CACHE(packet, pkt_len, CACHE_FLUSH_WRITEBACK);
+	struct pcnet_tx_head* entry;
+	__U16 status;
+	int index;
 
-	/* Wait for completion by testing the OWN bit */
-	for (i = 1000; i > 0; i--) {
+	while (dev->tx_free < TX_RING_SIZE)
+	{
+		index = dev->dirty_tx;
+		entry = &dev->uc->tx_ring[index];
 #if !defined(__CFG_SYS_VMM)
-		__FLUSH_CACHE(&entry->status, sizeof(entry_status), CACHE_FLUSH_INVALIDATE);
+		__FLUSH_CACHE(&entry->status, sizeof(entry->status), CACHE_FLUSH_INVALIDATE);
 #endif
 		status = __readw(&entry->status);
-		if ((status & 0x8000) == 0)
+		if (status & 0x8000)  //Still owned by NIC.
 		{
 			break;
 		}
-		__MicroDelay(100);
-#ifdef __PCNET_DEBUG
-		_hx_printf(".");
-#endif
+		if (status & 0x4000)
+		{
+			dev->tx_errors++;
+		}
+		if (dev->tx_done[index])
+		{
+			dev->tx_done[index](dev->tx_param[index]);
+			dev->tx_done[index] = NULL;
+		}
+		dev->tx_free++;
+		if (++dev->dirty_tx >= TX_RING_SIZE)
+		{
+			dev->dirty_tx = 0;
+		}
 	}
-	if (i <= 0) {
-		_hx_printf("PCNet: TIMEOUT: Tx%d failed (status = 0x%x).\r\n",dev->cur_tx, status);
-		pkt_len = 0;
-		goto failure;
+}
+
+//Queue a frame gathered from fragments into Tx ring,one descriptor per
+//fragment,TxDone is called when it's sent out.
+//Return FALSE if there is no enough free descriptors.
+static BOOL pcnet_xmit(pcnet_priv_t* dev, __ETH_TX_FRAG* pFrags, int nFragNum,
+	__ETH_TX_DONE TxDone, LPVOID pTxParam)
+{
+	struct pcnet_tx_head *entry, *first;
+	__U16 csr0, status;
+	int i, index;
+	DWORD dwFlags;
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	pcnet_tx_reclaim(dev);
+	if (dev->tx_free < nFragNum)
+	{
+		dev->tx_ring_full++;
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		return FALSE;
 	}
 
 	/*
 	* Setup Tx ring. Caution: the write order is important here,
-	* set the status with the "ownership" bits last.
+	* the first descriptor's "ownership" bit is set after all others.
 	*/
-	__writew(-pkt_len, &entry->length);
-	__writel(0, &entry->misc);
-	__writel(PCI_TO_MEM_LE(dev, packet), (unsigned long)&entry->base);
-	__writew(0x8300, &entry->status);
+	first = &dev->uc->tx_ring[dev->cur_tx];
+	for (i = 0; i < nFragNum; i++)
+	{
+#ifdef __PCNET_DEBUG
+		_hx_printf("Tx%d: %d bytes from 0x%p.\r\n", dev->cur_tx, pFrags[i].length, pFrags[i].pData);
+#endif
+		index = dev->cur_tx;
+		entry = &dev->uc->tx_ring[index];
+		//Synchronize cache to memory.
+		__FLUSH_CACHE(pFrags[i].pData, pFrags[i].length, CACHE_FLUSH_WRITEBACK);
+		__writew(-pFrags[i].length, &entry->length);
+		__writel(0, &entry->misc);
+		__writel(PCI_TO_MEM_LE(dev, pFrags[i].pData), (unsigned long)&entry->base);
+		status = (0 == i) ? 0x0200 : 0x8000;  //STP,or OWN for following ones.
+		dev->tx_done[index] = NULL;
+		if (nFragNum - 1 == i)
+		{
+			status |= 0x0100;  //ENP.
+			dev->tx_done[index] = TxDone;
+			dev->tx_param[index] = pTxParam;
+		}
+		__writew(status, &entry->status);
 #if !defined(__CFG_SYS_VMM)
-	__FLUSH_CACHE(&entry, sizeof(entry), CACHE_FLUSH_WRITEBACK);
+		__FLUSH_CACHE(entry, sizeof(*entry), CACHE_FLUSH_WRITEBACK);
 #endif
-	
-	/* Trigger an immediate send poll. We should retrieve the CSR0 register and then
-	   Set the poll demand bit instead by writting 0x0008 directly,which will lead
-	   the NIC disabling all interrupts. */
+		if (++dev->cur_tx >= TX_RING_SIZE)
+		{
+			dev->cur_tx = 0;
+		}
+	}
+	dev->tx_free -= nFragNum;
+	__writew(__readw(&first->status) | 0x8000, &first->status);
+#if !defined(__CFG_SYS_VMM)
+	__FLUSH_CACHE(first, sizeof(*first), CACHE_FLUSH_WRITEBACK);
+#endif
+
+	/* Trigger an immediate send poll. Only IENA is kept besides TDMD,writting
+	   back other bits of CSR0 would clear pending interrupts,and writting 0x0008
+	   directly will lead the NIC disabling all interrupts. */
 	csr0 = pcnet_read_csr(dev, 0);
-	csr0 |= 0x0008;
-	pcnet_write_csr(dev, 0, csr0);
+	pcnet_write_csr(dev, 0, (csr0 & 0x0040) | 0x0008);
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	return TRUE;
+}
+
+//Completion routine of the frame sent from interface's send buffer.
+static VOID pcnet_sendbuf_done(LPVOID pTxParam)
+{
+	((pcnet_priv_t*)pTxParam)->tx_sendbuf_busy = 0;
+}
+
+//Send a packet through the PCNet NIC,the packet resides in interface's
+//send buffer,so the previous one must be finished before it.
+static int pcnet_send(pcnet_priv_t *dev, void *packet, int pkt_len)
+{
+	__ETH_TX_FRAG frag;
+	DWORD dwFlags;
+	int i;
+
+	/* Wait for completion of the previous one */
+	for (i = 1000; i > 0; i--) {
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		pcnet_tx_reclaim(dev);
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		if (!dev->tx_sendbuf_busy)
+		{
+			break;
+		}
+		__MicroDelay(100);
+#ifdef __PCNET_DEBUG
+		_hx_printf(".");
+#endif
+	}
+	if (i <= 0) {
+		_hx_printf("PCNet: TIMEOUT: Tx%d failed.\r\n", dev->dirty_tx);
+		return 0;
+	}
 
-failure:
-	if (++dev->cur_tx >= TX_RING_SIZE)
+	frag.pData = (__u8*)packet;
+	frag.length = pkt_len;
+	dev->tx_sendbuf_busy = 1;
+	if (!pcnet_xmit(dev, &frag, 1, pcnet_sendbuf_done, dev))
 	{
-		dev->cur_tx = 0;
+		dev->tx_sendbuf_busy = 0;
+		return 0;
 	}
 #ifdef __PCNET_DEBUG
 	_hx_printf("Send done.\r\n");
@@ -793,11 +894,92 @@ failure:
 	return pkt_len;
 }
 
+//Give a loaned receiving buffer back to spare list,it's called when the
+//Ethernet Buffer object holding it is destroyed.
+static VOID pcnet_free_frame(__ETHERNET_BUFFER* pEthBuff)
+{
+	pcnet_priv_t* dev = (pcnet_priv_t*)pEthBuff->pFreeParam;
+	DWORD dwFlags;
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	if (dev->rx_spare_num >= PCNET_RX_SPARE_BUFFERS)
+	{
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		BUG();
+		return;
+	}
+	dev->rx_spare[dev->rx_spare_num++] = pEthBuff->pLoanFrame;
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+}
+
+//Create Ethernet Buffer object for a frame in Rx ring,the descriptor must
+//still be owned by host.Short frames are copied,and the receiving buffer of
+//a long frame is loaned to upper layer,a spare one takes it's place in ring.
+//It falls back to copy when run out of spare buffers.
+static __ETHERNET_BUFFER* pcnet_build_frame(pcnet_priv_t* dev,
+	struct pcnet_rx_head* entry,
+	unsigned char* buf, int pkt_len)
+{
+	__ETHERNET_BUFFER* pEthBuff = NULL;
+	unsigned char* spare = NULL;
+	DWORD dwFlags;
+
+	if (pkt_len >= ETH_RX_COPYBREAK)
+	{
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		if (dev->rx_spare_num > 0)
+		{
+			spare = dev->rx_spare[--dev->rx_spare_num];
+		}
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	}
+	if (spare)
+	{
+		pEthBuff = EthernetManager.CreateLoanedBuffer(dev->pEthInt, buf, pkt_len,
+			pcnet_free_frame, dev);
+		if (pEthBuff)
+		{
+			dev->rx_slot[dev->cur_rx] = spare;
+			__writel(PCI_TO_MEM_LE(dev, spare), (unsigned long)&entry->base);
+			return pEthBuff;
+		}
+		//Put the spare back and try to copy.
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		dev->rx_spare[dev->rx_spare_num++] = spare;
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	}
+
+	pEthBuff = EthernetManager.CreateEthernetBuffer(dev->pEthInt, pkt_len);
+	if (NULL == pEthBuff)
+	{
+		_hx_printf("  %s: create ethernet buffer failed.\r\n", __func__);
+		return NULL;
+	}
+	if (pkt_len > pEthBuff->buff_length)
+	{
+		EthernetManager.DestroyEthernetBuffer(pEthBuff);
+		return NULL;
+	}
+	memcpy(pEthBuff->Buffer, buf, pkt_len);
+	pEthBuff->act_length = pkt_len;
+	//Fill the MAC addresses and packet types.
+	memcpy(pEthBuff->dstMAC, buf, ETH_MAC_LEN);
+	buf += ETH_MAC_LEN;
+	memcpy(pEthBuff->srcMAC, buf, ETH_MAC_LEN);
+	buf += ETH_MAC_LEN;
+	pEthBuff->frame_type = _hx_ntohs(*(__u16*)buf);
+	pEthBuff->pEthernetInterface = dev->pEthInt;
+	pEthBuff->buff_status = ETHERNET_BUFFER_STATUS_INITIALIZED;
+	return pEthBuff;
+}
+
 //Receive a packet from PCNet NIC,it maybe called by the polling process
-//of HelloX's network framework.
-static unsigned char* pcnet_recv(pcnet_priv_t *dev,int* pPktLen)
+//of HelloX's network framework or Rx interrupt handler.
+//The descriptor is given back to NIC only after the frame is consumed.
+static __ETHERNET_BUFFER* pcnet_recv(pcnet_priv_t *dev)
 {
 	struct pcnet_rx_head *entry;
+	__ETHERNET_BUFFER* pEthBuff = NULL;
 	unsigned char *buf = NULL;
 	int pkt_len = 0;
 	__U16 status, err_status;
@@ -841,13 +1023,13 @@ static unsigned char* pcnet_recv(pcnet_priv_t *dev,int* pPktLen)
 						dev->cur_rx, pkt_len);
 				}
 				else {
-					buf = (*dev->rx_buf)[dev->cur_rx];
+					buf = dev->rx_slot[dev->cur_rx];
 					__FLUSH_CACHE(buf, buf + pkt_len, CACHE_FLUSH_INVALIDATE);
-					//NetReceive(buf, pkt_len);
 #ifdef __PCNET_DEBUG
 					_hx_printf("PCNet: Rx%d: %d bytes from 0x%p\r\n",
 						dev->cur_rx, pkt_len, buf);
 #endif
+					pEthBuff = pcnet_build_frame(dev, entry, buf, pkt_len);
 				}
 		}
 		status |= 0x8000;
@@ -855,17 +1037,13 @@ static unsigned char* pcnet_recv(pcnet_priv_t *dev,int* pPktLen)
         if (++dev->cur_rx >= RX_RING_SIZE)
 				dev->cur_rx = 0;
 
-		if (buf)  //Received a packet,return it.
+		if (pEthBuff)  //Received a packet,return it.
 		{
 			goto __TERMINAL;
 		}
 	}
 __TERMINAL:
-	if (pPktLen)
-	{
-		*pPktLen = pkt_len;  //Return the packet's length.
-	}
-	return buf;
+	return pEthBuff;
 }
 
 //Initializer of the ethernet interface,it will be called by HelloX's ethernet framework.
@@ -914,6 +1092,48 @@ __TERMINAL:
 	return bResult;
 }
 
+//Scatter-gather sending operation,the fragments are queued into Tx ring
+//directly without copying.PCnet has no offload capability,so pOffload is
+//always NULL.
+static BOOL Ethernet_SendFrags(__ETHERNET_INTERFACE* pInt, __ETH_TX_FRAG* pFrags, int nFragNum,
+	__ETH_TX_OFFLOAD* pOffload, __ETH_TX_DONE TxDone, LPVOID pTxParam)
+{
+	pcnet_priv_t* dev = NULL;
+
+	if ((NULL == pInt) || pOffload)
+	{
+		return FALSE;
+	}
+	dev = (pcnet_priv_t*)pInt->pIntExtension;
+	if (NULL == dev)
+	{
+		return FALSE;
+	}
+	return pcnet_xmit(dev, pFrags, nFragNum, TxDone, pTxParam);
+}
+
+//Enable or disable Rx interrupt,called by ethernet core thread when Rx
+//polling is over.
+static BOOL Ethernet_RxIntControl(__ETHERNET_INTERFACE* pInt, BOOL bEnable)
+{
+	pcnet_priv_t* dev = NULL;
+	DWORD dwFlags;
+
+	if (NULL == pInt)
+	{
+		return FALSE;
+	}
+	dev = (pcnet_priv_t*)pInt->pIntExtension;
+	if (NULL == dev)
+	{
+		return FALSE;
+	}
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	pcnet_enable_rint(dev, bEnable);
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	return TRUE;
+}
+
 /**
 *
 * Receive a frame from ehternet link.
@@ -924,9 +1144,8 @@ __TERMINAL:
 static __ETHERNET_BUFFER* Ethernet_RecvFrame(__ETHERNET_INTERFACE* pInt)
 {
 	__ETHERNET_BUFFER* pEthBuff = NULL;
-	int            len = 0;
 	pcnet_priv_t*  dev = NULL;
-	unsigned char* buf = NULL;
+	DWORD dwFlags;
 
 	if (NULL == pInt)
 	{
@@ -938,35 +1157,10 @@ static __ETHERNET_BUFFER* Ethernet_RecvFrame(__ETHERNET_INTERFACE* pInt)
 		return NULL;
 	}
 
-	buf = pcnet_recv(dev, &len);
-	if (!buf)  //No packet received.
-	{
-		return NULL;
-	}
-
-	//Received a pakcet,delivery it to IP stack.
-	if (len > 0)
-	{
-		pEthBuff = EthernetManager.CreateEthernetBuffer(len);
-		if (NULL == pEthBuff)
-		{
-			_hx_printf("  %s: create ethernet buffer failed.\r\n", __func__);
-			return NULL;
-		}
-		else  //Copy the received data to Ethernet Buffer object.
-		{
-			memcpy(pEthBuff->Buffer, buf, len);
-			pEthBuff->act_length = len;
-			//Fill the MAC addresses and packet types.
-			memcpy(pEthBuff->dstMAC, buf, ETH_MAC_LEN);
-			buf += ETH_MAC_LEN;
-			memcpy(pEthBuff->srcMAC, buf, ETH_MAC_LEN);
-			buf += ETH_MAC_LEN;
-			pEthBuff->frame_type = _hx_ntohs(*(__u16*)buf);
-			pEthBuff->pEthernetInterface = pInt;
-			pEthBuff->buff_status = ETHERNET_BUFFER_STATUS_INITIALIZED;
-		}
-	}
+	//Rx ring is also accessed by interrupt handler.
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	pEthBuff = pcnet_recv(dev);
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
 	return pEthBuff;
 }
 
@@ -1047,6 +1241,11 @@ BOOL PCNet_Drv_Initialize(LPVOID pData)
 			//Mark the structure as unavailable,it will be released later.
 			dev->available = 0;
 		}
+		else
+		{
+			dev->pEthInt->SendFrags = Ethernet_SendFrags;
+			dev->pEthInt->RxIntControl = Ethernet_RxIntControl;
+		}
 		//Process next one.
 		dev = dev->next;
 		index ++;
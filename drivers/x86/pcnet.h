@@ -57,7 +57,7 @@
 //Set the number of Tx and Rx buffers, using Log_2(# buffers).
 //Reasonable default values are 4 Tx buffers, and 16 Rx buffers.
 //That translates to 2 (4 == 2^^2) and 4 (16 == 2^^4).
-#define PCNET_LOG_TX_BUFFERS    0
+#define PCNET_LOG_TX_BUFFERS    4
 #define PCNET_LOG_RX_BUFFERS    2
 
 #define TX_RING_SIZE (1 << (PCNET_LOG_TX_BUFFERS))
@@ -69,6 +69,10 @@
 //Default packet buffer's size,1500 plus ethernet level headers.
 #define PKT_BUF_SZ              1544
 
+//Spare receiving buffers,used to replace the buffers loaned to upper layer.
+#define PCNET_RX_SPARE_BUFFERS  16
+#define RX_BUF_NUM              (RX_RING_SIZE + PCNET_RX_SPARE_BUFFERS)
+
 /* The PCNET Rx and Tx ring descriptors. */
 struct pcnet_rx_head {
 	__U32 base;
@@ -112,10 +116,27 @@ typedef struct pcnet_priv {
 	struct pcnet_uncached_priv *uc_unalign;
 	struct pcnet_priv* next;
 	/* Receive Buffer space */
-	unsigned char(*rx_buf)[RX_RING_SIZE][PKT_BUF_SZ + 4];
-	unsigned char(*rx_buf_unalign)[RX_RING_SIZE][PKT_BUF_SZ + 4];
+	unsigned char(*rx_buf)[RX_BUF_NUM][PKT_BUF_SZ + 4];
+	unsigned char(*rx_buf_unalign)[RX_BUF_NUM][PKT_BUF_SZ + 4];
+	/* Buffer each Rx descriptor currently points to. */
+	unsigned char* rx_slot[RX_RING_SIZE];
+	/* Spare buffers not in ring nor loaned. */
+	unsigned char* rx_spare[PCNET_RX_SPARE_BUFFERS];
+	int rx_spare_num;
 	int cur_rx;
 	int cur_tx;
+	/* Oldest Tx descriptor not reclaimed yet,and free descriptors. */
+	int dirty_tx;
+	int tx_free;
+	/* Completion routine of the frame ends at each Tx descriptor. */
+	__ETH_TX_DONE tx_done[TX_RING_SIZE];
+	LPVOID tx_param[TX_RING_SIZE];
+	/* Set when interface's send buffer is in Tx ring. */
+	volatile int tx_sendbuf_busy;
+	/* Rx interrupt is masked while Rx ring is polled. */
+	int rx_masked;
+	unsigned long tx_errors;
+	unsigned long tx_ring_full;
 	/* Hardware resources of the NIC. */
 	__U16 ioBase;
 	int   intVector;
@@ -202,12 +202,108 @@ __TERMINAL:
 	return bResult;
 }
 
-//Receive a frame from link into device private data structure's buffer,and return
-//the buffer to caller.
-static char* RTL8111_Recv(rtl8111_priv_t* priv, int* len)
+//Give a loaned Rx buffer back to spare list,it's called when the Ethernet
+//Buffer object holding it is destroyed.
+static VOID RTL8111_FreeFrame(__ETHERNET_BUFFER* pEthBuff)
+{
+	rtl8111_priv_t* priv = (rtl8111_priv_t*)pEthBuff->pFreeParam;
+	DWORD dwFlags;
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	if (priv->rx_spare_num >= NUM_RX_SPARE)
+	{
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		BUG();
+		return;
+	}
+	priv->rx_spare_dma_addr[priv->rx_spare_num++] = (dma_addr_t)pEthBuff->pLoanFrame;
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+}
+
+//Create Ethernet Buffer object for a received frame,the Rx descriptor must
+//still be owned by host.Short frames are copied,and the Rx buffer of a long
+//frame is loaned to upper layer,a spare one takes it's place in Rx ring.
+//It falls back to copy when run out of spare buffers.
+static __ETHERNET_BUFFER* RTL8111_BuildFrame(rtl8111_priv_t* priv, int cur_rx,
+	unsigned char* buf, int len)
+{
+	__ETHERNET_BUFFER* pEthBuff = NULL;
+	dma_addr_t spare = 0;
+	DWORD dwFlags;
+
+	if (len >= ETH_RX_COPYBREAK)
+	{
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		if (priv->rx_spare_num > 0)
+		{
+			spare = priv->rx_spare_dma_addr[--priv->rx_spare_num];
+		}
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	}
+	if (spare)
+	{
+		pEthBuff = EthernetManager.CreateLoanedBuffer(priv->pEthInt, buf, len,
+			RTL8111_FreeFrame, priv);
+		if (pEthBuff)
+		{
+			priv->rx_skbuff_dma_addr[cur_rx] = spare;
+			priv->RxDescArray[cur_rx].buf_addr = cpu_to_le32(spare);
+			return pEthBuff;
+		}
+		//Put the spare back and try to copy.
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		priv->rx_spare_dma_addr[priv->rx_spare_num++] = spare;
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	}
+
+	pEthBuff = EthernetManager.CreateEthernetBuffer(priv->pEthInt, len);
+	if (NULL == pEthBuff)
+	{
+		_rtl8111_debug("  %s: create ethernet buffer failed.\r\n", __func__);
+		return NULL;
+	}
+	if (len > pEthBuff->buff_length)
+	{
+		EthernetManager.DestroyEthernetBuffer(pEthBuff);
+		return NULL;
+	}
+	memcpy(pEthBuff->Buffer, buf, len);
+	pEthBuff->act_length = len;
+	//Fill the MAC addresses and packet types.
+	memcpy(pEthBuff->dstMAC, buf, ETH_MAC_LEN);
+	buf += ETH_MAC_LEN;
+	memcpy(pEthBuff->srcMAC, buf, ETH_MAC_LEN);
+	buf += ETH_MAC_LEN;
+	pEthBuff->frame_type = _hx_ntohs(*(__u16*)buf);
+	pEthBuff->pEthernetInterface = priv->pEthInt;
+	pEthBuff->buff_status = ETHERNET_BUFFER_STATUS_INITIALIZED;
+	return pEthBuff;
+}
+
+//Check result of Rx checksum offload,only unfragmented TCP and UDP packets
+//are checked by NIC.
+static DWORD RTL8111_RxCsum(__u32 status)
+{
+	__u32 proto = status & RxProtoMask;
+
+	if (status & RxIPF)
+	{
+		return 0;
+	}
+	if (((RxProtoTCP == proto) && !(status & RxTCPF)) ||
+		((RxProtoUDP == proto) && !(status & RxUDPF)))
+	{
+		return ETH_RX_CSUM_OK;
+	}
+	return 0;
+}
+
+//Receive a frame from link and return it in Ethernet Buffer object,the Rx
+//descriptor is given back to NIC only after the frame is consumed.
+static __ETHERNET_BUFFER* RTL8111_Recv(rtl8111_priv_t* priv)
 {
 	unsigned long ioaddr = priv->ioaddr;
-	char*         rtlbuf = NULL;
+	__ETHERNET_BUFFER* pEthBuff = NULL;
 	int           cur_rx;
 	int           pkt_size = 0;
 	int           rxdesc_cnt = 0;
@@ -237,7 +333,11 @@ static char* RTL8111_Recv(rtl8111_priv_t* priv, int* len)
 				pkt_size = priv->rx_pkt_len;
 			}
 
-			rtlbuf = (char*)rxdesc->buf_addr;
+			pEthBuff = RTL8111_BuildFrame(priv, cur_rx, (unsigned char*)rxdesc->buf_addr, pkt_size);
+			if (pEthBuff)
+			{
+				pEthBuff->dwRxOffload = RTL8111_RxCsum(le32_to_cpu(rxdesc->status));
+			}
 			// Update rx descriptor
 			if (cur_rx == (NUM_RX_DESC - 1))
 			{
@@ -257,93 +357,176 @@ static char* RTL8111_Recv(rtl8111_priv_t* priv, int* len)
 		__FLUSH_CACHE(rxdesc, sizeof(struct RxDesc), CACHE_FLUSH_INVALIDATE);
 
 		//only get one rtl111 frame
-		if (rtlbuf)
+		if (pEthBuff)
 		{
-			*len = pkt_size;
 			break;
 		}
 	}
 
 	priv->cur_rx = cur_rx;
-	return rtlbuf;
+	return pEthBuff;
 }
 
-//Send out a frame to net link,return 0 if fail,otherwise no-zero.
-static int RTL8111_Send(rtl8111_priv_t* dev, char* buff, int len)
+static BOOL RTL8111_TX_Interrupt(rtl8111_priv_t* priv);
+
+//Queue a frame gathered from fragments into Tx ring,one descriptor per
+//fragment,TxDone is called when it's sent out.
+//Return FALSE if there is no enough free descriptors.
+static BOOL RTL8111_Xmit(rtl8111_priv_t* priv, __ETH_TX_FRAG* pFrags, int nFragNum,
+	__ETH_TX_OFFLOAD* pOffload, __ETH_TX_DONE TxDone, LPVOID pTxParam)
 {
-	rtl8111_priv_t*  priv = dev;
 	unsigned long    ioaddr = priv->ioaddr;
-	int              entry = priv->cur_tx % NUM_TX_DESC;
-	int              buf_len = 60;
-	dma_addr_t       txbuf_dma_addr = 0;
-
-	//Synchronizing cache content.
-	__FLUSH_CACHE(&priv->TxDescArray[entry], sizeof(struct TxDesc), CACHE_FLUSH_INVALIDATE);
-
-	if ((le32_to_cpu(priv->TxDescArray[entry].status) & OWNbit) == 0)
+	int              entry, first;
+	__u32            status;
+	__u32            opts1 = 0, opts2 = 0;
+	int              i;
+	DWORD            dwFlags;
+
+	//Offload bits are set in all descriptors of the frame,NIC computes IP
+	//checksum too when TCP or UDP checksum is requested.
+	if (pOffload)
 	{
-		if (len <= priv->tx_pkt_len)
+		if (pOffload->dwFlags & ETH_OFFLOAD_TSO)
 		{
-			buf_len = len;
+			opts1 = TxLGSEN | ((__u32)pOffload->mss << TxMSSShift);
+		}
+		else if (RTL8111_TXDESC_V1(priv))
+		{
+			opts1 = TxIPCS |
+				((pOffload->dwFlags & ETH_OFFLOAD_TX_TCPCSUM) ? TxTCPCS : TxUDPCS);
 		}
 		else
 		{
-			//printk("%s: Error -- Tx packet size(%d) > mtu(%d)+14\n", netdev->name, skb->len, netdev->mtu);
-			buf_len = priv->tx_pkt_len;
+			opts2 = TxIPCS_C |
+				((pOffload->dwFlags & ETH_OFFLOAD_TX_TCPCSUM) ? TxTCPCS_C : TxUDPCS_C);
 		}
+	}
 
-		//memcpy((char*)priv->TxDescArray[entry].buf_addr, buff, buf_len);
-		priv->TxDescArray[entry].buf_addr = (__u32)buff;
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	RTL8111_TX_Interrupt(priv);
+	if (NUM_TX_DESC - (priv->cur_tx - priv->dirty_tx) < (unsigned long)nFragNum)
+	{
+		priv->tx_ring_full++;
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		return FALSE;
+	}
+
+	//Ownership of the first descriptor is given to NIC after all others.
+	first = priv->cur_tx % NUM_TX_DESC;
+	for (i = 0; i < nFragNum; i++)
+	{
+		entry = priv->cur_tx % NUM_TX_DESC;
+		priv->TxDescArray[entry].buf_addr = cpu_to_le32((__u32)pFrags[i].pData);
+		priv->TxDescArray[entry].buf_Haddr = 0;
+		priv->TxDescArray[entry].vlan_tag = cpu_to_le32(opts2);
 		//Write back the cache content if necessary.
-		__FLUSH_CACHE((char*)priv->TxDescArray[entry].buf_addr, buf_len, CACHE_FLUSH_WRITEBACK);
+		__FLUSH_CACHE(pFrags[i].pData, pFrags[i].length, CACHE_FLUSH_WRITEBACK);
 
-		if (entry != (NUM_TX_DESC - 1))
+		status = (__u32)pFrags[i].length | opts1;
+		if (0 == i)
 		{
-			priv->TxDescArray[entry].status = cpu_to_le32((OWNbit | FSbit | LSbit) | buf_len);
+			status |= FSbit;
 		}
 		else
 		{
-			priv->TxDescArray[entry].status = cpu_to_le32((OWNbit | EORbit | FSbit | LSbit) | buf_len);
+			status |= OWNbit;
 		}
+		priv->tx_done[entry] = NULL;
+		if (nFragNum - 1 == i)
+		{
+			status |= LSbit;
+			priv->tx_done[entry] = TxDone;
+			priv->tx_param[entry] = pTxParam;
+		}
+		if (entry == (NUM_TX_DESC - 1))
+		{
+			status |= EORbit;
+		}
+		priv->TxDescArray[entry].status = cpu_to_le32(status);
 		//Write back the TxDescriptor content from cache to main memory.
 		__FLUSH_CACHE(&priv->TxDescArray[entry], sizeof(struct TxDesc), CACHE_FLUSH_WRITEBACK);
-
-		//Start to poll.
-		RTL_W8(TxPoll, 0x40);
-
 		priv->cur_tx++;
 	}
-	return len;
+	priv->TxDescArray[first].status |= cpu_to_le32(OWNbit);
+	__FLUSH_CACHE(&priv->TxDescArray[first], sizeof(struct TxDesc), CACHE_FLUSH_WRITEBACK);
+
+	//Start to poll.
+	RTL_W8(TxPoll, 0x40);
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	return TRUE;
 }
 
-//Interrupt handler for transmition.
-static BOOL RTL8111_TX_Interrupt(rtl8111_priv_t* priv)
+//Completion routine of the frame sent from interface's send buffer.
+static VOID RTL8111_SendBufDone(LPVOID pTxParam)
 {
-	unsigned long  ioaddr = priv->ioaddr;
-	unsigned long  dirty_tx, tx_left = 0;
-	int txloop_cnt = 0;
-	int entry = priv->cur_tx % NUM_TX_DESC;
+	((rtl8111_priv_t*)pTxParam)->tx_sendbuf_busy = 0;
+}
 
-	dirty_tx = priv->dirty_tx;
-	tx_left = priv->cur_tx - dirty_tx;
+//Send out a frame to net link,return 0 if fail,otherwise no-zero.
+//The frame resides in interface's send buffer,so the previous one must
+//be finished before it.
+static int RTL8111_Send(rtl8111_priv_t* dev, char* buff, int len)
+{
+	rtl8111_priv_t*  priv = dev;
+	__ETH_TX_FRAG    frag;
+	DWORD            dwFlags;
+	int              i;
 
-	while ((tx_left > 0) && (txloop_cnt < max_interrupt_work))
+	for (i = 1000; i > 0; i--)
 	{
-		if ((le32_to_cpu(priv->TxDescArray[entry].status) & OWNbit) == 0)
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		RTL8111_TX_Interrupt(priv);
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		if (!priv->tx_sendbuf_busy)
 		{
-			//frame already send
-			dirty_tx++;
-			tx_left--;
-			entry++;
+			break;
 		}
-		txloop_cnt++;
+		__MicroDelay(100);
+	}
+	if (i <= 0)
+	{
+		return 0;
+	}
+	if (len > priv->tx_pkt_len)
+	{
+		//printk("%s: Error -- Tx packet size(%d) > mtu(%d)+14\n", netdev->name, skb->len, netdev->mtu);
+		len = priv->tx_pkt_len;
 	}
 
-	if (priv->dirty_tx != dirty_tx)
+	frag.pData = (__u8*)buff;
+	frag.length = len;
+	priv->tx_sendbuf_busy = 1;
+	if (!RTL8111_Xmit(priv, &frag, 1, NULL, RTL8111_SendBufDone, priv))
 	{
-		priv->dirty_tx = dirty_tx;
+		priv->tx_sendbuf_busy = 0;
+		return 0;
 	}
+	return len;
+}
+
+//Interrupt handler for transmition,reclaims the Tx descriptors NIC has
+//finished and notifies the owner of each frame sent out.
+//It's also called by sending routine with interrupt disabled.
+static BOOL RTL8111_TX_Interrupt(rtl8111_priv_t* priv)
+{
+	int entry;
 
+	while (priv->cur_tx != priv->dirty_tx)
+	{
+		entry = priv->dirty_tx % NUM_TX_DESC;
+		__FLUSH_CACHE(&priv->TxDescArray[entry], sizeof(struct TxDesc), CACHE_FLUSH_INVALIDATE);
+		if (le32_to_cpu(priv->TxDescArray[entry].status) & OWNbit)
+		{
+			//Not sent yet.
+			break;
+		}
+		if (priv->tx_done[entry])
+		{
+			priv->tx_done[entry](priv->tx_param[entry]);
+			priv->tx_done[entry] = NULL;
+		}
+		priv->dirty_tx++;
+	}
 	return TRUE;
 }
 
@@ -352,8 +535,6 @@ static BOOL RTL8111_RX_Interrupt(rtl8111_priv_t* priv)
 {
 	__ETHERNET_INTERFACE*  pEthInt = priv->pEthInt;
 	__ETHERNET_BUFFER*  pEthBuff = NULL;
-	unsigned char*      buf = NULL;
-	int                 len = 0;
 
 	if (NULL == pEthInt)
 	{
@@ -362,33 +543,10 @@ static BOOL RTL8111_RX_Interrupt(rtl8111_priv_t* priv)
 
 	while (TRUE)
 	{
-		pEthBuff = NULL;
-		buf = NULL;
-		len = 0;
-
-		buf = (unsigned char*)RTL8111_Recv(priv, &len);
-		if (buf)
+		pEthBuff = RTL8111_Recv(priv);
+		if (pEthBuff)
 		{
-			//Received a pakcet,post to kernel.			
-			pEthBuff = EthernetManager.CreateEthernetBuffer(len);
-			if (NULL == pEthBuff)
-			{
-				_rtl8111_debug("  %s: create ethernet buffer failed.\r\n", __func__);
-				return FALSE;
-			}
-			else  //Copy the received data to Ethernet Buffer object.
-			{
-				memcpy(pEthBuff->Buffer, buf, len);
-				pEthBuff->act_length = len;
-				//Fill the MAC addresses and packet types.
-				memcpy(pEthBuff->dstMAC, buf, ETH_MAC_LEN);
-				buf += ETH_MAC_LEN;
-				memcpy(pEthBuff->srcMAC, buf, ETH_MAC_LEN);
-				buf += ETH_MAC_LEN;
-				pEthBuff->frame_type = _hx_ntohs(*(__u16*)buf);
-				pEthBuff->pEthernetInterface = pEthInt;
-				pEthBuff->buff_status = ETHERNET_BUFFER_STATUS_INITIALIZED;
-			}
+			//Received a pakcet,post to kernel.
 			if (!EthernetManager.PostFrame(pEthInt, pEthBuff))
 			{
 				//Must destroy the ethernet buffer object,since it may lead memory leak.
@@ -442,21 +600,33 @@ static BOOL RTL8111_Interrupt(LPVOID lpESP, LPVOID lpParam)
 		{
 			break;
 		}
-		//Ackowledge interrupt by writting back the corresponding bit(s).
-		RTL_W16(IntrStatus, status);
+		//Ackowledge interrupt by writting back the corresponding bit(s),Rx bits
+		//are kept when Rx interrupt is masked,so it's raised once enabled.
+		RTL_W16(IntrStatus, status & (priv->intr_mask | ~(RxOK | RxErr)));
 
-		if ((status & rtl8111_intr_mask) == 0)
+		//Done if no enabled interrupt is pending,latched Rx bits are ignored
+		//while Rx ring is polled.
+		if ((status & priv->intr_mask) == 0)
 		{
-			_hx_printf("%s:Interrupt masked but raised,status = %X.\r\n"
-				__func__,
-				status);
+			if (boguscnt == max_interrupt_work)
+			{
+				_hx_printf("%s:Interrupt masked but raised,status = %X.\r\n"
+					__func__,
+					status);
+			}
 			break;
 		}
 
-		// Rx interrupt.
-		if (status & (RxOK | RxErr))
+		// Rx interrupt,mask it and schedule polling of Rx ring,it's enabled
+		// again once the ring is drained.
+		if (status & priv->intr_mask & (RxOK | RxErr))
 		{
-			RTL8111_RX_Interrupt(priv);
+			priv->intr_mask &= ~(RxOK | RxErr);
+			if (!EthernetManager.ScheduleRxPoll(priv->pEthInt))
+			{
+				priv->intr_mask |= (RxOK | RxErr);
+				RTL8111_RX_Interrupt(priv);
+			}
 		}
 		
 		//Link change interrupt.
@@ -475,6 +645,11 @@ static BOOL RTL8111_Interrupt(LPVOID lpESP, LPVOID lpParam)
 		if (status & (TxOK | TxErr))
 		{
 			RTL8111_TX_Interrupt(priv);
+			//Send the frames deferred since Tx ring was full.
+			if (priv->pEthInt)
+			{
+				EthernetManager.TxWakeup(priv->pEthInt);
+			}
 		}
 
 		if ((status & TxOK) && (status & TxDescUnavail))
@@ -487,7 +662,7 @@ static BOOL RTL8111_Interrupt(LPVOID lpESP, LPVOID lpParam)
 	} while (boguscnt > 0);
 
 	//Enable interrupt again.
-	RTL_W16(IntrMask, rtl8111_intr_mask);
+	RTL_W16(IntrMask, priv->intr_mask);
 	return TRUE;
 }
 
@@ -521,6 +696,12 @@ static BOOL RTL8111_Start(rtl8111_priv_t* priv)
 	priv->cur_rx = 0;
 	priv->cur_tx = 0;
 	priv->dirty_tx = 0;
+	priv->tx_sendbuf_busy = 0;
+	for (i = 0; i < NUM_TX_DESC; i++)
+	{
+		priv->tx_done[i] = NULL;
+		priv->tx_param[i] = NULL;
+	}
 
 	//alloc txdesc/rxdesc buf.
 	priv->sizeof_txdesc_space = NUM_TX_DESC * sizeof(struct TxDesc);
@@ -571,6 +752,18 @@ static BOOL RTL8111_Start(rtl8111_priv_t* priv)
 		priv->RxDescArray[i].buf_Haddr = 0;
 		priv->rxdesc_array_dma_addr[i] = (dma_addr_t)&priv->RxDescArray[i];
 	}
+	//Spare Rx buffers.
+	priv->rx_spare_num = 0;
+	for (i = 0; i < NUM_RX_SPARE; i++)
+	{
+		priv->rx_spare_dma_addr[i] = (dma_addr_t)_hx_malloc(MAX_RX_SKBDATA_SIZE);
+		if (0 == priv->rx_spare_dma_addr[i])
+		{
+			_hx_printf("%s:can not allocate spare rx buffer.\r\n", __func__);
+			goto __TERMINAL;
+		}
+		priv->rx_spare_num++;
+	}
 
 	//Synchronizing cache content if necessary.
 	__FLUSH_CACHE(priv->TxDescArray, priv->sizeof_txdesc_space, CACHE_FLUSH_WRITEBACK);
@@ -623,7 +816,9 @@ static BOOL RTL8111_Start(rtl8111_priv_t* priv)
 			RTL_W16(CPlusCmd, (RTL_R16(CPlusCmd) | (1 << 3)));
 			_rtl8111_debug("Set MAC Reg C+CR Offset 0xE0: bit-3.\n");
 		}
-		RTL_W16(0xE2, 0x0000);
+		//Let NIC validate checksums of received frames.
+		RTL_W16(CPlusCmd, (RTL_R16(CPlusCmd) | RxChkSum));
+		RTL_W16(IntrMitigate, RTL8111_INTR_MITIGATE);
 
 		priv->cur_rx = 0;
 
@@ -639,7 +834,8 @@ static BOOL RTL8111_Start(rtl8111_priv_t* priv)
 
 		RTL8111set_RX_mode(priv);
 		RTL_W16(MultiIntr, RTL_R16(MultiIntr) & 0xF000);
-		RTL_W16(IntrMask, rtl8111_intr_mask);
+		priv->intr_mask = rtl8111_intr_mask;
+		RTL_W16(IntrMask, priv->intr_mask);
 	}
 
 	priv->hInterrupt = ConnectInterrupt(RTL8111_Interrupt,
@@ -754,6 +950,33 @@ static BOOL Ethernet_Int_Init(__ETHERNET_INTERFACE* pInt)
 //are not common operations for Ethernet.
 static BOOL Ethernet_Ctrl(__ETHERNET_INTERFACE* pInt, DWORD dwOperation, LPVOID pData)
 {
+	rtl8111_priv_t* priv = NULL;
+
+	if ((NULL == pInt) || (NULL == pInt->pIntExtension))
+	{
+		return FALSE;
+	}
+	priv = (rtl8111_priv_t*)pInt->pIntExtension;
+	switch (dwOperation)
+	{
+	case ETH_MSG_OFFLOAD:
+		//Checksums are offloaded by all chips,large send is only used for the
+		//chips keep it in status of Tx descriptor,which segment at most
+		//RTL8111_TSO_MAX_FRAME_V1 bytes in one frame.
+		if (NULL == pData)
+		{
+			return FALSE;
+		}
+		*(DWORD*)pData = ETH_OFFLOAD_TX_TCPCSUM | ETH_OFFLOAD_TX_UDPCSUM | ETH_OFFLOAD_RX_CSUM;
+		if (RTL8111_TXDESC_V1(priv))
+		{
+			*(DWORD*)pData |= ETH_OFFLOAD_TSO;
+			pInt->nTsoMaxFrame = RTL8111_TSO_MAX_FRAME_V1;
+		}
+		break;
+	default:
+		break;
+	}
 	return TRUE;
 }
 
@@ -789,6 +1012,61 @@ __TERMINAL:
 	return bResult;
 }
 
+//Scatter-gather sending operation,the fragments are queued into Tx ring
+//directly without copying.
+static BOOL Ethernet_SendFrags(__ETHERNET_INTERFACE* pInt, __ETH_TX_FRAG* pFrags, int nFragNum,
+	__ETH_TX_OFFLOAD* pOffload, __ETH_TX_DONE TxDone, LPVOID pTxParam)
+{
+	rtl8111_priv_t* dev = NULL;
+
+	if (NULL == pInt)
+	{
+		return FALSE;
+	}
+	dev = (rtl8111_priv_t*)pInt->pIntExtension;
+	if (NULL == dev)
+	{
+		return FALSE;
+	}
+	if (pOffload && (pOffload->dwFlags & ETH_OFFLOAD_TSO) && (pOffload->mss > TxMSSMax))
+	{
+		return FALSE;
+	}
+	return RTL8111_Xmit(dev, pFrags, nFragNum, pOffload, TxDone, pTxParam);
+}
+
+//Enable or disable Rx interrupt,called by ethernet core thread when Rx
+//polling is over.
+static BOOL Ethernet_RxIntControl(__ETHERNET_INTERFACE* pInt, BOOL bEnable)
+{
+	rtl8111_priv_t* priv = NULL;
+	unsigned long   ioaddr;
+	DWORD           dwFlags;
+
+	if (NULL == pInt)
+	{
+		return FALSE;
+	}
+	priv = (rtl8111_priv_t*)pInt->pIntExtension;
+	if (NULL == priv)
+	{
+		return FALSE;
+	}
+	ioaddr = priv->ioaddr;
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	if (bEnable)
+	{
+		priv->intr_mask |= (RxOK | RxErr);
+	}
+	else
+	{
+		priv->intr_mask &= ~(RxOK | RxErr);
+	}
+	RTL_W16(IntrMask, priv->intr_mask);
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	return TRUE;
+}
+
 /**
 *
 * Receive a frame from ehternet link.
@@ -800,8 +1078,7 @@ static __ETHERNET_BUFFER* Ethernet_RecvFrame(__ETHERNET_INTERFACE* pInt)
 {
 	__ETHERNET_BUFFER* pEthBuff = NULL;
 	rtl8111_priv_t*    dev = NULL;
-	unsigned char*     buf = NULL;
-	int                len = 0;
+	DWORD              dwFlags;
 
 	if (NULL == pInt)
 	{
@@ -814,35 +1091,10 @@ static __ETHERNET_BUFFER* Ethernet_RecvFrame(__ETHERNET_INTERFACE* pInt)
 		return NULL;
 	}
 
-	buf = RTL8111_Recv(dev, &len);
-	if (!buf)  //No packet received.
-	{
-		return NULL;
-	}
-
-	//Received a pakcet,delivery it to IP stack.
-	if (len > 0)
-	{
-		pEthBuff = EthernetManager.CreateEthernetBuffer(len);
-		if (NULL == pEthBuff)
-		{
-			_rtl8111_debug("  %s: create ethernet buffer failed.\r\n", __func__);
-			return NULL;
-		}
-		else  //Copy the received data to Ethernet Buffer object.
-		{
-			memcpy(pEthBuff->Buffer, buf, len);
-			pEthBuff->act_length = len;
-			//Fill the MAC addresses and packet types.
-			memcpy(pEthBuff->dstMAC, buf, ETH_MAC_LEN);
-			buf += ETH_MAC_LEN;
-			memcpy(pEthBuff->srcMAC, buf, ETH_MAC_LEN);
-			buf += ETH_MAC_LEN;
-			pEthBuff->frame_type = _hx_ntohs(*(__u16*)buf);
-			pEthBuff->pEthernetInterface = pInt;
-			pEthBuff->buff_status = ETHERNET_BUFFER_STATUS_INITIALIZED;
-		}
-	}
+	//Rx ring is also accessed by interrupt handler.
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	pEthBuff = RTL8111_Recv(dev);
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
 	return pEthBuff;
 }
 
@@ -905,6 +1157,11 @@ BOOL RTL8111_Drv_Initialize(LPVOID pData)
 			//Mark the structure as unavailable,it will be released later.
 			dev->available = 0;
 		}
+		else
+		{
+			dev->pEthInt->SendFrags = Ethernet_SendFrags;
+			dev->pEthInt->RxIntControl = Ethernet_RxIntControl;
+		}
 		//Process next one.
 		dev = dev->next;
 		index++;
@@ -80,8 +80,14 @@
 
 #define InterFrameGap       0x03    /* 3 means InterFrameGap = the shortest one */
 
-#define NUM_TX_DESC         4     /* Number of Tx descriptors*/
+#define NUM_TX_DESC         64    /* Number of Tx descriptors*/
+#define RTL8111_TSO_MAX_FRAME_V1 32000 /* Longest large send frame of 8169/8168B */
 #define NUM_RX_DESC         4     /* Number of Rx descriptors*/
+#define NUM_RX_SPARE        16    /* Spare Rx buffers,replace the ones loaned to upper layer */
+
+/* Interrupt mitigation,Rx and Tx interrupts are delayed by timer and packet
+   count thresholds instead of raised for each frame. */
+#define RTL8111_INTR_MITIGATE 0x5151
 
 #define RTL_MIN_IO_SIZE     0x80
 #define TX_TIMEOUT          (6*1000 / SYSTEM_TIME_SLICE)    //(6*HZ)
@@ -153,6 +159,7 @@ enum r1000_registers {
 	EPHYAR = 0x80,
 	RxMaxSize = 0xDA,
 	CPlusCmd = 0xE0,
+	IntrMitigate = 0xE2,
 	RxDescStartAddr = 0xE4,
 	ETThReg = 0xEC,
 	FuncEvent = 0xF0,
@@ -300,6 +307,35 @@ enum _DescStatusBit {
 };
 
 
+//Offload bits of descriptors.Tx checksum and large send bits reside in status
+//of RTL8169/8168B(MCFG_METHOD_1 to MCFG_METHOD_12),and checksum bits reside in
+//vlan_tag of RTL8101E/8168C and later ones.Rx checksum result is in status.
+enum _DescOffloadBit {
+	TxLGSEN = (1 << 27),           //Large send.
+	TxIPCS = (1 << 18),
+	TxUDPCS = (1 << 17),
+	TxTCPCS = (1 << 16),
+	TxMSSShift = 16,               //MSS in status for large send.
+	TxMSSMax = 0x7FF,
+
+	TxIPCS_C = (1 << 29),          //In vlan_tag.
+	TxTCPCS_C = (1 << 30),
+	TxUDPCS_C = (int)(1U << 31),
+
+	RxProtoUDP = (1 << 17),
+	RxProtoTCP = (2 << 17),
+	RxProtoMask = (3 << 17),
+	RxIPF = (1 << 16),             //IP checksum failed.
+	RxUDPF = (1 << 15),
+	RxTCPF = (1 << 14),
+};
+
+//Rx checksum offload bit of CPlusCmd register.
+#define RxChkSum (1 << 5)
+
+//Chips that put Tx offload bits in status of descriptor.
+#define RTL8111_TXDESC_V1(priv) ((priv)->mcfg <= MCFG_METHOD_12)
+
 struct TxDesc {
 	__u32		status;
 	__u32		vlan_tag;
@@ -352,6 +388,14 @@ struct rtl8111_priv{
 	dma_addr_t txdesc_array_dma_addr[NUM_TX_DESC];
 	dma_addr_t rxdesc_array_dma_addr[NUM_RX_DESC];
 	dma_addr_t rx_skbuff_dma_addr[NUM_RX_DESC];
+	dma_addr_t rx_spare_dma_addr[NUM_RX_SPARE];
+	int rx_spare_num;
+
+	__ETH_TX_DONE tx_done[NUM_TX_DESC];     /* Completion routine of the frame ends at each Tx descriptor. */
+	LPVOID tx_param[NUM_TX_DESC];
+	volatile int tx_sendbuf_busy;           /* Set when interface's send buffer is in Tx ring. */
+	unsigned short intr_mask;               /* Interrupts currently enabled. */
+	unsigned long tx_ring_full;
 
 	void *txdesc_space;
 	dma_addr_t txdesc_phy_dma_addr;
@@ -0,0 +1,376 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : fatdcache.c
+//    Module Funciton           :
+//                                Directory entry(dentry) cache of FAT32 file system.
+//                                Each path component's lookup result,i.e,the short
+//                                entry and it's location in parent directory,is saved
+//                                in this cache,keyed by parent directory's start cluster
+//                                and the hash value of name,so the subsequent opening
+//                                of the same file or directory will not scan the
+//                                directory clusters again.
+//                                Lookup failure is also cached as negative entry.
+//                                The cache is bounded and recycled in LRU order.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#ifndef __STDAFX_H__
+#include <StdAfx.h>
+#endif
+
+#ifndef __FSSTR_H__
+#include "fsstr.h"
+#endif
+
+#ifndef __FAT32_H__
+#include "fat32.h"
+#endif
+
+//This module will be available if and only if the DDF function is enabled.
+#ifdef __CFG_SYS_DDF
+
+//Calculate the hash value of a name string.
+static DWORD DentryNameHash(CHAR* pszName)
+{
+	DWORD dwHash = 5381;
+
+	while(*pszName)
+	{
+		dwHash = ((dwHash << 5) + dwHash) + (BYTE)(*pszName);
+		pszName ++;
+	}
+	return dwHash;
+}
+
+//Detach one dentry from hash bucket and LRU list,caller should hold the critical section.
+static VOID DentryUnlink(__FAT32_DENTRY_CACHE* pCache,__FAT32_DENTRY* pDentry)
+{
+	__FAT32_DENTRY** ppPrev = &pCache->HashTable[pDentry->dwNameHash & (FAT_DENTRY_HASH_SIZE - 1)];
+
+	while(*ppPrev)
+	{
+		if(*ppPrev == pDentry)
+		{
+			*ppPrev = pDentry->pHashNext;
+			break;
+		}
+		ppPrev = &(*ppPrev)->pHashNext;
+	}
+	if(pDentry->pLruPrev)
+	{
+		pDentry->pLruPrev->pLruNext = pDentry->pLruNext;
+	}
+	else
+	{
+		pCache->pLruHead = pDentry->pLruNext;
+	}
+	if(pDentry->pLruNext)
+	{
+		pDentry->pLruNext->pLruPrev = pDentry->pLruPrev;
+	}
+	else
+	{
+		pCache->pLruTail = pDentry->pLruPrev;
+	}
+	pDentry->pHashNext = NULL;
+	pDentry->pLruPrev  = NULL;
+	pDentry->pLruNext  = NULL;
+}
+
+//Put one dentry at the head(most recently used) of LRU list.
+static VOID DentryLruHead(__FAT32_DENTRY_CACHE* pCache,__FAT32_DENTRY* pDentry)
+{
+	pDentry->pLruPrev = NULL;
+	pDentry->pLruNext = pCache->pLruHead;
+	if(pCache->pLruHead)
+	{
+		pCache->pLruHead->pLruPrev = pDentry;
+	}
+	pCache->pLruHead = pDentry;
+	if(NULL == pCache->pLruTail)
+	{
+		pCache->pLruTail = pDentry;
+	}
+}
+
+//Drop one dentry and put it into free list,caller should hold the critical section.
+static VOID DentryDrop(__FAT32_DENTRY_CACHE* pCache,__FAT32_DENTRY* pDentry)
+{
+	DentryUnlink(pCache,pDentry);
+	pDentry->pHashNext = pCache->pFreeList;
+	pCache->pFreeList  = pDentry;
+	pCache->dwEntryNum --;
+}
+
+//Initialize the dentry cache of a FAT32 file system,it's called when the volume
+//is mounted.All entries are allocated in advance,so no memory allocation will
+//occur in lookup path.
+BOOL FatDentryInit(__FAT32_FS* pFat32Fs)
+{
+	__FAT32_DENTRY_CACHE* pCache = NULL;
+	__FAT32_DENTRY*       pPool  = NULL;
+	int                   i;
+
+	if(NULL == pFat32Fs)
+	{
+		return FALSE;
+	}
+	pCache = &pFat32Fs->DentryCache;
+	memset(pCache,0,sizeof(__FAT32_DENTRY_CACHE));
+	pPool = (__FAT32_DENTRY*)FatMem_Alloc(FAT_DENTRY_CACHE_SIZE * sizeof(__FAT32_DENTRY));
+	if(NULL == pPool)  //Cache disabled,lookup will go to disk directly.
+	{
+		return FALSE;
+	}
+	for(i = 0;i < FAT_DENTRY_CACHE_SIZE;i ++)
+	{
+		pPool[i].pHashNext = pCache->pFreeList;
+		pCache->pFreeList  = &pPool[i];
+	}
+	pCache->pEntryPool = pPool;
+	return TRUE;
+}
+
+//Lookup one name in the directory starts from dwParentClus.
+//Returns FAT_DENTRY_MISS if not cached,FAT_DENTRY_NEGATIVE if the name is known
+//not exist,or FAT_DENTRY_HIT and the short entry and it's location are returned.
+DWORD FatDentryLookup(__FAT32_FS* pFat32Fs,DWORD dwParentClus,CHAR* pszName,
+					  __FAT32_SHORTENTRY* pShortEntry,DWORD* pDirClus,DWORD* pDirOffset)
+{
+	__FAT32_DENTRY_CACHE* pCache   = NULL;
+	__FAT32_DENTRY*       pDentry  = NULL;
+	DWORD                 dwHash   = 0;
+	DWORD                 dwResult = FAT_DENTRY_MISS;
+	DWORD                 dwFlags;
+
+	if((NULL == pFat32Fs) || (NULL == pszName))
+	{
+		return FAT_DENTRY_MISS;
+	}
+	pCache = &pFat32Fs->DentryCache;
+	if(NULL == pCache->pEntryPool)
+	{
+		return FAT_DENTRY_MISS;
+	}
+	dwHash = DentryNameHash(pszName);
+
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pDentry = pCache->HashTable[dwHash & (FAT_DENTRY_HASH_SIZE - 1)];
+	while(pDentry)
+	{
+		if((pDentry->dwParentClus == dwParentClus) && (pDentry->dwNameHash == dwHash) &&
+		   (0 == strcmp(pDentry->Name,pszName)))
+		{
+			break;
+		}
+		pDentry = pDentry->pHashNext;
+	}
+	if(NULL == pDentry)
+	{
+		pCache->dwMisses ++;
+		goto __TERMINAL;
+	}
+	//Move to the head of LRU list.
+	if(pCache->pLruHead != pDentry)
+	{
+		if(pDentry->pLruPrev)
+		{
+			pDentry->pLruPrev->pLruNext = pDentry->pLruNext;
+		}
+		if(pDentry->pLruNext)
+		{
+			pDentry->pLruNext->pLruPrev = pDentry->pLruPrev;
+		}
+		else
+		{
+			pCache->pLruTail = pDentry->pLruPrev;
+		}
+		DentryLruHead(pCache,pDentry);
+	}
+	if(pDentry->bNegative)
+	{
+		pCache->dwNegativeHits ++;
+		dwResult = FAT_DENTRY_NEGATIVE;
+		goto __TERMINAL;
+	}
+	memcpy((char*)pShortEntry,(const char*)&pDentry->ShortEntry,sizeof(__FAT32_SHORTENTRY));
+	if(pDirClus)
+	{
+		*pDirClus = pDentry->dwDirClus;
+	}
+	if(pDirOffset)
+	{
+		*pDirOffset = pDentry->dwDirOffset;
+	}
+	pCache->dwHits ++;
+	dwResult = FAT_DENTRY_HIT;
+
+__TERMINAL:
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+	return dwResult;
+}
+
+//Add one lookup result into cache,pShortEntry is NULL means a negative entry.
+//The least recently used entry will be recycled if the cache is full.
+VOID FatDentryAdd(__FAT32_FS* pFat32Fs,DWORD dwParentClus,CHAR* pszName,
+				  __FAT32_SHORTENTRY* pShortEntry,DWORD dwDirClus,DWORD dwDirOffset)
+{
+	__FAT32_DENTRY_CACHE* pCache   = NULL;
+	__FAT32_DENTRY*       pDentry  = NULL;
+	__FAT32_DENTRY**      ppBucket = NULL;
+	DWORD                 dwHash   = 0;
+	DWORD                 dwFlags;
+
+	if((NULL == pFat32Fs) || (NULL == pszName))
+	{
+		return;
+	}
+	pCache = &pFat32Fs->DentryCache;
+	if(NULL == pCache->pEntryPool)
+	{
+		return;
+	}
+	if(strlen(pszName) >= FAT_DENTRY_NAME_LEN)  //Too long to cache.
+	{
+		return;
+	}
+	dwHash   = DentryNameHash(pszName);
+	ppBucket = &pCache->HashTable[dwHash & (FAT_DENTRY_HASH_SIZE - 1)];
+
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	//Replace the old one if exist,another thread may add it in parallel.
+	pDentry = *ppBucket;
+	while(pDentry)
+	{
+		if((pDentry->dwParentClus == dwParentClus) && (pDentry->dwNameHash == dwHash) &&
+		   (0 == strcmp(pDentry->Name,pszName)))
+		{
+			DentryDrop(pCache,pDentry);
+			break;
+		}
+		pDentry = pDentry->pHashNext;
+	}
+	if(NULL == pCache->pFreeList)  //Cache is full,recycle the LRU one.
+	{
+		DentryDrop(pCache,pCache->pLruTail);
+		pCache->dwRecycled ++;
+	}
+	pDentry = pCache->pFreeList;
+	pCache->pFreeList = pDentry->pHashNext;
+
+	pDentry->dwParentClus = dwParentClus;
+	pDentry->dwNameHash   = dwHash;
+	strcpy(pDentry->Name,pszName);
+	if(pShortEntry)
+	{
+		memcpy((char*)&pDentry->ShortEntry,(const char*)pShortEntry,sizeof(__FAT32_SHORTENTRY));
+		pDentry->bNegative   = FALSE;
+		pDentry->dwDirClus   = dwDirClus;
+		pDentry->dwDirOffset = dwDirOffset;
+	}
+	else
+	{
+		memzero(&pDentry->ShortEntry,sizeof(__FAT32_SHORTENTRY));
+		pDentry->bNegative   = TRUE;
+		pDentry->dwDirClus   = 0;
+		pDentry->dwDirOffset = 0;
+	}
+	pDentry->pHashNext = *ppBucket;
+	*ppBucket = pDentry;
+	DentryLruHead(pCache,pDentry);
+	pCache->dwEntryNum ++;
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+}
+
+//Invalidate all entries under a directory,it should be called when a new entry
+//is created in the directory,or the directory itself is removed.
+VOID FatDentryInvalidateDir(__FAT32_FS* pFat32Fs,DWORD dwParentClus)
+{
+	__FAT32_DENTRY_CACHE* pCache   = NULL;
+	__FAT32_DENTRY*       pDentry  = NULL;
+	__FAT32_DENTRY*       pNext    = NULL;
+	DWORD                 dwFlags;
+
+	if(NULL == pFat32Fs)
+	{
+		return;
+	}
+	pCache = &pFat32Fs->DentryCache;
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pDentry = pCache->pLruHead;
+	while(pDentry)
+	{
+		pNext = pDentry->pLruNext;
+		if(pDentry->dwParentClus == dwParentClus)
+		{
+			DentryDrop(pCache,pDentry);
+		}
+		pDentry = pNext;
+	}
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+}
+
+//Invalidate the entries whose short entry locates at the given position,it's
+//called when a short entry is deleted or renamed.
+VOID FatDentryInvalidateEntry(__FAT32_FS* pFat32Fs,DWORD dwDirClus,DWORD dwDirOffset)
+{
+	__FAT32_DENTRY_CACHE* pCache   = NULL;
+	__FAT32_DENTRY*       pDentry  = NULL;
+	__FAT32_DENTRY*       pNext    = NULL;
+	DWORD                 dwFlags;
+
+	if(NULL == pFat32Fs)
+	{
+		return;
+	}
+	pCache = &pFat32Fs->DentryCache;
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pDentry = pCache->pLruHead;
+	while(pDentry)
+	{
+		pNext = pDentry->pLruNext;
+		if(!pDentry->bNegative && (pDentry->dwDirClus == dwDirClus) &&
+		   (pDentry->dwDirOffset == dwDirOffset))
+		{
+			DentryDrop(pCache,pDentry);
+		}
+		pDentry = pNext;
+	}
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+}
+
+//Refresh the cached short entry after it's content is changed on disk,such as
+//file size or start cluster changed by writting.
+VOID FatDentryUpdate(__FAT32_FS* pFat32Fs,DWORD dwDirClus,DWORD dwDirOffset,
+					 __FAT32_SHORTENTRY* pShortEntry)
+{
+	__FAT32_DENTRY_CACHE* pCache   = NULL;
+	__FAT32_DENTRY*       pDentry  = NULL;
+	DWORD                 dwFlags;
+
+	if((NULL == pFat32Fs) || (NULL == pShortEntry))
+	{
+		return;
+	}
+	pCache = &pFat32Fs->DentryCache;
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pDentry = pCache->pLruHead;
+	while(pDentry)
+	{
+		if(!pDentry->bNegative && (pDentry->dwDirClus == dwDirClus) &&
+		   (pDentry->dwDirOffset == dwDirOffset))
+		{
+			memcpy((char*)&pDentry->ShortEntry,(const char*)pShortEntry,sizeof(__FAT32_SHORTENTRY));
+		}
+		pDentry = pDentry->pLruNext;
+	}
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+}
+
+#endif
@@ -0,0 +1,909 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : ramfs.c
+//    Module Funciton           :
+//                                RAM file system.Nodes are indexed by a hash
+//                                table keyed on parent node and name,so path
+//                                resolution costs one probe per level.File data
+//                                lives in page backed extents,reading and writing
+//                                never touch block device layer.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#ifndef __STDAFX_H__
+#include <StdAfx.h>
+#endif
+
+#include "kapi.h"
+#include "../lib/stdio.h"
+#include "../lib/string.h"
+#include "../lib/stdlib.h"
+
+#ifndef __RAMFS_H__
+#include "ramfs.h"
+#endif
+
+//This module will be available if and only if DDF is enabled.
+#if defined(__CFG_SYS_DDF) && defined(__CFG_FS_RAM)
+
+//The only RAM file system instance.
+static __RAMFS*   g_pRamFs = NULL;
+
+//Allocate one extent from page frames.Mapped pages are used since page frames
+//beyond kernel area are not accessible directly.
+static BYTE* RamFsAllocPages(DWORD dwSize)
+{
+#ifdef __CFG_SYS_VMM
+	return (BYTE*)VirtualAlloc(NULL,dwSize,
+		VIRTUAL_AREA_ALLOCATE_ALL,
+		VIRTUAL_AREA_ACCESS_RW,
+		"RAMFS");
+#else
+	return (BYTE*)_hx_malloc(dwSize);
+#endif
+}
+
+static VOID RamFsFreePages(BYTE* pData)
+{
+#ifdef __CFG_SYS_VMM
+	VirtualFree(pData);
+#else
+	_hx_free(pData);
+#endif
+}
+
+//Hash a name under a given parent.
+static DWORD RamFsHash(__RAMFS_NODE* pParent,LPCSTR pszName)
+{
+	DWORD dwHash = (DWORD)pParent >> 4;
+
+	while(*pszName)
+	{
+		dwHash = dwHash * 31 + (BYTE)(*pszName);
+		pszName ++;
+	}
+	return dwHash;
+}
+
+//Locate a child of pParent by name.
+static __RAMFS_NODE* RamFsLookup(__RAMFS* pFs,__RAMFS_NODE* pParent,LPCSTR pszName)
+{
+	DWORD           dwHash = RamFsHash(pParent,pszName);
+	__RAMFS_NODE*   pNode  = pFs->HashTable[dwHash % RAMFS_HASH_SIZE];
+
+	pFs->dwLookups ++;
+	while(pNode)
+	{
+		pFs->dwProbes ++;
+		if((pNode->dwHash == dwHash) && (pNode->pParent == pParent) &&
+		   (0 == strcmp(pNode->szName,pszName)))
+		{
+			return pNode;
+		}
+		pNode = pNode->pHashNext;
+	}
+	return NULL;
+}
+
+//Resolve a full name,such as "R:\DIR\FILE",to a node.If pszLast is not NULL,
+//the parent of the last level is returned and the last level's name is copied
+//into pszLast.
+static __RAMFS_NODE* RamFsResolve(__RAMFS* pFs,LPCSTR pszFullName,CHAR* pszLast)
+{
+	__RAMFS_NODE*   pNode = pFs->pRoot;
+	CHAR            Level[RAMFS_NAME_LEN];
+	LPCSTR          p     = pszFullName;
+	int             i;
+
+	if((0 == p[0]) || (':' != p[1]) || ('\\' != p[2]))
+	{
+		return NULL;
+	}
+	p += 3;
+	if(pszLast)
+	{
+		pszLast[0] = 0;
+	}
+	while(*p)
+	{
+		for(i = 0;*p && ('\\' != *p);i ++,p ++)
+		{
+			if(i >= RAMFS_NAME_LEN - 1)  //Name too long.
+			{
+				return NULL;
+			}
+			Level[i] = ((*p >= 'a') && (*p <= 'z')) ? (*p - 'a' + 'A') : *p;
+		}
+		Level[i] = 0;
+		if('\\' == *p)
+		{
+			p ++;
+		}
+		if(0 == i)  //Empty level,e.g,trailing slash.
+		{
+			continue;
+		}
+		if(pszLast && (0 == *p))  //Last level,return it's parent.
+		{
+			strcpy(pszLast,Level);
+			return pNode;
+		}
+		if(!(pNode->dwAttributes & FILE_ATTR_DIRECTORY))
+		{
+			return NULL;
+		}
+		pNode = RamFsLookup(pFs,pNode,Level);
+		if(NULL == pNode)
+		{
+			return NULL;
+		}
+	}
+	return pNode;
+}
+
+//Create a node under pParent.
+static __RAMFS_NODE* RamFsCreateNode(__RAMFS* pFs,__RAMFS_NODE* pParent,LPCSTR pszName,
+									 DWORD dwAttributes)
+{
+	__RAMFS_NODE*   pNode  = NULL;
+	DWORD           dwIndex;
+
+	if((NULL == pParent) || (0 == pszName[0]))
+	{
+		return NULL;
+	}
+	if(!(pParent->dwAttributes & FILE_ATTR_DIRECTORY))
+	{
+		return NULL;
+	}
+	if(RamFsLookup(pFs,pParent,pszName))  //Already exist.
+	{
+		return NULL;
+	}
+	pNode = (__RAMFS_NODE*)CREATE_OBJECT(__RAMFS_NODE);
+	if(NULL == pNode)
+	{
+		return NULL;
+	}
+	strncpy(pNode->szName,(CHAR*)pszName,RAMFS_NAME_LEN - 1);
+	pNode->dwHash       = RamFsHash(pParent,pNode->szName);
+	pNode->dwAttributes = dwAttributes;
+	pNode->pParent      = pParent;
+
+	//Link into hash table and parent's child list.
+	dwIndex = pNode->dwHash % RAMFS_HASH_SIZE;
+	pNode->pHashNext = pFs->HashTable[dwIndex];
+	pFs->HashTable[dwIndex] = pNode;
+	pNode->pNextSibling = pParent->pChild;
+	if(pParent->pChild)
+	{
+		pParent->pChild->pPrevSibling = pNode;
+	}
+	pParent->pChild = pNode;
+
+	if(dwAttributes & FILE_ATTR_DIRECTORY)
+	{
+		pFs->dwDirNum ++;
+	}
+	else
+	{
+		pFs->dwFileNum ++;
+	}
+	return pNode;
+}
+
+//Release extents beyond dwSize bytes.
+static VOID RamFsTruncate(__RAMFS* pFs,__RAMFS_NODE* pNode,DWORD dwSize)
+{
+	__RAMFS_EXTENT* pExt = NULL;
+
+	while(pNode->dwExtentNum)
+	{
+		pExt = &pNode->pExtents[pNode->dwExtentNum - 1];
+		if(pExt->dwOffset < dwSize)
+		{
+			break;
+		}
+		RamFsFreePages(pExt->pData);
+		pNode->dwCapacity -= pExt->dwSize;
+		pFs->dwUsed       -= pExt->dwSize;
+		pNode->dwExtentNum --;
+	}
+	if(pNode->dwFileSize > dwSize)
+	{
+		pNode->dwFileSize = dwSize;
+	}
+}
+
+//Remove a node with no child and not opened.
+static BOOL RamFsRemoveNode(__RAMFS* pFs,__RAMFS_NODE* pNode)
+{
+	__RAMFS_NODE**  ppPrev = NULL;
+
+	if((pNode == pFs->pRoot) || pNode->pChild || pNode->dwOpenCount)
+	{
+		return FALSE;
+	}
+	ppPrev = &pFs->HashTable[pNode->dwHash % RAMFS_HASH_SIZE];
+	while(*ppPrev != pNode)
+	{
+		ppPrev = &(*ppPrev)->pHashNext;
+	}
+	*ppPrev = pNode->pHashNext;
+
+	if(pNode->pPrevSibling)
+	{
+		pNode->pPrevSibling->pNextSibling = pNode->pNextSibling;
+	}
+	else
+	{
+		pNode->pParent->pChild = pNode->pNextSibling;
+	}
+	if(pNode->pNextSibling)
+	{
+		pNode->pNextSibling->pPrevSibling = pNode->pPrevSibling;
+	}
+
+	RamFsTruncate(pFs,pNode,0);
+	if(pNode->pExtents)
+	{
+		_hx_free(pNode->pExtents);
+	}
+	if(pNode->dwAttributes & FILE_ATTR_DIRECTORY)
+	{
+		pFs->dwDirNum --;
+	}
+	else
+	{
+		pFs->dwFileNum --;
+	}
+	RELEASE_OBJECT(pNode);
+	return TRUE;
+}
+
+//Append one extent to a file,the extent size grows with the file.
+static BOOL RamFsGrow(__RAMFS* pFs,__RAMFS_NODE* pNode)
+{
+	__RAMFS_EXTENT* pExtents = NULL;
+	DWORD           dwSize   = RAMFS_MIN_EXTENT;
+	BYTE*           pData    = NULL;
+
+	if(pNode->dwExtentNum)
+	{
+		dwSize = pNode->pExtents[pNode->dwExtentNum - 1].dwSize * 2;
+		if(dwSize > RAMFS_MAX_EXTENT)
+		{
+			dwSize = RAMFS_MAX_EXTENT;
+		}
+	}
+	if(pFs->dwUsed + dwSize > pFs->dwCapacity)
+	{
+		dwSize = RAMFS_MIN_EXTENT;  //Try the smallest one.
+		if(pFs->dwUsed + dwSize > pFs->dwCapacity)
+		{
+			pFs->dwFullFails ++;
+			return FALSE;
+		}
+	}
+	if(pNode->dwExtentNum == pNode->dwExtentSlots)  //Enlarge extent array.
+	{
+		pExtents = (__RAMFS_EXTENT*)_hx_malloc(sizeof(__RAMFS_EXTENT) * (pNode->dwExtentSlots + 8));
+		if(NULL == pExtents)
+		{
+			return FALSE;
+		}
+		if(pNode->pExtents)
+		{
+			memcpy(pExtents,pNode->pExtents,sizeof(__RAMFS_EXTENT) * pNode->dwExtentNum);
+			_hx_free(pNode->pExtents);
+		}
+		pNode->pExtents       = pExtents;
+		pNode->dwExtentSlots += 8;
+	}
+	pData = RamFsAllocPages(dwSize);
+	if(NULL == pData)
+	{
+		return FALSE;
+	}
+	pNode->pExtents[pNode->dwExtentNum].pData    = pData;
+	pNode->pExtents[pNode->dwExtentNum].dwOffset = pNode->dwCapacity;
+	pNode->pExtents[pNode->dwExtentNum].dwSize   = dwSize;
+	pNode->dwExtentNum ++;
+	pNode->dwCapacity += dwSize;
+	pFs->dwUsed       += dwSize;
+	pFs->dwExtentAllocs ++;
+	return TRUE;
+}
+
+//Locate the extent containing a file offset,by binary search.
+static DWORD RamFsFindExtent(__RAMFS_NODE* pNode,DWORD dwOffset)
+{
+	DWORD dwLow  = 0;
+	DWORD dwHigh = pNode->dwExtentNum - 1;
+	DWORD dwMid;
+
+	while(dwLow < dwHigh)
+	{
+		dwMid = (dwLow + dwHigh + 1) / 2;
+		if(pNode->pExtents[dwMid].dwOffset <= dwOffset)
+		{
+			dwLow = dwMid;
+		}
+		else
+		{
+			dwHigh = dwMid - 1;
+		}
+	}
+	return dwLow;
+}
+
+//Copy data between a file and a buffer,the range must be within capacity.
+static VOID RamFsCopy(__RAMFS_NODE* pNode,DWORD dwOffset,BYTE* pBuffer,DWORD dwLength,BOOL bWrite)
+{
+	__RAMFS_EXTENT* pExt  = NULL;
+	DWORD           dwIndex;
+	DWORD           dwIn;
+	DWORD           dwChunk;
+
+	if(0 == dwLength)
+	{
+		return;
+	}
+	dwIndex = RamFsFindExtent(pNode,dwOffset);
+	while(dwLength)
+	{
+		pExt    = &pNode->pExtents[dwIndex];
+		dwIn    = dwOffset - pExt->dwOffset;
+		dwChunk = pExt->dwSize - dwIn;
+		if(dwChunk > dwLength)
+		{
+			dwChunk = dwLength;
+		}
+		if(bWrite)
+		{
+			memcpy(pExt->pData + dwIn,pBuffer,dwChunk);
+		}
+		else
+		{
+			memcpy(pBuffer,pExt->pData + dwIn,dwChunk);
+		}
+		dwOffset += dwChunk;
+		pBuffer  += dwChunk;
+		dwLength -= dwChunk;
+		dwIndex ++;
+	}
+}
+
+//Implementation of DeviceOpen.
+static __COMMON_OBJECT* RamFsDeviceOpen(__COMMON_OBJECT* lpDrv,
+										__COMMON_OBJECT* lpDev,
+										__DRCB* lpDrcb)
+{
+	__RAMFS*            pFs         = NULL;
+	__RAMFS_NODE*       pNode       = NULL;
+	__RAMFS_FILE*       pFile       = NULL;
+	__DEVICE_OBJECT*    pFileDevice = NULL;
+	CHAR                FileDevName[32];
+	static DWORD        dwNameIndex = 0;
+
+	if((NULL == lpDrv) || (NULL == lpDev) || (NULL == lpDrcb))
+	{
+		return NULL;
+	}
+	pFs = (__RAMFS*)((__DEVICE_OBJECT*)lpDev)->lpDevExtension;
+	WaitForThisObject(pFs->hMutex);
+	pNode = RamFsResolve(pFs,(LPCSTR)lpDrcb->lpInputBuffer,NULL);
+	if((NULL == pNode) || (pNode->dwAttributes & FILE_ATTR_DIRECTORY))
+	{
+		goto __TERMINAL;
+	}
+	pFile = (__RAMFS_FILE*)CREATE_OBJECT(__RAMFS_FILE);
+	if(NULL == pFile)
+	{
+		goto __TERMINAL;
+	}
+	pFile->pFileSystem = pFs;
+	pFile->pNode       = pNode;
+	pFile->dwCurrPos   = 0;
+	pFile->dwOpenMode  = lpDrcb->dwInputLen;  //dwInputLen is used to contain open mode.
+
+	_hx_sprintf(FileDevName,"%s%X",RAMFS_FILE_NAME_BASE,dwNameIndex ++);
+	pFileDevice = IOManager.CreateDevice((__COMMON_OBJECT*)&IOManager,
+		FileDevName,
+		DEVICE_TYPE_FILE,
+		1, //For file,block size is 1.
+		DEVICE_BLOCK_SIZE_ANY,
+		DEVICE_BLOCK_SIZE_ANY,
+		pFile,
+		(__DRIVER_OBJECT*)lpDrv);
+	if(NULL == pFileDevice)
+	{
+		RELEASE_OBJECT(pFile);
+		goto __TERMINAL;
+	}
+	pNode->dwOpenCount ++;
+
+__TERMINAL:
+	ReleaseMutex(pFs->hMutex);
+	return (__COMMON_OBJECT*)pFileDevice;
+}
+
+//Implementation of DeviceClose.
+static DWORD RamFsDeviceClose(__COMMON_OBJECT* lpDrv,
+							  __COMMON_OBJECT* lpDev,
+							  __DRCB* lpDrcb)
+{
+	__DEVICE_OBJECT*    pFileDevice = (__DEVICE_OBJECT*)lpDev;
+	__RAMFS_FILE*       pFile       = NULL;
+	__RAMFS*            pFs         = NULL;
+
+	if(NULL == pFileDevice)
+	{
+		return 0;
+	}
+	pFile = (__RAMFS_FILE*)pFileDevice->lpDevExtension;
+	pFs   = pFile->pFileSystem;
+	WaitForThisObject(pFs->hMutex);
+	pFile->pNode->dwOpenCount --;
+	ReleaseMutex(pFs->hMutex);
+	RELEASE_OBJECT(pFile);
+	IOManager.DestroyDevice((__COMMON_OBJECT*)&IOManager,pFileDevice);
+	return 0;
+}
+
+//Implementation of DeviceCreate,creates a new empty file.
+static DWORD RamFsDeviceCreate(__COMMON_OBJECT* lpDrv,
+							   __COMMON_OBJECT* lpDev,
+							   __DRCB* lpDrcb)
+{
+	__RAMFS*            pFs      = NULL;
+	__RAMFS_NODE*       pParent  = NULL;
+	CHAR                Name[RAMFS_NAME_LEN];
+	DWORD               dwResult = 0;
+
+	if((NULL == lpDev) || (NULL == lpDrcb) || (NULL == lpDrcb->lpInputBuffer))
+	{
+		return 0;
+	}
+	pFs = (__RAMFS*)((__DEVICE_OBJECT*)lpDev)->lpDevExtension;
+	WaitForThisObject(pFs->hMutex);
+	pParent = RamFsResolve(pFs,(LPCSTR)lpDrcb->lpInputBuffer,Name);
+	if(RamFsCreateNode(pFs,pParent,Name,FILE_ATTR_ARCHIVE))
+	{
+		dwResult = 1;
+	}
+	ReleaseMutex(pFs->hMutex);
+	return dwResult;
+}
+
+//Implementation of DeviceRead,reads from current position.
+static DWORD RamFsDeviceRead(__COMMON_OBJECT* lpDrv,
+							 __COMMON_OBJECT* lpDev,
+							 __DRCB* lpDrcb)
+{
+	__RAMFS_FILE*       pFile    = NULL;
+	__RAMFS*            pFs      = NULL;
+	DWORD               dwToRead = 0;
+
+	if((NULL == lpDev) || (NULL == lpDrcb))
+	{
+		return 0;
+	}
+	pFile = (__RAMFS_FILE*)((__DEVICE_OBJECT*)lpDev)->lpDevExtension;
+	pFs   = pFile->pFileSystem;
+	WaitForThisObject(pFs->hMutex);
+	dwToRead = lpDrcb->dwOutputLen;  //dwOutputLen contains the desired read size.
+	if(pFile->dwCurrPos >= pFile->pNode->dwFileSize)
+	{
+		dwToRead = 0;
+	}
+	else if(dwToRead > pFile->pNode->dwFileSize - pFile->dwCurrPos)
+	{
+		dwToRead = pFile->pNode->dwFileSize - pFile->dwCurrPos;
+	}
+	RamFsCopy(pFile->pNode,pFile->dwCurrPos,(BYTE*)lpDrcb->lpOutputBuffer,dwToRead,FALSE);
+	pFile->dwCurrPos += dwToRead;
+	pFs->dwReads ++;
+	pFs->dwReadBytes += dwToRead;
+	pFs->dwReadKB    += pFs->dwReadBytes / 1024;  //Carry whole KBs,keep the rest.
+	pFs->dwReadBytes %= 1024;
+	ReleaseMutex(pFs->hMutex);
+	lpDrcb->dwStatus = DRCB_STATUS_SUCCESS;
+	return dwToRead;
+}
+
+//Implementation of DeviceWrite,writes at current position and extends the
+//file if necessary.
+static DWORD RamFsDeviceWrite(__COMMON_OBJECT* lpDrv,
+							  __COMMON_OBJECT* lpDev,
+							  __DRCB* lpDrcb)
+{
+	__RAMFS_FILE*       pFile     = NULL;
+	__RAMFS_NODE*       pNode     = NULL;
+	__RAMFS*            pFs       = NULL;
+	DWORD               dwToWrite = 0;
+	DWORD               dwEnd     = 0;
+
+	if((NULL == lpDev) || (NULL == lpDrcb))
+	{
+		return 0;
+	}
+	pFile = (__RAMFS_FILE*)((__DEVICE_OBJECT*)lpDev)->lpDevExtension;
+	pNode = pFile->pNode;
+	pFs   = pFile->pFileSystem;
+	WaitForThisObject(pFs->hMutex);
+	dwToWrite = lpDrcb->dwInputLen;
+	if(pFile->dwCurrPos + dwToWrite < pFile->dwCurrPos)  //Overflow.
+	{
+		dwToWrite = 0xFFFFFFFF - pFile->dwCurrPos;
+	}
+	dwEnd = pFile->dwCurrPos + dwToWrite;
+	while(pNode->dwCapacity < dwEnd)
+	{
+		if(!RamFsGrow(pFs,pNode))  //Write as much as possible.
+		{
+			dwEnd     = pNode->dwCapacity;
+			dwToWrite = (dwEnd > pFile->dwCurrPos) ? (dwEnd - pFile->dwCurrPos) : 0;
+			break;
+		}
+	}
+	//Zero the gap if writing beyond the end of file,it may happen when the
+	//file is truncated through another handle.
+	if((pFile->dwCurrPos > pNode->dwFileSize) && (pNode->dwCapacity >= pFile->dwCurrPos))
+	{
+		DWORD dwGap = pFile->dwCurrPos - pNode->dwFileSize;
+		DWORD dwPos = pNode->dwFileSize;
+		BYTE  Zero[64] = { 0 };
+
+		while(dwGap)
+		{
+			DWORD dwChunk = (dwGap > sizeof(Zero)) ? sizeof(Zero) : dwGap;
+			RamFsCopy(pNode,dwPos,Zero,dwChunk,TRUE);
+			dwPos += dwChunk;
+			dwGap -= dwChunk;
+		}
+	}
+	RamFsCopy(pNode,pFile->dwCurrPos,(BYTE*)lpDrcb->lpInputBuffer,dwToWrite,TRUE);
+	pFile->dwCurrPos += dwToWrite;
+	if(pFile->dwCurrPos > pNode->dwFileSize)
+	{
+		pNode->dwFileSize = pFile->dwCurrPos;
+	}
+	pFs->dwWrites ++;
+	pFs->dwWriteBytes += dwToWrite;
+	pFs->dwWriteKB    += pFs->dwWriteBytes / 1024;  //Carry whole KBs,keep the rest.
+	pFs->dwWriteBytes %= 1024;
+	ReleaseMutex(pFs->hMutex);
+	lpDrcb->dwStatus = (dwToWrite == lpDrcb->dwInputLen) ? DRCB_STATUS_SUCCESS : DRCB_STATUS_FAIL;
+	return dwToWrite;
+}
+
+//Implementation of DeviceSeek.
+static DWORD RamFsDeviceSeek(__COMMON_OBJECT* lpDrv,
+							 __COMMON_OBJECT* lpDev,
+							 __DRCB* lpDrcb)
+{
+	__RAMFS_FILE*       pFile    = NULL;
+	DWORD               dwWhere  = 0;
+	INT                 nOffset  = 0;
+	DWORD               dwPos    = 0;
+
+	if((NULL == lpDev) || (NULL == lpDrcb))
+	{
+		return (DWORD)-1;
+	}
+	pFile   = (__RAMFS_FILE*)((__DEVICE_OBJECT*)lpDev)->lpDevExtension;
+	dwWhere = (DWORD)lpDrcb->lpInputBuffer;
+	nOffset = *((INT*)lpDrcb->dwExtraParam1);
+	switch(dwWhere)
+	{
+	case FILE_FROM_BEGIN:
+		dwPos = 0;
+		break;
+	case FILE_FROM_CURRENT:
+		dwPos = pFile->dwCurrPos;
+		break;
+	case FILE_FROM_END:
+		dwPos = pFile->pNode->dwFileSize;
+		break;
+	default:
+		return (DWORD)-1;
+	}
+	if((nOffset < 0) && ((DWORD)(-nOffset) > dwPos))
+	{
+		return (DWORD)-1;
+	}
+	dwPos += nOffset;
+	if(dwPos > pFile->pNode->dwFileSize)  //Same as FAT,can not seek beyond the end.
+	{
+		dwPos = pFile->pNode->dwFileSize;
+	}
+	pFile->dwCurrPos = dwPos;
+	return dwPos;
+}
+
+//Implementation of DeviceSize.
+static DWORD RamFsDeviceSize(__COMMON_OBJECT* lpDrv,
+							 __COMMON_OBJECT* lpDev,
+							 __DRCB* lpDrcb)
+{
+	__RAMFS_FILE*       pFile = NULL;
+
+	if(NULL == lpDev)
+	{
+		return 0;
+	}
+	pFile = (__RAMFS_FILE*)((__DEVICE_OBJECT*)lpDev)->lpDevExtension;
+	return pFile->pNode->dwFileSize;
+}
+
+//Implementation of DeviceFlush,nothing to flush.
+static DWORD RamFsDeviceFlush(__COMMON_OBJECT* lpDrv,
+							  __COMMON_OBJECT* lpDev,
+							  __DRCB* lpDrcb)
+{
+	return 1;
+}
+
+//Fill find data with the next node of a find handle.
+static BOOL RamFsFillFindData(__RAMFS_FIND_HANDLE* pFindHandle,FS_FIND_DATA* pFindData)
+{
+	__RAMFS_NODE*  pNode = pFindHandle->pNext;
+
+	if(NULL == pNode)
+	{
+		return FALSE;
+	}
+	pFindHandle->pNext = pNode->pNextSibling;
+	pFindData->dwFileAttribute = pNode->dwAttributes;
+	pFindData->nFileSizeHigh   = 0;
+	pFindData->nFileSizeLow    = pNode->dwFileSize;
+	strcpy(pFindData->cFileName,pNode->szName);
+	strncpy(pFindData->cAlternateFileName,pNode->szName,12);
+	pFindData->cAlternateFileName[12] = 0;
+	return TRUE;
+}
+
+//Implementation of DeviceCtrl.
+static DWORD RamFsDeviceCtrl(__COMMON_OBJECT* lpDrv,
+							 __COMMON_OBJECT* lpDev,
+							 __DRCB* lpDrcb)
+{
+	__RAMFS*               pFs         = NULL;
+	__RAMFS_NODE*          pNode       = NULL;
+	__RAMFS_FILE*          pFile       = NULL;
+	__RAMFS_FIND_HANDLE*   pFindHandle = NULL;
+	CHAR                   Name[RAMFS_NAME_LEN];
+	DWORD                  dwResult    = 0;
+
+	if((NULL == lpDev) || (NULL == lpDrcb))
+	{
+		return 0;
+	}
+	if(IOCONTROL_FS_SETENDFILE == lpDrcb->dwCtrlCommand)  //Issued to file device.
+	{
+		pFile = (__RAMFS_FILE*)((__DEVICE_OBJECT*)lpDev)->lpDevExtension;
+		pFs   = pFile->pFileSystem;
+		WaitForThisObject(pFs->hMutex);
+		RamFsTruncate(pFs,pFile->pNode,pFile->dwCurrPos);
+		ReleaseMutex(pFs->hMutex);
+		lpDrcb->dwStatus = DRCB_STATUS_SUCCESS;
+		return 1;
+	}
+	pFs = (__RAMFS*)((__DEVICE_OBJECT*)lpDev)->lpDevExtension;
+	if(NULL == pFs)  //Driver device object.
+	{
+		return 0;
+	}
+
+	WaitForThisObject(pFs->hMutex);
+	switch(lpDrcb->dwCtrlCommand)
+	{
+	case IOCONTROL_FS_FINDFIRSTFILE:
+		pNode = RamFsResolve(pFs,(LPCSTR)lpDrcb->dwExtraParam1,NULL);
+		if((NULL == pNode) || !(pNode->dwAttributes & FILE_ATTR_DIRECTORY))
+		{
+			break;
+		}
+		pFindHandle = (__RAMFS_FIND_HANDLE*)CREATE_OBJECT(__RAMFS_FIND_HANDLE);
+		if(NULL == pFindHandle)
+		{
+			break;
+		}
+		pFindHandle->pNext = pNode->pChild;
+		if(!RamFsFillFindData(pFindHandle,(FS_FIND_DATA*)lpDrcb->dwExtraParam2))  //Empty.
+		{
+			RELEASE_OBJECT(pFindHandle);
+			break;
+		}
+		lpDrcb->lpOutputBuffer = (LPVOID)pFindHandle;
+		dwResult = 1;
+		break;
+	case IOCONTROL_FS_FINDNEXTFILE:
+		pFindHandle = (__RAMFS_FIND_HANDLE*)lpDrcb->lpInputBuffer;
+		if(pFindHandle && RamFsFillFindData(pFindHandle,(FS_FIND_DATA*)lpDrcb->dwExtraParam2))
+		{
+			dwResult = 1;
+		}
+		break;
+	case IOCONTROL_FS_FINDCLOSE:
+		pFindHandle = (__RAMFS_FIND_HANDLE*)lpDrcb->dwExtraParam2;
+		if(pFindHandle)
+		{
+			RELEASE_OBJECT(pFindHandle);
+			dwResult = 1;
+		}
+		break;
+	case IOCONTROL_FS_CREATEDIR:
+		pNode = RamFsResolve(pFs,(LPCSTR)lpDrcb->lpInputBuffer,Name);
+		if(RamFsCreateNode(pFs,pNode,Name,FILE_ATTR_DIRECTORY))
+		{
+			dwResult = 1;
+		}
+		break;
+	case IOCONTROL_FS_GETFILEATTR:
+		pNode = RamFsResolve(pFs,(LPCSTR)lpDrcb->dwExtraParam1,NULL);
+		if(pNode)
+		{
+			lpDrcb->dwExtraParam2 = pNode->dwAttributes;
+			dwResult = 1;
+		}
+		break;
+	case IOCONTROL_FS_DELETEFILE:
+	case IOCONTROL_FS_REMOVEDIR:
+		pNode = RamFsResolve(pFs,(LPCSTR)lpDrcb->lpInputBuffer,NULL);
+		if(NULL == pNode)
+		{
+			break;
+		}
+		//Delete file only removes file,and remove directory only removes directory.
+		if((IOCONTROL_FS_DELETEFILE == lpDrcb->dwCtrlCommand) ==
+		   ((pNode->dwAttributes & FILE_ATTR_DIRECTORY) ? TRUE : FALSE))
+		{
+			break;
+		}
+		if(RamFsRemoveNode(pFs,pNode))
+		{
+			dwResult = 1;
+		}
+		break;
+	default:
+		break;
+	}
+	ReleaseMutex(pFs->hMutex);
+	lpDrcb->dwStatus = dwResult ? DRCB_STATUS_SUCCESS : DRCB_STATUS_FAIL;
+	return dwResult;
+}
+
+//Show usage and statistics of RAM file system.
+VOID RamFsShowStat(VOID)
+{
+	__RAMFS*       pFs      = g_pRamFs;
+	__RAMFS_NODE*  pNode    = NULL;
+	DWORD          dwUsed   = 0;
+	DWORD          dwLongest = 0;
+	DWORD          dwLen;
+	int            i;
+
+	if(NULL == pFs)
+	{
+		return;
+	}
+	for(i = 0;i < RAMFS_HASH_SIZE;i ++)
+	{
+		dwLen = 0;
+		for(pNode = pFs->HashTable[i];pNode;pNode = pNode->pHashNext)
+		{
+			dwLen ++;
+		}
+		if(dwLen)
+		{
+			dwUsed ++;
+		}
+		if(dwLen > dwLongest)
+		{
+			dwLongest = dwLen;
+		}
+	}
+	_hx_printf("  RAMFS: %d KB used of %d KB,%d file(s),%d dir(s).\r\n",
+		pFs->dwUsed / 1024,
+		pFs->dwCapacity / 1024,
+		pFs->dwFileNum,
+		pFs->dwDirNum);
+	_hx_printf("  RAMFS: reads %d (%d KB),writes %d (%d KB),extents %d,full %d.\r\n",
+		pFs->dwReads,
+		pFs->dwReadKB,
+		pFs->dwWrites,
+		pFs->dwWriteKB,
+		pFs->dwExtentAllocs,
+		pFs->dwFullFails);
+	_hx_printf("  RAMFS: lookups %d,probes %d,buckets %d/%d,longest chain %d.\r\n",
+		pFs->dwLookups,
+		pFs->dwProbes,
+		dwUsed,
+		RAMFS_HASH_SIZE,
+		dwLongest);
+}
+
+//Implementation of DriverEntry routine for RAM file system.The file system
+//is created and added to IOManager directly since it has no partition.
+BOOL RamFsDriverEntry(__DRIVER_OBJECT* lpDriverObject)
+{
+	__DEVICE_OBJECT*  pRamFsObject = NULL;
+	__RAMFS*          pFs          = NULL;
+
+	//Initialize the driver object.
+	lpDriverObject->DeviceClose   = RamFsDeviceClose;
+	lpDriverObject->DeviceCtrl    = RamFsDeviceCtrl;
+	lpDriverObject->DeviceFlush   = RamFsDeviceFlush;
+	lpDriverObject->DeviceOpen    = RamFsDeviceOpen;
+	lpDriverObject->DeviceRead    = RamFsDeviceRead;
+	lpDriverObject->DeviceSeek    = RamFsDeviceSeek;
+	lpDriverObject->DeviceWrite   = RamFsDeviceWrite;
+	lpDriverObject->DeviceCreate  = RamFsDeviceCreate;
+	lpDriverObject->DeviceSize    = RamFsDeviceSize;
+
+	pFs = (__RAMFS*)CREATE_OBJECT(__RAMFS);
+	if(NULL == pFs)
+	{
+		goto __TERMINAL;
+	}
+	pFs->dwCapacity = RAMFS_CAPACITY;
+	pFs->pRoot = (__RAMFS_NODE*)CREATE_OBJECT(__RAMFS_NODE);
+	if(NULL == pFs->pRoot)
+	{
+		goto __TERMINAL;
+	}
+	pFs->pRoot->dwAttributes = FILE_ATTR_DIRECTORY;
+	pFs->hMutex = CreateMutex();
+	if(NULL == pFs->hMutex)
+	{
+		goto __TERMINAL;
+	}
+
+	pRamFsObject = IOManager.CreateDevice((__COMMON_OBJECT*)&IOManager,
+		RAMFS_DEVICE_NAME,
+		DEVICE_TYPE_RAMFS,
+		DEVICE_BLOCK_SIZE_INVALID,  //File system object can not be accessed directly.
+		DEVICE_BLOCK_SIZE_INVALID,
+		DEVICE_BLOCK_SIZE_INVALID,
+		(LPVOID)pFs,
+		lpDriverObject);
+	if(NULL == pRamFsObject)
+	{
+		goto __TERMINAL;
+	}
+	if(!IOManager.AddFileSystem((__COMMON_OBJECT*)&IOManager,
+		(__COMMON_OBJECT*)pRamFsObject,
+		FILE_SYSTEM_TYPE_RAM,
+		RAMFS_VOLUME_LABEL "     "))  //Volume label is VOLUME_LBL_LEN - 1 bytes at least.
+	{
+		IOManager.DestroyDevice((__COMMON_OBJECT*)&IOManager,pRamFsObject);
+		goto __TERMINAL;
+	}
+	g_pRamFs = pFs;
+	return TRUE;
+
+__TERMINAL:
+	if(pFs)
+	{
+		if(pFs->hMutex)
+		{
+			DestroyMutex(pFs->hMutex);
+		}
+		if(pFs->pRoot)
+		{
+			RELEASE_OBJECT(pFs->pRoot);
+		}
+		RELEASE_OBJECT(pFs);
+	}
+	return FALSE;
+}
+
+#endif
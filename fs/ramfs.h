@@ -0,0 +1,102 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : ramfs.h
+//    Module Funciton           :
+//                                RAM file system,files and directories reside
+//                                in memory only and are lost when system restarts.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#ifndef __RAMFS_H__
+#define __RAMFS_H__
+
+#define RAMFS_DRIVER_DEVICE_NAME "\\\\.\\FS_RAMFS"    //Name of RAMFS driver device object.
+#define RAMFS_DEVICE_NAME        "\\\\.\\RAMFS_DEV0"  //Name of RAM file system device.
+#define RAMFS_FILE_NAME_BASE     "\\\\.\\RAM_FILE"    //File device name base.
+#define RAMFS_VOLUME_LABEL       "RAMDISK"
+
+//Maximal bytes all files can occupy.
+#define RAMFS_CAPACITY           (16 * 1024 * 1024)
+
+//File data is stored in extents,the first one is RAMFS_MIN_EXTENT bytes,and
+//each following one doubles until RAMFS_MAX_EXTENT.
+#define RAMFS_MIN_EXTENT         4096
+#define RAMFS_MAX_EXTENT         (256 * 1024)
+
+#define RAMFS_HASH_SIZE          128          //Buckets of directory index.
+#define RAMFS_NAME_LEN           64           //Maximal length of one name level.
+
+//Data extent of a file.
+typedef struct tag__RAMFS_EXTENT{
+	BYTE*                     pData;
+	DWORD                     dwOffset;       //Offset in file.
+	DWORD                     dwSize;
+}__RAMFS_EXTENT;
+
+//One file or directory.
+typedef struct tag__RAMFS_NODE{
+	struct tag__RAMFS_NODE*   pHashNext;      //Next node in the same hash bucket.
+	struct tag__RAMFS_NODE*   pParent;
+	struct tag__RAMFS_NODE*   pChild;         //First child of a directory.
+	struct tag__RAMFS_NODE*   pNextSibling;
+	struct tag__RAMFS_NODE*   pPrevSibling;
+	CHAR                      szName[RAMFS_NAME_LEN];
+	DWORD                     dwHash;
+	DWORD                     dwAttributes;
+	DWORD                     dwFileSize;
+	DWORD                     dwCapacity;     //Total bytes of extents.
+	__RAMFS_EXTENT*           pExtents;
+	DWORD                     dwExtentNum;
+	DWORD                     dwExtentSlots;  //Elements of pExtents array.
+	DWORD                     dwOpenCount;
+}__RAMFS_NODE;
+
+//RAM file system object.
+typedef struct tag__RAMFS{
+	__RAMFS_NODE*             pRoot;
+	__RAMFS_NODE*             HashTable[RAMFS_HASH_SIZE];
+	HANDLE                    hMutex;
+	DWORD                     dwCapacity;
+	DWORD                     dwUsed;         //Bytes of all extents.
+	DWORD                     dwFileNum;
+	DWORD                     dwDirNum;
+
+	//Statistics.
+	DWORD                     dwLookups;
+	DWORD                     dwProbes;       //Nodes compared by lookups.
+	DWORD                     dwReads;
+	DWORD                     dwWrites;
+	DWORD                     dwReadKB;
+	DWORD                     dwWriteKB;
+	DWORD                     dwReadBytes;    //Bytes read not yet counted in dwReadKB.
+	DWORD                     dwWriteBytes;   //Bytes written not yet counted in dwWriteKB.
+	DWORD                     dwExtentAllocs;
+	DWORD                     dwFullFails;    //Writes failed by capacity limit.
+}__RAMFS;
+
+//Opened file.
+typedef struct tag__RAMFS_FILE{
+	__RAMFS*                  pFileSystem;
+	__RAMFS_NODE*             pNode;
+	DWORD                     dwCurrPos;
+	DWORD                     dwOpenMode;
+}__RAMFS_FILE;
+
+//Directory iterator.
+typedef struct tag__RAMFS_FIND_HANDLE{
+	__RAMFS_NODE*             pNext;
+}__RAMFS_FIND_HANDLE;
+
+//Entry point for RAMFS driver.
+BOOL RamFsDriverEntry(__DRIVER_OBJECT* lpDriverObject);
+
+//Show usage and statistics of RAM file system.
+VOID RamFsShowStat(VOID);
+
+#endif  //__RAMFS_H__
@@ -29,4 +29,14 @@ typedef DWORD                    sys_prot_t;
 typedef __COMMON_OBJECT*         sys_mbox_t;
 typedef __COMMON_OBJECT*         sys_sem_t;
 
+//Mutex used by lwIP,the owner is raised to tcpip thread's priority while
+//holding it,the priority it had before is saved here to restore.
+typedef struct tag__SYS_MUTEX{
+	__COMMON_OBJECT*         pMutex;          //Kernel mutex object.
+	__KERNEL_THREAD_OBJECT*  pOwner;
+	DWORD                    dwOwnerPriority;
+	BOOL                     bRaised;         //Owner's priority is raised.
+}__SYS_MUTEX;
+typedef __SYS_MUTEX              sys_mutex_t;
+
 #endif /* __ARCH_SYS_ARCH_H__ */
@@ -0,0 +1,97 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : blkqueue.h
+//    Module Funciton           :
+//                                Per disk block request queue,i.e,the I/O scheduler
+//                                between file systems and disk drivers.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#ifndef __BLKQUEUE_H__
+#define __BLKQUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Expire time of read and write requests,in million second.Reads are always
+//served ahead of writes unless the oldest write is expired.
+#define BLKQ_READ_EXPIRE       50
+#define BLKQ_WRITE_EXPIRE      500
+
+//Maximal sectors one dispatch can carry after merging.
+#define BLKQ_MAX_MERGE_SECTORS 128
+
+//Maximal batches one thread dispatches in a row,then the dispatching is handed
+//over to the submitter of next batch,so no thread serves others endlessly.
+#define BLKQ_MAX_DRAIN_BATCHES 8
+
+#define BLKQ_NAME_LEN          16
+
+//Batch dispatch routine supplied by disk driver,it transfers dwSectorNum
+//continuous sectors from or to the disk in one command.
+typedef BOOL (*__BLKQ_DISPATCH)(LPVOID pDiskParam,BOOL bWrite,
+	DWORD dwStartSector,DWORD dwSectorNum,BYTE* pBuffer);
+
+//One pending block request.
+typedef struct tag__BLK_REQUEST{
+	struct tag__BLK_REQUEST*  pNext;          //Sorted by start sector.
+	BOOL                      bWrite;
+	DWORD                     dwStartSector;
+	DWORD                     dwSectorNum;
+	BYTE*                     pBuffer;
+	DWORD                     dwDeadline;     //Expire tick.
+	HANDLE                    hEvent;         //Signaled when the request is over.
+	BOOL                      bResult;
+	DWORD                     dwBatchNum;     //Sectors of the batch this request heads,if it's
+	                                          //submitter is woken up to dispatch it.
+}__BLK_REQUEST;
+
+//Request queue of one disk.
+typedef struct tag__BLK_QUEUE{
+	struct tag__BLK_QUEUE*    pNext;          //All queues in system.
+	CHAR                      szName[BLKQ_NAME_LEN];
+	LPVOID                    pDiskParam;
+	__BLKQ_DISPATCH           Dispatch;
+	DWORD                     dwSectorSize;
+	DWORD                     dwMaxSectors;   //Maximal sectors of one dispatch.
+	BYTE*                     pMergeBuffer;   //dwMaxSectors * dwSectorSize.
+
+	BOOL                      bBusy;          //A thread is dispatching.
+	DWORD                     dwHeadPos;      //Sector after the last dispatched one.
+	__BLK_REQUEST*            pReadList;
+	__BLK_REQUEST*            pWriteList;
+	DWORD                     dwDepth;        //Requests in queue now.
+
+	//Statistics.
+	DWORD                     dwRequests;     //Requests submitted.
+	DWORD                     dwDispatches;   //Commands issued to disk.
+	DWORD                     dwBackMerges;
+	DWORD                     dwFrontMerges;
+	DWORD                     dwMaxDepth;
+	DWORD                     dwDepthSum;     //Sum of queue depth seen by requests.
+	DWORD                     dwExpired;      //Dispatched because of expiration.
+}__BLK_QUEUE;
+
+//Create a request queue for one disk.
+__BLK_QUEUE* BlkQueueCreate(LPCSTR pszName,LPVOID pDiskParam,__BLKQ_DISPATCH Dispatch,
+	DWORD dwSectorSize,DWORD dwMaxSectors);
+
+//Submit one request and wait it to finish.
+BOOL BlkQueueSubmit(__BLK_QUEUE* pQueue,BOOL bWrite,DWORD dwStartSector,
+	DWORD dwSectorNum,BYTE* pBuffer);
+
+//Show statistics of all request queues.
+VOID BlkQueueShowStat(VOID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__BLKQUEUE_H__
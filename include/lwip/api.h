@@ -130,6 +130,32 @@ struct api_msg_msg;
 /** A callback prototype to inform about events for a netconn */
 typedef void (* netconn_callback)(struct netconn *, enum netconn_evt, u16_t len);
 
+#if LWIP_NETCONN_UDP_RING
+/** A datagram queued in the receive ring of a UDP netconn */
+struct netconn_dgram {
+  struct pbuf *p;
+  ip_addr_t addr;
+  u16_t port;
+};
+
+/** Receive ring of a UDP netconn, filled by recv_udp in the core context */
+struct netconn_ring {
+  /** next entry to read, free running */
+  u16_t head;
+  /** next entry to write, free running */
+  u16_t tail;
+  /** readers blocked on recvmbox that no doorbell is rung for yet */
+  u8_t waiters;
+  /** datagrams dropped since the ring was full */
+  u32_t drops;
+  struct netconn_dgram dgrams[UDP_RECV_RING_SIZE];
+};
+
+/** Flags for netconn_recv_dgram */
+#define NETCONN_DGRAM_NOWAIT 0x01
+#define NETCONN_DGRAM_PEEK   0x02
+#endif /* LWIP_NETCONN_UDP_RING */
+
 /** A netconn descriptor */
 struct netconn {
   /** type of the netconn (TCP, UDP or RAW) */
@@ -150,6 +176,10 @@ struct netconn {
   /** mbox where received packets are stored until they are fetched
       by the netconn application thread (can grow quite big) */
   sys_mbox_t recvmbox;
+#if LWIP_NETCONN_UDP_RING
+  /** UDP: received datagrams, recvmbox only wakes up readers then */
+  struct netconn_ring *recvring;
+#endif /* LWIP_NETCONN_UDP_RING */
 #if LWIP_TCP
   /** mbox where new connections are stored until processed
       by the application thread */
@@ -226,6 +256,9 @@ err_t   netconn_listen_with_backlog(struct netconn *conn, u8_t backlog);
 err_t   netconn_accept(struct netconn *conn, struct netconn **new_conn);
 err_t   netconn_recv(struct netconn *conn, struct netbuf **new_buf);
 err_t   netconn_recv_tcp_pbuf(struct netconn *conn, struct pbuf **new_buf);
+#if LWIP_NETCONN_UDP_RING
+err_t   netconn_recv_dgram(struct netconn *conn, struct netconn_dgram *dgram, u8_t flags);
+#endif /* LWIP_NETCONN_UDP_RING */
 void    netconn_recved(struct netconn *conn, u32_t length);
 err_t   netconn_sendto(struct netconn *conn, struct netbuf *buf,
                        ip_addr_t *addr, u16_t port);
@@ -241,6 +274,7 @@ err_t   netconn_join_leave_group(struct netconn *conn, ip_addr_t *multiaddr,
 #endif /* LWIP_IGMP */
 #if LWIP_DNS
 err_t   netconn_gethostbyname(const char *name, ip_addr_t *addr);
+err_t   netconn_gethostbyname_addrs(const char *name, ip_addr_t *addrs, u8_t *numaddrs);
 #endif /* LWIP_DNS */
 
 #define netconn_err(conn)               ((conn)->last_err)
@@ -134,6 +134,8 @@ struct dns_api_msg {
   const char *name;
   /** Rhe resolved address is stored here */
   ip_addr_t *addr;
+  /** Number of elements of addr, set to the number of addresses stored */
+  u8_t *numaddrs;
   /** This semaphore is posted when the name is resolved, the application thread
       should wait on it. */
   sys_sem_t *sem;
@@ -164,6 +166,9 @@ void do_gethostbyname(void *arg);
 
 struct netconn* netconn_alloc(enum netconn_type t, netconn_callback callback);
 void netconn_free(struct netconn *conn);
+#if LWIP_NETCONN_UDP_RING
+void netconn_ring_wakeup(struct netconn *conn);
+#endif /* LWIP_NETCONN_UDP_RING */
 
 #ifdef __cplusplus
 }
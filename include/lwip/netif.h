@@ -94,6 +94,16 @@ extern "C" {
  * Set by the netif driver in its init function. */
 #define NETIF_FLAG_IGMP         0x80U
 
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+/** Checksums generated in software for packets sent through the netif,
+ * see netif->chksum_flags. A cleared flag leaves the checksum to the NIC,
+ * the packet is marked with PBUF_FLAG_TX_CSUM. */
+#define NETIF_CHECKSUM_GEN_UDP      0x0001U
+#define NETIF_CHECKSUM_GEN_TCP      0x0002U
+#define NETIF_CHECKSUM_ENABLE_ALL   0xFFFFU
+#define NETIF_CHECKSUM_DISABLE_ALL  0x0000U
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+
 /** Function prototype for netif init functions. Set up flags and output/linkoutput
  * callback functions in this function.
  *
@@ -190,6 +200,16 @@ struct netif {
   char name[2];
   /** number of this interface */
   u8_t num;
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+  /** checksums generated in software (see NETIF_CHECKSUM_ above) */
+  u16_t chksum_flags;
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+#if LWIP_TCP_TSO
+  /** largest IP packet the NIC segments for TCP, 0 if TSO is not supported */
+  u16_t tso_max;
+  /** most pbufs the NIC gathers into one TSO packet, including the header */
+  u8_t tso_max_pbufs;
+#endif /* LWIP_TCP_TSO */
 #if LWIP_SNMP
   /** link type (from "snmp_ifType" enum from snmp.h) */
   u8_t link_type;
@@ -213,8 +233,12 @@ struct netif {
   netif_igmp_mac_filter_fn igmp_mac_filter;
 #endif /* LWIP_IGMP */
 #if LWIP_NETIF_HWADDRHINT
-  u8_t *addr_hint;
+  u16_t *addr_hint;
 #endif /* LWIP_NETIF_HWADDRHINT */
+#if LWIP_ARP
+  /** ARP table index last used to send through this netif */
+  u16_t arp_hint;
+#endif /* LWIP_ARP */
 #if ENABLE_LOOPBACK
   /* List of packets to be queued for ourselves. */
   struct pbuf *loop_first;
@@ -225,6 +249,16 @@ struct netif {
 #endif /* ENABLE_LOOPBACK */
 };
 
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+#define NETIF_SET_CHECKSUM_CTRL(netif, chksumflags) ((netif)->chksum_flags = (chksumflags))
+/** netif may be NULL if the route is not known, checksum is generated then */
+#define NETIF_CHECKSUM_ENABLED(netif, chksumflag) \
+  (((netif) == NULL) || (((netif)->chksum_flags & (chksumflag)) != 0))
+#else /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+#define NETIF_SET_CHECKSUM_CTRL(netif, chksumflags)
+#define NETIF_CHECKSUM_ENABLED(netif, chksumflag) 1
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+
 #if LWIP_SNMP
 #define NETIF_INIT_SNMP(netif, type, speed) \
   /* use "snmp_ifType" enum from snmp.h for "type", snmp_ifType_ethernet_csmacd by example */ \
@@ -249,6 +283,8 @@ struct netif {
 extern struct netif *netif_list;
 /** The default network interface. */
 extern struct netif *netif_default;
+/** Generation of routing state, see netif_route_gen in netif.c. */
+extern u32_t netif_route_gen;
 
 void netif_init(void);
 
@@ -425,12 +425,29 @@
 #endif
 
 /**
- * ARP_TABLE_SIZE: Number of active MAC-IP address pairs cached.
+ * ARP_TABLE_SIZE: Number of active MAC-IP address pairs cached. The table
+ * is allocated from the heap with this number of entries at start up.
  */
 #ifndef ARP_TABLE_SIZE
 #define ARP_TABLE_SIZE                  10
 #endif
 
+/**
+ * ARP_TABLE_MAX_SIZE: The ARP table is doubled when it is full, up to this
+ * number of entries. Old entries are recycled only when it can't grow.
+ */
+#ifndef ARP_TABLE_MAX_SIZE
+#define ARP_TABLE_MAX_SIZE              ARP_TABLE_SIZE
+#endif
+
+/**
+ * ARP_HASH_SIZE: Number of hash buckets the ARP table is looked up by,
+ * must be a power of 2.
+ */
+#ifndef ARP_HASH_SIZE
+#define ARP_HASH_SIZE                   16
+#endif
+
 /**
  * ARP_QUEUEING==1: Multiple outgoing packets are queued during hardware address
  * resolution. By default, only the most recent packet is queued per IP address.
@@ -442,6 +459,15 @@
 #define ARP_QUEUEING                    0
 #endif
 
+/**
+ * ARP_QUEUE_LEN: The maximum number of packets queued on one pending ARP
+ * entry (ARP_QUEUEING==1), so one unresolved address can't take all of
+ * MEMP_NUM_ARP_QUEUE.
+ */
+#ifndef ARP_QUEUE_LEN
+#define ARP_QUEUE_LEN                   3
+#endif
+
 /**
  * ETHARP_TRUST_IP_MAC==1: Incoming IP packets cause the ARP table to be
  * updated with the source MAC and IP addresses supplied in the packet.
@@ -819,6 +845,48 @@
 #define DNS_MSG_SIZE                    512
 #endif
 
+/** DNS_MAX_REQUESTS: maximum number of callers waiting for queries in
+ * flight. Parallel lookups of the same name share one query, so
+ * DNS_TABLE_SIZE only limits the distinct names being resolved. */
+#ifndef DNS_MAX_REQUESTS
+#define DNS_MAX_REQUESTS                8
+#endif
+
+/** DNS_CACHE_SIZE: number of resolved names cached, with their A records or
+ * with a negative answer. The least recently used one is replaced. */
+#ifndef DNS_CACHE_SIZE
+#define DNS_CACHE_SIZE                  8
+#endif
+
+/** DNS_CACHE_HASH_SIZE: buckets of the cache index, must be a power of 2. */
+#ifndef DNS_CACHE_HASH_SIZE
+#define DNS_CACHE_HASH_SIZE             16
+#endif
+
+/** DNS_MAX_ADDRS_PER_NAME: maximum number of A records cached per name.
+ * dns_gethostbyname hands them out in turn. */
+#ifndef DNS_MAX_ADDRS_PER_NAME
+#define DNS_MAX_ADDRS_PER_NAME          4
+#endif
+
+/** DNS_NEG_TTL: seconds a name which does not exist (or has no A record) is
+ * cached if the response carries no SOA record to take the TTL from. */
+#ifndef DNS_NEG_TTL
+#define DNS_NEG_TTL                     30
+#endif
+
+/** DNS_MAX_NEG_TTL: upper limit of the TTL of negative answers. */
+#ifndef DNS_MAX_NEG_TTL
+#define DNS_MAX_NEG_TTL                 300
+#endif
+
+/** DNS_PREFETCH==1: query a cached name again once 90% of its TTL has passed,
+ * if it has been looked up since it was resolved, so names in use don't
+ * expire and cost a round trip. */
+#ifndef DNS_PREFETCH
+#define DNS_PREFETCH                    1
+#endif
+
 /** DNS_LOCAL_HOSTLIST: Implements a local host-to-address list. If enabled,
  *  you have to define
  *    #define DNS_LOCAL_HOSTLIST_INIT {{"host1", 0x123}, {"host2", 0x234}}
@@ -1019,6 +1087,78 @@
 #define LWIP_TCP_TIMESTAMPS             0
 #endif
 
+/**
+ * LWIP_WND_SCALE==1: support the TCP window scale option (RFC 7323).
+ * TCP_WND and TCP_SND_BUF may then exceed 64K. The receive window is
+ * announced shifted right by TCP_RCV_SCALE, so TCP_WND must not exceed
+ * (0xffff << TCP_RCV_SCALE).
+ */
+#ifndef LWIP_WND_SCALE
+#define LWIP_WND_SCALE                  0
+#endif
+
+/**
+ * TCP_RCV_SCALE: window scale shift count advertised in SYN segments
+ * (0..14), only used when LWIP_WND_SCALE==1.
+ */
+#ifndef TCP_RCV_SCALE
+#define TCP_RCV_SCALE                   0
+#endif
+
+/**
+ * LWIP_TCP_SACK==1: support selective acknowledgements (RFC 2018).
+ * Out-of-sequence data is reported to the peer in SACK blocks, and
+ * segments the peer reports as lost are retransmitted ahead of the
+ * retransmission timeout.
+ */
+#ifndef LWIP_TCP_SACK
+#define LWIP_TCP_SACK                   0
+#endif
+
+/**
+ * TCP_PCB_HASH==1: demultiplex incoming segments through hash tables
+ * instead of walking the PCB lists. Active and TIME-WAIT PCBs are hashed
+ * on the 4-tuple, LISTEN PCBs on the local port, and the PCB the last
+ * segment went to is checked first.
+ */
+#ifndef TCP_PCB_HASH
+#define TCP_PCB_HASH                    0
+#endif
+
+/**
+ * TCP_CONN_HASH_SIZE: number of buckets for active and TIME-WAIT PCBs,
+ * must be a power of 2.
+ */
+#ifndef TCP_CONN_HASH_SIZE
+#define TCP_CONN_HASH_SIZE              64
+#endif
+
+/**
+ * TCP_LISTEN_HASH_SIZE: number of buckets for LISTEN PCBs, must be a
+ * power of 2.
+ */
+#ifndef TCP_LISTEN_HASH_SIZE
+#define TCP_LISTEN_HASH_SIZE            16
+#endif
+
+/**
+ * TCP_MAX_TIME_WAIT: maximum number of PCBs in TIME-WAIT. When another
+ * connection enters TIME-WAIT, the oldest one is freed. 0 means no limit,
+ * TIME-WAIT PCBs are then only reclaimed when tcp_alloc() runs out.
+ */
+#ifndef TCP_MAX_TIME_WAIT
+#define TCP_MAX_TIME_WAIT               0
+#endif
+
+/**
+ * TCP_TW_RECYCLE==1: a SYN for a connection in TIME-WAIT whose sequence
+ * number is above the last one received frees the TIME-WAIT PCB and is
+ * passed to the listener (RFC 1122, 4.2.2.13).
+ */
+#ifndef TCP_TW_RECYCLE
+#define TCP_TW_RECYCLE                  0
+#endif
+
 /**
  * TCP_WND_UPDATE_THRESHOLD: difference in window to trigger an
  * explicit window update
@@ -1333,6 +1473,25 @@
 #define DEFAULT_ACCEPTMBOX_SIZE         0
 #endif
 
+/**
+ * LWIP_NETCONN_UDP_RING==1: UDP netconns queue received datagrams in a fixed
+ * ring of UDP_RECV_RING_SIZE entries instead of posting a netbuf for each one
+ * to recvmbox. recvmbox is then only a one-slot doorbell for blocked readers,
+ * each datagram wakes up one reader, which passes the doorbell on if more
+ * datagrams are queued.
+ */
+#ifndef LWIP_NETCONN_UDP_RING
+#define LWIP_NETCONN_UDP_RING           0
+#endif
+
+/**
+ * UDP_RECV_RING_SIZE: the number of datagrams the receive ring of a UDP
+ * netconn holds, must be a power of 2. (requires LWIP_NETCONN_UDP_RING)
+ */
+#ifndef UDP_RECV_RING_SIZE
+#define UDP_RECV_RING_SIZE              32
+#endif
+
 /*
    ----------------------------------------------
    ---------- Sequential layer options ----------
@@ -1443,6 +1602,32 @@
 #define SO_REUSE_RXTOALL                0
 #endif
 
+/**
+ * LWIP_SOCKET_EPOLL==1: Enable lwip_epoll_create/ctl/wait, an epoll-style
+ * readiness API. Ready sockets are queued by the netconn event callback, so
+ * waiting costs O(ready sockets) instead of a select() scan of all of them.
+ */
+#ifndef LWIP_SOCKET_EPOLL
+#define LWIP_SOCKET_EPOLL               0
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL_NUM: the number of simultaneously open epoll instances.
+ * (requires LWIP_SOCKET_EPOLL)
+ */
+#ifndef LWIP_SOCKET_EPOLL_NUM
+#define LWIP_SOCKET_EPOLL_NUM           4
+#endif
+
+/**
+ * LWIP_SOCKET_MMSG==1: Enable lwip_sendmmsg/lwip_recvmmsg, which move several
+ * datagrams per call. With LWIP_TCPIP_CORE_LOCKING, UDP sockets also cache the
+ * route to the last destination and send without an ip_route() lookup.
+ */
+#ifndef LWIP_SOCKET_MMSG
+#define LWIP_SOCKET_MMSG                0
+#endif
+
 /*
    ----------------------------------------
    ---------- Statistics options ----------
@@ -1779,6 +1964,35 @@
 #define LWIP_CHECKSUM_ON_COPY           0
 #endif
 
+/**
+ * LWIP_CHECKSUM_CTRL_PER_NETIF==1: Checksum generation can be enabled or
+ * disabled for each netif (see NETIF_SET_CHECKSUM_CTRL()), TCP and UDP
+ * checksums are then left to the NIC. Received packets marked with
+ * PBUF_FLAG_RX_CSUM_OK are not checked again in software.
+ */
+#ifndef LWIP_CHECKSUM_CTRL_PER_NETIF
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    0
+#endif
+
+/**
+ * LWIP_TCP_TSO==1: Send consecutive full sized TCP segments in one large
+ * packet through netifs with a non-zero tso_max, the NIC cuts it into the
+ * original segments. The packet references the data of the segments, so
+ * the netif must gather up to tso_max_pbufs pbufs. Requires
+ * LWIP_CHECKSUM_CTRL_PER_NETIF and LWIP_SUPPORT_CUSTOM_PBUF.
+ */
+#ifndef LWIP_TCP_TSO
+#define LWIP_TCP_TSO                    0
+#endif
+
+/**
+ * MEMP_NUM_TCP_TSO_PBUF: the number of pbufs referencing segment data in TSO
+ * packets which are not sent out yet.
+ */
+#ifndef MEMP_NUM_TCP_TSO_PBUF
+#define MEMP_NUM_TCP_TSO_PBUF           TCP_SND_QUEUELEN
+#endif
+
 /*
    ---------------------------------------
    ---------- Debugging options ----------
@@ -69,6 +69,18 @@ typedef enum {
 #define PBUF_FLAG_IS_CUSTOM 0x02U
 /** indicates this pbuf is UDP multicast to be looped back */
 #define PBUF_FLAG_MCASTLOOP 0x04U
+/** indicates rx_chksum holds the sum of the transport data of a received
+    packet, generated while it was copied from the NIC */
+#define PBUF_FLAG_RX_CHKSUM 0x08U
+/** indicates the IP header and TCP/UDP checksums of a received packet were
+    verified by the NIC */
+#define PBUF_FLAG_RX_CSUM_OK 0x10U
+/** indicates the TCP/UDP checksum of a packet to send is left to the NIC,
+    the checksum field holds the sum of the pseudo header */
+#define PBUF_FLAG_TX_CSUM   0x20U
+/** indicates a TCP packet to send is cut into segments of tso_mss bytes by
+    the NIC, the pseudo header sum in the checksum field excludes the length */
+#define PBUF_FLAG_TSO       0x40U
 
 struct pbuf {
   /** next pbuf in singly linked pbuf chain */
@@ -101,8 +113,30 @@ struct pbuf {
    * the stack itself, or pbuf->next pointers from a chain.
    */
   u16_t ref;
+
+#if LWIP_CHECKSUM_ON_COPY
+  /** non-inverted sum of rx_chksum_len bytes of transport data, valid if
+      PBUF_FLAG_RX_CHKSUM is set */
+  u16_t rx_chksum;
+  u16_t rx_chksum_len;
+#endif /* LWIP_CHECKSUM_ON_COPY */
+
+#if LWIP_TCP_TSO
+  /** TCP payload of each segment, valid if PBUF_FLAG_TSO is set */
+  u16_t tso_mss;
+#endif /* LWIP_TCP_TSO */
 };
 
+/** Carry the offloads requested for p_from over to its copy p_to */
+#if LWIP_TCP_TSO
+#define PBUF_COPY_OFFLOAD(p_to, p_from) do { \
+  (p_to)->flags |= (p_from)->flags & (PBUF_FLAG_TX_CSUM | PBUF_FLAG_TSO); \
+  (p_to)->tso_mss = (p_from)->tso_mss; } while(0)
+#else /* LWIP_TCP_TSO */
+#define PBUF_COPY_OFFLOAD(p_to, p_from) \
+  ((p_to)->flags |= (p_from)->flags & PBUF_FLAG_TX_CSUM)
+#endif /* LWIP_TCP_TSO */
+
 #if LWIP_SUPPORT_CUSTOM_PBUF
 /** Prototype for a function to free a custom pbuf */
 typedef void (*pbuf_free_custom_fn)(struct pbuf *p);
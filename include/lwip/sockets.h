@@ -90,7 +90,7 @@ struct sockaddr {
 /*
  * Additional options, not kept in so_options.
  */
-#define SO_SNDBUF    0x1001    /* Unimplemented: send buffer size */
+#define SO_SNDBUF    0x1001    /* send buffer size (TCP) */
 #define SO_RCVBUF    0x1002    /* receive buffer size */
 #define SO_SNDLOWAT  0x1003    /* Unimplemented: send low-water mark */
 #define SO_RCVLOWAT  0x1004    /* Unimplemented: receive low-water mark */
@@ -132,6 +132,7 @@ struct linger {
 #define MSG_OOB        0x04    /* Unimplemented: Requests out-of-band data. The significance and semantics of out-of-band data are protocol-specific */
 #define MSG_DONTWAIT   0x08    /* Nonblocking i/o for this operation only */
 #define MSG_MORE       0x10    /* Sender will send more */
+#define MSG_TRUNC      0x20    /* Datagram was truncated, set in msg_flags by lwip_recvmmsg */
 
 
 /*
@@ -314,6 +315,54 @@ struct timeval {
 };
 #endif /* LWIP_TIMEVAL_PRIVATE */
 
+#if LWIP_SOCKET_EPOLL
+/* Events for lwip_epoll_ctl/lwip_epoll_wait */
+#define EPOLLIN       0x001
+#define EPOLLOUT      0x004
+#define EPOLLERR      0x008
+#define EPOLLONESHOT  (1U << 30)
+#define EPOLLET       (1U << 31)
+
+/* Operations for lwip_epoll_ctl */
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+typedef union epoll_data {
+  void  *ptr;
+  int    fd;
+  u32_t  u32;
+} epoll_data_t;
+
+struct epoll_event {
+  u32_t        events;
+  epoll_data_t data;
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
+#if LWIP_SOCKET_MMSG
+struct iovec {
+  void  *iov_base;
+  size_t iov_len;
+};
+
+struct msghdr {
+  void         *msg_name;       /* Destination or source address, may be NULL */
+  socklen_t     msg_namelen;
+  struct iovec *msg_iov;
+  int           msg_iovlen;
+  void         *msg_control;    /* Unsupported, ignored */
+  socklen_t     msg_controllen;
+  int           msg_flags;      /* MSG_TRUNC on return of lwip_recvmmsg */
+};
+
+/* One message of a batch, msg_len is the bytes sent or received */
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int  msg_len;
+};
+#endif /* LWIP_SOCKET_MMSG */
+
 void lwip_socket_init(void);
 
 int lwip_accept(int s, struct sockaddr *addr, socklen_t *addrlen);
@@ -339,6 +388,15 @@ int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptse
                 struct timeval *timeout);
 int lwip_ioctl(int s, long cmd, void *argp);
 int lwip_fcntl(int s, int cmd, int val);
+#if LWIP_SOCKET_EPOLL
+int lwip_epoll_create(int size);
+int lwip_epoll_ctl(int epfd, int op, int s, struct epoll_event *event);
+int lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+#endif /* LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET_MMSG
+int lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+int lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+#endif /* LWIP_SOCKET_MMSG */
 
 #if LWIP_COMPAT_SOCKETS
 #define accept(a,b,c)         lwip_accept(a,b,c)
@@ -358,6 +416,15 @@ int lwip_fcntl(int s, int cmd, int val);
 #define socket(a,b,c)         lwip_socket(a,b,c)
 #define select(a,b,c,d,e)     lwip_select(a,b,c,d,e)
 #define ioctlsocket(a,b,c)    lwip_ioctl(a,b,c)
+#if LWIP_SOCKET_EPOLL
+#define epoll_create(a)       lwip_epoll_create(a)
+#define epoll_ctl(a,b,c,d)    lwip_epoll_ctl(a,b,c,d)
+#define epoll_wait(a,b,c,d)   lwip_epoll_wait(a,b,c,d)
+#endif /* LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET_MMSG
+#define sendmmsg(a,b,c,d)     lwip_sendmmsg(a,b,c,d)
+#define recvmmsg(a,b,c,d)     lwip_recvmmsg(a,b,c,d)
+#endif /* LWIP_SOCKET_MMSG */
 
 #if LWIP_POSIX_SOCKETS_IO_NAMES
 #define read(a,b,c)           lwip_read(a,b,c)
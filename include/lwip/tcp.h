@@ -151,16 +151,36 @@ enum tcp_state {
 #define DEF_ACCEPT_CALLBACK
 #endif /* LWIP_CALLBACK_API */
 
+#if LWIP_WND_SCALE
+/* Window fields hold the unscaled value, the header carries it shifted */
+typedef u32_t tcpwnd_size_t;
+#define TCPWNDSIZE_F U32_F
+#define RCV_WND_SCALE(pcb, wnd) (((wnd) >> (pcb)->rcv_scale))
+#define SND_WND_SCALE(pcb, wnd) (((tcpwnd_size_t)(wnd) << (pcb)->snd_scale))
+#else /* LWIP_WND_SCALE */
+typedef u16_t tcpwnd_size_t;
+#define TCPWNDSIZE_F U16_F
+#define RCV_WND_SCALE(pcb, wnd) (wnd)
+#define SND_WND_SCALE(pcb, wnd) (wnd)
+#endif /* LWIP_WND_SCALE */
+#define TCPWND_MIN16(x)         ((u16_t)LWIP_MIN((x), 0xffff))
+
+typedef u16_t tcpflags_t;
+
 /**
  * members common to struct tcp_pcb and struct tcp_listen_pcb
  */
 #define TCP_PCB_COMMON(type) \
   type *next; /* for the linked list */ \
+  type *hash_next; /* for the demultiplexing hash bucket */ \
   enum tcp_state state; /* TCP state */ \
   u8_t prio; \
   void *callback_arg; \
   /* the accept callback for listen- and normal pcbs, if LWIP_CALLBACK_API */ \
   DEF_ACCEPT_CALLBACK \
+  /* buffer sizes set by SO_RCVBUF/SO_SNDBUF, inherited on accept */ \
+  tcpwnd_size_t rcv_wnd_max; \
+  tcpwnd_size_t snd_buf_max; \
   /* ports are in host byte order */ \
   u16_t local_port
 
@@ -175,22 +195,24 @@ struct tcp_pcb {
   /* ports are in host byte order */
   u16_t remote_port;
   
-  u8_t flags;
-#define TF_ACK_DELAY   ((u8_t)0x01U)   /* Delayed ACK. */
-#define TF_ACK_NOW     ((u8_t)0x02U)   /* Immediate ACK. */
-#define TF_INFR        ((u8_t)0x04U)   /* In fast recovery. */
-#define TF_TIMESTAMP   ((u8_t)0x08U)   /* Timestamp option enabled */
-#define TF_RXCLOSED    ((u8_t)0x10U)   /* rx closed by tcp_shutdown */
-#define TF_FIN         ((u8_t)0x20U)   /* Connection was closed locally (FIN segment enqueued). */
-#define TF_NODELAY     ((u8_t)0x40U)   /* Disable Nagle algorithm */
-#define TF_NAGLEMEMERR ((u8_t)0x80U)   /* nagle enabled, memerr, try to output to prevent delayed ACK to happen */
+  tcpflags_t flags;
+#define TF_ACK_DELAY   ((tcpflags_t)0x0001U)   /* Delayed ACK. */
+#define TF_ACK_NOW     ((tcpflags_t)0x0002U)   /* Immediate ACK. */
+#define TF_INFR        ((tcpflags_t)0x0004U)   /* In fast recovery. */
+#define TF_TIMESTAMP   ((tcpflags_t)0x0008U)   /* Timestamp option enabled */
+#define TF_RXCLOSED    ((tcpflags_t)0x0010U)   /* rx closed by tcp_shutdown */
+#define TF_FIN         ((tcpflags_t)0x0020U)   /* Connection was closed locally (FIN segment enqueued). */
+#define TF_NODELAY     ((tcpflags_t)0x0040U)   /* Disable Nagle algorithm */
+#define TF_NAGLEMEMERR ((tcpflags_t)0x0080U)   /* nagle enabled, memerr, try to output to prevent delayed ACK to happen */
+#define TF_WND_SCALE   ((tcpflags_t)0x0100U)   /* Window scale option enabled */
+#define TF_SACK        ((tcpflags_t)0x0200U)   /* Peer accepts SACK blocks */
 
   /* the rest of the fields are in host byte order
      as we have to do some math with them */
   /* receiver variables */
   u32_t rcv_nxt;   /* next seqno expected */
-  u16_t rcv_wnd;   /* receiver window available */
-  u16_t rcv_ann_wnd; /* receiver window to announce */
+  tcpwnd_size_t rcv_wnd;   /* receiver window available */
+  tcpwnd_size_t rcv_ann_wnd; /* receiver window to announce */
   u32_t rcv_ann_right_edge; /* announced right edge of window */
 
   /* Timers */
@@ -213,21 +235,24 @@ struct tcp_pcb {
   /* fast retransmit/recovery */
   u32_t lastack; /* Highest acknowledged seqno. */
   u8_t dupacks;
+#if LWIP_TCP_SACK
+  u32_t recover; /* snd_nxt when fast recovery started */
+#endif /* LWIP_TCP_SACK */
   
   /* congestion avoidance/control variables */
-  u16_t cwnd;  
-  u16_t ssthresh;
+  tcpwnd_size_t cwnd;
+  tcpwnd_size_t ssthresh;
 
   /* sender variables */
   u32_t snd_nxt;   /* next new seqno to be sent */
-  u16_t snd_wnd;   /* sender window */
+  tcpwnd_size_t snd_wnd;   /* sender window */
   u32_t snd_wl1, snd_wl2; /* Sequence and acknowledgement numbers of last
                              window update. */
   u32_t snd_lbb;       /* Sequence number of next byte to be buffered. */
 
-  u16_t acked;
+  tcpwnd_size_t acked;
   
-  u16_t snd_buf;   /* Available buffer space for sending (in bytes). */
+  tcpwnd_size_t snd_buf;   /* Available buffer space for sending (in bytes). */
 #define TCP_SNDQUEUELEN_OVERFLOW (0xffffU-3)
   u16_t snd_queuelen; /* Available buffer space for sending (in tcp_segs). */
 
@@ -263,6 +288,11 @@ struct tcp_pcb {
   u32_t ts_recent;
 #endif /* LWIP_TCP_TIMESTAMPS */
 
+#if LWIP_WND_SCALE
+  u8_t snd_scale;  /* shift count of the window the peer announces */
+  u8_t rcv_scale;  /* shift count of the window we announce */
+#endif /* LWIP_WND_SCALE */
+
   /* idle time before KEEPALIVE is sent */
   u32_t keep_idle;
 #if LWIP_TCP_KEEPALIVE
@@ -321,7 +351,8 @@ void             tcp_poll    (struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interv
 void             tcp_err     (struct tcp_pcb *pcb, tcp_err_fn err);
 
 #define          tcp_mss(pcb)             (((pcb)->flags & TF_TIMESTAMP) ? ((pcb)->mss - 12)  : (pcb)->mss)
-#define          tcp_sndbuf(pcb)          ((pcb)->snd_buf)
+#define          tcp_sndbuf(pcb)          (TCPWND_MIN16((pcb)->snd_buf))
+#define          tcp_sndlowat(pcb)        ((u16_t)LWIP_MIN((pcb)->snd_buf_max / 2, 0xfffe))
 #define          tcp_sndqueuelen(pcb)     ((pcb)->snd_queuelen)
 #define          tcp_nagle_disable(pcb)   ((pcb)->flags |= TF_NODELAY)
 #define          tcp_nagle_enable(pcb)    ((pcb)->flags &= ~TF_NODELAY)
@@ -357,6 +388,8 @@ err_t            tcp_write   (struct tcp_pcb *pcb, const void *dataptr, u16_t le
                               u8_t apiflags);
 
 void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
+void             tcp_setsndbuf(struct tcp_pcb *pcb, u32_t size);
+void             tcp_setrcvbuf(struct tcp_pcb *pcb, u32_t size);
 
 #define TCP_PRIO_MIN    1
 #define TCP_PRIO_NORMAL 64
@@ -70,6 +70,9 @@ err_t            tcp_send_empty_ack(struct tcp_pcb *pcb);
 void             tcp_rexmit  (struct tcp_pcb *pcb);
 void             tcp_rexmit_rto  (struct tcp_pcb *pcb);
 void             tcp_rexmit_fast (struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK
+void             tcp_rexmit_sack (struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK */
 u32_t            tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb);
 
 /**
@@ -293,18 +296,46 @@ struct tcp_seg {
 #define TF_SEG_OPTS_TS          (u8_t)0x02U /* Include timestamp option. */
 #define TF_SEG_DATA_CHECKSUMMED (u8_t)0x04U /* ALL data (not the header) is
                                                checksummed into 'chksum' */
+#define TF_SEG_OPTS_WND_SCALE   (u8_t)0x08U /* Include window scale option. */
+#define TF_SEG_OPTS_SACK_PERM   (u8_t)0x10U /* Include SACK permitted option. */
+#define TF_SEG_SACKED           (u8_t)0x20U /* Peer holds this segment (SACK) */
+#define TF_SEG_SACK_REXMIT      (u8_t)0x40U /* Retransmitted by SACK recovery */
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
+#if LWIP_TCP_TSO
+/** A pbuf of a TSO packet referencing the data of a segment, the pbuf holding
+ * the data is referenced until the packet is sent out. */
+struct tcp_tso_pbuf {
+  struct pbuf_custom pc;
+  struct pbuf *original;
+};
+#endif /* LWIP_TCP_TSO */
+
 #define LWIP_TCP_OPT_LENGTH(flags)              \
-  (flags & TF_SEG_OPTS_MSS ? 4  : 0) +          \
-  (flags & TF_SEG_OPTS_TS  ? 12 : 0)
+  ((flags) & TF_SEG_OPTS_MSS       ? 4  : 0) +  \
+  ((flags) & TF_SEG_OPTS_TS        ? 12 : 0) +  \
+  ((flags) & TF_SEG_OPTS_WND_SCALE ? 4  : 0) +  \
+  ((flags) & TF_SEG_OPTS_SACK_PERM ? 4  : 0)
 
 /** This returns a TCP header option for MSS in an u32_t */
-#define TCP_BUILD_MSS_OPTION(x) (x) = PP_HTONL(((u32_t)2 << 24) |          \
-                                               ((u32_t)4 << 16) |          \
-                                               (((u32_t)TCP_MSS / 256) << 8) | \
-                                               (TCP_MSS & 255))
+#define TCP_BUILD_MSS_OPTION(x, mss) (x) = htonl(((u32_t)2 << 24) |        \
+                                                 ((u32_t)4 << 16) |        \
+                                                 (((u32_t)(mss) / 256) << 8) | \
+                                                 ((mss) & 255))
+
+/** NOP + window scale option carrying TCP_RCV_SCALE */
+#define TCP_BUILD_WND_SCALE_OPTION(x) (x) = PP_HTONL(((u32_t)1 << 24) |    \
+                                                     ((u32_t)3 << 16) |    \
+                                                     ((u32_t)3 << 8)  |    \
+                                                     (TCP_RCV_SCALE & 255))
+
+/** NOP + NOP + SACK permitted option */
+#define TCP_BUILD_SACK_PERM_OPTION(x) (x) = PP_HTONL(0x01010402UL)
+
+/** Most SACK blocks put in one ACK, 40 bytes of options hold 4 blocks,
+    only 3 fit next to the timestamp option */
+#define TCP_SACK_MAX_BLOCKS      4
 
 /* Global variables: */
 extern struct tcp_pcb *tcp_input_pcb;
@@ -330,6 +361,35 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
    3) All PCBs in the tcp_listen_pcbs list is in LISTEN state.
    4) All PCBs in the tcp_tw_pcbs list is in TIME-WAIT state.
 */
+/* With TCP_PCB_HASH, active and TIME-WAIT PCBs are also kept in
+   tcp_conn_hash_tbl, hashed on the 4-tuple, and LISTEN PCBs in
+   tcp_listen_hash_tbl, hashed on the local port. TCP_REG and TCP_RMV
+   update these indexes and count the PCBs in TIME-WAIT. */
+#define TCP_PCB_INDEX (TCP_PCB_HASH || TCP_MAX_TIME_WAIT)
+
+#if TCP_PCB_HASH
+#define TCP_LISTEN_HASH(port) (((port) ^ ((port) >> 8)) & (TCP_LISTEN_HASH_SIZE - 1))
+
+extern struct tcp_pcb *tcp_conn_hash_tbl[TCP_CONN_HASH_SIZE];
+extern struct tcp_pcb_listen *tcp_listen_hash_tbl[TCP_LISTEN_HASH_SIZE];
+extern struct tcp_pcb *tcp_last_hit;     /* PCB the last segment went to. */
+
+u16_t tcp_conn_hash(ip_addr_t *local_ip, u16_t local_port,
+                    ip_addr_t *remote_ip, u16_t remote_port);
+#endif /* TCP_PCB_HASH */
+
+#if TCP_PCB_INDEX
+extern u16_t tcp_tw_count;               /* Number of PCBs in tcp_tw_pcbs. */
+
+void tcp_pcb_index_add(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+void tcp_pcb_index_remove(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+#define TCP_INDEX_ADD(pcbs, npcb)    tcp_pcb_index_add(pcbs, npcb)
+#define TCP_INDEX_REMOVE(pcbs, npcb) tcp_pcb_index_remove(pcbs, npcb)
+#else /* TCP_PCB_INDEX */
+#define TCP_INDEX_ADD(pcbs, npcb)
+#define TCP_INDEX_REMOVE(pcbs, npcb)
+#endif /* TCP_PCB_INDEX */
+
 /* Define two macros, TCP_REG and TCP_RMV that registers a TCP PCB
    with a PCB list or removes a PCB from a list, respectively. */
 #ifndef TCP_DEBUG_PCB_LISTS
@@ -349,6 +409,7 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
                             *(pcbs) = (npcb); \
                             LWIP_ASSERT("TCP_RMV: tcp_pcbs sane", tcp_pcbs_sane()); \
               tcp_timer_needed(); \
+                            TCP_INDEX_ADD(pcbs, npcb); \
                             } while(0)
 #define TCP_RMV(pcbs, npcb) do { \
                             LWIP_ASSERT("TCP_RMV: pcbs != NULL", *(pcbs) != NULL); \
@@ -364,6 +425,7 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
                             (npcb)->next = NULL; \
                             LWIP_ASSERT("TCP_RMV: tcp_pcbs sane", tcp_pcbs_sane()); \
                             LWIP_DEBUGF(TCP_DEBUG, ("TCP_RMV: removed %p from %p\n", (npcb), *(pcbs))); \
+                            TCP_INDEX_REMOVE(pcbs, npcb); \
                             } while(0)
 
 #else /* LWIP_DEBUG */
@@ -373,6 +435,7 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
     (npcb)->next = *pcbs;                          \
     *(pcbs) = (npcb);                              \
     tcp_timer_needed();                            \
+    TCP_INDEX_ADD(pcbs, npcb);                     \
   } while (0)
 
 #define TCP_RMV(pcbs, npcb)                        \
@@ -391,6 +454,7 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
       }                                            \
     }                                              \
     (npcb)->next = NULL;                           \
+    TCP_INDEX_REMOVE(pcbs, npcb);                  \
   } while(0)
 
 #endif /* LWIP_DEBUG */
@@ -29,24 +29,193 @@
 //Swich of debugging functions.
 //#define LWIP_DEBUG           1
 
-//Use binary semaphore for mutex.
-#define LWIP_COMPAT_MUTEX    1
+//Use kernel mutex object for lwIP's mutex,implemented in sys_arch.c.
+#define LWIP_COMPAT_MUTEX    0
+
+//Socket and netconn API calls lock the TCP/IP core and run in the caller's
+//context,instead of posting a message to tcpip thread and waiting for it,
+//tcpip thread processes timers and input packets only.
+#define LWIP_TCPIP_CORE_LOCKING 1
 
 //Use light weight protection.
 #define SYS_LIGHTWEIGHT_PROT 1
 
-//Use standard C memory manipulation routines,such as malloc/free.
-#define MEM_LIBC_MALLOC      1
+//Use lwIP's own heap and typed fixed-size memory pools,instead of the kernel's
+//general purpose allocator,so allocation per packet is O(1) and the kernel heap
+//is not fragmented by network traffic.
+#ifndef MEM_LIBC_MALLOC
+#define MEM_LIBC_MALLOC      0
+#endif
+#define MEMP_MEM_MALLOC      0
+
+//Memory of lwIP heap and pools is allocated from kernel heap once when they
+//are initialized,instead of static arrays that enlarge kernel image.
+#define LWIP_POOL_MEMORY_ALLOC(size) malloc(size)
+
+//mem_free may be called in interrupt context,by NIC driver's Tx completion
+//routine,so protect lwIP heap by critical section instead of mutex.
+#define LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT 1
+
+//Memory profiles of lwIP,sizes of heap and pools are defined by profile.
+#define LWIP_PROFILE_TINY    0
+#define LWIP_PROFILE_CLIENT  1
+#define LWIP_PROFILE_SERVER  2
+
+#ifndef LWIP_MEM_PROFILE
+#define LWIP_MEM_PROFILE     LWIP_PROFILE_CLIENT
+#endif
+
+//Maximal segment size,the MSS advertised in SYN is derived from MTU of
+//the outgoing interface and never exceeds this value.
+#define TCP_MSS                  1460
+
+//Window scaling(RFC 7323) lets TCP window exceed 64K,the receive window is
+//announced shifted right by TCP_RCV_SCALE bits.Default window and send
+//buffer are defined by profile,and can be changed per socket by
+//SO_RCVBUF/SO_SNDBUF,up to (0xFFFF << TCP_RCV_SCALE).
+#define LWIP_WND_SCALE           1
+
+//Timestamps for RTT measurement and PAWS,and selective acknowledgement
+//so more than one lost segment is repaired per round trip.
+#define LWIP_TCP_TIMESTAMPS      1
+#define LWIP_TCP_SACK            1
+
+//Find the PCB of incoming segments by hash tables instead of walking the
+//lists,and bound the PCBs held by TIME-WAIT,a new SYN to a TIME-WAIT
+//connection takes it over.
+#define TCP_PCB_HASH             1
+#define TCP_TW_RECYCLE           1
+
+#if (LWIP_MEM_PROFILE == LWIP_PROFILE_TINY)
+#define MEM_SIZE                 (16 * 1024)
+#define PBUF_POOL_SIZE           16
+#define MEMP_NUM_PBUF            32
+#define MEMP_NUM_UDP_PCB         8
+#define MEMP_NUM_TCP_PCB         8
+#define MEMP_NUM_TCP_PCB_LISTEN  4
+#define MEMP_NUM_TCP_SEG         32
+#define TCP_WND                  (4 * TCP_MSS)
+#define TCP_SND_BUF              (4 * TCP_MSS)
+#define TCP_SND_QUEUELEN         16
+#define TCP_RCV_SCALE            0
+#define TCP_CONN_HASH_SIZE       16
+#define TCP_MAX_TIME_WAIT        2
+#define MEMP_NUM_NETCONN         16
+#define MEMP_NUM_NETBUF          8
+#define MEMP_NUM_TCPIP_MSG_API   16
+#define MEMP_NUM_TCPIP_MSG_INPKT 16
+#define MEMP_NUM_ARP_QUEUE       16
+#define ARP_TABLE_SIZE           10
+#define ARP_TABLE_MAX_SIZE       16
+#define ARP_HASH_SIZE            8
+#define MEMP_NUM_REASSDATA       4
+#define IP_REASS_MAX_PBUFS       10
+#define MEMP_NUM_FRAG_PBUF       8
+#elif (LWIP_MEM_PROFILE == LWIP_PROFILE_SERVER)
+#define MEM_SIZE                 (1024 * 1024)
+#define PBUF_POOL_SIZE           512
+#define MEMP_NUM_PBUF            128
+#define MEMP_NUM_UDP_PCB         32
+#define MEMP_NUM_TCP_PCB         128
+#define MEMP_NUM_TCP_PCB_LISTEN  16
+#define MEMP_NUM_TCP_SEG         1024
+#define TCP_WND                  (256 * 1024)
+#define TCP_SND_BUF              (256 * 1024)
+#define TCP_SND_QUEUELEN         (2 * TCP_SND_BUF / TCP_MSS + 2)
+#define TCP_RCV_SCALE            3
+#define TCP_CONN_HASH_SIZE       256
+#define TCP_MAX_TIME_WAIT        32
+#define MEMP_NUM_NETCONN         176
+#define MEMP_NUM_NETBUF          64
+#define MEMP_NUM_TCPIP_MSG_API   64
+#define MEMP_NUM_TCPIP_MSG_INPKT 256
+#define MEMP_NUM_ARP_QUEUE       64
+#define ARP_TABLE_SIZE           64
+#define ARP_TABLE_MAX_SIZE       1024
+#define ARP_HASH_SIZE            256
+#define MEMP_NUM_REASSDATA       16
+#define IP_REASS_MAX_PBUFS       64
+#define MEMP_NUM_FRAG_PBUF       32
+#else //LWIP_PROFILE_CLIENT.
+#define MEM_SIZE                 (256 * 1024)
+#define PBUF_POOL_SIZE           128
+#define MEMP_NUM_PBUF            64
+#define MEMP_NUM_UDP_PCB         16
+#define MEMP_NUM_TCP_PCB         32
+#define MEMP_NUM_TCP_PCB_LISTEN  8
+#define MEMP_NUM_TCP_SEG         256
+#define TCP_WND                  (128 * 1024)
+#define TCP_SND_BUF              (128 * 1024)
+#define TCP_SND_QUEUELEN         (2 * TCP_SND_BUF / TCP_MSS + 2)
+#define TCP_RCV_SCALE            2
+#define TCP_CONN_HASH_SIZE       64
+#define TCP_MAX_TIME_WAIT        8
+#define MEMP_NUM_NETCONN         56
+#define MEMP_NUM_NETBUF          16
+#define MEMP_NUM_TCPIP_MSG_API   32
+#define MEMP_NUM_TCPIP_MSG_INPKT 64
+#define MEMP_NUM_ARP_QUEUE       32
+#define ARP_TABLE_SIZE           32
+#define ARP_TABLE_MAX_SIZE       256
+#define ARP_HASH_SIZE            64
+#define MEMP_NUM_REASSDATA       8
+#define IP_REASS_MAX_PBUFS       32
+#define MEMP_NUM_FRAG_PBUF       16
+#endif
+
+//Received frames are copied into PBUF_POOL pbufs,one pbuf holds a whole
+//Ethernet frame.
+#define PBUF_POOL_BUFSIZE        1536
 
-//Use HelloX's memory allocator to allocate memory pool.
-#define MEMP_MEM_MALLOC      1
+//Queue up to ARP_QUEUE_LEN packets on an unresolved address,instead of
+//only the last one,so a burst sent to a new peer is not lost.
+#define ARP_QUEUEING         1
 
 //Enable loop back interface.
 #define LWIP_HAVE_LOOPIF     1
 
+//Generate checksum while copying data,for both TCP sending(tcp_write) and
+//frames received from NIC.
+#define LWIP_CHECKSUM_ON_COPY 1
+
+//Use x86 optimized routines for checksum and copy with checksum,defined
+//in inet_chksum.c.
+#ifdef __I386__
+#define LWIP_CHKSUM_ALGORITHM      4
+#define LWIP_CHKSUM_COPY_ALGORITHM 2
+#endif
+
+//Leave TCP/UDP checksum to NIC if it supports,negotiated per interface
+//when it's registered to Ethernet Manager.
+#define LWIP_CHECKSUM_CTRL_PER_NETIF 1
+
+//Send up to 64K TCP data in one packet and let NIC cut it into segments,
+//the memory is too tight for it in tiny profile.
+#if (LWIP_MEM_PROFILE == LWIP_PROFILE_TINY)
+#define LWIP_TCP_TSO         0
+#else
+#define LWIP_TCP_TSO         1
+#endif
+
 //Enable receive timeout mechanism.
 #define LWIP_SO_RCVTIMEO     1
 
+//epoll style readiness notification,sockets are queued to epoll instances
+//by event callback when they become ready,instead of being scanned by select.
+#define LWIP_SOCKET_EPOLL    1
+
+//Batched UDP send and receive,sendmmsg/recvmmsg.Received datagrams are kept
+//in a fixed ring of each UDP socket,and each UDP/TCP PCB remembers the ARP
+//entry of it's peer.
+#define LWIP_SOCKET_MMSG      1
+#define LWIP_NETCONN_UDP_RING 1
+#if (LWIP_MEM_PROFILE == LWIP_PROFILE_TINY)
+#define UDP_RECV_RING_SIZE    8
+#else
+#define UDP_RECV_RING_SIZE    32
+#endif
+#define LWIP_NETIF_HWADDRHINT 1
+
 //Enable or disable TCP functions in lwIP.
 #define LWIP_TCP             1
 
@@ -56,6 +225,16 @@
 //Enable or disable DNS functions in lwIP.
 #define LWIP_DNS             1
 
+//Resolved names are cached,the periodical reconnections of applications
+//then don't wait for DNS server.
+#if (LWIP_MEM_PROFILE == LWIP_PROFILE_TINY)
+#define DNS_CACHE_SIZE       8
+#else
+#define DNS_CACHE_SIZE       32
+#define DNS_CACHE_HASH_SIZE  32
+#define DNS_MAX_REQUESTS     16
+#endif
+
 //Change the default value(3) to larger number,since DHCP is enabled.
 #define MEMP_NUM_SYS_TIMEOUT 8
 
@@ -79,8 +258,9 @@
 //TCPIP thread's priority.
 #define TCPIP_THREAD_PRIO                PRIORITY_LEVEL_HIGH
 
-//Mail box's size for TCP/IP thread.Increase this value may improve performance.
-#define TCPIP_MBOX_SIZE                  8
+//Mail box's size for TCP/IP thread,large enough to hold all input packet
+//and API messages,so posting to tcpip thread never blocks on a full mailbox.
+#define TCPIP_MBOX_SIZE                  (MEMP_NUM_TCPIP_MSG_API + MEMP_NUM_TCPIP_MSG_INPKT)
 
 //SLIP interface's thread name.
 #define SLIPIF_THREAD_NAME               "slipif_loop"
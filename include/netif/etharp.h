@@ -178,10 +178,54 @@ struct etharp_q_entry {
 };
 #endif /* ARP_QUEUEING */
 
-#define etharp_init() /* Compatibility define, not init needed. */
+/** Statistics of the ARP table, @see etharp_get_table_stats() */
+struct etharp_table_stats {
+  /** entries allocated, and the most they can grow to */
+  u16_t size;
+  u16_t max_size;
+  /** entries in use */
+  u16_t stable;
+  u16_t pending;
+  /** addresses resolved when sending, and how many of them from the
+      entry last used (per netif or per pcb) without a hash lookup */
+  u32_t hits;
+  u32_t hint_hits;
+  /** packets sent to pending addresses */
+  u32_t misses;
+  /** ARP requests sent to resolve addresses */
+  u32_t requests;
+  /** entries timed out, and taken over when the table was full */
+  u32_t expired;
+  u32_t recycled;
+  /** packets dropped since the queue of a pending entry was full */
+  u32_t queue_drops;
+};
+
+#define ETHARP_INFO_PENDING 1
+#define ETHARP_INFO_STABLE  2
+#define ETHARP_INFO_STATIC  3
+
+/** A copy of one ARP table entry, @see etharp_get_entries() */
+struct etharp_entry_info {
+  ip_addr_t ipaddr;
+  struct eth_addr ethaddr;
+  /** name of the netif it's resolved on */
+  char ifname[2];
+  /** ETHARP_INFO_* */
+  u8_t state;
+  /** packets queued */
+  u8_t queued;
+  /** ARP timer intervals since the last update */
+  u32_t age;
+};
+
+void etharp_init(void);
 void etharp_tmr(void);
-s8_t etharp_find_addr(struct netif *netif, ip_addr_t *ipaddr,
+s16_t etharp_find_addr(struct netif *netif, ip_addr_t *ipaddr,
          struct eth_addr **eth_ret, ip_addr_t **ip_ret);
+void etharp_cleanup_netif(struct netif *netif);
+void etharp_get_table_stats(struct etharp_table_stats *stats);
+u16_t etharp_get_entries(struct etharp_entry_info *info, u16_t max);
 err_t etharp_output(struct netif *netif, struct pbuf *q, ip_addr_t *ipaddr);
 err_t etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q);
 err_t etharp_request(struct netif *netif, ip_addr_t *ipaddr);
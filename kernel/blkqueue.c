@@ -0,0 +1,440 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : blkqueue.c
+//    Module Funciton           :
+//                                Per disk block request queue.
+//                                Sector requests from file systems are queued here
+//                                while the disk is busy,adjacent requests are merged
+//                                into one command and dispatched in elevator order,
+//                                reads ahead of writes unless writes are expired.
+//                                No dedicated thread is used,the thread that finds
+//                                the disk idle dispatches requests of other threads,
+//                                up to BLKQ_MAX_DRAIN_BATCHES batches,and then hands
+//                                the dispatching over to the submitter of next batch.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#ifndef __STDAFX_H__
+#include "StdAfx.h"
+#endif
+
+#include "kapi.h"
+#include "string.h"
+#include "stdio.h"
+#include "blkqueue.h"
+
+//All request queues in system,for statistics.
+static __BLK_QUEUE* s_pQueueList = NULL;
+
+//Create a request queue for one disk.
+__BLK_QUEUE* BlkQueueCreate(LPCSTR pszName,LPVOID pDiskParam,__BLKQ_DISPATCH Dispatch,
+	DWORD dwSectorSize,DWORD dwMaxSectors)
+{
+	__BLK_QUEUE*  pQueue  = NULL;
+	DWORD         dwFlags;
+
+	if((NULL == Dispatch) || (0 == dwSectorSize))
+	{
+		goto __TERMINAL;
+	}
+	if((0 == dwMaxSectors) || (dwMaxSectors > BLKQ_MAX_MERGE_SECTORS))
+	{
+		dwMaxSectors = BLKQ_MAX_MERGE_SECTORS;
+	}
+	pQueue = (__BLK_QUEUE*)KMemAlloc(sizeof(__BLK_QUEUE),KMEM_SIZE_TYPE_ANY);
+	if(NULL == pQueue)
+	{
+		goto __TERMINAL;
+	}
+	memset(pQueue,0,sizeof(__BLK_QUEUE));
+	pQueue->pMergeBuffer = (BYTE*)KMemAlloc(dwMaxSectors * dwSectorSize,KMEM_SIZE_TYPE_ANY);
+	if(NULL == pQueue->pMergeBuffer)
+	{
+		KMemFree(pQueue,KMEM_SIZE_TYPE_ANY,0);
+		pQueue = NULL;
+		goto __TERMINAL;
+	}
+	if(pszName)
+	{
+		strncpy(pQueue->szName,(CHAR*)pszName,BLKQ_NAME_LEN - 1);
+	}
+	pQueue->pDiskParam   = pDiskParam;
+	pQueue->Dispatch     = Dispatch;
+	pQueue->dwSectorSize = dwSectorSize;
+	pQueue->dwMaxSectors = dwMaxSectors;
+
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pQueue->pNext = s_pQueueList;
+	s_pQueueList  = pQueue;
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+
+__TERMINAL:
+	return pQueue;
+}
+
+//Insert a request into list,sorted by start sector.Requests with the same start
+//sector keep their arriving order.
+static VOID InsertSorted(__BLK_REQUEST** ppList,__BLK_REQUEST* pReq)
+{
+	while((*ppList) && ((*ppList)->dwStartSector <= pReq->dwStartSector))
+	{
+		ppList = &(*ppList)->pNext;
+	}
+	pReq->pNext = *ppList;
+	*ppList     = pReq;
+}
+
+//Return the request with the earliest deadline in list.
+static __BLK_REQUEST* OldestRequest(__BLK_REQUEST* pList)
+{
+	__BLK_REQUEST*  pOldest = pList;
+
+	while(pList)
+	{
+		if((LONG)(pList->dwDeadline - pOldest->dwDeadline) < 0)
+		{
+			pOldest = pList;
+		}
+		pList = pList->pNext;
+	}
+	return pOldest;
+}
+
+//Check if the request is expired.
+#define REQUEST_EXPIRED(req) ((LONG)(System.dwClockTickCounter - (req)->dwDeadline) >= 0)
+
+//Pick next batch from queue and detach it,the batch is a chain of adjacent
+//requests in the same direction.Must be called with interrupt disabled.
+static __BLK_REQUEST* PickBatch(__BLK_QUEUE* pQueue,BOOL* pbWrite,
+								DWORD* pdwStart,DWORD* pdwNum)
+{
+	__BLK_REQUEST**  ppList    = NULL;
+	__BLK_REQUEST*   pSeed     = NULL;
+	__BLK_REQUEST*   pFirst    = NULL;
+	__BLK_REQUEST*   pLast     = NULL;
+	__BLK_REQUEST*   pPrev     = NULL;   //Predecessor of pFirst.
+	__BLK_REQUEST*   pReq      = NULL;
+	__BLK_REQUEST*   pOldest   = NULL;
+	DWORD            dwNum     = 0;
+	DWORD            dwCount   = 0;
+	BOOL             bSeenSeed = FALSE;
+
+	//Select direction,reads first unless the oldest write is expired.
+	if(pQueue->pWriteList)
+	{
+		pOldest = OldestRequest(pQueue->pWriteList);
+		if((NULL == pQueue->pReadList) || REQUEST_EXPIRED(pOldest))
+		{
+			ppList   = &pQueue->pWriteList;
+			*pbWrite = TRUE;
+		}
+	}
+	if(NULL == ppList)
+	{
+		if(NULL == pQueue->pReadList)  //Queue is empty.
+		{
+			return NULL;
+		}
+		ppList   = &pQueue->pReadList;
+		*pbWrite = FALSE;
+		pOldest  = OldestRequest(pQueue->pReadList);
+	}
+
+	//Expired request goes first,otherwise continue the sweep from head position.
+	if(REQUEST_EXPIRED(pOldest))
+	{
+		pSeed = pOldest;
+		pQueue->dwExpired ++;
+	}
+	else
+	{
+		for(pReq = *ppList;pReq;pReq = pReq->pNext)
+		{
+			if(pReq->dwStartSector >= pQueue->dwHeadPos)
+			{
+				pSeed = pReq;
+				break;
+			}
+		}
+		if(NULL == pSeed)  //Wrap around.
+		{
+			pSeed = *ppList;
+		}
+	}
+
+	//Locate the first request of the adjacent run that seed belongs to.
+	pFirst = *ppList;
+	for(pReq = *ppList;pReq != pSeed;pReq = pReq->pNext)
+	{
+		if(pReq->dwStartSector + pReq->dwSectorNum != pReq->pNext->dwStartSector)
+		{
+			pPrev  = pReq;
+			pFirst = pReq->pNext;
+		}
+	}
+	//Shrink the run from front if seed can not be reached within merge limit.
+	while(pFirst != pSeed)
+	{
+		dwNum = 0;
+		for(pReq = pFirst;pReq != pSeed->pNext;pReq = pReq->pNext)
+		{
+			dwNum += pReq->dwSectorNum;
+		}
+		if(dwNum <= pQueue->dwMaxSectors)
+		{
+			break;
+		}
+		pPrev  = pFirst;
+		pFirst = pFirst->pNext;
+	}
+
+	//Extend the batch as long as requests are adjacent and fit merge buffer.
+	dwNum = 0;
+	pReq  = pFirst;
+	while(pReq)
+	{
+		if(pLast && (pLast->dwStartSector + pLast->dwSectorNum != pReq->dwStartSector))
+		{
+			break;
+		}
+		if(pLast && (dwNum + pReq->dwSectorNum > pQueue->dwMaxSectors))
+		{
+			break;
+		}
+		if(pLast)
+		{
+			if(bSeenSeed)
+			{
+				pQueue->dwBackMerges ++;
+			}
+			else
+			{
+				pQueue->dwFrontMerges ++;
+			}
+		}
+		if(pReq == pSeed)
+		{
+			bSeenSeed = TRUE;
+		}
+		dwNum += pReq->dwSectorNum;
+		dwCount ++;
+		pLast = pReq;
+		pReq  = pReq->pNext;
+	}
+
+	//Detach the batch from list.
+	if(pPrev)
+	{
+		pPrev->pNext = pLast->pNext;
+	}
+	else
+	{
+		*ppList = pLast->pNext;
+	}
+	pLast->pNext = NULL;
+
+	pQueue->dwDepth  -= dwCount;
+	pQueue->dwHeadPos = pFirst->dwStartSector + dwNum;
+	pQueue->dwDispatches ++;
+	*pdwStart = pFirst->dwStartSector;
+	*pdwNum   = dwNum;
+	return pFirst;
+}
+
+//Issue one batch to disk and wake up the submitters.
+static VOID DispatchBatch(__BLK_QUEUE* pQueue,__BLK_REQUEST* pBatch,BOOL bWrite,
+						  DWORD dwStart,DWORD dwNum)
+{
+	__BLK_REQUEST*   pReq    = NULL;
+	__BLK_REQUEST*   pNext   = NULL;
+	BYTE*            pBuffer = NULL;
+	BOOL             bResult = FALSE;
+
+	if(NULL == pBatch->pNext)  //Single request,transfer into it's buffer directly.
+	{
+		bResult = pQueue->Dispatch(pQueue->pDiskParam,bWrite,dwStart,dwNum,pBatch->pBuffer);
+	}
+	else
+	{
+		if(bWrite)  //Gather.
+		{
+			for(pReq = pBatch;pReq;pReq = pReq->pNext)
+			{
+				pBuffer = pQueue->pMergeBuffer + (pReq->dwStartSector - dwStart) * pQueue->dwSectorSize;
+				memcpy(pBuffer,pReq->pBuffer,pReq->dwSectorNum * pQueue->dwSectorSize);
+			}
+		}
+		bResult = pQueue->Dispatch(pQueue->pDiskParam,bWrite,dwStart,dwNum,pQueue->pMergeBuffer);
+		if(bResult && !bWrite)  //Scatter.
+		{
+			for(pReq = pBatch;pReq;pReq = pReq->pNext)
+			{
+				pBuffer = pQueue->pMergeBuffer + (pReq->dwStartSector - dwStart) * pQueue->dwSectorSize;
+				memcpy(pReq->pBuffer,pBuffer,pReq->dwSectorNum * pQueue->dwSectorSize);
+			}
+		}
+	}
+	//Request objects reside in submitter's stack,so pNext must be fetched before
+	//waking up the submitter.
+	for(pReq = pBatch;pReq;pReq = pNext)
+	{
+		pNext = pReq->pNext;
+		pReq->bResult = bResult;
+		SetEvent(pReq->hEvent);
+	}
+}
+
+//Dispatch queued requests until the queue is empty,then mark the queue idle.
+//At most BLKQ_MAX_DRAIN_BATCHES batches are dispatched by current thread,the
+//next batch is then handed over to it's head request's submitter,which goes on
+//draining the queue after dispatching it.
+static VOID DrainQueue(__BLK_QUEUE* pQueue)
+{
+	__BLK_REQUEST*   pBatch    = NULL;
+	BOOL             bWrite    = FALSE;
+	DWORD            dwStart   = 0;
+	DWORD            dwNum     = 0;
+	DWORD            dwBatches = 0;
+	DWORD            dwFlags;
+
+	while(TRUE)
+	{
+		__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+		pBatch = PickBatch(pQueue,&bWrite,&dwStart,&dwNum);
+		if(NULL == pBatch)
+		{
+			pQueue->bBusy = FALSE;
+			__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+			break;
+		}
+		if(dwBatches >= BLKQ_MAX_DRAIN_BATCHES)  //Hand over,the queue stays busy.
+		{
+			pBatch->dwBatchNum = dwNum;
+			__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+			SetEvent(pBatch->hEvent);
+			break;
+		}
+		__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+		DispatchBatch(pQueue,pBatch,bWrite,dwStart,dwNum);
+		dwBatches ++;
+	}
+}
+
+//Submit one request and wait it to finish.
+//If the disk is idle the request is issued by current thread directly,and the
+//thread then serves all requests queued meanwhile.Otherwise the request is queued
+//and current thread is blocked until the dispatching thread completes it.
+BOOL BlkQueueSubmit(__BLK_QUEUE* pQueue,BOOL bWrite,DWORD dwStartSector,
+	DWORD dwSectorNum,BYTE* pBuffer)
+{
+	__BLK_REQUEST    req;
+	BOOL             bResult = FALSE;
+	DWORD            dwFlags;
+
+	if((NULL == pQueue) || (0 == dwSectorNum) || (NULL == pBuffer))
+	{
+		return FALSE;
+	}
+
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pQueue->dwRequests ++;
+	if(!pQueue->bBusy)
+	{
+		pQueue->bBusy = TRUE;
+		__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+		goto __DISPATCH;
+	}
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+
+	//Disk is busy,queue the request.Event object is created out of critical
+	//section so the busy state must be checked again.
+	req.hEvent = CreateEvent(FALSE);
+	if(NULL == req.hEvent)
+	{
+		return FALSE;
+	}
+	req.pNext         = NULL;
+	req.bWrite        = bWrite;
+	req.dwStartSector = dwStartSector;
+	req.dwSectorNum   = dwSectorNum;
+	req.pBuffer       = pBuffer;
+	req.bResult       = FALSE;
+	req.dwBatchNum    = 0;
+	req.dwDeadline    = System.dwClockTickCounter +
+		(bWrite ? BLKQ_WRITE_EXPIRE : BLKQ_READ_EXPIRE) / SYSTEM_TIME_SLICE;
+
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	if(!pQueue->bBusy)  //Dispatching thread finished meanwhile.
+	{
+		pQueue->bBusy = TRUE;
+		__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+		DestroyEvent(req.hEvent);
+		goto __DISPATCH;
+	}
+	InsertSorted(bWrite ? &pQueue->pWriteList : &pQueue->pReadList,&req);
+	pQueue->dwDepth ++;
+	pQueue->dwDepthSum += pQueue->dwDepth;
+	if(pQueue->dwDepth > pQueue->dwMaxDepth)
+	{
+		pQueue->dwMaxDepth = pQueue->dwDepth;
+	}
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+
+	WaitForThisObject(req.hEvent);
+	if(req.dwBatchNum)  //Dispatching is handed over to current thread.
+	{
+		DispatchBatch(pQueue,&req,bWrite,dwStartSector,req.dwBatchNum);
+		DrainQueue(pQueue);
+	}
+	DestroyEvent(req.hEvent);
+	return req.bResult;
+
+__DISPATCH:
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	pQueue->dwDispatches ++;
+	pQueue->dwHeadPos = dwStartSector + dwSectorNum;
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+	bResult = pQueue->Dispatch(pQueue->pDiskParam,bWrite,dwStartSector,dwSectorNum,pBuffer);
+	DrainQueue(pQueue);
+	return bResult;
+}
+
+//Show statistics of all request queues.
+VOID BlkQueueShowStat(VOID)
+{
+	__BLK_QUEUE*     pQueue   = s_pQueueList;
+	DWORD            dwMerged = 0;
+	DWORD            dwRatio  = 0;
+	DWORD            dwDepth  = 0;
+
+	if(NULL == pQueue)
+	{
+		_hx_printf("  No block request queue in system.\r\n");
+		return;
+	}
+	_hx_printf("  queue       requests  dispatch  f_merge  b_merge  merge%%  avg_dep  max_dep  expired\r\n");
+	_hx_printf("  ----------  --------  --------  -------  -------  ------  -------  -------  -------\r\n");
+	while(pQueue)
+	{
+		dwMerged = pQueue->dwFrontMerges + pQueue->dwBackMerges;
+		dwRatio  = pQueue->dwRequests ? (dwMerged * 100) / pQueue->dwRequests : 0;
+		dwDepth  = pQueue->dwRequests ? (pQueue->dwDepthSum * 100) / pQueue->dwRequests : 0;
+		_hx_printf("  %-10s  %8d  %8d  %7d  %7d  %5d%%  %4d.%02d  %7d  %7d\r\n",
+			pQueue->szName,
+			pQueue->dwRequests,
+			pQueue->dwDispatches,
+			pQueue->dwFrontMerges,
+			pQueue->dwBackMerges,
+			dwRatio,
+			dwDepth / 100,dwDepth % 100,
+			pQueue->dwMaxDepth,
+			pQueue->dwExpired);
+		pQueue = pQueue->pNext;
+	}
+}
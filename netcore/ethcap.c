@@ -0,0 +1,967 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : ethcap.c
+//    Module Funciton           :
+//                                Packet capture of Ethernet Manager.Frames are
+//                                hooked in _PostFrame and the sending routines,
+//                                checked by a compiled filter expression,and
+//                                stored into a pre-allocated ring.Producers only
+//                                reserve a slot by atomic increment and never
+//                                lock,readers validate each slot by it's sequence
+//                                number,so the ring can be read while capturing.
+//
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#include <StdAfx.h>
+#include <kapi.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "ethmgr.h"
+#include "ethcap.h"
+
+//Bytes gathered from fragments to evaluate filter,enough for Ethernet,VLAN,
+//IPv4 header with options and TCP/UDP ports.
+#define ETH_CAP_HDR_LEN       128
+
+//pcap file format.
+#define PCAP_MAGIC            0xA1B2C3D4
+#define PCAP_VERSION_MAJOR    2
+#define PCAP_VERSION_MINOR    4
+#define PCAP_LINKTYPE_ETHER   1
+
+typedef struct tag__PCAP_FILE_HEADER{
+	DWORD      magic;
+	WORD       version_major;
+	WORD       version_minor;
+	DWORD      thiszone;
+	DWORD      sigfigs;
+	DWORD      snaplen;
+	DWORD      linktype;
+}__PCAP_FILE_HEADER;
+
+typedef struct tag__PCAP_RECORD_HEADER{
+	DWORD      ts_sec;
+	DWORD      ts_usec;
+	DWORD      incl_len;
+	DWORD      orig_len;
+}__PCAP_RECORD_HEADER;
+
+//Fields of a frame the filter looks at.
+typedef struct tag__ETH_CAP_FRAME_INFO{
+	__u16      eth_type;
+	BOOL       bIp;
+	BYTE       ip_proto;
+	DWORD      src_ip;           //Network order.
+	DWORD      dst_ip;
+	BOOL       bPorts;           //TCP or UDP and not a subsequent fragment.
+	__u16      src_port;
+	__u16      dst_port;
+}__ETH_CAP_FRAME_INFO;
+
+//State of filter compiler.
+typedef struct tag__ETH_CAP_PARSER{
+	char**          ppszTokens;
+	int             nTokenNum;
+	int             nPos;
+	__ETH_CAP_INSN* pInsns;
+	int             nInsnNum;
+}__ETH_CAP_PARSER;
+
+//Global packet capture object.
+__ETH_CAPTURE EthCapture = { 0 };
+
+//Compiler barrier,keeps slot data written before it's sequence number.
+#if defined(__GCC__)
+#define ETH_CAP_BARRIER() __asm__ __volatile__("" : : : "memory")
+#else
+#define ETH_CAP_BARRIER()
+#endif
+
+//Add dwAdd to a counter and return the old value,without any lock,since
+//frames are captured in interrupt context as well as in kernel threads.
+static DWORD EthCapAtomicAdd(volatile DWORD* pdwValue, DWORD dwAdd)
+{
+#ifdef __I386__
+#ifdef __GCC__
+	__asm__ __volatile__("lock; xaddl %0, %1" : "+r"(dwAdd), "+m"(*pdwValue) : : "memory");
+#else
+	__asm {
+		mov ecx, pdwValue
+		mov eax, dwAdd
+		lock xadd [ecx], eax
+		mov dwAdd, eax
+	}
+#endif
+	return dwAdd;
+#else
+	DWORD dwOld;
+	DWORD dwFlags;
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	dwOld = *pdwValue;
+	*pdwValue = dwOld + dwAdd;
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	return dwOld;
+#endif
+}
+
+//Pick up the fields filter needs from frame header.
+static VOID EthCapDecode(__u8* pData, int nAvail, __ETH_CAP_FRAME_INFO* pInfo)
+{
+	int l3 = 14;
+	int ihl = 0;
+
+	memset(pInfo, 0, sizeof(__ETH_CAP_FRAME_INFO));
+	if (nAvail < 14)
+	{
+		return;
+	}
+	pInfo->eth_type = (pData[12] << 8) + pData[13];
+	if ((0x8100 == pInfo->eth_type) && (nAvail >= 18))  //Skip VLAN tag.
+	{
+		pInfo->eth_type = (pData[16] << 8) + pData[17];
+		l3 = 18;
+	}
+	if ((0x0800 != pInfo->eth_type) || (nAvail < l3 + 20))
+	{
+		return;
+	}
+	pInfo->bIp = TRUE;
+	pInfo->ip_proto = pData[l3 + 9];
+	memcpy(&pInfo->src_ip, &pData[l3 + 12], sizeof(DWORD));
+	memcpy(&pInfo->dst_ip, &pData[l3 + 16], sizeof(DWORD));
+	ihl = (pData[l3] & 0x0F) * 4;
+	//Only the first fragment carries ports.
+	if (((pData[l3 + 6] & 0x1F) | pData[l3 + 7]) != 0)
+	{
+		return;
+	}
+	if ((6 != pInfo->ip_proto) && (17 != pInfo->ip_proto))
+	{
+		return;
+	}
+	if (nAvail < l3 + ihl + 4)
+	{
+		return;
+	}
+	pInfo->bPorts = TRUE;
+	pInfo->src_port = (pData[l3 + ihl] << 8) + pData[l3 + ihl + 1];
+	pInfo->dst_port = (pData[l3 + ihl + 2] << 8) + pData[l3 + ihl + 3];
+}
+
+//Run the compiled filter on a frame,results are kept in a bit stack.
+static BOOL EthCapMatch(__u8* pData, int nAvail, int nLength, BYTE byDir)
+{
+	__ETH_CAP_FRAME_INFO info;
+	__ETH_CAP_INSN* pInsn = NULL;
+	DWORD dwStack = 0;
+	DWORD bResult = 0;
+	BYTE match = 0;
+	int i;
+
+	EthCapDecode(pData, nAvail, &info);
+	for (i = 0; i < EthCapture.nInsnNum; i++)
+	{
+		pInsn = &EthCapture.Filter[i];
+		match = pInsn->match ? pInsn->match : (ETH_CAP_MATCH_SRC | ETH_CAP_MATCH_DST);
+		switch (pInsn->op)
+		{
+		case ETH_CAP_OP_ETHTYPE:
+			bResult = (info.eth_type == pInsn->value);
+			break;
+		case ETH_CAP_OP_ETHADDR:
+			bResult = (nAvail >= 14) &&
+				(((match & ETH_CAP_MATCH_DST) && (0 == memcmp(pData, pInsn->mac, ETH_MAC_LEN))) ||
+				((match & ETH_CAP_MATCH_SRC) && (0 == memcmp(pData + ETH_MAC_LEN, pInsn->mac, ETH_MAC_LEN))));
+			break;
+		case ETH_CAP_OP_IPPROTO:
+			bResult = info.bIp && (info.ip_proto == pInsn->value);
+			break;
+		case ETH_CAP_OP_IPADDR:
+			bResult = info.bIp &&
+				(((match & ETH_CAP_MATCH_SRC) && (info.src_ip == pInsn->value)) ||
+				((match & ETH_CAP_MATCH_DST) && (info.dst_ip == pInsn->value)));
+			break;
+		case ETH_CAP_OP_PORT:
+			bResult = info.bPorts &&
+				(((match & ETH_CAP_MATCH_SRC) && (info.src_port == pInsn->value)) ||
+				((match & ETH_CAP_MATCH_DST) && (info.dst_port == pInsn->value)));
+			break;
+		case ETH_CAP_OP_GREATER:
+			bResult = ((DWORD)nLength >= pInsn->value);
+			break;
+		case ETH_CAP_OP_LESS:
+			bResult = ((DWORD)nLength <= pInsn->value);
+			break;
+		case ETH_CAP_OP_DIR:
+			bResult = (byDir == pInsn->value);
+			break;
+		case ETH_CAP_OP_AND:
+			bResult = dwStack & (dwStack >> 1) & 1;
+			dwStack >>= 2;
+			break;
+		case ETH_CAP_OP_OR:
+			bResult = (dwStack | (dwStack >> 1)) & 1;
+			dwStack >>= 2;
+			break;
+		case ETH_CAP_OP_NOT:
+			bResult = !(dwStack & 1);
+			dwStack >>= 1;
+			break;
+		default:
+			BUG();
+			break;
+		}
+		dwStack = (dwStack << 1) | (bResult ? 1 : 0);
+	}
+	return (dwStack & 1);
+}
+
+//Store a frame gathered from fragments into the ring.If bCommit is FALSE the
+//record is left invisible and the producer stays in the ring,EthCaptureCommit
+//must be called with the returned handle then.Returns sequence number + 1 of
+//the record,or 0 if the frame is not stored.
+static DWORD EthCapPut(__ETHERNET_INTERFACE* pEthInt, __ETH_TX_FRAG* pFrags, int nFragNum,
+	int nLength, BYTE byDir, BOOL bCommit)
+{
+	__ETH_CAP_RECORD* pRecord = NULL;
+	__u8 header[ETH_CAP_HDR_LEN];
+	__u8* pDest = NULL;
+	__U64 tsc;
+	DWORD dwIndex = 0;
+	int nAvail = 0;
+	int nCopy = 0;
+	int nCapLen = 0;
+	int i;
+
+	EthCapAtomicAdd(&EthCapture.dwWriters, 1);
+	if (!EthCapture.bEnabled)  //Stopped after the hook checked it.
+	{
+		goto __TERMINAL;
+	}
+	EthCapAtomicAdd(&EthCapture.dwSeen, 1);
+	if (EthCapture.nInsnNum)
+	{
+		if (1 == nFragNum)
+		{
+			if (!EthCapMatch(pFrags[0].pData, pFrags[0].length, nLength, byDir))
+			{
+				goto __TERMINAL;
+			}
+		}
+		else
+		{
+			for (i = 0; (i < nFragNum) && (nAvail < ETH_CAP_HDR_LEN); i++)
+			{
+				nCopy = pFrags[i].length;
+				if (nCopy > ETH_CAP_HDR_LEN - nAvail)
+				{
+					nCopy = ETH_CAP_HDR_LEN - nAvail;
+				}
+				memcpy(&header[nAvail], pFrags[i].pData, nCopy);
+				nAvail += nCopy;
+			}
+			if (!EthCapMatch(header, nAvail, nLength, byDir))
+			{
+				goto __TERMINAL;
+			}
+		}
+	}
+
+	dwIndex = EthCapAtomicAdd(&EthCapture.dwHead, 1);
+	if (!EthCapture.bWrap && (dwIndex >= EthCapture.dwSlots))
+	{
+		//Ring is full,dropped frames are counted by head.
+		goto __TERMINAL;
+	}
+	pRecord = (__ETH_CAP_RECORD*)(EthCapture.pRing +
+		(dwIndex % EthCapture.dwSlots) * EthCapture.dwSlotSize);
+	pRecord->dwSeq = 0;
+	ETH_CAP_BARRIER();
+	__GetTsc(&tsc);
+	pRecord->dwTscLow = tsc.dwLowPart;
+	pRecord->dwTscHigh = tsc.dwHighPart;
+	pRecord->dwOrigLen = nLength;
+	pRecord->byIfIndex = (BYTE)(pEthInt - &EthernetManager.EthInterfaces[0]);
+	pRecord->byDir = byDir;
+	pDest = (__u8*)(pRecord + 1);
+	for (i = 0; (i < nFragNum) && (nCapLen < (int)EthCapture.dwSnapLen); i++)
+	{
+		nCopy = pFrags[i].length;
+		if (nCopy > (int)EthCapture.dwSnapLen - nCapLen)
+		{
+			nCopy = EthCapture.dwSnapLen - nCapLen;
+		}
+		memcpy(pDest + nCapLen, pFrags[i].pData, nCopy);
+		nCapLen += nCopy;
+	}
+	pRecord->wCapLen = (WORD)nCapLen;
+	if (!bCommit)
+	{
+		return dwIndex + 1;
+	}
+	ETH_CAP_BARRIER();
+	pRecord->dwSeq = dwIndex + 1;
+
+__TERMINAL:
+	EthCapAtomicAdd(&EthCapture.dwWriters, (DWORD)-1);
+	return pRecord ? (dwIndex + 1) : 0;
+}
+
+VOID EthCaptureFrame(__ETHERNET_INTERFACE* pEthInt, __u8* pFrame, int nLength, BYTE byDir)
+{
+	__ETH_TX_FRAG frag;
+
+	frag.pData = pFrame;
+	frag.length = nLength;
+	EthCapPut(pEthInt, &frag, 1, nLength, byDir, TRUE);
+}
+
+DWORD EthCaptureReserve(__ETHERNET_INTERFACE* pEthInt, __ETH_TX_FRAG* pFrags, int nFragNum)
+{
+	int nLength = 0;
+	int i;
+
+	for (i = 0; i < nFragNum; i++)
+	{
+		nLength += pFrags[i].length;
+	}
+	return EthCapPut(pEthInt, pFrags, nFragNum, nLength, ETH_CAP_DIR_OUT, FALSE);
+}
+
+VOID EthCaptureCommit(DWORD dwHandle, BOOL bSent)
+{
+	__ETH_CAP_RECORD* pRecord = (__ETH_CAP_RECORD*)(EthCapture.pRing +
+		((dwHandle - 1) % EthCapture.dwSlots) * EthCapture.dwSlotSize);
+	DWORD dwFlags;
+
+	if (bSent)
+	{
+		ETH_CAP_BARRIER();
+		pRecord->dwSeq = dwHandle;
+	}
+	else
+	{
+		//Give the slot back if no one reserved after it,otherwise it's left
+		//as a record being written,which is skipped by readers.
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		if (EthCapture.dwHead == dwHandle)
+		{
+			EthCapture.dwHead--;
+		}
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		EthCapAtomicAdd(&EthCapture.dwSeen, (DWORD)-1);
+	}
+	EthCapAtomicAdd(&EthCapture.dwWriters, (DWORD)-1);
+}
+
+//Helpers of filter compiler.
+static char* EthCapToken(__ETH_CAP_PARSER* pParser)
+{
+	if (pParser->nPos >= pParser->nTokenNum)
+	{
+		return NULL;
+	}
+	return pParser->ppszTokens[pParser->nPos];
+}
+
+static BOOL EthCapAccept(__ETH_CAP_PARSER* pParser, char* pszKeyword)
+{
+	char* pszToken = EthCapToken(pParser);
+
+	if (pszToken && (0 == strcmp(pszToken, pszKeyword)))
+	{
+		pParser->nPos++;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static __ETH_CAP_INSN* EthCapEmit(__ETH_CAP_PARSER* pParser, BYTE op, BYTE match, DWORD value)
+{
+	__ETH_CAP_INSN* pInsn = NULL;
+
+	if (pParser->nInsnNum >= ETH_CAP_MAX_INSNS)
+	{
+		return NULL;
+	}
+	pInsn = &pParser->pInsns[pParser->nInsnNum++];
+	memset(pInsn, 0, sizeof(__ETH_CAP_INSN));
+	pInsn->op = op;
+	pInsn->match = match;
+	pInsn->value = value;
+	return pInsn;
+}
+
+//Convert a decimal or 0x prefixed hex number token.
+static BOOL EthCapNumber(char* pszToken, DWORD* pdwValue)
+{
+	char* pEnd = NULL;
+
+	if ((NULL == pszToken) || (0 == pszToken[0]))
+	{
+		return FALSE;
+	}
+	*pdwValue = (DWORD)strtol(pszToken, &pEnd, 0);
+	return (0 == *pEnd);
+}
+
+//Convert a.b.c.d to network order address.
+static BOOL EthCapIpAddr(char* pszToken, DWORD* pdwAddr)
+{
+	BYTE addr[4];
+	char* pEnd = NULL;
+	int nValue;
+	int i;
+
+	if (NULL == pszToken)
+	{
+		return FALSE;
+	}
+	for (i = 0; i < 4; i++)
+	{
+		if ((*pszToken < '0') || (*pszToken > '9'))
+		{
+			return FALSE;
+		}
+		nValue = strtol(pszToken, &pEnd, 10);
+		if ((nValue > 255) || (*pEnd != ((i < 3) ? '.' : 0)))
+		{
+			return FALSE;
+		}
+		addr[i] = (BYTE)nValue;
+		pszToken = pEnd + 1;
+	}
+	memcpy(pdwAddr, addr, sizeof(DWORD));
+	return TRUE;
+}
+
+//Convert xx:xx:xx:xx:xx:xx to MAC address.
+static BOOL EthCapMacAddr(char* pszToken, BYTE* pMac)
+{
+	char* pEnd = NULL;
+	int nValue;
+	int i;
+
+	if (NULL == pszToken)
+	{
+		return FALSE;
+	}
+	for (i = 0; i < ETH_MAC_LEN; i++)
+	{
+		nValue = strtol(pszToken, &pEnd, 16);
+		if ((pEnd == pszToken) || (nValue > 255) || (*pEnd != ((i < ETH_MAC_LEN - 1) ? ':' : 0)))
+		{
+			return FALSE;
+		}
+		pMac[i] = (BYTE)nValue;
+		pszToken = pEnd + 1;
+	}
+	return TRUE;
+}
+
+static BOOL EthCapParseOr(__ETH_CAP_PARSER* pParser);
+
+//primitive := ip | arp | ip6 | tcp | udp | icmp | in | out | proto N
+//           | ether proto N | ether [src|dst] MAC
+//           | [src|dst] host A.B.C.D | [src|dst] port N
+//           | greater N | less N | ( expr ) | not primitive
+static BOOL EthCapParseUnary(__ETH_CAP_PARSER* pParser)
+{
+	__ETH_CAP_INSN* pInsn = NULL;
+	DWORD dwValue = 0;
+	BYTE match = 0;
+
+	if (EthCapAccept(pParser, "not"))
+	{
+		if (!EthCapParseUnary(pParser))
+		{
+			return FALSE;
+		}
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_NOT, 0, 0));
+	}
+	if (EthCapAccept(pParser, "("))
+	{
+		if (!EthCapParseOr(pParser))
+		{
+			return FALSE;
+		}
+		return EthCapAccept(pParser, ")");
+	}
+	if (EthCapAccept(pParser, "ip"))
+	{
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_ETHTYPE, 0, 0x0800));
+	}
+	if (EthCapAccept(pParser, "arp"))
+	{
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_ETHTYPE, 0, 0x0806));
+	}
+	if (EthCapAccept(pParser, "ip6"))
+	{
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_ETHTYPE, 0, 0x86DD));
+	}
+	if (EthCapAccept(pParser, "tcp"))
+	{
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_IPPROTO, 0, 6));
+	}
+	if (EthCapAccept(pParser, "udp"))
+	{
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_IPPROTO, 0, 17));
+	}
+	if (EthCapAccept(pParser, "icmp"))
+	{
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_IPPROTO, 0, 1));
+	}
+	if (EthCapAccept(pParser, "in"))
+	{
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_DIR, 0, ETH_CAP_DIR_IN));
+	}
+	if (EthCapAccept(pParser, "out"))
+	{
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_DIR, 0, ETH_CAP_DIR_OUT));
+	}
+	if (EthCapAccept(pParser, "proto"))
+	{
+		if (!EthCapNumber(EthCapToken(pParser), &dwValue))
+		{
+			return FALSE;
+		}
+		pParser->nPos++;
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_IPPROTO, 0, dwValue));
+	}
+	if (EthCapAccept(pParser, "greater") || EthCapAccept(pParser, "less"))
+	{
+		BYTE op = (0 == strcmp(pParser->ppszTokens[pParser->nPos - 1], "less")) ?
+			ETH_CAP_OP_LESS : ETH_CAP_OP_GREATER;
+		if (!EthCapNumber(EthCapToken(pParser), &dwValue))
+		{
+			return FALSE;
+		}
+		pParser->nPos++;
+		return (NULL != EthCapEmit(pParser, op, 0, dwValue));
+	}
+	if (EthCapAccept(pParser, "ether"))
+	{
+		if (EthCapAccept(pParser, "proto"))
+		{
+			if (!EthCapNumber(EthCapToken(pParser), &dwValue))
+			{
+				return FALSE;
+			}
+			pParser->nPos++;
+			return (NULL != EthCapEmit(pParser, ETH_CAP_OP_ETHTYPE, 0, dwValue));
+		}
+		if (EthCapAccept(pParser, "src"))
+		{
+			match = ETH_CAP_MATCH_SRC;
+		}
+		else if (EthCapAccept(pParser, "dst"))
+		{
+			match = ETH_CAP_MATCH_DST;
+		}
+		EthCapAccept(pParser, "host");
+		pInsn = EthCapEmit(pParser, ETH_CAP_OP_ETHADDR, match, 0);
+		if ((NULL == pInsn) || !EthCapMacAddr(EthCapToken(pParser), pInsn->mac))
+		{
+			return FALSE;
+		}
+		pParser->nPos++;
+		return TRUE;
+	}
+
+	//IPv4 host or TCP/UDP port,optionally qualified by direction.
+	if (EthCapAccept(pParser, "src"))
+	{
+		match = ETH_CAP_MATCH_SRC;
+	}
+	else if (EthCapAccept(pParser, "dst"))
+	{
+		match = ETH_CAP_MATCH_DST;
+	}
+	if (EthCapAccept(pParser, "host"))
+	{
+		if (!EthCapIpAddr(EthCapToken(pParser), &dwValue))
+		{
+			return FALSE;
+		}
+		pParser->nPos++;
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_IPADDR, match, dwValue));
+	}
+	if (EthCapAccept(pParser, "port"))
+	{
+		if (!EthCapNumber(EthCapToken(pParser), &dwValue) || (dwValue > 0xFFFF))
+		{
+			return FALSE;
+		}
+		pParser->nPos++;
+		return (NULL != EthCapEmit(pParser, ETH_CAP_OP_PORT, match, dwValue));
+	}
+	return FALSE;
+}
+
+//and_expr := unary [and unary]...
+static BOOL EthCapParseAnd(__ETH_CAP_PARSER* pParser)
+{
+	if (!EthCapParseUnary(pParser))
+	{
+		return FALSE;
+	}
+	while (EthCapAccept(pParser, "and"))
+	{
+		if (!EthCapParseUnary(pParser))
+		{
+			return FALSE;
+		}
+		if (NULL == EthCapEmit(pParser, ETH_CAP_OP_AND, 0, 0))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+//expr := and_expr [or and_expr]...
+static BOOL EthCapParseOr(__ETH_CAP_PARSER* pParser)
+{
+	if (!EthCapParseAnd(pParser))
+	{
+		return FALSE;
+	}
+	while (EthCapAccept(pParser, "or"))
+	{
+		if (!EthCapParseAnd(pParser))
+		{
+			return FALSE;
+		}
+		if (NULL == EthCapEmit(pParser, ETH_CAP_OP_OR, 0, 0))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+//Stop capturing and wait for producers in progress to leave the ring.
+VOID EthCaptureStop(VOID)
+{
+	EthCapture.bEnabled = FALSE;
+	ETH_CAP_BARRIER();
+	while (EthCapture.dwWriters)
+	{
+		Sleep(0);
+	}
+}
+
+BOOL EthCaptureStart(DWORD dwSlots, DWORD dwSnapLen, BOOL bWrap, char** ppszTokens, int nTokenNum)
+{
+	__ETH_CAP_INSN insns[ETH_CAP_MAX_INSNS];
+	__ETH_CAP_PARSER parser;
+	__U64 tsc;
+	DWORD dwSlotSize = 0;
+
+	if (0 == dwSlots)
+	{
+		dwSlots = ETH_CAP_DEF_SLOTS;
+	}
+	if (dwSlots > ETH_CAP_MAX_SLOTS)
+	{
+		dwSlots = ETH_CAP_MAX_SLOTS;
+	}
+	if (0 == dwSnapLen)
+	{
+		dwSnapLen = ETH_CAP_DEF_SNAPLEN;
+	}
+	if (dwSnapLen > ETH_CAP_MAX_SNAPLEN)
+	{
+		dwSnapLen = ETH_CAP_MAX_SNAPLEN;
+	}
+
+	//Compile filter before touching the running capture.
+	parser.ppszTokens = ppszTokens;
+	parser.nTokenNum = nTokenNum;
+	parser.nPos = 0;
+	parser.pInsns = insns;
+	parser.nInsnNum = 0;
+	if (nTokenNum > 0)
+	{
+		if (!EthCapParseOr(&parser) || (parser.nPos != nTokenNum))
+		{
+			_hx_printf("  Invalid filter near '%s'.\r\n",
+				(parser.nPos < nTokenNum) ? ppszTokens[parser.nPos] : "end");
+			return FALSE;
+		}
+	}
+
+	EthCaptureStop();
+	dwSlotSize = (sizeof(__ETH_CAP_RECORD) + dwSnapLen + 3) & ~3;
+	if (EthCapture.pRing && (EthCapture.dwSlots * EthCapture.dwSlotSize != dwSlots * dwSlotSize))
+	{
+		KMemFree(EthCapture.pRing, KMEM_SIZE_TYPE_ANY, 0);
+		EthCapture.pRing = NULL;
+	}
+	if (NULL == EthCapture.pRing)
+	{
+		EthCapture.pRing = (BYTE*)KMemAlloc(dwSlots * dwSlotSize, KMEM_SIZE_TYPE_ANY);
+		if (NULL == EthCapture.pRing)
+		{
+			_hx_printf("  Can not allocate capture ring of %u bytes.\r\n", dwSlots * dwSlotSize);
+			return FALSE;
+		}
+	}
+	memset(EthCapture.pRing, 0, dwSlots * dwSlotSize);
+	EthCapture.dwSlots = dwSlots;
+	EthCapture.dwSlotSize = dwSlotSize;
+	EthCapture.dwSnapLen = dwSnapLen;
+	EthCapture.bWrap = bWrap;
+	EthCapture.dwHead = 0;
+	EthCapture.dwSeen = 0;
+	memcpy(EthCapture.Filter, insns, sizeof(insns));
+	EthCapture.nInsnNum = parser.nInsnNum;
+	if (0 == EthCapture.dwCyclesPerUs)
+	{
+		EthCapture.dwCyclesPerUs = __GetTscCyclesPerUs();
+	}
+	__GetTsc(&tsc);
+	EthCapture.dwStartTscLow = tsc.dwLowPart;
+	EthCapture.dwStartTscHigh = tsc.dwHighPart;
+	ETH_CAP_BARRIER();
+	EthCapture.bEnabled = TRUE;
+	return TRUE;
+}
+
+//Range of sequence numbers still in the ring.
+static VOID EthCapRange(DWORD* pdwFirst, DWORD* pdwEnd)
+{
+	DWORD dwHead = EthCapture.dwHead;
+
+	if (!EthCapture.bWrap)
+	{
+		*pdwFirst = 0;
+		*pdwEnd = (dwHead < EthCapture.dwSlots) ? dwHead : EthCapture.dwSlots;
+		return;
+	}
+	*pdwFirst = (dwHead > EthCapture.dwSlots) ? (dwHead - EthCapture.dwSlots) : 0;
+	*pdwEnd = dwHead;
+}
+
+//Copy out the frame of a sequence number,fails if it's being written or has
+//been overwritten.
+static BOOL EthCapRead(DWORD dwIndex, __ETH_CAP_RECORD* pRecord, __u8* pData)
+{
+	__ETH_CAP_RECORD* pSlot = (__ETH_CAP_RECORD*)(EthCapture.pRing +
+		(dwIndex % EthCapture.dwSlots) * EthCapture.dwSlotSize);
+
+	if (pSlot->dwSeq != dwIndex + 1)
+	{
+		return FALSE;
+	}
+	ETH_CAP_BARRIER();
+	memcpy(pRecord, pSlot, sizeof(__ETH_CAP_RECORD));
+	if (pRecord->wCapLen > EthCapture.dwSnapLen)
+	{
+		return FALSE;
+	}
+	if (pData)
+	{
+		memcpy(pData, pSlot + 1, pRecord->wCapLen);
+	}
+	ETH_CAP_BARRIER();
+	return (pSlot->dwSeq == dwIndex + 1);
+}
+
+//Micro seconds from capture start of a record.
+static uint64_t EthCapTime(__ETH_CAP_RECORD* pRecord)
+{
+	uint64_t tsc = ((uint64_t)pRecord->dwTscHigh << 32) + pRecord->dwTscLow;
+	uint64_t start = ((uint64_t)EthCapture.dwStartTscHigh << 32) + EthCapture.dwStartTscLow;
+
+	return (tsc - start) / EthCapture.dwCyclesPerUs;
+}
+
+//Print one line summary of a captured frame.
+static VOID EthCapSummary(DWORD dwIndex, __ETH_CAP_RECORD* pRecord, __u8* pData)
+{
+	__ETH_CAP_FRAME_INFO info;
+	BYTE* pSrc = NULL;
+	BYTE* pDst = NULL;
+	uint64_t us = EthCapTime(pRecord);
+	char* pszIfName = "?";
+
+	if (pRecord->byIfIndex < EthernetManager.nIntIndex)
+	{
+		pszIfName = EthernetManager.EthInterfaces[pRecord->byIfIndex].ethName;
+	}
+	_hx_printf("  %6u %4u.%06u %-8s %s %5u ",
+		dwIndex,
+		(DWORD)(us / 1000000),
+		(DWORD)(us % 1000000),
+		pszIfName,
+		(ETH_CAP_DIR_IN == pRecord->byDir) ? "in " : "out",
+		pRecord->dwOrigLen);
+	EthCapDecode(pData, pRecord->wCapLen, &info);
+	if (!info.bIp)
+	{
+		_hx_printf("type 0x%04X\r\n", info.eth_type);
+		return;
+	}
+	pSrc = (BYTE*)&info.src_ip;
+	pDst = (BYTE*)&info.dst_ip;
+	_hx_printf("%d.%d.%d.%d", pSrc[0], pSrc[1], pSrc[2], pSrc[3]);
+	if (info.bPorts)
+	{
+		_hx_printf(":%d", info.src_port);
+	}
+	_hx_printf(" > %d.%d.%d.%d", pDst[0], pDst[1], pDst[2], pDst[3]);
+	if (info.bPorts)
+	{
+		_hx_printf(":%d", info.dst_port);
+	}
+	_hx_printf(" proto %d\r\n", info.ip_proto);
+}
+
+VOID EthCaptureShow(int nFrames)
+{
+	__ETH_CAP_RECORD record;
+	__u8* pData = NULL;
+	DWORD dwFirst = 0, dwEnd = 0;
+	DWORD dwHead = EthCapture.dwHead;
+	DWORD dwIndex;
+
+	_hx_printf("  Capture is %s,%u slots of %u bytes,%s when full.\r\n",
+		EthCapture.bEnabled ? "running" : "stopped",
+		EthCapture.dwSlots,
+		EthCapture.dwSnapLen,
+		EthCapture.bWrap ? "overwrite" : "stop");
+	_hx_printf("  Frames seen: %u,matched: %u,%s: %u,filter instructions: %d.\r\n",
+		EthCapture.dwSeen,
+		dwHead,
+		EthCapture.bWrap ? "overwritten" : "dropped",
+		(dwHead > EthCapture.dwSlots) ? (dwHead - EthCapture.dwSlots) : 0,
+		EthCapture.nInsnNum);
+	if ((NULL == EthCapture.pRing) || (nFrames <= 0))
+	{
+		return;
+	}
+	pData = (__u8*)KMemAlloc(EthCapture.dwSnapLen, KMEM_SIZE_TYPE_ANY);
+	if (NULL == pData)
+	{
+		return;
+	}
+	EthCapRange(&dwFirst, &dwEnd);
+	if (dwEnd - dwFirst > (DWORD)nFrames)
+	{
+		dwFirst = dwEnd - nFrames;
+	}
+	for (dwIndex = dwFirst; dwIndex < dwEnd; dwIndex++)
+	{
+		if (EthCapRead(dwIndex, &record, pData))
+		{
+			EthCapSummary(dwIndex, &record, pData);
+		}
+	}
+	KMemFree(pData, KMEM_SIZE_TYPE_ANY, 0);
+}
+
+BOOL EthCaptureSave(LPSTR pszTarget)
+{
+	__PCAP_FILE_HEADER fileHdr;
+	__PCAP_RECORD_HEADER* pRecHdr = NULL;
+	__ETH_CAP_RECORD record;
+	__COMMON_OBJECT* hFile = NULL;
+	BYTE* pBuffer = NULL;
+	uint64_t us;
+	DWORD dwFirst = 0, dwEnd = 0;
+	DWORD dwWritten = 0;
+	DWORD dwSaved = 0;
+	DWORD dwIndex;
+	BOOL bResult = FALSE;
+
+	if (NULL == EthCapture.pRing)
+	{
+		_hx_printf("  Nothing captured.\r\n");
+		goto __TERMINAL;
+	}
+	pBuffer = (BYTE*)KMemAlloc(sizeof(__PCAP_RECORD_HEADER) + EthCapture.dwSnapLen,
+		KMEM_SIZE_TYPE_ANY);
+	if (NULL == pBuffer)
+	{
+		goto __TERMINAL;
+	}
+	pRecHdr = (__PCAP_RECORD_HEADER*)pBuffer;
+	hFile = IOManager.CreateFile((__COMMON_OBJECT*)&IOManager,
+		pszTarget,
+		FILE_ACCESS_READWRITE | FILE_OPEN_ALWAYS,
+		0,
+		NULL);
+	if (NULL == hFile)
+	{
+		_hx_printf("  Can not open %s.\r\n", pszTarget);
+		goto __TERMINAL;
+	}
+	//Drop the content of an existing file,the file pointer is at it's start.
+	//Devices such as COM port are streamed to as they are.
+	if ((((__DEVICE_OBJECT*)hFile)->dwAttribute & DEVICE_TYPE_FILE) &&
+		!IOManager.SetEndOfFile((__COMMON_OBJECT*)&IOManager, hFile))
+	{
+		_hx_printf("  Can not truncate %s.\r\n", pszTarget);
+		goto __TERMINAL;
+	}
+
+	fileHdr.magic = PCAP_MAGIC;
+	fileHdr.version_major = PCAP_VERSION_MAJOR;
+	fileHdr.version_minor = PCAP_VERSION_MINOR;
+	fileHdr.thiszone = 0;
+	fileHdr.sigfigs = 0;
+	fileHdr.snaplen = EthCapture.dwSnapLen;
+	fileHdr.linktype = PCAP_LINKTYPE_ETHER;
+	if (!IOManager.WriteFile((__COMMON_OBJECT*)&IOManager, hFile,
+		sizeof(fileHdr), &fileHdr, &dwWritten))
+	{
+		_hx_printf("  Failed to write %s.\r\n", pszTarget);
+		goto __TERMINAL;
+	}
+
+	EthCapRange(&dwFirst, &dwEnd);
+	for (dwIndex = dwFirst; dwIndex < dwEnd; dwIndex++)
+	{
+		if (!EthCapRead(dwIndex, &record, (__u8*)(pRecHdr + 1)))
+		{
+			continue;
+		}
+		us = EthCapTime(&record);
+		pRecHdr->ts_sec = (DWORD)(us / 1000000);
+		pRecHdr->ts_usec = (DWORD)(us % 1000000);
+		pRecHdr->incl_len = record.wCapLen;
+		pRecHdr->orig_len = record.dwOrigLen;
+		if (!IOManager.WriteFile((__COMMON_OBJECT*)&IOManager, hFile,
+			sizeof(__PCAP_RECORD_HEADER) + record.wCapLen, pBuffer, &dwWritten))
+		{
+			_hx_printf("  Failed to write %s.\r\n", pszTarget);
+			goto __TERMINAL;
+		}
+		dwSaved++;
+	}
+	IOManager.FlushFileBuffers((__COMMON_OBJECT*)&IOManager, hFile);
+	_hx_printf("  %u frame(s) saved to %s.\r\n", dwSaved, pszTarget);
+	bResult = TRUE;
+
+__TERMINAL:
+	if (hFile)
+	{
+		IOManager.CloseFile((__COMMON_OBJECT*)&IOManager, hFile);
+	}
+	if (pBuffer)
+	{
+		KMemFree(pBuffer, KMEM_SIZE_TYPE_ANY, 0);
+	}
+	return bResult;
+}
@@ -0,0 +1,125 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : ethcap.h
+//    Module Funciton           :
+//                                Packet capture of Ethernet Manager,frames
+//                                received and sent are truncated and stored
+//                                into a pre-allocated lock free ring,with TSC
+//                                time stamp,and can be saved in pcap format.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//***********************************************************************/
+
+#ifndef __ETHCAP_H__
+#define __ETHCAP_H__
+
+#include "ethmgr.h"
+
+#define ETH_CAP_DEF_SLOTS     2048        //Frames the ring holds by default.
+#define ETH_CAP_MAX_SLOTS     65536
+#define ETH_CAP_DEF_SNAPLEN   128         //Bytes of each frame stored by default.
+#define ETH_CAP_MAX_SNAPLEN   (ETH_DEFAULT_MTU + 14)
+#define ETH_CAP_MAX_INSNS     32          //Instructions of a compiled filter.
+
+//Direction of captured frames.
+#define ETH_CAP_DIR_IN        0x01
+#define ETH_CAP_DIR_OUT       0x02
+
+//Filter instructions,evaluated in postfix order on a bit stack.
+#define ETH_CAP_OP_ETHTYPE    1           //Ethernet type equals value.
+#define ETH_CAP_OP_ETHADDR    2           //Source or destination MAC equals mac.
+#define ETH_CAP_OP_IPPROTO    3           //IPv4 protocol equals value.
+#define ETH_CAP_OP_IPADDR     4           //IPv4 source or destination equals value.
+#define ETH_CAP_OP_PORT       5           //TCP/UDP source or destination port equals value.
+#define ETH_CAP_OP_GREATER    6           //Frame length is not less than value.
+#define ETH_CAP_OP_LESS       7           //Frame length is not greater than value.
+#define ETH_CAP_OP_DIR        8           //Frame is in the direction of value.
+#define ETH_CAP_OP_AND        9
+#define ETH_CAP_OP_OR         10
+#define ETH_CAP_OP_NOT        11
+
+//Which address or port an instruction matches,both if neither is set.
+#define ETH_CAP_MATCH_SRC     0x01
+#define ETH_CAP_MATCH_DST     0x02
+
+typedef struct tag__ETH_CAP_INSN{
+	BYTE                      op;
+	BYTE                      match;      //ETH_CAP_MATCH_XXX.
+	BYTE                      mac[ETH_MAC_LEN];
+	DWORD                     value;      //IPv4 address is in network order.
+}__ETH_CAP_INSN;
+
+//Header of each slot in capture ring,frame data follows it.
+typedef struct tag__ETH_CAP_RECORD{
+	volatile DWORD            dwSeq;      //Sequence number + 1 once written,0 when writting.
+	DWORD                     dwTscLow;
+	DWORD                     dwTscHigh;
+	DWORD                     dwOrigLen;
+	WORD                      wCapLen;
+	BYTE                      byIfIndex;
+	BYTE                      byDir;
+}__ETH_CAP_RECORD;
+
+//Packet capture object.
+typedef struct tag__ETH_CAPTURE{
+	volatile BOOL             bEnabled;   //The only thing checked in hot path when disabled.
+	BOOL                      bWrap;      //Overwrite oldest frames when ring is full.
+	BYTE*                     pRing;
+	DWORD                     dwSlots;
+	DWORD                     dwSlotSize;
+	DWORD                     dwSnapLen;
+	volatile DWORD            dwHead;     //Slots reserved so far.
+	volatile DWORD            dwSeen;     //Frames examined by filter.
+	volatile DWORD            dwWriters;  //Producers in progress.
+	DWORD                     dwStartTscLow;
+	DWORD                     dwStartTscHigh;
+	DWORD                     dwCyclesPerUs;
+	__ETH_CAP_INSN            Filter[ETH_CAP_MAX_INSNS];
+	int                       nInsnNum;   //0 if all frames are captured.
+}__ETH_CAPTURE;
+
+extern __ETH_CAPTURE EthCapture;
+
+//Capture a frame,only called through the hooks below.
+VOID EthCaptureFrame(__ETHERNET_INTERFACE* pEthInt, __u8* pFrame, int nLength, BYTE byDir);
+
+//Capture an outgoing frame in two steps,since it's fragments may be released
+//once it's sent.The record is reserved before sending and becomes visible when
+//committed with bSent,a handle of 0 means the frame is not captured.
+DWORD EthCaptureReserve(__ETHERNET_INTERFACE* pEthInt, __ETH_TX_FRAG* pFrags, int nFragNum);
+VOID EthCaptureCommit(DWORD dwHandle, BOOL bSent);
+
+//Hooks in Ethernet Manager's receiving and sending path,costs one branch
+//when capture is not running.
+#define ETH_CAPTURE_FRAME(pEthInt,pFrame,nLength,byDir) \
+	do { \
+		if (EthCapture.bEnabled) { EthCaptureFrame(pEthInt,pFrame,nLength,byDir); } \
+	} while (0)
+#define ETH_CAPTURE_RESERVE(dwHandle,pEthInt,pFrags,nFragNum) \
+	do { \
+		if (EthCapture.bEnabled) { dwHandle = EthCaptureReserve(pEthInt,pFrags,nFragNum); } \
+	} while (0)
+#define ETH_CAPTURE_COMMIT(dwHandle,bSent) \
+	do { \
+		if (dwHandle) { EthCaptureCommit(dwHandle,bSent); } \
+	} while (0)
+
+//Start capturing with the filter expression given in tokens,such as
+//"tcp and port 80","not arp","ether src 00:11:22:33:44:55 or in".
+BOOL EthCaptureStart(DWORD dwSlots, DWORD dwSnapLen, BOOL bWrap, char** ppszTokens, int nTokenNum);
+
+//Stop capturing,captured frames are kept until next start.
+VOID EthCaptureStop(VOID);
+
+//Show statistics and summary of the last nFrames frames.
+VOID EthCaptureShow(int nFrames);
+
+//Save captured frames in pcap format to a file or device,such as a serial port.
+BOOL EthCaptureSave(LPSTR pszTarget);
+
+#endif  //__ETHCAP_H__
@@ -23,7 +23,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "hx_inet.h"
 #include "ethmgr.h"
+#include "ethcap.h"
 #include "proto.h"
 
 //A helper routine to refresh DHCP configurations of the given interface.
@@ -182,33 +184,41 @@ static void netifConfig(__ETHERNET_INTERFACE* pif,UCHAR proto, __ETH_INTERFACE_S
 
 //Try to receive a packet from a specified interface.This routine maybe called by the
 //ethernet core thread when processing DELIVERY message.
-static void _eth_if_input(__ETHERNET_INTERFACE* pEthInt)
+//At most nBudget frames are received if it's not zero,the number of frames
+//received is returned.
+static int _eth_if_input(__ETHERNET_INTERFACE* pEthInt, int nBudget)
 {
 	__ETHERNET_BUFFER*    p = NULL;
 	__NETWORK_PROTOCOL*   pProtocol = NULL;
 	BOOL                  bDeliveryResult = FALSE;
+	BOOL                  bLoaned = FALSE;
 	int                   err = 0;
 	int                   index = 0;
+	int                   nRecv = 0;
 
 	if (NULL == pEthInt)
 	{
-		return;
+		return 0;
 	}
 
 	if (pEthInt->RecvFrame)
 	{
-		while (TRUE)
+		while ((0 == nBudget) || (nRecv < nBudget))
 		{
 			p = pEthInt->RecvFrame(pEthInt);
 			if (NULL == p)  //No available frames.
 			{
 				break;
 			}
+			nRecv++;
+			ETH_CAPTURE_FRAME(pEthInt, ETH_FRAME_DATA(p), p->act_length, ETH_CAP_DIR_IN);
 			//_hx_printf("  %s: Received ethernet frame,type = %X,length = %d.\r\n",
 			//	__func__,p->frame_type, p->act_length);
 			//Update interface statistics.
 			pEthInt->ifState.dwFrameRecv++;
 			pEthInt->ifState.dwTotalRecvSize += p->act_length;
+			bLoaned = (NULL != p->pLoanFrame);
+			bDeliveryResult = FALSE;
 			//Delivery the frame to layer 3.
 			for (index = 0; index < MAX_BIND_PROTOCOL_NUM; index++)
 			{
@@ -228,10 +238,220 @@ static void _eth_if_input(__ETHERNET_INTERFACE* pEthInt)
 					}
 				}
 			}
-			//Release the Ethernet Buffer object.
-			EthernetManager.DestroyEthernetBuffer(p);
+			//Release the Ethernet Buffer object,a loaned one is owned by
+			//L3 protocol once delivered successfully.
+			if (!(bLoaned && bDeliveryResult))
+			{
+				EthernetManager.DestroyEthernetBuffer(p);
+			}
+		}
+	}
+	return nRecv;
+}
+
+//Schedule a polling of interface's Rx ring,it's called by NIC driver in
+//interrupt handler after masking Rx interrupt.Only one polling is pending
+//for each interface.
+static BOOL _ScheduleRxPoll(__ETHERNET_INTERFACE* pEthInt)
+{
+	__KERNEL_THREAD_MESSAGE msg;
+	DWORD dwFlags;
+
+	if ((NULL == pEthInt) || (NULL == pEthInt->RxIntControl))
+	{
+		return FALSE;
+	}
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	if (pEthInt->bRxPollScheduled)
+	{
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		return TRUE;
+	}
+	pEthInt->bRxPollScheduled = TRUE;
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+
+	msg.wCommand = ETH_MSG_RXPOLL;
+	msg.wParam = 0;
+	msg.dwParam = (DWORD)pEthInt;
+	if (!SendMessage((HANDLE)EthernetManager.EthernetCoreThread, &msg))
+	{
+		//Can not schedule,enable Rx interrupt again to avoid losing frames.
+		pEthInt->bRxPollScheduled = FALSE;
+		pEthInt->RxIntControl(pEthInt, TRUE);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+//Handle the scheduled Rx polling of an interface.If the budget is exhausted
+//another round is scheduled,otherwise the Rx ring is drained and Rx interrupt
+//is enabled again.
+static void _RxPollHandler(__ETHERNET_INTERFACE* pEthInt)
+{
+	__KERNEL_THREAD_MESSAGE msg;
+
+	if ((NULL == pEthInt) || (NULL == pEthInt->RxIntControl))
+	{
+		return;
+	}
+	pEthInt->ifState.dwRxPollNum++;
+	if (_eth_if_input(pEthInt, ETH_RX_POLL_BUDGET) >= ETH_RX_POLL_BUDGET)
+	{
+		pEthInt->ifState.dwRxPollFull++;
+		//Continue in next round,after the messages already in queue.
+		msg.wCommand = ETH_MSG_RXPOLL;
+		msg.wParam = 0;
+		msg.dwParam = (DWORD)pEthInt;
+		if (SendMessage((HANDLE)EthernetManager.EthernetCoreThread, &msg))
+		{
+			return;
 		}
 	}
+	pEthInt->bRxPollScheduled = FALSE;
+	pEthInt->RxIntControl(pEthInt, TRUE);
+}
+
+//Schedule sending of the frames deferred by SendFrags,it's called by NIC driver
+//after Tx descriptors are reclaimed,maybe in interrupt handler.Only one sending
+//is pending for each interface.
+static BOOL _TxWakeup(__ETHERNET_INTERFACE* pEthInt)
+{
+	__KERNEL_THREAD_MESSAGE msg;
+	DWORD dwFlags;
+
+	if (NULL == pEthInt)
+	{
+		return FALSE;
+	}
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	if ((0 == pEthInt->nTxPendNum) || pEthInt->bTxWakeupScheduled)
+	{
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		return TRUE;
+	}
+	pEthInt->bTxWakeupScheduled = TRUE;
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+
+	msg.wCommand = ETH_MSG_TXWAKEUP;
+	msg.wParam = 0;
+	msg.dwParam = (DWORD)pEthInt;
+	if (!SendMessage((HANDLE)EthernetManager.EthernetCoreThread, &msg))
+	{
+		//Try again when next Tx descriptor is reclaimed.
+		pEthInt->bTxWakeupScheduled = FALSE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+//Queue the deferred frames to NIC in sending order,until the Tx ring is full
+//again.The frame is removed from pending list only after it's queued,so any
+//descriptor reclaimed after the flag is cleared schedules another round.
+static void _TxWakeupHandler(__ETHERNET_INTERFACE* pEthInt)
+{
+	__ETH_TX_PENDING* pPend = NULL;
+	BOOL bDown = FALSE;
+	BOOL bSent = FALSE;
+	DWORD dwFlags;
+
+	if (NULL == pEthInt)
+	{
+		return;
+	}
+	pEthInt->bTxWakeupScheduled = FALSE;
+	while (TRUE)
+	{
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		pPend = pEthInt->pTxPendFirst;
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		if (NULL == pPend)
+		{
+			break;
+		}
+		bDown = (pEthInt->ifState.dwInterfaceStatus & ETHERNET_INTERFACE_STATUS_DOWN) ? TRUE : FALSE;
+		bSent = FALSE;
+		if (!bDown)
+		{
+			bSent = pEthInt->SendFrags(pEthInt, pPend->Frags, pPend->nFragNum,
+				pPend->bOffload ? &pPend->Offload : NULL,
+				pPend->TxDone, pPend->pTxParam);
+			if (!bSent)
+			{
+				//Tx ring is full again.
+				break;
+			}
+		}
+		__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+		pEthInt->pTxPendFirst = pPend->pNext;
+		if (NULL == pEthInt->pTxPendFirst)
+		{
+			pEthInt->pTxPendLast = NULL;
+		}
+		pEthInt->nTxPendNum--;
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		if (!bSent)
+		{
+			//Interface is shut down,release the fragments.
+			pEthInt->ifState.dwTxDeferDrop++;
+			pPend->TxDone(pPend->pTxParam);
+		}
+		_hx_free(pPend);
+	}
+}
+
+//Defer a scatter-gather frame since NIC's Tx ring is full,it's sent in
+//ethernet core thread once Tx descriptors are reclaimed.
+static BOOL _DeferFrags(__ETHERNET_INTERFACE* pEthInt, __ETH_TX_FRAG* pFrags, int nFragNum,
+	__ETH_TX_OFFLOAD* pOffload, __ETH_TX_DONE TxDone, LPVOID pTxParam)
+{
+	__ETH_TX_PENDING* pPend = NULL;
+	DWORD dwFlags;
+	int i;
+
+	if (pEthInt->nTxPendNum >= ETH_TX_PENDING_MAX)
+	{
+		pEthInt->ifState.dwTxDeferDrop++;
+		return FALSE;
+	}
+	pPend = (__ETH_TX_PENDING*)_hx_malloc(sizeof(__ETH_TX_PENDING));
+	if (NULL == pPend)
+	{
+		pEthInt->ifState.dwTxDeferDrop++;
+		return FALSE;
+	}
+	for (i = 0; i < nFragNum; i++)
+	{
+		pPend->Frags[i] = pFrags[i];
+	}
+	pPend->nFragNum = nFragNum;
+	pPend->bOffload = FALSE;
+	if (pOffload)
+	{
+		pPend->Offload = *pOffload;
+		pPend->bOffload = TRUE;
+	}
+	pPend->TxDone = TxDone;
+	pPend->pTxParam = pTxParam;
+	pPend->pNext = NULL;
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	if (pEthInt->pTxPendLast)
+	{
+		pEthInt->pTxPendLast->pNext = pPend;
+	}
+	else
+	{
+		pEthInt->pTxPendFirst = pPend;
+	}
+	pEthInt->pTxPendLast = pPend;
+	pEthInt->nTxPendNum++;
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	pEthInt->ifState.dwTxDeferred++;
+
+	//Descriptors may be reclaimed before the frame is deferred,so try once
+	//in ethernet core thread.
+	_TxWakeup(pEthInt);
+	return TRUE;
 }
 
 //A helper routine,to poll all ethernet interface(s) to check if there is frame availabe,
@@ -244,7 +464,7 @@ static void _ethernet_if_input()
 	for (index = 0; index < EthernetManager.nIntIndex; index++)
 	{
 		pEthInt = &EthernetManager.EthInterfaces[index];
-		_eth_if_input(pEthInt);
+		_eth_if_input(pEthInt, 0);
 	}
 }
 
@@ -353,6 +573,7 @@ static BOOL _PostFrame(__ETHERNET_INTERFACE* pEthInt, __ETHERNET_BUFFER* pBuffer
 	{
 		return FALSE;
 	}
+	ETH_CAPTURE_FRAME(pEthInt, ETH_FRAME_DATA(pBuffer), pBuffer->act_length, ETH_CAP_DIR_IN);
 	//Link the ethernet buffer object to list,and send a message to ethernet core
 	//thread if is the fist buffer object.
 	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
@@ -401,6 +622,7 @@ static BOOL _PostFrameHandler()
 	__ETHERNET_INTERFACE* pEthInt = NULL;
 	__NETWORK_PROTOCOL* pProtocol = NULL;
 	BOOL bDeliveryResult = FALSE;
+	BOOL bLoaned = FALSE;
 	int index = 0;
 	DWORD dwFlags;
 
@@ -441,6 +663,8 @@ static BOOL _PostFrameHandler()
 		}
 		pEthInt->ifState.dwFrameRecv++;
 		pEthInt->ifState.dwTotalRecvSize += pBuffer->act_length;
+		bLoaned = (NULL != pBuffer->pLoanFrame);
+		bDeliveryResult = FALSE;
 		//Delivery the frame to layer 3.
 		for (index = 0; index < MAX_BIND_PROTOCOL_NUM; index++)
 		{
@@ -459,8 +683,12 @@ static BOOL _PostFrameHandler()
 				}
 			}
 		}
-		//Release the Ethernet Buffer object.
-		EthernetManager.DestroyEthernetBuffer(pBuffer);
+		//Release the Ethernet Buffer object,a loaned one is owned by
+		//L3 protocol once delivered successfully.
+		if (!(bLoaned && bDeliveryResult))
+		{
+			EthernetManager.DestroyEthernetBuffer(pBuffer);
+		}
 	}
 	return TRUE;
 }
@@ -566,7 +794,14 @@ static DWORD EthCoreThreadEntry(LPVOID pData)
 				if (&pEthInt->SendBuffer != pEthBuffer)  //Not the default Ethernet Buffer.
 				{
 					//Copy to ethernet interface's default buffer.
-					memcpy(&pEthInt->SendBuffer, pEthBuffer, sizeof(__ETHERNET_BUFFER));
+					if (tot_len > pEthInt->SendBuffer.buff_length)
+					{
+						EthernetManager.DestroyEthernetBuffer(pEthBuffer);
+						break;
+					}
+					memcpy(&pEthInt->SendBuffer, pEthBuffer, ETH_LOANED_BUFFER_SIZE + tot_len);
+					pEthInt->SendBuffer.buff_length = ETH_DEFAULT_MTU + ETH_HEADER_LEN;
+					pEthInt->SendBuffer.pPool = NULL;
 					//Release the Ethernet Buffer object.
 					EthernetManager.DestroyEthernetBuffer(pEthBuffer);
 				}
@@ -582,7 +817,13 @@ static DWORD EthCoreThreadEntry(LPVOID pData)
 
 			case ETH_MSG_RECEIVE:              //Receive frame,may triggered by interrupt.
 				pEthInt = (__ETHERNET_INTERFACE*)msg.dwParam;
-				_eth_if_input(pEthInt);
+				_eth_if_input(pEthInt, 0);
+				break;
+			case ETH_MSG_RXPOLL:               //Rx polling scheduled by interrupt.
+				_RxPollHandler((__ETHERNET_INTERFACE*)msg.dwParam);
+				break;
+			case ETH_MSG_TXWAKEUP:             //Tx descriptors reclaimed.
+				_TxWakeupHandler((__ETHERNET_INTERFACE*)msg.dwParam);
 				break;
 			case ETH_MSG_POSTFRAME:
 				_PostFrameHandler();
@@ -714,10 +955,200 @@ static BOOL SendFrame(__ETHERNET_INTERFACE* pEthInt, __ETHERNET_BUFFER* pEthBuff
 	}
 	//_hx_printf("%s:send out a frame with length = %d.\r\n", __func__,
 	//	pSendBuff->act_length);
+	ETH_CAPTURE_FRAME(pEthInt, ETH_FRAME_DATA(pSendBuff), pSendBuff->act_length, ETH_CAP_DIR_OUT);
 	SendMessage((HANDLE)EthernetManager.EthernetCoreThread, &msg);
 	return TRUE;
 }
 
+//Create a buffer pool,nBuffLength is the frame length each buffer can hold,
+//0 for header only buffers.All buffers are allocated in one memory block.
+static BOOL _CreateBufferPool(__ETH_BUFFER_POOL* pPool, int nBuffNum, int nBuffLength)
+{
+	__ETHERNET_BUFFER* pEthBuff = NULL;
+	int i = 0;
+
+	memset(pPool, 0, sizeof(__ETH_BUFFER_POOL));
+	pPool->nBuffSize = (ETH_LOANED_BUFFER_SIZE + nBuffLength + 7) & ~7;
+	pPool->pMemory = _hx_malloc(pPool->nBuffSize * nBuffNum);
+	if (NULL == pPool->pMemory)
+	{
+		return FALSE;
+	}
+	for (i = nBuffNum - 1; i >= 0; i--)
+	{
+		pEthBuff = (__ETHERNET_BUFFER*)((char*)pPool->pMemory + i * pPool->nBuffSize);
+		pEthBuff->pNext = pPool->pFreeList;
+		pPool->pFreeList = pEthBuff;
+	}
+	pPool->nBuffLength = nBuffLength;
+	pPool->nBuffNum = nBuffNum;
+	pPool->nFreeNum = nBuffNum;
+	pPool->nMinFree = nBuffNum;
+	pPool->nLowWater = ETH_POOL_LOW_WATER(nBuffNum);
+	pPool->nHighWater = ETH_POOL_HIGH_WATER(nBuffNum);
+	return TRUE;
+}
+
+//Release the memory of a buffer pool,all buffers must be returned already.
+static VOID _DestroyBufferPool(__ETH_BUFFER_POOL* pPool)
+{
+	if (pPool->pMemory)
+	{
+		_hx_free(pPool->pMemory);
+	}
+	memset(pPool, 0, sizeof(__ETH_BUFFER_POOL));
+}
+
+//Take a buffer from pool,NULL is returned if the pool is exhausted or
+//throttled.It maybe called in interrupt context.
+static __ETHERNET_BUFFER* _GetPoolBuffer(__ETH_BUFFER_POOL* pPool)
+{
+	__ETHERNET_BUFFER* pEthBuff = NULL;
+	DWORD dwFlags;
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	if (pPool->bThrottled || (NULL == pPool->pFreeList))
+	{
+		pPool->dwDropNum++;
+		__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+		return NULL;
+	}
+	pEthBuff = pPool->pFreeList;
+	pPool->pFreeList = pEthBuff->pNext;
+	pPool->nFreeNum--;
+	pPool->dwAllocNum++;
+	if (pPool->nFreeNum < pPool->nMinFree)
+	{
+		pPool->nMinFree = pPool->nFreeNum;
+	}
+	if (pPool->nFreeNum < pPool->nLowWater)
+	{
+		pPool->bThrottled = TRUE;
+		pPool->dwThrottleNum++;
+	}
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+	pEthBuff->pPool = pPool;
+	return pEthBuff;
+}
+
+//Return a buffer to it's pool.
+static VOID _PutPoolBuffer(__ETH_BUFFER_POOL* pPool, __ETHERNET_BUFFER* pEthBuff)
+{
+	DWORD dwFlags;
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	pEthBuff->pNext = pPool->pFreeList;
+	pPool->pFreeList = pEthBuff;
+	pPool->nFreeNum++;
+	if (pPool->bThrottled && (pPool->nFreeNum > pPool->nHighWater))
+	{
+		pPool->bThrottled = FALSE;
+	}
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+}
+
+//Send out a frame gathered from fragments through the specified interface,it's
+//queued to NIC directly in caller's context,TxDone is called by the driver when
+//the frame is sent out.The fragments must not be changed before that.
+static BOOL _SendFrags(__ETHERNET_INTERFACE* pEthInt, __ETH_TX_FRAG* pFrags, int nFragNum,
+	__ETH_TX_OFFLOAD* pOffload, __ETH_TX_DONE TxDone, LPVOID pTxParam)
+{
+	BOOL bResult = FALSE;
+	DWORD dwCapture = 0;
+	int tot_len = 0;
+	int max_len = ETH_DEFAULT_MTU + ETH_HEADER_LEN;
+	int i = 0;
+
+	if ((NULL == pEthInt) || (NULL == pFrags))
+	{
+		goto __TERMINAL;
+	}
+	if ((nFragNum <= 0) || (nFragNum > ETH_MAX_TX_FRAGS))
+	{
+		goto __TERMINAL;
+	}
+	if (NULL == pEthInt->SendFrags)
+	{
+		goto __TERMINAL;
+	}
+	if (pEthInt->ifState.dwInterfaceStatus & ETHERNET_INTERFACE_STATUS_DOWN)
+	{
+		goto __TERMINAL;
+	}
+	if (pOffload)
+	{
+		//Only the offloads negotiated can be requested.
+		if (pOffload->dwFlags & ~pEthInt->dwOffload)
+		{
+			goto __TERMINAL;
+		}
+		if (pOffload->dwFlags & ETH_OFFLOAD_TSO)
+		{
+			if (0 == pOffload->mss)
+			{
+				goto __TERMINAL;
+			}
+			max_len = pEthInt->nTsoMaxFrame;
+		}
+	}
+	for (i = 0; i < nFragNum; i++)
+	{
+		tot_len += pFrags[i].length;
+	}
+	if (tot_len > max_len)
+	{
+		goto __TERMINAL;
+	}
+	//Reserve capture record before queuing,fragments may be released once the
+	//frame is sent,it's committed only if the frame is sent or deferred.
+	ETH_CAPTURE_RESERVE(dwCapture, pEthInt, pFrags, nFragNum);
+	//Keep sending order,the frame is deferred behind the pending ones,or
+	//if the Tx ring is full.
+	if (pEthInt->nTxPendNum ||
+		!pEthInt->SendFrags(pEthInt, pFrags, nFragNum, pOffload, TxDone, pTxParam))
+	{
+		bResult = _DeferFrags(pEthInt, pFrags, nFragNum, pOffload, TxDone, pTxParam);
+	}
+	else
+	{
+		bResult = TRUE;
+	}
+	ETH_CAPTURE_COMMIT(dwCapture, bResult);
+	if (bResult)
+	{
+		pEthInt->ifState.dwFrameSendSuccess += 1;
+		pEthInt->ifState.dwTotalSendSize += tot_len;
+	}
+	pEthInt->ifState.dwFrameSend += 1;
+
+__TERMINAL:
+	return bResult;
+}
+
+//Create jumbo buffer pool for a given interface,only one jumbo pool can be
+//created for each interface.
+static BOOL _CreateJumboPool(__ETHERNET_INTERFACE* pEthInt, int nBuffNum, int nFrameLength)
+{
+	if ((NULL == pEthInt) || (nBuffNum <= 0))
+	{
+		return FALSE;
+	}
+	if (nFrameLength <= ETH_DEFAULT_MTU + ETH_HEADER_LEN)
+	{
+		return FALSE;
+	}
+	//The length of buffer is recorded in a 16 bits field.
+	if (nFrameLength > 0xFFFF)
+	{
+		return FALSE;
+	}
+	if (pEthInt->JumboPool.pMemory)  //Already created.
+	{
+		return FALSE;
+	}
+	return _CreateBufferPool(&pEthInt->JumboPool, nBuffNum, nFrameLength);
+}
+
 //Implementation of AddEthernetInterface,which is called by Ethernet Driver to register an interface
 //object.
 static __ETHERNET_INTERFACE* AddEthernetInterface(char* ethName,char* mac,LPVOID pIntExtension,
@@ -731,6 +1162,8 @@ static __ETHERNET_INTERFACE* AddEthernetInterface(char* ethName,char* mac,LPVOID
 	int                          index = 0, i = 0;
 	BOOL                         bDefaultInt = FALSE;       //If the added interface is default one.
 	__NETWORK_PROTOCOL*          pProtocol = NULL;
+	DWORD                        dwOffload = 0;
+	int                          nMaxFrame = 0;
 
 	if ((NULL == ethName) || (NULL == SendFrame) || (NULL == mac))  //Name and send operation are mandatory.
 	{
@@ -761,6 +1194,16 @@ static __ETHERNET_INTERFACE* AddEthernetInterface(char* ethName,char* mac,LPVOID
 	pEthInt->SendBuffer.pEthernetInterface = NULL;
 	pEthInt->SendBuffer.pNext = NULL;
 
+	//Create buffer pools,buffers are allocated from heap if failed.
+	if (!_CreateBufferPool(&pEthInt->BuffPool, ETH_BUFFER_POOL_SIZE, ETH_DEFAULT_MTU + ETH_HEADER_LEN))
+	{
+		_hx_printf("  Warning: can not create buffer pool for [%s].\r\n", ethName);
+	}
+	if (!_CreateBufferPool(&pEthInt->HdrPool, ETH_HEADER_POOL_SIZE, 0))
+	{
+		_hx_printf("  Warning: can not create header pool for [%s].\r\n", ethName);
+	}
+
 	//Copy ethernet name,do not use strxxx routine for safety.
 	while (ethName[index] && (index < MAX_ETH_NAME_LEN))
 	{
@@ -788,6 +1231,35 @@ static __ETHERNET_INTERFACE* AddEthernetInterface(char* ethName,char* mac,LPVOID
 	pEthInt->RecvFrame = RecvFrame;
 	pEthInt->IntControl = IntCtrl;
 
+	//Negotiate offloads with NIC before binding to protocols,so they are
+	//known when L3 interfaces are created.TSO relies on checksum offload,
+	//driver lowers the maximal TSO frame length if NIC can not reach it.
+	pEthInt->nTsoMaxFrame = ETH_TSO_MAX_FRAME;
+	if (IntCtrl && IntCtrl(pEthInt, ETH_MSG_OFFLOAD, &dwOffload))
+	{
+		dwOffload &= ETH_OFFLOAD_ALL;
+		if (!(dwOffload & ETH_OFFLOAD_TX_TCPCSUM))
+		{
+			dwOffload &= ~ETH_OFFLOAD_TSO;
+		}
+		if ((pEthInt->nTsoMaxFrame > ETH_TSO_MAX_FRAME) ||
+			(pEthInt->nTsoMaxFrame <= ETH_DEFAULT_MTU + ETH_HEADER_LEN))
+		{
+			dwOffload &= ~ETH_OFFLOAD_TSO;
+			pEthInt->nTsoMaxFrame = ETH_TSO_MAX_FRAME;
+		}
+		pEthInt->dwOffload = dwOffload;
+	}
+	//Create jumbo pool if the NIC receives frames longer than default MTU.
+	if (IntCtrl && IntCtrl(pEthInt, ETH_MSG_MAXFRAME, &nMaxFrame) &&
+		(nMaxFrame > ETH_DEFAULT_MTU + ETH_HEADER_LEN))
+	{
+		if (!_CreateJumboPool(pEthInt, ETH_JUMBO_POOL_SIZE, nMaxFrame))
+		{
+			_hx_printf("  Warning: can not create jumbo pool for [%s].\r\n", ethName);
+		}
+	}
+
 	//Bind to protocols.
 	i = 0;
 	index = 0;
@@ -854,6 +1326,9 @@ __TERMINAL:
 						pEthInt->Proto_Interface[index].pL3Interface);
 				}
 			}
+			_DestroyBufferPool(&pEthInt->BuffPool);
+			_DestroyBufferPool(&pEthInt->JumboPool);
+			_DestroyBufferPool(&pEthInt->HdrPool);
 			//Clear the allocated ethernet slot.
 			memset(pEthInt, 0, sizeof(__ETHERNET_INTERFACE));
 			EthernetManager.nIntIndex--;
@@ -909,6 +1384,39 @@ __TERMINAL:
 	return bResult;
 }
 
+//Show usage and statistics of a buffer pool.
+static VOID ShowBufferPool(char* pszName, __ETH_BUFFER_POOL* pPool)
+{
+	if (NULL == pPool->pMemory)  //Pool is not created.
+	{
+		return;
+	}
+	_hx_printf("    %-19s: free %d/%d,min free %d,watermark %d/%d%s\r\n",
+		pszName,
+		pPool->nFreeNum,
+		pPool->nBuffNum,
+		pPool->nMinFree,
+		pPool->nLowWater,
+		pPool->nHighWater,
+		pPool->bThrottled ? ",throttled" : "");
+	_hx_printf("    %-19s  alloc %d,drop %d,throttle %d\r\n",
+		"",
+		pPool->dwAllocNum,
+		pPool->dwDropNum,
+		pPool->dwThrottleNum);
+}
+
+//Show offloads negotiated with NIC.
+static VOID ShowOffload(DWORD dwOffload)
+{
+	_hx_printf("    Offloads           : %s%s%s%s%s\r\n",
+		(dwOffload & ETH_OFFLOAD_TX_TCPCSUM) ? "tx-tcp-csum " : "",
+		(dwOffload & ETH_OFFLOAD_TX_UDPCSUM) ? "tx-udp-csum " : "",
+		(dwOffload & ETH_OFFLOAD_RX_CSUM) ? "rx-csum " : "",
+		(dwOffload & ETH_OFFLOAD_TSO) ? "tso " : "",
+		dwOffload ? "" : "none");
+}
+
 //Display all ethernet interface's statistics information.
 static VOID ShowInt(char* ethName)
 {
@@ -929,6 +1437,14 @@ static VOID ShowInt(char* ethName)
 			_hx_printf("    Receive frame #    : %d\r\n", pState->dwFrameRecv);
 			_hx_printf("    Success recv #     : %d\r\n", pState->dwFrameRecvSuccess);
 			_hx_printf("    Receive bytes size : %d\r\n", pState->dwTotalRecvSize);
+			_hx_printf("    Rx polling rounds  : %d(%d exhausted budget)\r\n",
+				pState->dwRxPollNum, pState->dwRxPollFull);
+			_hx_printf("    Tx deferred #      : %d(%d dropped,%d linearized)\r\n",
+				pState->dwTxDeferred, pState->dwTxDeferDrop, pState->dwTxLinearized);
+			ShowOffload(EthernetManager.EthInterfaces[index].dwOffload);
+			ShowBufferPool("Buffer pool", &EthernetManager.EthInterfaces[index].BuffPool);
+			ShowBufferPool("Jumbo pool", &EthernetManager.EthInterfaces[index].JumboPool);
+			ShowBufferPool("Header pool", &EthernetManager.EthInterfaces[index].HdrPool);
 		}
 	}
 	else //Show a specified ethernet interface.
@@ -1169,25 +1685,56 @@ __TERMINAL:
 
 //Create an Ethernet Buffer object and return it,NULL will be returned
 //if failed to create.
-//buff_length will be skiped in current implementation,since the Ethernet Buffer
-//use the MTU as default buffer size.
-static __ETHERNET_BUFFER* _CreateEthernetBuffer(int buff_length)
+//The buffer is taken from pEthInt's buffer pool,jumbo pool is used if
+//buff_length exceeds the default MTU.It's allocated from heap if pEthInt
+//is NULL or the interface has no pool.
+static __ETHERNET_BUFFER* _CreateEthernetBuffer(__ETHERNET_INTERFACE* pEthInt, int buff_length)
 {
 	__ETHERNET_BUFFER* pEthBuff = NULL;
+	__ETH_BUFFER_POOL* pPool = NULL;
 
-	pEthBuff = (__ETHERNET_BUFFER*)_hx_malloc(sizeof(__ETHERNET_BUFFER));
-	if (NULL == pEthBuff)
+	if (pEthInt)
 	{
-		_hx_printf("  %s: can not allocate Ethernet Buffer object.\r\n", __func__);
-		goto __TERMINAL;
+		pPool = &pEthInt->BuffPool;
+		if (buff_length > ETH_DEFAULT_MTU + ETH_HEADER_LEN)
+		{
+			pPool = &pEthInt->JumboPool;
+		}
+	}
+	if (pPool && pPool->pMemory)
+	{
+		pEthBuff = _GetPoolBuffer(pPool);
+		if (NULL == pEthBuff)
+		{
+			goto __TERMINAL;
+		}
+		pEthBuff->buff_length = pPool->nBuffLength;
+	}
+	else
+	{
+		if (buff_length > ETH_DEFAULT_MTU + ETH_HEADER_LEN)
+		{
+			goto __TERMINAL;
+		}
+		pEthBuff = (__ETHERNET_BUFFER*)_hx_malloc(sizeof(__ETHERNET_BUFFER));
+		if (NULL == pEthBuff)
+		{
+			_hx_printf("  %s: can not allocate Ethernet Buffer object.\r\n", __func__);
+			goto __TERMINAL;
+		}
+		pEthBuff->buff_length = ETH_DEFAULT_MTU + ETH_HEADER_LEN;
+		pEthBuff->pPool = NULL;
 	}
 	//Create OK,initialize it.
 	pEthBuff->pNext = NULL;
 	pEthBuff->act_length = buff_length;
-	pEthBuff->buff_length = ETH_DEFAULT_MTU + ETH_HEADER_LEN;
 	pEthBuff->frame_type = 0;
 	pEthBuff->buff_status = ETHERNET_BUFFER_STATUS_FREE;
-	pEthBuff->pEthernetInterface = NULL;
+	pEthBuff->pEthernetInterface = pEthInt;
+	pEthBuff->pLoanFrame = NULL;
+	pEthBuff->FrameFree = NULL;
+	pEthBuff->pFreeParam = NULL;
+	pEthBuff->dwRxOffload = 0;
 	memset(pEthBuff->srcMAC, 0, sizeof(pEthBuff->srcMAC));
 	memset(pEthBuff->dstMAC, 0, sizeof(pEthBuff->dstMAC));
 
@@ -1195,6 +1742,60 @@ __TERMINAL:
 	return pEthBuff;
 }
 
+//Create an Ethernet Buffer object whose frame data resides in NIC driver's
+//receiving buffer,only the header part of the object is allocated,from
+//interface's header pool.
+//The frame is given back to driver by calling FrameFree when the object is
+//destroyed,so the driver must not reuse it before that.
+static __ETHERNET_BUFFER* _CreateLoanedBuffer(__ETHERNET_INTERFACE* pEthInt,
+	__u8* pFrame,
+	int frame_length,
+	__ETH_FRAME_FREE FrameFree,
+	LPVOID pFreeParam)
+{
+	__ETHERNET_BUFFER* pEthBuff = NULL;
+
+	if ((NULL == pFrame) || (NULL == FrameFree))
+	{
+		goto __TERMINAL;
+	}
+	if ((frame_length < ETH_HEADER_LEN) || (frame_length > 0xFFFF))
+	{
+		goto __TERMINAL;
+	}
+	if (pEthInt && pEthInt->HdrPool.pMemory)
+	{
+		pEthBuff = _GetPoolBuffer(&pEthInt->HdrPool);
+	}
+	else
+	{
+		pEthBuff = (__ETHERNET_BUFFER*)_hx_malloc(ETH_LOANED_BUFFER_SIZE);
+		if (pEthBuff)
+		{
+			pEthBuff->pPool = NULL;
+		}
+	}
+	if (NULL == pEthBuff)
+	{
+		goto __TERMINAL;
+	}
+	pEthBuff->pNext = NULL;
+	pEthBuff->act_length = frame_length;
+	pEthBuff->buff_length = frame_length;
+	pEthBuff->buff_status = ETHERNET_BUFFER_STATUS_INITIALIZED;
+	pEthBuff->pEthernetInterface = pEthInt;
+	pEthBuff->pLoanFrame = pFrame;
+	pEthBuff->FrameFree = FrameFree;
+	pEthBuff->pFreeParam = pFreeParam;
+	pEthBuff->dwRxOffload = 0;
+	memcpy(pEthBuff->dstMAC, pFrame, ETH_MAC_LEN);
+	memcpy(pEthBuff->srcMAC, pFrame + ETH_MAC_LEN, ETH_MAC_LEN);
+	pEthBuff->frame_type = _hx_ntohs(*(__u16*)(pFrame + ETH_MAC_LEN + ETH_MAC_LEN));
+
+__TERMINAL:
+	return pEthBuff;
+}
+
 //Destroy a specified Ethernet Buffer object.
 static VOID _DestroyEthernetBuffer(__ETHERNET_BUFFER* pEthBuff)
 {
@@ -1202,8 +1803,21 @@ static VOID _DestroyEthernetBuffer(__ETHERNET_BUFFER* pEthBuff)
 	{
 		return;
 	}
-	//Buffer length should be fixed as ETH_DEFAULT_MTU + ETH_HEADER_LEN currently.
-	if ((ETH_DEFAULT_MTU + ETH_HEADER_LEN)!= pEthBuff->buff_length)
+	//Give the loaned frame back to driver.
+	if (pEthBuff->pLoanFrame)
+	{
+		pEthBuff->FrameFree(pEthBuff);
+	}
+	//Return to the pool it comes from.
+	if (pEthBuff->pPool)
+	{
+		_PutPoolBuffer((__ETH_BUFFER_POOL*)pEthBuff->pPool, pEthBuff);
+		return;
+	}
+	//Buffer length should be fixed as ETH_DEFAULT_MTU + ETH_HEADER_LEN for
+	//buffers allocated from heap.
+	if ((NULL == pEthBuff->pLoanFrame) &&
+		((ETH_DEFAULT_MTU + ETH_HEADER_LEN) != pEthBuff->buff_length))
 	{
 		BUG();
 		return;
@@ -1240,5 +1854,9 @@ struct __ETHERNET_MANAGER EthernetManager = {
 	UnshutInterface,        //UnshutInterface.
 	_GetEthernetInterfaceState,    //GetEthernetInterfaceState.
 	_CreateEthernetBuffer,         //CreateEthernetBuffer.
-	_DestroyEthernetBuffer         //DestroyEthernetBuffer.
+	_DestroyEthernetBuffer,        //DestroyEthernetBuffer.
+	_CreateLoanedBuffer,           //CreateLoanedBuffer.
+	_SendFrags,                    //SendFrags.
+	_ScheduleRxPoll,               //ScheduleRxPoll.
+	_TxWakeup                      //TxWakeup.
 };
@@ -42,19 +42,31 @@
 #define ETH_MSG_SHOWINT 0x0200    //Display interface's statistics informtion.
 #define ETH_MSG_DELIVER 0x0400    //Delivery a packet to upper layer.
 #define ETH_MSG_POSTFRAME 0x0800  //Post a frame to ethernet core.
+#define ETH_MSG_RXPOLL  0x1000    //Poll the Rx ring of interface,scheduled by interrupt.
+#define ETH_MSG_OFFLOAD 0x2000    //Query offload capabilities of NIC,by IntControl only.
+#define ETH_MSG_TXWAKEUP 0x4000   //Send deferred frames,scheduled by TxWakeup.
+#define ETH_MSG_MAXFRAME 0x8000   //Query maximal frame length NIC receives,by IntControl only.
+
+//Maximal frames fetched from one interface in one polling round,the rest
+//are fetched in next round so other interfaces and messages get a chance.
+#define ETH_RX_POLL_BUDGET   16
 
 #define MAX_ETH_NAME_LEN     31   //Maximal length of ethernet interface.
 #define ETH_MAC_LEN          6    //MAC address's length.
 #define ETH_DEFAULT_MTU      1500 //Default maximal transmition unit.
 #define ETH_HEADER_LEN       24   //Ethernet frame header's length,assume 24 bytes to accomadate more data.
 
+//Received frames shorter than this value are copied into a new Ethernet Buffer
+//by NIC driver,and longer ones are loaned to upper layer in place,the driver's
+//receiving buffer is replaced by a spare one in this case.
+#define ETH_RX_COPYBREAK     256
+
 //Ethernet buffer object,each ethernet frame corresponding one of this object.
 typedef struct tag__ETHERNET_BUFFER{
 	struct tag__ETHERNET_BUFFER* pNext;  //Pointing to next one if has.
 	__u8       srcMAC[ETH_MAC_LEN];      //Source MAC address.
 	__u8       dstMAC[ETH_MAC_LEN];      //Destination MAC address.
 	__u16      frame_type;
-	__u8       Buffer[ETH_DEFAULT_MTU + ETH_HEADER_LEN];  //Actual ethernet frame data.
 	__u16      buff_length;              //Length of frame data,current is not used.
 	__u16      act_length;               //Actual buffer length.
 	__u16      buff_status;              //Status of the Ethernet Buffer.
@@ -62,8 +74,113 @@ typedef struct tag__ETHERNET_BUFFER{
 #define ETHERNET_BUFFER_STATUS_INITIALIZED 0x01  //Buffer is initialized.
 #define ETHERNET_BUFFER_STATUS_PENDING     0x02  //Pending in queue.
 	LPVOID     pEthernetInterface;       //Ethernet Interface this buffer associated to.
+
+	//Frame data loaned by NIC driver,Buffer is not used if it's not NULL.
+	//FrameFree gives the frame back to driver when the buffer is destroyed.
+	//A loaned buffer is owned by L3 protocol once DeliveryFrame returns TRUE.
+	__u8*      pLoanFrame;
+	VOID       (*FrameFree)(struct tag__ETHERNET_BUFFER* pEthBuff);
+	LPVOID     pFreeParam;               //Driver's private data used by FrameFree.
+	LPVOID     pPool;                    //Buffer pool it comes from,NULL if from heap.
+	DWORD      dwRxOffload;              //Checks done by NIC on received frame,ETH_RX_XXX.
+#define ETH_RX_CSUM_OK                     0x01  //IPv4 header and TCP/UDP checksum are valid.
+
+	//Must be the last member,since it's not allocated for loaned buffers.
+	__u8       Buffer[ETH_DEFAULT_MTU + ETH_HEADER_LEN];  //Actual ethernet frame data.
 }__ETHERNET_BUFFER;
 
+//Bytes of an Ethernet Buffer object that loans it's frame from driver.
+#define ETH_LOANED_BUFFER_SIZE ((size_t)&(((__ETHERNET_BUFFER*)0)->Buffer))
+
+//Start address of the frame data in an Ethernet Buffer.
+#define ETH_FRAME_DATA(pEthBuff) \
+	((pEthBuff)->pLoanFrame ? (pEthBuff)->pLoanFrame : (pEthBuff)->Buffer)
+
+//Routine to give a loaned frame back to NIC driver.
+typedef VOID (*__ETH_FRAME_FREE)(__ETHERNET_BUFFER* pEthBuff);
+
+//Pre-allocated Ethernet Buffers of each interface,sized when the interface
+//is added.A pool stops serving once it's free buffers drop below the low
+//watermark,and resumes after they rise above the high watermark again.
+#define ETH_BUFFER_POOL_SIZE    64   //Standard buffers of each interface.
+#define ETH_HEADER_POOL_SIZE    64   //Header only buffers,for loaned frames.
+#define ETH_POOL_LOW_WATER(n)   ((n) / 16)
+#define ETH_POOL_HIGH_WATER(n)  ((n) / 4)
+
+//Jumbo buffer pool is created when the interface is added,if the driver reports
+//a maximal frame length longer than default MTU,when IntControl is called with
+//ETH_MSG_MAXFRAME.ETH_JUMBO_FRAME_LEN is the usual length of jumbo frame.
+#define ETH_JUMBO_POOL_SIZE     16
+#define ETH_JUMBO_FRAME_LEN     (9000 + ETH_HEADER_LEN)
+
+typedef struct tag__ETH_BUFFER_POOL{
+	__ETHERNET_BUFFER*  pFreeList;       //Free buffers,linked by pNext.
+	LPVOID              pMemory;         //Memory of all buffers,NULL if pool is not created.
+	int                 nBuffSize;       //Bytes of one buffer.
+	int                 nBuffLength;     //Frame length one buffer can hold.
+	int                 nBuffNum;
+	int                 nFreeNum;
+	int                 nMinFree;        //The least free buffers ever.
+	int                 nLowWater;
+	int                 nHighWater;
+	BOOL                bThrottled;      //Stop serving until rise above high watermark.
+	DWORD               dwAllocNum;
+	DWORD               dwDropNum;       //Requests failed since pool is exhausted or throttled.
+	DWORD               dwThrottleNum;   //Times of throttling.
+}__ETH_BUFFER_POOL;
+
+//Maximal fragments one frame can be gathered from,when it's sent out by
+//the scatter-gather operation of interface.
+#define ETH_MAX_TX_FRAGS     16
+
+//One fragment of a frame to send,NIC gathers all fragments into one frame.
+typedef struct tag__ETH_TX_FRAG{
+	__u8*      pData;
+	int        length;
+}__ETH_TX_FRAG;
+
+//Offload capabilities of NIC,reported by driver when IntControl is called with
+//ETH_MSG_OFFLOAD in process of adding interface.Tx offloads are only applied to
+//frames sent by scatter-gather,so driver reports them only if SendFrags is set.
+#define ETH_OFFLOAD_TX_TCPCSUM  0x0001  //Compute TCP checksum of IPv4 frames.
+#define ETH_OFFLOAD_TX_UDPCSUM  0x0002  //Compute UDP checksum of IPv4 frames.
+#define ETH_OFFLOAD_RX_CSUM     0x0004  //Validate IPv4,TCP and UDP checksum of received frames.
+#define ETH_OFFLOAD_TSO         0x0008  //Segment large TCP frames,requires ETH_OFFLOAD_TX_TCPCSUM.
+#define ETH_OFFLOAD_ALL         0x000F
+
+//Maximal frame length NIC segments when TSO is used,including ethernet header.
+//Driver may lower it in nTsoMaxFrame of interface when ETH_MSG_OFFLOAD is handled.
+#define ETH_TSO_MAX_FRAME       0xFFFF
+
+//Offloads requested for one frame sent by scatter-gather.The checksum field of
+//TCP or UDP header holds the sum of pseudo header,which excludes the length for
+//TSO frames,NIC fills the final checksum.
+typedef struct tag__ETH_TX_OFFLOAD{
+	DWORD      dwFlags;                  //ETH_OFFLOAD_TX_XXX or ETH_OFFLOAD_TSO.
+	__u16      l3_offset;                //Offset of IP header in frame.
+	__u16      l4_offset;                //Offset of TCP/UDP header in frame.
+	__u16      mss;                      //Payload of each TCP segment,TSO only.
+}__ETH_TX_OFFLOAD;
+
+//Called by NIC driver once a scatter-gather frame is sent out,the fragments
+//can be released then.It maybe called in interrupt context.
+typedef VOID (*__ETH_TX_DONE)(LPVOID pTxParam);
+
+//Scatter-gather frame deferred since NIC's Tx ring is full,it's queued to NIC
+//in ethernet core thread once the driver reclaims Tx descriptors and calls
+//TxWakeup.At most ETH_TX_PENDING_MAX frames are deferred per interface.
+#define ETH_TX_PENDING_MAX   64
+
+typedef struct tag__ETH_TX_PENDING{
+	struct tag__ETH_TX_PENDING* pNext;
+	__ETH_TX_FRAG       Frags[ETH_MAX_TX_FRAGS];
+	int                 nFragNum;
+	__ETH_TX_OFFLOAD    Offload;
+	BOOL                bOffload;            //Offload is requested.
+	__ETH_TX_DONE       TxDone;
+	LPVOID              pTxParam;
+}__ETH_TX_PENDING;
+
 //Common network address,used to contain any type of network address.
 typedef struct tag__COMMON_NETWORK_ADDRESS{
 	UCHAR AddressType;
@@ -143,6 +260,11 @@ typedef struct tag__ETH_INTERFACE_STATE{
 	DWORD              dwFrameRecvSuccess;  //Delivery pkt to upper layer successful.
 	DWORD              dwTotalSendSize;     //How many bytes has been sent since boot.
 	DWORD              dwTotalRecvSize;     //Receive size.
+	DWORD              dwRxPollNum;         //Rounds of scheduled Rx polling.
+	DWORD              dwRxPollFull;        //Rounds exhausted the budget.
+	DWORD              dwTxDeferred;        //Frames deferred since Tx ring is full.
+	DWORD              dwTxDeferDrop;       //Frames dropped since too many deferred.
+	DWORD              dwTxLinearized;      //Frames copied since too many fragments.
 }__ETH_INTERFACE_STATE;
 
 //Maximal protocols one Ethernet Interface can bind to.
@@ -163,11 +285,37 @@ typedef struct tag__ETHERNET_INTERFACE{
 	__ETH_INTERFACE_STATE   ifState;                   //Interface state info.
 	struct __PROTO_INTERFACE_BIND Proto_Interface[MAX_BIND_PROTOCOL_NUM];
 	LPVOID                  pIntExtension;             //Private information.
+	DWORD                   dwOffload;                 //Offloads negotiated with NIC,ETH_OFFLOAD_XXX.
+	int                     nTsoMaxFrame;              //Maximal TSO frame length,including ethernet header.
+
+	//Ethernet Buffer pools of this interface.
+	__ETH_BUFFER_POOL       BuffPool;                  //Standard frames.
+	__ETH_BUFFER_POOL       JumboPool;                 //Optional,for jumbo frames.
+	__ETH_BUFFER_POOL       HdrPool;                   //Header only,for loaned frames.
 
 	//Operations open to HelloX's ethernet framework.
 	BOOL                    (*SendFrame)(struct tag__ETHERNET_INTERFACE*); //Sending operation.
 	__ETHERNET_BUFFER*      (*RecvFrame)(struct tag__ETHERNET_INTERFACE*); //Receive operation.
 	BOOL                    (*IntControl)(struct tag__ETHERNET_INTERFACE*, DWORD dwOperations, LPVOID);  //Other operations.
+
+	//Scatter-gather sending operation,optional.The fragments are queued into NIC's
+	//Tx ring directly in caller's context,and TxDone is called when sent out.
+	//pOffload is NULL if no offload is requested for the frame.
+	//Driver sets it after the interface is added.
+	BOOL                    (*SendFrags)(struct tag__ETHERNET_INTERFACE*, __ETH_TX_FRAG* pFrags,
+		int nFragNum, __ETH_TX_OFFLOAD* pOffload, __ETH_TX_DONE TxDone, LPVOID pTxParam);
+
+	//Enable or disable Rx interrupt of NIC,optional.Driver that sets it masks Rx
+	//interrupt and calls ScheduleRxPoll in it's interrupt handler,the ethernet
+	//core thread then polls the Rx ring and enables the interrupt once drained.
+	BOOL                    (*RxIntControl)(struct tag__ETHERNET_INTERFACE*, BOOL bEnable);
+	volatile BOOL           bRxPollScheduled;
+
+	//Scatter-gather frames deferred since Tx ring is full,in sending order.
+	__ETH_TX_PENDING*       pTxPendFirst;
+	__ETH_TX_PENDING*       pTxPendLast;
+	volatile int            nTxPendNum;
+	volatile BOOL           bTxWakeupScheduled;
 }__ETHERNET_INTERFACE;
 
 //Operation protypes for convinence.
@@ -175,6 +323,7 @@ typedef BOOL                (*__ETHOPS_SEND_FRAME)(__ETHERNET_INTERFACE*);
 typedef __ETHERNET_BUFFER*  (*__ETHOPS_RECV_FRAME)(__ETHERNET_INTERFACE*);
 typedef BOOL                (*__ETHOPS_INT_CONTROL)(__ETHERNET_INTERFACE*, DWORD, LPVOID);
 typedef BOOL                (*__ETHOPS_INITIALIZE)(__ETHERNET_INTERFACE*);
+typedef BOOL                (*__ETHOPS_SEND_FRAGS)(__ETHERNET_INTERFACE*, __ETH_TX_FRAG*, int, __ETH_TX_OFFLOAD*, __ETH_TX_DONE, LPVOID);
 
 //Default name of Ethernet core thread.
 #define ETH_THREAD_NAME  "netCore"
@@ -225,8 +374,36 @@ struct __ETHERNET_MANAGER{
 	BOOL                    (*ShutdownInterface)(char* ethName);
 	BOOL                    (*UnshutInterface)(char* ethName);
 	BOOL                    (*GetEthernetInterfaceState)(__ETH_INTERFACE_STATE* pState, int nIndex, int* pnNextInt);
-	__ETHERNET_BUFFER*      (*CreateEthernetBuffer)(int buffer_length);
+	//Ethernet Buffer is taken from pEthInt's buffer pool,or allocated from heap if
+	//pEthInt is NULL.Jumbo pool is used if buffer_length exceeds default MTU.
+	__ETHERNET_BUFFER*      (*CreateEthernetBuffer)(__ETHERNET_INTERFACE* pEthInt, int buffer_length);
 	VOID                    (*DestroyEthernetBuffer)(__ETHERNET_BUFFER* pEthBuff);
+
+	//Create an Ethernet Buffer whose frame resides in NIC driver's receiving
+	//buffer,FrameFree is called when the Ethernet Buffer is destroyed.
+	__ETHERNET_BUFFER*      (*CreateLoanedBuffer)(__ETHERNET_INTERFACE* pEthInt,
+		__u8* pFrame,
+		int frame_length,
+		__ETH_FRAME_FREE FrameFree,
+		LPVOID pFreeParam);
+
+	//Send a frame gathered from fragments,without copying it or switching to
+	//ethernet core thread.Only available when interface's SendFrags is set.
+	//The offloads requested must be negotiated with the interface.
+	BOOL                    (*SendFrags)(__ETHERNET_INTERFACE* pEthInt,
+		__ETH_TX_FRAG* pFrags,
+		int nFragNum,
+		__ETH_TX_OFFLOAD* pOffload,
+		__ETH_TX_DONE TxDone,
+		LPVOID pTxParam);
+
+	//Schedule a polling of interface's Rx ring,called in NIC's interrupt handler
+	//with Rx interrupt masked.
+	BOOL                    (*ScheduleRxPoll)(__ETHERNET_INTERFACE* pEthInt);
+
+	//Send the frames deferred by SendFrags,called by NIC driver after Tx
+	//descriptors are reclaimed,maybe in interrupt handler.
+	BOOL                    (*TxWakeup)(__ETHERNET_INTERFACE* pEthInt);
 };
 
 //Global ethernet manager objects.
@@ -46,6 +46,7 @@
 #include "lwip/api.h"
 #include "lwip/tcpip.h"
 #include "lwip/memp.h"
+#include "lwip/mem.h"
 
 #include "lwip/ip.h"
 #include "lwip/raw.h"
@@ -84,6 +85,11 @@ netconn_new_with_proto_and_callback(enum netconn_type t, u8_t proto, netconn_cal
 #endif /* LWIP_TCP */
       sys_sem_free(&conn->op_completed);
       sys_mbox_free(&conn->recvmbox);
+#if LWIP_NETCONN_UDP_RING
+      if (conn->recvring != NULL) {
+        mem_free(conn->recvring);
+      }
+#endif /* LWIP_NETCONN_UDP_RING */
       memp_free(MEMP_NETCONN, conn);
       return NULL;
     }
@@ -421,6 +427,120 @@ netconn_recv_data(struct netconn *conn, void **new_buf)
   return ERR_OK;
 }
 
+#if LWIP_NETCONN_UDP_RING
+/**
+ * Receive a datagram from the receive ring of a UDP netconn, without
+ * allocating a netbuf. The caller owns dgram->p afterwards and must free it.
+ *
+ * @param conn the UDP netconn from which to receive data
+ * @param dgram where the datagram and it's source are stored
+ * @param flags NETCONN_DGRAM_NOWAIT to return ERR_WOULDBLOCK instead of
+ *              blocking, NETCONN_DGRAM_PEEK to leave the datagram queued
+ * @return ERR_OK if a datagram has been received, an error code otherwise
+ */
+err_t
+netconn_recv_dgram(struct netconn *conn, struct netconn_dgram *dgram, u8_t flags)
+{
+  struct netconn_ring *ring;
+  void *doorbell;
+  u16_t len;
+  u8_t wakeup;
+  err_t err;
+#if LWIP_SO_RCVTIMEO
+  int timeout;
+  u32_t waited;
+  u8_t expired = 0;
+#endif /* LWIP_SO_RCVTIMEO */
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ERROR("netconn_recv_dgram: invalid pointer", (dgram != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_recv_dgram: invalid conn", (conn != NULL) &&
+             (conn->recvring != NULL), return ERR_ARG;);
+
+  err = conn->last_err;
+  if (ERR_IS_FATAL(err)) {
+    return err;
+  }
+  ring = conn->recvring;
+#if LWIP_SO_RCVTIMEO
+  timeout = conn->recv_timeout;
+#endif /* LWIP_SO_RCVTIMEO */
+
+  for (;;) {
+    SYS_ARCH_PROTECT(lev);
+    if (ring->head != ring->tail) {
+      *dgram = ring->dgrams[ring->head & (UDP_RECV_RING_SIZE - 1)];
+      if (flags & NETCONN_DGRAM_PEEK) {
+        /* keep it queued, the caller gets a reference */
+        pbuf_ref(dgram->p);
+      } else {
+        ring->head++;
+        len = dgram->p->tot_len;
+#if LWIP_SO_RCVBUF
+        conn->recv_avail -= len;
+#endif /* LWIP_SO_RCVBUF */
+      }
+      /* pass the doorbell on if another reader is blocked while datagrams
+         are still queued, recv_udp only rings it once per datagram */
+      wakeup = 0;
+      if ((ring->head != ring->tail) && (ring->waiters > 0)) {
+        ring->waiters--;
+        wakeup = 1;
+      }
+      SYS_ARCH_UNPROTECT(lev);
+      if (wakeup) {
+        netconn_ring_wakeup(conn);
+      }
+      if (!(flags & NETCONN_DGRAM_PEEK)) {
+        /* Register event with callback */
+        API_EVENT(conn, NETCONN_EVT_RCVMINUS, len);
+      }
+      return ERR_OK;
+    }
+    if (flags & NETCONN_DGRAM_NOWAIT) {
+      SYS_ARCH_UNPROTECT(lev);
+      return ERR_WOULDBLOCK;
+    }
+#if LWIP_SO_RCVTIMEO
+    if (expired) {
+      SYS_ARCH_UNPROTECT(lev);
+      NETCONN_SET_SAFE_ERR(conn, ERR_TIMEOUT);
+      return ERR_TIMEOUT;
+    }
+#endif /* LWIP_SO_RCVTIMEO */
+    /* ask recv_udp to ring the doorbell, checked again once woken up
+       since the doorbell may be a stale one */
+    ring->waiters++;
+    SYS_ARCH_UNPROTECT(lev);
+#if LWIP_SO_RCVTIMEO
+    waited = sys_arch_mbox_fetch(&conn->recvmbox, &doorbell, (u32_t)timeout);
+    if (waited == SYS_ARCH_TIMEOUT) {
+      SYS_ARCH_PROTECT(lev);
+      if (ring->waiters > 0) {
+        /* no doorbell is rung for this reader */
+        ring->waiters--;
+        SYS_ARCH_UNPROTECT(lev);
+        NETCONN_SET_SAFE_ERR(conn, ERR_TIMEOUT);
+        return ERR_TIMEOUT;
+      }
+      SYS_ARCH_UNPROTECT(lev);
+      /* a doorbell has been rung for this reader just after time out, take
+         it so it's not left to another reader, then check the ring once */
+      sys_arch_mbox_fetch(&conn->recvmbox, &doorbell, 0);
+      expired = 1;
+      continue;
+    }
+    if (timeout > 0) {
+      /* don't restart the timeout on a stale doorbell, 0 means forever */
+      timeout = (waited < (u32_t)timeout) ? (timeout - (int)waited) : 1;
+    }
+#else /* LWIP_SO_RCVTIMEO */
+    sys_arch_mbox_fetch(&conn->recvmbox, &doorbell, 0);
+#endif /* LWIP_SO_RCVTIMEO */
+  }
+}
+#endif /* LWIP_NETCONN_UDP_RING */
+
 /**
  * Receive data (in form of a pbuf) from a TCP netconn
  *
@@ -460,6 +580,39 @@ netconn_recv(struct netconn *conn, struct netbuf **new_buf)
   LWIP_ERROR("netconn_recv: invalid conn",    (conn != NULL),    return ERR_ARG;);
   LWIP_ERROR("netconn_accept: invalid recvmbox", sys_mbox_valid(&conn->recvmbox), return ERR_CONN;);
 
+#if LWIP_NETCONN_UDP_RING
+  if (conn->recvring != NULL) {
+    struct netconn_dgram dgram;
+    struct netbuf *nbuf;
+    err_t ring_err;
+
+    nbuf = (struct netbuf *)memp_malloc(MEMP_NETBUF);
+    if (nbuf == NULL) {
+      NETCONN_SET_SAFE_ERR(conn, ERR_MEM);
+      return ERR_MEM;
+    }
+    ring_err = netconn_recv_dgram(conn, &dgram, 0);
+    if (ring_err != ERR_OK) {
+      memp_free(MEMP_NETBUF, nbuf);
+      return ring_err;
+    }
+    nbuf->p = dgram.p;
+    nbuf->ptr = dgram.p;
+    ip_addr_set(&nbuf->addr, &dgram.addr);
+    nbuf->port = dgram.port;
+#if LWIP_CHECKSUM_ON_COPY
+    nbuf->flags = 0;
+#endif /* LWIP_CHECKSUM_ON_COPY */
+#if LWIP_NETBUF_RECVINFO
+    /* the ring does not keep the destination */
+    ip_addr_set_any(&nbuf->toaddr);
+    nbuf->toport_chksum = 0;
+#endif /* LWIP_NETBUF_RECVINFO */
+    *new_buf = nbuf;
+    return ERR_OK;
+  }
+#endif /* LWIP_NETCONN_UDP_RING */
+
 #if LWIP_TCP
   if (conn->type == NETCONN_TCP) {
     struct pbuf *p = NULL;
@@ -707,17 +860,36 @@ netconn_join_leave_group(struct netconn *conn,
  * @return ERR_OK: resolving succeeded
  *         ERR_MEM: memory error, try again later
  *         ERR_ARG: dns client not initialized or invalid hostname
- *         ERR_VAL: dns server response was invalid
+ *         ERR_VAL: dns server response was invalid, or the name does not exist
  */
 err_t
 netconn_gethostbyname(const char *name, ip_addr_t *addr)
+{
+  u8_t numaddrs = 1;
+
+  return netconn_gethostbyname_addrs(name, addr, &numaddrs);
+}
+
+/**
+ * Execute a DNS query, all addresses of the name are returned (up to
+ * DNS_MAX_ADDRS_PER_NAME)
+ *
+ * @param name a string representation of the DNS host name to query
+ * @param addrs a preallocated array where to store the resolved IP addresses
+ * @param numaddrs number of elements of addrs, set to the number of addresses
+ *        stored if resolving succeeded
+ * @return see netconn_gethostbyname
+ */
+err_t
+netconn_gethostbyname_addrs(const char *name, ip_addr_t *addrs, u8_t *numaddrs)
 {
   struct dns_api_msg msg;
   err_t err;
   sys_sem_t sem;
 
   LWIP_ERROR("netconn_gethostbyname: invalid name", (name != NULL), return ERR_ARG;);
-  LWIP_ERROR("netconn_gethostbyname: invalid addr", (addr != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_gethostbyname: invalid addr", (addrs != NULL) &&
+             (numaddrs != NULL) && (*numaddrs > 0), return ERR_ARG;);
 
   err = sys_sem_new(&sem, 0);
   if (err != ERR_OK) {
@@ -725,7 +897,8 @@ netconn_gethostbyname(const char *name, ip_addr_t *addr)
   }
 
   msg.name = name;
-  msg.addr = addr;
+  msg.addr = addrs;
+  msg.numaddrs = numaddrs;
   msg.err = &err;
   msg.sem = &sem;
 
@@ -48,6 +48,8 @@
 #include "lwip/raw.h"
 
 #include "lwip/memp.h"
+#include "lwip/mem.h"
+#include "lwip/stats.h"
 #include "lwip/tcpip.h"
 #include "lwip/igmp.h"
 #include "lwip/dns.h"
@@ -134,6 +136,68 @@ recv_raw(void *arg, struct raw_pcb *pcb, struct pbuf *p,
 #endif /* LWIP_RAW*/
 
 #if LWIP_UDP
+#if LWIP_NETCONN_UDP_RING
+/**
+ * Ring the doorbell of a UDP netconn for one reader, which has been taken off
+ * ring->waiters by the caller. If a doorbell is pending already, the reader is
+ * counted as waiting again and is woken up by the reader taking that doorbell.
+ */
+void
+netconn_ring_wakeup(struct netconn *conn)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (sys_mbox_trypost(&conn->recvmbox, conn->recvring) != ERR_OK) {
+    SYS_ARCH_PROTECT(lev);
+    conn->recvring->waiters++;
+    SYS_ARCH_UNPROTECT(lev);
+  }
+}
+
+/**
+ * Queue a received datagram to the receive ring of a UDP netconn, readers
+ * are only woken up through recvmbox if one of them is blocked.
+ */
+static void
+recv_udp_ring(struct netconn *conn, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+  struct netconn_ring *ring = conn->recvring;
+  struct netconn_dgram *dgram;
+  u16_t len = p->tot_len;
+  u8_t wakeup;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  if ((u16_t)(ring->tail - ring->head) >= UDP_RECV_RING_SIZE) {
+    ring->drops++;
+    SYS_ARCH_UNPROTECT(lev);
+    UDP_STATS_INC(udp.drop);
+    pbuf_free(p);
+    return;
+  }
+  dgram = &ring->dgrams[ring->tail & (UDP_RECV_RING_SIZE - 1)];
+  dgram->p = p;
+  ip_addr_set(&dgram->addr, addr);
+  dgram->port = port;
+  ring->tail++;
+#if LWIP_SO_RCVBUF
+  conn->recv_avail += len;
+#endif /* LWIP_SO_RCVBUF */
+  wakeup = 0;
+  if (ring->waiters > 0) {
+    ring->waiters--;
+    wakeup = 1;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (wakeup) {
+    netconn_ring_wakeup(conn);
+  }
+  /* Register event with callback */
+  API_EVENT(conn, NETCONN_EVT_RCVPLUS, len);
+}
+#endif /* LWIP_NETCONN_UDP_RING */
+
 /**
  * Receive callback function for UDP netconns.
  * Posts the packet to conn->recvmbox or deletes it on memory error.
@@ -168,6 +232,13 @@ recv_udp(void *arg, struct udp_pcb *pcb, struct pbuf *p,
     return;
   }
 
+#if LWIP_NETCONN_UDP_RING
+  if (conn->recvring != NULL) {
+    recv_udp_ring(conn, p, addr, port);
+    return;
+  }
+#endif /* LWIP_NETCONN_UDP_RING */
+
   buf = (struct netbuf *)memp_malloc(MEMP_NETBUF);
   if (buf == NULL) {
     pbuf_free(p);
@@ -292,7 +363,7 @@ poll_tcp(void *arg, struct tcp_pcb *pcb)
   if (conn->flags & NETCONN_FLAG_CHECK_WRITESPACE) {
     /* If the queued byte- or pbuf-count drops below the configured low-water limit,
        let select mark this pcb as writable again. */
-    if ((conn->pcb.tcp != NULL) && (tcp_sndbuf(conn->pcb.tcp) > TCP_SNDLOWAT) &&
+    if ((conn->pcb.tcp != NULL) && (tcp_sndbuf(conn->pcb.tcp) > tcp_sndlowat(conn->pcb.tcp)) &&
       (tcp_sndqueuelen(conn->pcb.tcp) < TCP_SNDQUEUELOWAT)) {
       conn->flags &= ~NETCONN_FLAG_CHECK_WRITESPACE;
       API_EVENT(conn, NETCONN_EVT_SENDPLUS, 0);
@@ -326,7 +397,7 @@ sent_tcp(void *arg, struct tcp_pcb *pcb, u16_t len)
   if (conn) {
     /* If the queued byte- or pbuf-count drops below the configured low-water limit,
        let select mark this pcb as writable again. */
-    if ((conn->pcb.tcp != NULL) && (tcp_sndbuf(conn->pcb.tcp) > TCP_SNDLOWAT) &&
+    if ((conn->pcb.tcp != NULL) && (tcp_sndbuf(conn->pcb.tcp) > tcp_sndlowat(conn->pcb.tcp)) &&
       (tcp_sndqueuelen(conn->pcb.tcp) < TCP_SNDQUEUELOWAT)) {
       conn->flags &= ~NETCONN_FLAG_CHECK_WRITESPACE;
       API_EVENT(conn, NETCONN_EVT_SENDPLUS, len);
@@ -587,7 +658,12 @@ netconn_alloc(enum netconn_type t, netconn_callback callback)
 #endif /* LWIP_RAW */
 #if LWIP_UDP
   case NETCONN_UDP:
+#if LWIP_NETCONN_UDP_RING
+    /* datagrams go to recvring, recvmbox is the doorbell only */
+    size = 1;
+#else /* LWIP_NETCONN_UDP_RING */
     size = DEFAULT_UDP_RECVMBOX_SIZE;
+#endif /* LWIP_NETCONN_UDP_RING */
     break;
 #endif /* LWIP_UDP */
 #if LWIP_TCP
@@ -610,6 +686,22 @@ netconn_alloc(enum netconn_type t, netconn_callback callback)
     memp_free(MEMP_NETCONN, conn);
     return NULL;
   }
+#if LWIP_NETCONN_UDP_RING
+  conn->recvring = NULL;
+  if (NETCONNTYPE_GROUP(t) == NETCONN_UDP) {
+    conn->recvring = (struct netconn_ring *)mem_malloc(sizeof(struct netconn_ring));
+    if (conn->recvring == NULL) {
+      sys_mbox_free(&conn->recvmbox);
+      sys_sem_free(&conn->op_completed);
+      memp_free(MEMP_NETCONN, conn);
+      return NULL;
+    }
+    conn->recvring->head = 0;
+    conn->recvring->tail = 0;
+    conn->recvring->waiters = 0;
+    conn->recvring->drops = 0;
+  }
+#endif /* LWIP_NETCONN_UDP_RING */
 
 #if LWIP_TCP
   sys_mbox_set_invalid(&conn->acceptmbox);
@@ -676,6 +768,23 @@ netconn_drain(struct netconn *conn)
 
   /* This runs in tcpip_thread, so we don't need to lock against rx packets */
 
+#if LWIP_NETCONN_UDP_RING
+  /* Free the datagrams left in the receive ring. */
+  if (conn->recvring != NULL) {
+    struct netconn_ring *ring = conn->recvring;
+    while (ring->head != ring->tail) {
+      pbuf_free(ring->dgrams[ring->head & (UDP_RECV_RING_SIZE - 1)].p);
+      ring->head++;
+    }
+    conn->recvring = NULL;
+    mem_free(ring);
+    /* recvmbox holds a doorbell at most */
+    if (sys_mbox_valid(&conn->recvmbox)) {
+      while (sys_mbox_tryfetch(&conn->recvmbox, &mem) != SYS_MBOX_EMPTY);
+    }
+  }
+#endif /* LWIP_NETCONN_UDP_RING */
+
   /* Delete and drain the recvmbox. */
   if (sys_mbox_valid(&conn->recvmbox)) {
     while (sys_mbox_tryfetch(&conn->recvmbox, &mem) != SYS_MBOX_EMPTY) {
@@ -1249,7 +1358,7 @@ do_writemore(struct netconn *conn)
   } else {
     /* if OK or memory error, check available space */
     if (((err == ERR_OK) || (err == ERR_MEM)) &&
-        ((tcp_sndbuf(conn->pcb.tcp) <= TCP_SNDLOWAT) ||
+        ((tcp_sndbuf(conn->pcb.tcp) <= tcp_sndlowat(conn->pcb.tcp)) ||
          (tcp_sndqueuelen(conn->pcb.tcp) >= TCP_SNDQUEUELOWAT))) {
       /* The queued byte- or pbuf-count exceeds the configured low-water limit,
          let select mark this pcb as non-writable. */
@@ -1487,6 +1596,22 @@ do_join_leave_group(struct api_msg_msg *msg)
 #endif /* LWIP_IGMP */
 
 #if LWIP_DNS
+/**
+ * Store the other cached addresses of a resolved name if the application
+ * asked for more than one.
+ */
+static void
+do_dns_getaddrs(struct dns_api_msg *msg)
+{
+  u8_t num = 0;
+
+  if (*msg->numaddrs > 1) {
+    num = dns_getaddrs(msg->name, msg->addr, *msg->numaddrs);
+  }
+  /* dotted or local names are not cached, msg->addr holds the address */
+  *msg->numaddrs = (num > 0) ? num : 1;
+}
+
 /**
  * Callback function that is called when DNS name is resolved
  * (or on timeout). A waiting application thread is waked up by
@@ -1507,6 +1632,7 @@ do_dns_found(const char *name, ip_addr_t *ipaddr, void *arg)
     /* address was resolved */
     *msg->err = ERR_OK;
     *msg->addr = *ipaddr;
+    do_dns_getaddrs(msg);
   }
   /* wake up the application task waiting in netconn_gethostbyname */
   sys_sem_signal(msg->sem);
@@ -1524,6 +1650,9 @@ do_gethostbyname(void *arg)
   struct dns_api_msg *msg = (struct dns_api_msg*)arg;
 
   *msg->err = dns_gethostbyname(msg->name, msg->addr, do_dns_found, msg);
+  if (*msg->err == ERR_OK) {
+    do_dns_getaddrs(msg);
+  }
   if (*msg->err != ERR_INPROGRESS) {
     /* on error or immediate success, wake up the application
      * task waiting in netconn_gethostbyname */
@@ -75,7 +75,8 @@ int h_errno;
 /**
  * Returns an entry containing addresses of address family AF_INET
  * for the host with name name.
- * Due to dns_gethostbyname limitations, only one address is returned.
+ * All addresses cached for the name are returned, up to
+ * DNS_MAX_ADDRS_PER_NAME.
  *
  * @param name the hostname to resolve
  * @return an entry containing addresses of address family AF_INET
@@ -85,16 +86,17 @@ struct hostent*
 lwip_gethostbyname(const char *name)
 {
   err_t err;
-  ip_addr_t addr;
+  u8_t numaddrs, i;
 
   /* buffer variables for lwip_gethostbyname() */
   HOSTENT_STORAGE struct hostent s_hostent;
   HOSTENT_STORAGE char *s_aliases;
-  HOSTENT_STORAGE ip_addr_t s_hostent_addr;
-  HOSTENT_STORAGE ip_addr_t *s_phostent_addr[2];
+  HOSTENT_STORAGE ip_addr_t s_hostent_addr[DNS_MAX_ADDRS_PER_NAME];
+  HOSTENT_STORAGE ip_addr_t *s_phostent_addr[DNS_MAX_ADDRS_PER_NAME + 1];
 
-  /* query host IP address */
-  err = netconn_gethostbyname(name, &addr);
+  /* query host IP addresses */
+  numaddrs = DNS_MAX_ADDRS_PER_NAME;
+  err = netconn_gethostbyname_addrs(name, s_hostent_addr, &numaddrs);
   if (err != ERR_OK) {
     LWIP_DEBUGF(DNS_DEBUG, ("lwip_gethostbyname(%s) failed, err=%d\n", name, err));
     h_errno = HOST_NOT_FOUND;
@@ -102,9 +104,10 @@ lwip_gethostbyname(const char *name)
   }
 
   /* fill hostent */
-  s_hostent_addr = addr;
-  s_phostent_addr[0] = &s_hostent_addr;
-  s_phostent_addr[1] = NULL;
+  for (i = 0; i < numaddrs; i++) {
+    s_phostent_addr[i] = &s_hostent_addr[i];
+  }
+  s_phostent_addr[numaddrs] = NULL;
   s_hostent.h_name = (char*)name;
   s_hostent.h_aliases = &s_aliases;
   s_hostent.h_addrtype = AF_INET;
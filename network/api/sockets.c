@@ -52,6 +52,8 @@
 #include "lwip/udp.h"
 #include "lwip/tcpip.h"
 #include "lwip/pbuf.h"
+#include "lwip/mem.h"
+#include "lwip/stats.h"
 #if LWIP_CHECKSUM_ON_COPY
 #include "lwip/inet_chksum.h"
 #endif
@@ -60,6 +62,13 @@
 
 #define NUM_SOCKETS MEMP_NUM_NETCONN
 
+/** UDP datagrams are sent with the core locked in the calling thread, through
+ * the netif cached in the socket */
+#define LWIP_SOCKET_UDP_FASTPATH (LWIP_SOCKET_MMSG && LWIP_TCPIP_CORE_LOCKING && LWIP_UDP)
+
+/** Datagrams lwip_sendmmsg builds before locking the core to send them */
+#define LWIP_SENDMMSG_BATCH 8
+
 /** Contains all internal pointers and states used for a socket */
 struct lwip_sock {
   /** sockets currently are built on netconns, each socket has one netconn */
@@ -80,6 +89,17 @@ struct lwip_sock {
   int err;
   /** counter of how many threads are waiting for this socket using select */
   int select_waiting;
+#if LWIP_SOCKET_EPOLL
+  /** epoll instances this socket is registered to */
+  struct lwip_epitem *epitems;
+#endif /* LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET_UDP_FASTPATH
+  /** last UDP destination and the netif it was routed to, valid as long as
+      tx_gen equals netif_route_gen */
+  ip_addr_t tx_dst;
+  struct netif *tx_netif;
+  u32_t tx_gen;
+#endif /* LWIP_SOCKET_UDP_FASTPATH */
 };
 
 /** Description for a task waiting in select */
@@ -130,6 +150,54 @@ static struct lwip_select_cb *select_cb_list;
     and checked in event_callback to see if it has changed. */
 static volatile int select_cb_ctr;
 
+#if LWIP_SOCKET_EPOLL
+/** Registration of a socket to an epoll instance */
+struct lwip_epitem {
+  /** next registration of the same socket */
+  struct lwip_epitem *next_sock;
+  /** neighbours in the list of registrations of the epoll instance */
+  struct lwip_epitem *prev_ep, *next_ep;
+  /** neighbours in the ready list of the epoll instance */
+  struct lwip_epitem *prev_ready, *next_ready;
+  /** the epoll instance */
+  struct lwip_epoll *ep;
+  /** the socket registered */
+  int s;
+  /** events of interest, EPOLLERR is always included until EPOLLONESHOT
+      disarms the registration */
+  u32_t events;
+  /** user data returned with the events */
+  epoll_data_t data;
+  /** 1 if on the ready list */
+  u8_t ready;
+};
+
+/** An epoll instance */
+struct lwip_epoll {
+  /** 1 if the instance is allocated */
+  u8_t used;
+  /** number of tasks waiting in lwip_epoll_wait */
+  int waiting;
+  /** don't signal the same semaphore twice: set to 1 when signalled */
+  int sem_signalled;
+  /** semaphore to wake up tasks waiting in lwip_epoll_wait */
+  sys_sem_t sem;
+  /** all registrations */
+  struct lwip_epitem *items;
+  /** registrations which may be ready, in the order they became ready */
+  struct lwip_epitem *ready_head, *ready_tail;
+};
+
+/** Events an epoll registration can report */
+#define EPOLL_EVENTS (EPOLLIN | EPOLLOUT | EPOLLERR)
+
+/** epoll descriptors follow the socket descriptors */
+#define EPOLL_FD_BASE NUM_SOCKETS
+
+/** The global array of epoll instances */
+static struct lwip_epoll epolls[LWIP_SOCKET_EPOLL_NUM];
+#endif /* LWIP_SOCKET_EPOLL */
+
 /** Table to quickly map an lwIP error (err_t) to a socket error
   * by using -err as an index */
 static const int err_to_errno_table[] = {
@@ -171,10 +239,32 @@ static const int err_to_errno_table[] = {
   set_errno(sk->err); \
 } while (0)
 
+#if LWIP_TCPIP_CORE_LOCKING
+/** get/setsockopt run in the calling thread with the core locked */
+#define SOCKOPT_CALL(fn, data) do { \
+  LOCK_TCPIP_CORE(); \
+  fn(data); \
+  UNLOCK_TCPIP_CORE(); \
+} while (0)
+#define SOCKOPT_ACK(sk)
+#else /* LWIP_TCPIP_CORE_LOCKING */
+/** get/setsockopt are passed to tcpip_thread, the caller waits for the ack */
+#define SOCKOPT_CALL(fn, data) do { \
+  tcpip_callback(fn, data); \
+  sys_arch_sem_wait(&(data)->sock->conn->op_completed, 0); \
+} while (0)
+#define SOCKOPT_ACK(sk) sys_sem_signal(&(sk)->conn->op_completed)
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+
 /* Forward delcaration of some functions */
 static void event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len);
 static void lwip_getsockopt_internal(void *arg);
 static void lwip_setsockopt_internal(void *arg);
+#if LWIP_SOCKET_EPOLL
+static struct lwip_epitem *lwip_epoll_detach_sock(struct lwip_sock *sock);
+static void lwip_epoll_free_items(struct lwip_epitem *items);
+static int lwip_epoll_close(int epfd);
+#endif /* LWIP_SOCKET_EPOLL */
 
 /**
  * Initialize this module. This function has to be called before any other
@@ -263,6 +353,12 @@ alloc_socket(struct netconn *newconn, int accepted)
       sockets[i].errevent   = 0;
       sockets[i].err        = 0;
       sockets[i].select_waiting = 0;
+#if LWIP_SOCKET_EPOLL
+      sockets[i].epitems    = NULL;
+#endif /* LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET_UDP_FASTPATH
+      sockets[i].tx_netif   = NULL;
+#endif /* LWIP_SOCKET_UDP_FASTPATH */
       return i;
     }
     SYS_ARCH_UNPROTECT(lev);
@@ -280,6 +376,9 @@ static void
 free_socket(struct lwip_sock *sock, int is_tcp)
 {
   void *lastdata;
+#if LWIP_SOCKET_EPOLL
+  struct lwip_epitem *epitems;
+#endif /* LWIP_SOCKET_EPOLL */
   SYS_ARCH_DECL_PROTECT(lev);
 
   lastdata         = sock->lastdata;
@@ -289,10 +388,19 @@ free_socket(struct lwip_sock *sock, int is_tcp)
 
   /* Protect socket array */
   SYS_ARCH_PROTECT(lev);
+#if LWIP_SOCKET_EPOLL
+  /* detached together with clearing conn, so lwip_epoll_ctl cannot register
+     the socket again in between */
+  epitems          = lwip_epoll_detach_sock(sock);
+#endif /* LWIP_SOCKET_EPOLL */
   sock->conn       = NULL;
   SYS_ARCH_UNPROTECT(lev);
   /* don't use 'sock' after this line, as another task might have allocated it */
 
+#if LWIP_SOCKET_EPOLL
+  lwip_epoll_free_items(epitems);
+#endif /* LWIP_SOCKET_EPOLL */
+
   if (lastdata != NULL) {
     if (is_tcp) {
       pbuf_free((struct pbuf *)lastdata);
@@ -445,6 +553,12 @@ lwip_close(int s)
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_close(%d)\n", s));
 
+#if LWIP_SOCKET_EPOLL
+  if (s >= EPOLL_FD_BASE) {
+    return lwip_epoll_close(s);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   sock = get_socket(s);
   if (!sock) {
     return -1;
@@ -545,6 +659,53 @@ lwip_listen(int s, int backlog)
   return 0;
 }
 
+#if LWIP_NETCONN_UDP_RING
+/**
+ * Receive a datagram from the receive ring of a UDP socket.
+ *
+ * @return ERR_OK if dgram has been filled in, otherwise errno has been set
+ */
+static err_t
+lwip_recv_dgram(struct lwip_sock *sock, struct netconn_dgram *dgram, int flags)
+{
+  u8_t dgram_flags = 0;
+  err_t err;
+
+  if ((flags & MSG_DONTWAIT) || netconn_is_nonblocking(sock->conn)) {
+    dgram_flags |= NETCONN_DGRAM_NOWAIT;
+  }
+  if (flags & MSG_PEEK) {
+    dgram_flags |= NETCONN_DGRAM_PEEK;
+  }
+  err = netconn_recv_dgram(sock->conn, dgram, dgram_flags);
+  if (err != ERR_OK) {
+    sock_set_errno(sock, err_to_errno(err));
+  }
+  return err;
+}
+
+/** Store the source of a received datagram to from */
+static void
+lwip_dgram_from(struct netconn_dgram *dgram, struct sockaddr *from, socklen_t *fromlen)
+{
+  struct sockaddr_in sin;
+
+  if ((from == NULL) || (fromlen == NULL)) {
+    return;
+  }
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_len = sizeof(sin);
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(dgram->port);
+  inet_addr_from_ipaddr(&sin.sin_addr, &dgram->addr);
+
+  if (*fromlen > sizeof(sin)) {
+    *fromlen = sizeof(sin);
+  }
+  MEMCPY(from, &sin, *fromlen);
+}
+#endif /* LWIP_NETCONN_UDP_RING */
+
 int
 lwip_recvfrom(int s, void *mem, size_t len, int flags,
         struct sockaddr *from, socklen_t *fromlen)
@@ -565,6 +726,23 @@ lwip_recvfrom(int s, void *mem, size_t len, int flags,
     return -1;
   }
 
+#if LWIP_NETCONN_UDP_RING
+  if (sock->conn->recvring != NULL) {
+    struct netconn_dgram dgram;
+
+    if (lwip_recv_dgram(sock, &dgram, flags) != ERR_OK) {
+      return -1;
+    }
+    p = dgram.p;
+    copylen = (len > p->tot_len) ? p->tot_len : (u16_t)len;
+    pbuf_copy_partial(p, mem, copylen, 0);
+    lwip_dgram_from(&dgram, from, fromlen);
+    pbuf_free(p);
+    sock_set_errno(sock, 0);
+    return copylen;
+  }
+#endif /* LWIP_NETCONN_UDP_RING */
+
   do {
     LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom: top while sock->lastdata=%p\n", sock->lastdata));
     /* Check if there is data left from the last recv operation. */
@@ -784,6 +962,55 @@ lwip_send(int s, const void *data, size_t size, int flags)
   return (err == ERR_OK ? (int)size : -1);
 }
 
+#if LWIP_SOCKET_UDP_FASTPATH
+/**
+ * Send a UDP datagram of a socket, called with the core locked. The netif
+ * the last destination was routed to is kept in the socket, so datagrams
+ * sent to the same destination skip ip_route, and the ARP entry is found
+ * through the address hint of the pcb.
+ */
+static err_t
+lwip_sock_udp_output(struct lwip_sock *sock, struct pbuf *p, ip_addr_t *dst_ip,
+                     u16_t dst_port, u8_t have_chksum, u16_t chksum)
+{
+  struct udp_pcb *pcb = sock->conn->pcb.udp;
+  struct netif *netif;
+
+#if LWIP_IGMP
+  if (ip_addr_ismulticast(dst_ip)) {
+    /* routed by the multicast interface of the pcb */
+#if LWIP_CHECKSUM_ON_COPY
+    return udp_sendto_chksum(pcb, p, dst_ip, dst_port, have_chksum, chksum);
+#else /* LWIP_CHECKSUM_ON_COPY */
+    return udp_sendto(pcb, p, dst_ip, dst_port);
+#endif /* LWIP_CHECKSUM_ON_COPY */
+  }
+#endif /* LWIP_IGMP */
+
+  if ((sock->tx_netif != NULL) && (sock->tx_gen == netif_route_gen) &&
+      ip_addr_cmp(&sock->tx_dst, dst_ip)) {
+    netif = sock->tx_netif;
+  } else {
+    netif = ip_route(dst_ip);
+    if (netif == NULL) {
+      sock->tx_netif = NULL;
+      UDP_STATS_INC(udp.rterr);
+      return ERR_RTE;
+    }
+    ip_addr_copy(sock->tx_dst, *dst_ip);
+    sock->tx_netif = netif;
+    sock->tx_gen = netif_route_gen;
+  }
+#if LWIP_CHECKSUM_ON_COPY
+  return udp_sendto_if_chksum(pcb, p, dst_ip, dst_port, netif, have_chksum, chksum);
+#else /* LWIP_CHECKSUM_ON_COPY */
+  LWIP_UNUSED_ARG(have_chksum);
+  LWIP_UNUSED_ARG(chksum);
+  return udp_sendto_if(pcb, p, dst_ip, dst_port, netif);
+#endif /* LWIP_CHECKSUM_ON_COPY */
+}
+#endif /* LWIP_SOCKET_UDP_FASTPATH */
+
 int
 lwip_sendto(int s, const void *data, size_t size, int flags,
        const struct sockaddr *to, socklen_t tolen)
@@ -859,7 +1086,15 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
       if (sock->conn->type == NETCONN_RAW) {
         err = sock->conn->last_err = raw_sendto(sock->conn->pcb.raw, p, remote_addr);
       } else {
-#if LWIP_UDP
+#if LWIP_SOCKET_UDP_FASTPATH
+#if LWIP_CHECKSUM_ON_COPY && LWIP_NETIF_TX_SINGLE_PBUF
+        err = sock->conn->last_err = lwip_sock_udp_output(sock, p,
+          remote_addr, remote_port, 1, chksum);
+#else /* LWIP_CHECKSUM_ON_COPY && LWIP_NETIF_TX_SINGLE_PBUF */
+        err = sock->conn->last_err = lwip_sock_udp_output(sock, p,
+          remote_addr, remote_port, 0, 0);
+#endif /* LWIP_CHECKSUM_ON_COPY && LWIP_NETIF_TX_SINGLE_PBUF */
+#elif LWIP_UDP
 #if LWIP_CHECKSUM_ON_COPY && LWIP_NETIF_TX_SINGLE_PBUF
         err = sock->conn->last_err = udp_sendto_chksum(sock->conn->pcb.udp, p,
           remote_addr, remote_port, 1, chksum);
@@ -931,6 +1166,277 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
   return (err == ERR_OK ? short_size : -1);
 }
 
+#if LWIP_SOCKET_MMSG
+#if LWIP_SOCKET_UDP_FASTPATH
+/** A datagram built by lwip_sendmmsg */
+struct lwip_mmsg_dgram {
+  struct pbuf *p;
+  ip_addr_t addr;
+  u16_t port;
+  u8_t have_chksum;
+  u16_t chksum;
+};
+
+/**
+ * Copy a message given to lwip_sendmmsg into a pbuf and find its destination.
+ */
+static err_t
+lwip_sendmmsg_build(struct lwip_sock *sock, struct msghdr *hdr, struct lwip_mmsg_dgram *dgram)
+{
+  const struct sockaddr_in *to_in;
+  size_t size = 0;
+  u16_t off = 0;
+  int j;
+
+  LWIP_ERROR("lwip_sendmmsg: invalid address", (((hdr->msg_name == NULL) && (hdr->msg_namelen == 0)) ||
+             ((hdr->msg_namelen == sizeof(struct sockaddr_in)) &&
+             ((((struct sockaddr *)hdr->msg_name)->sa_family) == AF_INET) &&
+             ((((mem_ptr_t)hdr->msg_name) % 4) == 0))),
+             return ERR_ARG;);
+  LWIP_ERROR("lwip_sendmmsg: invalid iov", (hdr->msg_iovlen >= 0) &&
+             ((hdr->msg_iov != NULL) || (hdr->msg_iovlen == 0)), return ERR_ARG;);
+
+  for (j = 0; j < hdr->msg_iovlen; j++) {
+    size += hdr->msg_iov[j].iov_len;
+  }
+  if (size > 0xffff) {
+    return ERR_VAL;
+  }
+
+  dgram->p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)size, PBUF_RAM);
+  if (dgram->p == NULL) {
+    return ERR_MEM;
+  }
+  dgram->have_chksum = 0;
+  dgram->chksum = 0;
+#if LWIP_CHECKSUM_ON_COPY
+  if (hdr->msg_iovlen == 1) {
+    dgram->chksum = LWIP_CHKSUM_COPY(dgram->p->payload, hdr->msg_iov[0].iov_base, (u16_t)size);
+    dgram->have_chksum = 1;
+  } else
+#endif /* LWIP_CHECKSUM_ON_COPY */
+  {
+    /* a PBUF_RAM pbuf is contiguous */
+    for (j = 0; j < hdr->msg_iovlen; j++) {
+      MEMCPY((u8_t *)dgram->p->payload + off, hdr->msg_iov[j].iov_base, hdr->msg_iov[j].iov_len);
+      off += (u16_t)hdr->msg_iov[j].iov_len;
+    }
+  }
+
+  to_in = (const struct sockaddr_in *)hdr->msg_name;
+  if (to_in != NULL) {
+    inet_addr_to_ipaddr(&dgram->addr, &to_in->sin_addr);
+    dgram->port = ntohs(to_in->sin_port);
+  } else {
+    ip_addr_copy(dgram->addr, sock->conn->pcb.udp->remote_ip);
+    dgram->port = sock->conn->pcb.udp->remote_port;
+  }
+  return ERR_OK;
+}
+
+/**
+ * Send messages of a UDP socket: datagrams are built without holding the
+ * core lock, then each batch of them is sent with the core locked once.
+ */
+static int
+lwip_sendmmsg_udp(struct lwip_sock *sock, struct mmsghdr *msgvec, unsigned int vlen)
+{
+  struct lwip_mmsg_dgram batch[LWIP_SENDMMSG_BATCH];
+  unsigned int sent = 0, num, done, i;
+  err_t err = ERR_OK;
+
+  while (sent < vlen) {
+    for (num = 0; (num < LWIP_SENDMMSG_BATCH) && (sent + num < vlen); num++) {
+      err = lwip_sendmmsg_build(sock, &msgvec[sent + num].msg_hdr, &batch[num]);
+      if (err != ERR_OK) {
+        break;
+      }
+    }
+
+    done = 0;
+    if (num > 0) {
+      LOCK_TCPIP_CORE();
+      for (i = 0; i < num; i++) {
+        err_t out = sock->conn->last_err = lwip_sock_udp_output(sock, batch[i].p,
+          &batch[i].addr, batch[i].port, batch[i].have_chksum, batch[i].chksum);
+        if (out != ERR_OK) {
+          err = out;
+          break;
+        }
+        msgvec[sent + i].msg_len = batch[i].p->tot_len;
+        done++;
+      }
+      UNLOCK_TCPIP_CORE();
+      for (i = 0; i < num; i++) {
+        pbuf_free(batch[i].p);
+      }
+    }
+    sent += done;
+    if (err != ERR_OK) {
+      break;
+    }
+  }
+
+  if ((sent == 0) && (err != ERR_OK)) {
+    sock_set_errno(sock, err_to_errno(err));
+    return -1;
+  }
+  sock_set_errno(sock, 0);
+  return (int)sent;
+}
+#endif /* LWIP_SOCKET_UDP_FASTPATH */
+
+/**
+ * Send several messages in one call.
+ *
+ * @return the number of messages sent, msg_len of each of them is set;
+ *         -1 if none could be sent
+ */
+int
+lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  struct msghdr *hdr;
+  unsigned int i;
+  size_t size;
+  u8_t *buf;
+  int j, len;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_sendmmsg(%d, %p, %u, 0x%x)\n", s, (void *)msgvec, vlen, flags));
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  LWIP_ERROR("lwip_sendmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+
+#if LWIP_SOCKET_UDP_FASTPATH
+  if (NETCONNTYPE_GROUP(sock->conn->type) == NETCONN_UDP) {
+    return lwip_sendmmsg_udp(sock, msgvec, vlen);
+  }
+#endif /* LWIP_SOCKET_UDP_FASTPATH */
+
+  for (i = 0; i < vlen; i++) {
+    hdr = &msgvec[i].msg_hdr;
+    if (hdr->msg_iovlen == 1) {
+      len = lwip_sendto(s, hdr->msg_iov[0].iov_base, hdr->msg_iov[0].iov_len, flags,
+        (const struct sockaddr *)hdr->msg_name, hdr->msg_namelen);
+    } else {
+      /* gather the message, lwip_sendto takes one buffer */
+      size = 0;
+      for (j = 0; j < hdr->msg_iovlen; j++) {
+        size += hdr->msg_iov[j].iov_len;
+      }
+      if (size > 0xffff) {
+        sock_set_errno(sock, EMSGSIZE);
+        break;
+      }
+      buf = (u8_t *)mem_malloc((mem_size_t)(size ? size : 1));
+      if (buf == NULL) {
+        sock_set_errno(sock, ENOMEM);
+        break;
+      }
+      for (j = 0, size = 0; j < hdr->msg_iovlen; j++) {
+        MEMCPY(buf + size, hdr->msg_iov[j].iov_base, hdr->msg_iov[j].iov_len);
+        size += hdr->msg_iov[j].iov_len;
+      }
+      len = lwip_sendto(s, buf, size, flags,
+        (const struct sockaddr *)hdr->msg_name, hdr->msg_namelen);
+      mem_free(buf);
+    }
+    if (len < 0) {
+      break;
+    }
+    msgvec[i].msg_len = (unsigned int)len;
+  }
+
+  if (i == 0) {
+    /* errno has been set by lwip_sendto */
+    return (vlen == 0) ? 0 : -1;
+  }
+  sock_set_errno(sock, 0);
+  return (int)i;
+}
+
+/**
+ * Receive several messages in one call. Only the first one is waited for
+ * (unless the socket is nonblocking or MSG_DONTWAIT is given), the others
+ * are the ones already queued.
+ *
+ * @return the number of messages received, msg_len and msg_flags of each of
+ *         them are set; -1 if none could be received
+ */
+int
+lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  struct msghdr *hdr;
+  unsigned int i;
+  int len;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg(%d, %p, %u, 0x%x)\n", s, (void *)msgvec, vlen, flags));
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  LWIP_ERROR("lwip_recvmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+
+  for (i = 0; i < vlen; i++) {
+    hdr = &msgvec[i].msg_hdr;
+    hdr->msg_flags = 0;
+#if LWIP_NETCONN_UDP_RING
+    if (sock->conn->recvring != NULL) {
+      struct netconn_dgram dgram;
+      u16_t off = 0, copylen;
+      int j;
+
+      if (lwip_recv_dgram(sock, &dgram, flags) != ERR_OK) {
+        break;
+      }
+      /* scatter the datagram into the iovs */
+      for (j = 0; (j < hdr->msg_iovlen) && (off < dgram.p->tot_len); j++) {
+        copylen = dgram.p->tot_len - off;
+        if (hdr->msg_iov[j].iov_len < copylen) {
+          copylen = (u16_t)hdr->msg_iov[j].iov_len;
+        }
+        pbuf_copy_partial(dgram.p, hdr->msg_iov[j].iov_base, copylen, off);
+        off += copylen;
+      }
+      if (off < dgram.p->tot_len) {
+        hdr->msg_flags |= MSG_TRUNC;
+      }
+      lwip_dgram_from(&dgram, (struct sockaddr *)hdr->msg_name, &hdr->msg_namelen);
+      pbuf_free(dgram.p);
+      msgvec[i].msg_len = off;
+    } else
+#endif /* LWIP_NETCONN_UDP_RING */
+    {
+      if (hdr->msg_iovlen != 1) {
+        /* only datagrams from the receive ring can be scattered */
+        sock_set_errno(sock, err_to_errno(ERR_ARG));
+        break;
+      }
+      len = lwip_recvfrom(s, hdr->msg_iov[0].iov_base, hdr->msg_iov[0].iov_len, flags,
+        (struct sockaddr *)hdr->msg_name, (hdr->msg_name != NULL) ? &hdr->msg_namelen : NULL);
+      if (len < 0) {
+        break;
+      }
+      msgvec[i].msg_len = (unsigned int)len;
+    }
+    /* don't wait for the messages following the first one */
+    flags |= MSG_DONTWAIT;
+  }
+
+  if (i == 0) {
+    /* errno has been set already */
+    return (vlen == 0) ? 0 : -1;
+  }
+  sock_set_errno(sock, 0);
+  return (int)i;
+}
+#endif /* LWIP_SOCKET_MMSG */
+
 int
 lwip_socket(int domain, int type, int protocol)
 {
@@ -1226,6 +1732,454 @@ return_copy_fdsets:
   return nready;
 }
 
+#if LWIP_SOCKET_EPOLL
+/**
+ * Map an epoll descriptor to its epoll instance.
+ *
+ * @param epfd descriptor returned by lwip_epoll_create
+ * @return the epoll instance or NULL (errno set) if not found
+ */
+static struct lwip_epoll *
+get_epoll(int epfd)
+{
+  int i = epfd - EPOLL_FD_BASE;
+
+  if ((i < 0) || (i >= LWIP_SOCKET_EPOLL_NUM) || (epolls[i].used != 1)) {
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("get_epoll(%d): invalid\n", epfd));
+    set_errno(EBADF);
+    return NULL;
+  }
+  return &epolls[i];
+}
+
+/**
+ * Events currently pending on a socket, tested the same way as lwip_selscan.
+ * Call with SYS_ARCH protected.
+ */
+static u32_t
+lwip_epoll_poll(struct lwip_sock *sock)
+{
+  u32_t revents = 0;
+
+  if ((sock->lastdata != NULL) || (sock->rcvevent > 0)) {
+    revents |= EPOLLIN;
+  }
+  if (sock->sendevent != 0) {
+    revents |= EPOLLOUT;
+  }
+  if (sock->errevent != 0) {
+    revents |= EPOLLERR;
+  }
+  return revents;
+}
+
+/**
+ * Append a registration to the ready list of its epoll instance (if not yet
+ * on it) and optionally wake up a task waiting in lwip_epoll_wait.
+ * Call with SYS_ARCH protected.
+ */
+static void
+lwip_epoll_ready_add(struct lwip_epitem *epi, int wakeup)
+{
+  struct lwip_epoll *ep = epi->ep;
+
+  if (!epi->ready) {
+    epi->ready = 1;
+    epi->next_ready = NULL;
+    epi->prev_ready = ep->ready_tail;
+    if (ep->ready_tail != NULL) {
+      ep->ready_tail->next_ready = epi;
+    } else {
+      ep->ready_head = epi;
+    }
+    ep->ready_tail = epi;
+  }
+  if (wakeup && (ep->waiting != 0) && (ep->sem_signalled == 0)) {
+    ep->sem_signalled = 1;
+    sys_sem_signal(&ep->sem);
+  }
+}
+
+/**
+ * Remove a registration from the ready list of its epoll instance.
+ * Call with SYS_ARCH protected.
+ */
+static void
+lwip_epoll_ready_del(struct lwip_epitem *epi)
+{
+  struct lwip_epoll *ep = epi->ep;
+
+  if (!epi->ready) {
+    return;
+  }
+  if (epi->prev_ready != NULL) {
+    epi->prev_ready->next_ready = epi->next_ready;
+  } else {
+    ep->ready_head = epi->next_ready;
+  }
+  if (epi->next_ready != NULL) {
+    epi->next_ready->prev_ready = epi->prev_ready;
+  } else {
+    ep->ready_tail = epi->prev_ready;
+  }
+  epi->ready = 0;
+}
+
+/**
+ * Remove a registration from the lists of its epoll instance.
+ * Call with SYS_ARCH protected.
+ */
+static void
+lwip_epoll_ep_unlink(struct lwip_epitem *epi)
+{
+  lwip_epoll_ready_del(epi);
+  if (epi->prev_ep != NULL) {
+    epi->prev_ep->next_ep = epi->next_ep;
+  } else {
+    epi->ep->items = epi->next_ep;
+  }
+  if (epi->next_ep != NULL) {
+    epi->next_ep->prev_ep = epi->prev_ep;
+  }
+}
+
+/**
+ * Find the registration of a socket to an epoll instance.
+ * Call with SYS_ARCH protected.
+ */
+static struct lwip_epitem *
+lwip_epoll_find(struct lwip_sock *sock, struct lwip_epoll *ep)
+{
+  struct lwip_epitem *epi;
+
+  for (epi = sock->epitems; epi != NULL; epi = epi->next_sock) {
+    if (epi->ep == ep) {
+      break;
+    }
+  }
+  return epi;
+}
+
+/**
+ * Detach all registrations of a socket which is being freed.
+ * Call with SYS_ARCH protected, free the result with lwip_epoll_free_items.
+ *
+ * @return list of the registrations, linked by next_sock
+ */
+static struct lwip_epitem *
+lwip_epoll_detach_sock(struct lwip_sock *sock)
+{
+  struct lwip_epitem *items, *epi;
+
+  items = sock->epitems;
+  sock->epitems = NULL;
+  for (epi = items; epi != NULL; epi = epi->next_sock) {
+    lwip_epoll_ep_unlink(epi);
+  }
+  return items;
+}
+
+/** Free a list of registrations returned by lwip_epoll_detach_sock */
+static void
+lwip_epoll_free_items(struct lwip_epitem *items)
+{
+  struct lwip_epitem *next;
+
+  while (items != NULL) {
+    next = items->next_sock;
+    mem_free(items);
+    items = next;
+  }
+}
+
+/**
+ * Move the ready registrations of an epoll instance into events.
+ * Readiness is checked again since the registration was queued: registrations
+ * no longer ready are dropped, level triggered ones that are reported are
+ * queued again at the tail (so they are checked on the next call and busy
+ * sockets don't starve the others), edge triggered ones wait for the next
+ * event and EPOLLONESHOT ones are disarmed until EPOLL_CTL_MOD.
+ * Call with SYS_ARCH protected.
+ *
+ * @return number of events stored
+ */
+static int
+lwip_epoll_collect(struct lwip_epoll *ep, struct epoll_event *events, int maxevents)
+{
+  struct lwip_epitem *epi, *last;
+  struct lwip_sock *sock;
+  u32_t revents;
+  int nready = 0;
+
+  /* stop after the registrations queued before this call */
+  last = ep->ready_tail;
+  while ((nready < maxevents) && ((epi = ep->ready_head) != NULL)) {
+    lwip_epoll_ready_del(epi);
+    sock = tryget_socket(epi->s);
+    revents = (sock != NULL) ? (lwip_epoll_poll(sock) & epi->events & EPOLL_EVENTS) : 0;
+    if (revents != 0) {
+      events[nready].events = revents;
+      events[nready].data = epi->data;
+      nready++;
+      if (epi->events & EPOLLONESHOT) {
+        epi->events &= ~EPOLL_EVENTS;
+      } else if (!(epi->events & EPOLLET)) {
+        lwip_epoll_ready_add(epi, 0);
+      }
+    }
+    if (epi == last) {
+      break;
+    }
+  }
+  return nready;
+}
+
+int
+lwip_epoll_create(int size)
+{
+  struct lwip_epoll *ep;
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  /* size is only a hint, registrations are allocated from the heap */
+  LWIP_UNUSED_ARG(size);
+
+  for (i = 0; i < LWIP_SOCKET_EPOLL_NUM; ++i) {
+    SYS_ARCH_PROTECT(lev);
+    if (epolls[i].used == 0) {
+      ep = &epolls[i];
+      ep->used = 1;
+      SYS_ARCH_UNPROTECT(lev);
+      ep->waiting = 0;
+      ep->sem_signalled = 0;
+      ep->items = NULL;
+      ep->ready_head = NULL;
+      ep->ready_tail = NULL;
+      if (sys_sem_new(&ep->sem, 0) != ERR_OK) {
+        ep->used = 0;
+        set_errno(ENOMEM);
+        return -1;
+      }
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create() = %d\n", EPOLL_FD_BASE + i));
+      set_errno(0);
+      return EPOLL_FD_BASE + i;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  set_errno(EMFILE);
+  return -1;
+}
+
+int
+lwip_epoll_ctl(int epfd, int op, int s, struct epoll_event *event)
+{
+  struct lwip_epoll *ep;
+  struct lwip_sock *sock;
+  struct lwip_epitem *epi, **pepi;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_ctl(%d, %d, %d)\n", epfd, op, s));
+
+  ep = get_epoll(epfd);
+  if (!ep) {
+    return -1;
+  }
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  if ((op != EPOLL_CTL_DEL) && (event == NULL)) {
+    set_errno(EINVAL);
+    return -1;
+  }
+
+  switch (op) {
+  case EPOLL_CTL_ADD:
+    epi = (struct lwip_epitem *)mem_malloc(sizeof(struct lwip_epitem));
+    if (epi == NULL) {
+      set_errno(ENOMEM);
+      return -1;
+    }
+    memset(epi, 0, sizeof(struct lwip_epitem));
+    epi->ep = ep;
+    epi->s = s;
+    epi->events = event->events | EPOLLERR;
+    epi->data = event->data;
+
+    SYS_ARCH_PROTECT(lev);
+    /* socket or epoll instance may have been closed meanwhile */
+    if ((sock->conn == NULL) || (ep->used != 1)) {
+      SYS_ARCH_UNPROTECT(lev);
+      mem_free(epi);
+      set_errno(EBADF);
+      return -1;
+    }
+    if (lwip_epoll_find(sock, ep) != NULL) {
+      SYS_ARCH_UNPROTECT(lev);
+      mem_free(epi);
+      set_errno(EEXIST);
+      return -1;
+    }
+    epi->next_sock = sock->epitems;
+    sock->epitems = epi;
+    epi->next_ep = ep->items;
+    if (ep->items != NULL) {
+      ep->items->prev_ep = epi;
+    }
+    ep->items = epi;
+    /* report what is already pending */
+    if (lwip_epoll_poll(sock) & epi->events & EPOLL_EVENTS) {
+      lwip_epoll_ready_add(epi, 1);
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    break;
+
+  case EPOLL_CTL_MOD:
+    SYS_ARCH_PROTECT(lev);
+    epi = lwip_epoll_find(sock, ep);
+    if (epi == NULL) {
+      SYS_ARCH_UNPROTECT(lev);
+      set_errno(ENOENT);
+      return -1;
+    }
+    epi->events = event->events | EPOLLERR;
+    epi->data = event->data;
+    if (lwip_epoll_poll(sock) & epi->events & EPOLL_EVENTS) {
+      lwip_epoll_ready_add(epi, 1);
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    break;
+
+  case EPOLL_CTL_DEL:
+    SYS_ARCH_PROTECT(lev);
+    for (pepi = &sock->epitems; *pepi != NULL; pepi = &(*pepi)->next_sock) {
+      if ((*pepi)->ep == ep) {
+        break;
+      }
+    }
+    epi = *pepi;
+    if (epi == NULL) {
+      SYS_ARCH_UNPROTECT(lev);
+      set_errno(ENOENT);
+      return -1;
+    }
+    *pepi = epi->next_sock;
+    lwip_epoll_ep_unlink(epi);
+    SYS_ARCH_UNPROTECT(lev);
+    mem_free(epi);
+    break;
+
+  default:
+    set_errno(EINVAL);
+    return -1;
+  }
+
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * Wait for events on the sockets registered to an epoll instance.
+ *
+ * @param timeout in milliseconds, 0 polls and a negative value waits forever
+ * @return number of events stored in events, 0 on timeout, -1 on error
+ */
+int
+lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+  struct lwip_epoll *ep;
+  u32_t waitres;
+  int nready;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait(%d, %d, %d)\n", epfd, maxevents, timeout));
+
+  ep = get_epoll(epfd);
+  if (!ep) {
+    return -1;
+  }
+  if ((events == NULL) || (maxevents <= 0)) {
+    set_errno(EINVAL);
+    return -1;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  nready = lwip_epoll_collect(ep, events, maxevents);
+  while ((nready == 0) && (timeout != 0)) {
+    /* Nothing ready: sleep until event_callback queues a registration.
+       waiting is increased while still protected, so an event coming in
+       after the check above signals the semaphore. */
+    ep->waiting++;
+    SYS_ARCH_UNPROTECT(lev);
+
+    waitres = sys_arch_sem_wait(&ep->sem, (timeout > 0) ? (u32_t)timeout : 0);
+
+    SYS_ARCH_PROTECT(lev);
+    ep->waiting--;
+    ep->sem_signalled = 0;
+    nready = lwip_epoll_collect(ep, events, maxevents);
+    if ((timeout > 0) || (waitres == SYS_ARCH_TIMEOUT)) {
+      /* a finite timeout is not restarted after a spurious wakeup */
+      break;
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait: nready=%d\n", nready));
+  set_errno(0);
+  return nready;
+}
+
+/**
+ * Close an epoll instance, called by lwip_close for epoll descriptors.
+ * Fails with EBUSY while a task is waiting on it.
+ */
+static int
+lwip_epoll_close(int epfd)
+{
+  struct lwip_epoll *ep;
+  struct lwip_epitem *items, *epi, **pepi;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  ep = get_epoll(epfd);
+  if (!ep) {
+    return -1;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (ep->waiting != 0) {
+    SYS_ARCH_UNPROTECT(lev);
+    set_errno(EBUSY);
+    return -1;
+  }
+  /* 2 while being closed: get_epoll fails but it can't be reused yet */
+  ep->used = 2;
+  items = ep->items;
+  ep->items = NULL;
+  ep->ready_head = NULL;
+  ep->ready_tail = NULL;
+  for (epi = items; epi != NULL; epi = epi->next_ep) {
+    for (pepi = &sockets[epi->s].epitems; *pepi != NULL; pepi = &(*pepi)->next_sock) {
+      if (*pepi == epi) {
+        *pepi = epi->next_sock;
+        break;
+      }
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  while (items != NULL) {
+    epi = items->next_ep;
+    mem_free(items);
+    items = epi;
+  }
+  sys_sem_free(&ep->sem);
+  ep->used = 0;
+  set_errno(0);
+  return 0;
+}
+#endif /* LWIP_SOCKET_EPOLL */
+
 /**
  * Callback registered in the netconn layer for each socket-netconn.
  * Processes recvevent (data available) and wakes up tasks waiting for select.
@@ -1293,6 +2247,22 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
       break;
   }
 
+#if LWIP_SOCKET_EPOLL
+  /* Queue the registrations this event makes ready. Only events which make
+     the socket (more) ready are considered, so edge triggered registrations
+     are not reported again just because the application read some data. */
+  if ((sock->epitems != NULL) && ((evt == NETCONN_EVT_RCVPLUS) ||
+      (evt == NETCONN_EVT_SENDPLUS) || (evt == NETCONN_EVT_ERROR))) {
+    u32_t revents = lwip_epoll_poll(sock);
+    struct lwip_epitem *epi;
+    for (epi = sock->epitems; epi != NULL; epi = epi->next_sock) {
+      if (revents & epi->events & EPOLL_EVENTS) {
+        lwip_epoll_ready_add(epi, 1);
+      }
+    }
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   if (sock->select_waiting == 0) {
     /* noone is waiting for this socket, no need to check select_cb_list */
     SYS_ARCH_UNPROTECT(lev);
@@ -1476,7 +2446,6 @@ lwip_getsockopt(int s, int level, int optname, void *optval, socklen_t *optlen)
     case SO_RCVBUF:
 #endif /* LWIP_SO_RCVBUF */
     /* UNIMPL case SO_OOBINLINE: */
-    /* UNIMPL case SO_SNDBUF: */
     /* UNIMPL case SO_RCVLOWAT: */
     /* UNIMPL case SO_SNDLOWAT: */
 #if SO_REUSE
@@ -1488,8 +2457,30 @@ lwip_getsockopt(int s, int level, int optname, void *optval, socklen_t *optlen)
       if (*optlen < sizeof(int)) {
         err = EINVAL;
       }
+#if LWIP_SO_RCVBUF && LWIP_TCP
+      if ((optname == SO_RCVBUF) && (sock->conn->type == NETCONN_TCP) &&
+          (sock->conn->pcb.tcp == NULL)) {
+        err = EINVAL;
+      }
+#endif /* LWIP_SO_RCVBUF && LWIP_TCP */
       break;
 
+#if LWIP_TCP
+#if !LWIP_SO_RCVBUF
+    case SO_RCVBUF:
+#endif /* !LWIP_SO_RCVBUF */
+    case SO_SNDBUF:
+      /* buffer sizes of TCP sockets are kept by the pcb */
+      if (*optlen < sizeof(int)) {
+        err = EINVAL;
+      } else if (sock->conn->type != NETCONN_TCP) {
+        err = ENOPROTOOPT;
+      } else if (sock->conn->pcb.tcp == NULL) {
+        err = EINVAL;
+      }
+      break;
+#endif /* LWIP_TCP */
+
     case SO_NO_CHECK:
       if (*optlen < sizeof(int)) {
         err = EINVAL;
@@ -1627,8 +2618,7 @@ lwip_getsockopt(int s, int level, int optname, void *optval, socklen_t *optlen)
   data.optval = optval;
   data.optlen = optlen;
   data.err = err;
-  tcpip_callback(lwip_getsockopt_internal, &data);
-  sys_arch_sem_wait(&sock->conn->op_completed, 0);
+  SOCKOPT_CALL(lwip_getsockopt_internal, &data);
   /* maybe lwip_getsockopt_internal has changed err */
   err = data.err;
 
@@ -1718,11 +2708,24 @@ lwip_getsockopt_internal(void *arg)
       *(int *)optval = netconn_get_recvtimeout(sock->conn);
       break;
 #endif /* LWIP_SO_RCVTIMEO */
-#if LWIP_SO_RCVBUF
+#if LWIP_SO_RCVBUF || LWIP_TCP
     case SO_RCVBUF:
+#if LWIP_TCP
+      if (sock->conn->type == NETCONN_TCP) {
+        *(int *)optval = (int)sock->conn->pcb.tcp->rcv_wnd_max;
+        break;
+      }
+#endif /* LWIP_TCP */
+#if LWIP_SO_RCVBUF
       *(int *)optval = netconn_get_recvbufsize(sock->conn);
-      break;
 #endif /* LWIP_SO_RCVBUF */
+      break;
+#endif /* LWIP_SO_RCVBUF || LWIP_TCP */
+#if LWIP_TCP
+    case SO_SNDBUF:
+      *(int *)optval = (int)sock->conn->pcb.tcp->snd_buf_max;
+      break;
+#endif /* LWIP_TCP */
 #if LWIP_UDP
     case SO_NO_CHECK:
       *(int*)optval = (udp_flags(sock->conn->pcb.udp) & UDP_FLAGS_NOCHKSUM) ? 1 : 0;
@@ -1836,7 +2839,7 @@ lwip_getsockopt_internal(void *arg)
     LWIP_ASSERT("unhandled level", 0);
     break;
   } /* switch (level) */
-  sys_sem_signal(&sock->conn->op_completed);
+  SOCKOPT_ACK(sock);
 }
 
 int
@@ -1875,7 +2878,6 @@ lwip_setsockopt(int s, int level, int optname, const void *optval, socklen_t opt
     case SO_RCVBUF:
 #endif /* LWIP_SO_RCVBUF */
     /* UNIMPL case SO_OOBINLINE: */
-    /* UNIMPL case SO_SNDBUF: */
     /* UNIMPL case SO_RCVLOWAT: */
     /* UNIMPL case SO_SNDLOWAT: */
 #if SO_REUSE
@@ -1886,7 +2888,30 @@ lwip_setsockopt(int s, int level, int optname, const void *optval, socklen_t opt
       if (optlen < sizeof(int)) {
         err = EINVAL;
       }
+#if LWIP_SO_RCVBUF && LWIP_TCP
+      if ((optname == SO_RCVBUF) && (sock->conn->type == NETCONN_TCP) &&
+          (sock->conn->pcb.tcp == NULL)) {
+        err = EINVAL;
+      }
+#endif /* LWIP_SO_RCVBUF && LWIP_TCP */
+      break;
+#if LWIP_TCP
+#if !LWIP_SO_RCVBUF
+    case SO_RCVBUF:
+#endif /* !LWIP_SO_RCVBUF */
+    case SO_SNDBUF:
+      /* buffer sizes of TCP sockets are kept by the pcb */
+      if (optlen < sizeof(int)) {
+        err = EINVAL;
+      } else if (sock->conn->type != NETCONN_TCP) {
+        err = ENOPROTOOPT;
+      } else if (sock->conn->pcb.tcp == NULL) {
+        err = EINVAL;
+      } else if (*(int*)optval <= 0) {
+        err = EINVAL;
+      }
       break;
+#endif /* LWIP_TCP */
     case SO_NO_CHECK:
       if (optlen < sizeof(int)) {
         err = EINVAL;
@@ -2037,8 +3062,7 @@ lwip_setsockopt(int s, int level, int optname, const void *optval, socklen_t opt
   data.optval = (void*)optval;
   data.optlen = &optlen;
   data.err = err;
-  tcpip_callback(lwip_setsockopt_internal, &data);
-  sys_arch_sem_wait(&sock->conn->op_completed, 0);
+  SOCKOPT_CALL(lwip_setsockopt_internal, &data);
   /* maybe lwip_setsockopt_internal has changed err */
   err = data.err;
 
@@ -2098,11 +3122,27 @@ lwip_setsockopt_internal(void *arg)
       netconn_set_recvtimeout(sock->conn, *(int*)optval);
       break;
 #endif /* LWIP_SO_RCVTIMEO */
-#if LWIP_SO_RCVBUF
+#if LWIP_SO_RCVBUF || LWIP_TCP
     case SO_RCVBUF:
+#if LWIP_TCP
+      if (sock->conn->type == NETCONN_TCP) {
+        /* the window scaling in use limits the largest size */
+        tcp_setrcvbuf(sock->conn->pcb.tcp, (u32_t)LWIP_MAX(*(int*)optval, 2 * TCP_MSS));
+        break;
+      }
+#endif /* LWIP_TCP */
+#if LWIP_SO_RCVBUF
       netconn_set_recvbufsize(sock->conn, *(int*)optval);
-      break;
 #endif /* LWIP_SO_RCVBUF */
+      break;
+#endif /* LWIP_SO_RCVBUF || LWIP_TCP */
+#if LWIP_TCP
+    case SO_SNDBUF:
+      /* the queue length limit keeps larger buffers from being used */
+      tcp_setsndbuf(sock->conn->pcb.tcp,
+        (u32_t)LWIP_MIN(LWIP_MAX(*(int*)optval, 2 * TCP_MSS), TCP_SND_BUF));
+      break;
+#endif /* LWIP_TCP */
 #if LWIP_UDP
     case SO_NO_CHECK:
       if (*(int*)optval) {
@@ -2247,7 +3287,7 @@ lwip_setsockopt_internal(void *arg)
     LWIP_ASSERT("unhandled level", 0);
     break;
   }  /* switch (level) */
-  sys_sem_signal(&sock->conn->op_completed);
+  SOCKOPT_ACK(sock);
 }
 
 int
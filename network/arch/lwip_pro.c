@@ -33,6 +33,7 @@
 #include "lwip/snmp.h"
 #include "lwip/tcpip.h"
 #include "lwip/dhcp.h"
+#include "lwip/inet_chksum.h"
 #include "netif/etharp.h"
 
 #include "lwip_pro.h"
@@ -58,10 +59,137 @@ static VOID pbuf_to_ethbuf(struct pbuf* p, __ETHERNET_BUFFER* pEthBuff)
 	return;
 }
 
+//Called by NIC driver when a pbuf chain sent by scatter-gather is out.
+static VOID eth_tx_done(LPVOID pTxParam)
+{
+	pbuf_free((struct pbuf*)pTxParam);
+}
+
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+//Locate the headers of a frame whose checksum is left to NIC,and fill the
+//offload request for NIC.The length of TCP or UDP part is returned by pL4Len.
+//FALSE is returned if it's not an IPv4 TCP or UDP frame.
+static BOOL eth_tx_offload(struct pbuf* p, __ETH_TX_OFFLOAD* pOffload, __u16* pL4Len)
+{
+	__u8 hdr[SIZEOF_ETH_HDR + 4 + IP_HLEN];
+	__u16 l3 = SIZEOF_ETH_HDR;
+	__u16 ip_hlen = 0;
+
+	if (pbuf_copy_partial(p, hdr, sizeof(hdr), 0) != sizeof(hdr))
+	{
+		return FALSE;
+	}
+	//Skip VLAN tag.
+	if ((hdr[l3 - 2] == 0x81) && (hdr[l3 - 1] == 0x00))
+	{
+		l3 += 4;
+	}
+	if ((hdr[l3 - 2] != 0x08) || (hdr[l3 - 1] != 0x00) || ((hdr[l3] >> 4) != 4))
+	{
+		return FALSE;
+	}
+	ip_hlen = (hdr[l3] & 0x0F) * 4;
+	switch (hdr[l3 + 9])
+	{
+	case IP_PROTO_TCP:
+		pOffload->dwFlags = ETH_OFFLOAD_TX_TCPCSUM;
+		break;
+	case IP_PROTO_UDP:
+		pOffload->dwFlags = ETH_OFFLOAD_TX_UDPCSUM;
+		break;
+	default:
+		return FALSE;
+	}
+	pOffload->mss = 0;
+#if LWIP_TCP_TSO
+	if (p->flags & PBUF_FLAG_TSO)
+	{
+		pOffload->dwFlags |= ETH_OFFLOAD_TSO;
+		pOffload->mss = p->tso_mss;
+	}
+#endif
+	pOffload->l3_offset = l3;
+	pOffload->l4_offset = l3 + ip_hlen;
+	*pL4Len = ((hdr[l3 + 2] << 8) + hdr[l3 + 3]) - ip_hlen;
+	return TRUE;
+}
+
+//Compute the checksum left to NIC in software,for the NIC can only send
+//frames in Ethernet Buffer.The checksum field holds the pseudo header's sum.
+static VOID eth_tx_csum(__ETHERNET_BUFFER* pEthBuff, __ETH_TX_OFFLOAD* pOffload, __u16 l4_len)
+{
+	__u8* l4 = &pEthBuff->Buffer[pOffload->l4_offset];
+	u16_t chksum = 0;
+	int offset = 6;  //Checksum offset in UDP header.
+
+	if (pOffload->dwFlags & ETH_OFFLOAD_TX_TCPCSUM)
+	{
+		offset = 16;
+	}
+	chksum = inet_chksum(l4, l4_len);
+	if ((0 == chksum) && (6 == offset))
+	{
+		chksum = 0xffff;
+	}
+	memcpy(l4 + offset, &chksum, sizeof(chksum));
+}
+#endif
+
+//Send out a pbuf chain by scatter-gather,each pbuf is mapped to one fragment
+//and the chain is referenced until NIC finishes it.A chain longer than
+//ETH_MAX_TX_FRAGS is flattened into one pbuf first,which is counted in the
+//interface's statistics.The frame is deferred by ethernet core if the Tx ring
+//is full,ERR_MEM is returned only if it can not be deferred either.
+static err_t eth_frags_output(__ETHERNET_INTERFACE* pEthInt, struct pbuf* p,
+	__ETH_TX_OFFLOAD* pOffload)
+{
+	__ETH_TX_FRAG frags[ETH_MAX_TX_FRAGS];
+	struct pbuf* q = NULL;
+	int nFragNum = 0;
+
+	if (pbuf_clen(p) > ETH_MAX_TX_FRAGS)
+	{
+		q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+		if (NULL == q)
+		{
+			return ERR_MEM;
+		}
+		pbuf_copy(q, p);
+		PBUF_COPY_OFFLOAD(q, p);
+		p = q;
+		pEthInt->ifState.dwTxLinearized++;
+	}
+	else
+	{
+		pbuf_ref(p);
+	}
+	for (q = p; q != NULL; q = q->next)
+	{
+		if (0 == q->len)
+		{
+			continue;
+		}
+		frags[nFragNum].pData = (__u8*)q->payload;
+		frags[nFragNum].length = q->len;
+		nFragNum++;
+	}
+	if (!EthernetManager.SendFrags(pEthInt, frags, nFragNum, pOffload, eth_tx_done, p))
+	{
+		pbuf_free(p);
+		return (pEthInt->nTxPendNum >= ETH_TX_PENDING_MAX) ? ERR_MEM : ERR_IF;
+	}
+	return ERR_OK;
+}
+
 //A helper routine called by lwIP,to send out an ethernet frame in a given interface.
 static err_t eth_level_output(struct netif* netif, struct pbuf* p)
 {
 	__ETHERNET_INTERFACE*   pEthInt = NULL;
+	__ETH_TX_OFFLOAD* pOffload = NULL;
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+	__ETH_TX_OFFLOAD offload;
+	__u16 l4_len = 0;
+#endif
 	struct pbuf* q = NULL;
 
 	if ((NULL == netif) || (NULL == p))
@@ -73,12 +201,39 @@ static err_t eth_level_output(struct netif* netif, struct pbuf* p)
 	{
 		BUG();
 	}
-	if (p->tot_len > ETH_DEFAULT_MTU + ETH_HEADER_LEN)  //Too large packet.
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+	//Checksum or segmentation is left to NIC.
+	if (p->flags & (PBUF_FLAG_TX_CSUM | PBUF_FLAG_TSO))
+	{
+		if (!eth_tx_offload(p, &offload, &l4_len))
+		{
+			return ERR_ARG;
+		}
+		pOffload = &offload;
+	}
+#endif
+	//Only TSO frame could exceed MTU,and it's cut by NIC.
+	if ((p->tot_len > ETH_DEFAULT_MTU + ETH_HEADER_LEN) &&
+		((NULL == pOffload) || !(pOffload->dwFlags & ETH_OFFLOAD_TSO)))
 	{
 		_hx_printf("%s:Packet to send out[size = %d] of size.\r\n", __func__,
 			p->tot_len);
 		return !ERR_OK;
 	}
+	//Hand the pbuf chain to NIC directly if scatter-gather is supported.
+	if (pEthInt->SendFrags)
+	{
+		return eth_frags_output(pEthInt, p, pOffload);
+	}
+#if LWIP_TCP_TSO
+	if (pOffload && (pOffload->dwFlags & ETH_OFFLOAD_TSO))
+	{
+		//Should not occur since TSO is negotiated only with SendFrags,
+		//stop TSO on this interface and let TCP retransmit.
+		netif->tso_max = 0;
+		return ERR_IF;
+	}
+#endif
 	if (p->tot_len > pEthInt->SendBuffer.buff_length)
 	{
 		_hx_printf("%s:Packet to send out[size = %d] of size.\r\n", __func__,
@@ -87,6 +242,12 @@ static err_t eth_level_output(struct netif* netif, struct pbuf* p)
 	}
 	//Convert pbuf to ethernet buffer.
 	pbuf_to_ethbuf(p, &pEthInt->SendBuffer);
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+	if (pOffload)
+	{
+		eth_tx_csum(&pEthInt->SendBuffer, pOffload, l4_len);
+	}
+#endif
 	//_hx_printf("  %s:send out a eth_frame,act_length = %d,tot_length = %d.\r\n", 
 	//	__func__, pEthInt->SendBuffer.act_length,p->tot_len);
 	if (EthernetManager.SendFrame(pEthInt, NULL))
@@ -100,6 +261,9 @@ static err_t eth_level_output(struct netif* netif, struct pbuf* p)
 static err_t _ethernet_if_init(struct netif *netif)
 {
 	__ETHERNET_INTERFACE*   pEthInt = NULL;
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+	u16_t flags = 0;
+#endif
 
 	if (NULL == netif)
 	{
@@ -131,6 +295,28 @@ static err_t _ethernet_if_init(struct netif *netif)
 	//Set the MAC address of this interface.
 	memcpy(netif->hwaddr, pEthInt->ethMac, ETH_MAC_LEN);
 
+	//Leave checksum and segmentation to NIC if negotiated when the
+	//interface is registered.
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+	flags = NETIF_CHECKSUM_ENABLE_ALL;
+	if (pEthInt->dwOffload & ETH_OFFLOAD_TX_TCPCSUM)
+	{
+		flags &= ~NETIF_CHECKSUM_GEN_TCP;
+	}
+	if (pEthInt->dwOffload & ETH_OFFLOAD_TX_UDPCSUM)
+	{
+		flags &= ~NETIF_CHECKSUM_GEN_UDP;
+	}
+	NETIF_SET_CHECKSUM_CTRL(netif, flags);
+#endif
+#if LWIP_TCP_TSO
+	if (pEthInt->dwOffload & ETH_OFFLOAD_TSO)
+	{
+		netif->tso_max = pEthInt->nTsoMaxFrame - ETH_HEADER_LEN;
+		netif->tso_max_pbufs = ETH_MAX_TX_FRAGS;
+	}
+#endif
+
 	return ERR_OK;
 }
 
@@ -197,12 +383,152 @@ VOID lwipDeleteEthernetInterface(__ETHERNET_INTERFACE* pEthInt, LPVOID pL3Interf
 	return;
 }
 
+#if LWIP_SUPPORT_CUSTOM_PBUF
+//Custom pbuf that refers the frame loaned by NIC driver,no copy is
+//required in this case.
+typedef struct tag__LWIP_LOAN_PBUF{
+	struct pbuf_custom pc;
+	__ETHERNET_BUFFER* pEthBuff;
+}__LWIP_LOAN_PBUF;
+
+//Called by lwIP when the custom pbuf is released,the Ethernet Buffer
+//is destroyed and the frame is given back to NIC driver.
+static void lwipFreeLoanPbuf(struct pbuf* p)
+{
+	__LWIP_LOAN_PBUF* pLoan = (__LWIP_LOAN_PBUF*)p;
+
+	EthernetManager.DestroyEthernetBuffer(pLoan->pEthBuff);
+	mem_free(pLoan);
+}
+
+//Delivery a loaned frame to lwIP without copying.
+static BOOL lwipDeliveryLoanFrame(__ETHERNET_BUFFER* pEthBuff, struct netif* pIf)
+{
+	__LWIP_LOAN_PBUF* pLoan = NULL;
+	struct pbuf* p = NULL;
+
+	pLoan = (__LWIP_LOAN_PBUF*)mem_malloc(sizeof(__LWIP_LOAN_PBUF));
+	if (NULL == pLoan)
+	{
+		return FALSE;
+	}
+	pLoan->pc.custom_free_function = lwipFreeLoanPbuf;
+	pLoan->pEthBuff = pEthBuff;
+	p = pbuf_alloced_custom(PBUF_RAW, pEthBuff->act_length, PBUF_REF, &pLoan->pc,
+		pEthBuff->pLoanFrame, pEthBuff->act_length);
+	if (NULL == p)
+	{
+		mem_free(pLoan);
+		return FALSE;
+	}
+	//The Ethernet Buffer is owned by the pbuf if accepted,and may be
+	//released in tcpip thread at any time.
+	if (pEthBuff->dwRxOffload & ETH_RX_CSUM_OK)
+	{
+		p->flags |= PBUF_FLAG_RX_CSUM_OK;
+	}
+	if (ERR_OK != pIf->input(p, pIf))
+	{
+		//Not accepted,give the Ethernet Buffer back to caller.
+		mem_free(pLoan);
+		return FALSE;
+	}
+	return TRUE;
+}
+#endif
+
+//Copy a received frame into pbuf chain.The transport data of unfragmented
+//TCP or UDP packet is summed while copying,so it's not read again when the
+//checksum is verified in tcp_input or udp_input.It's skipped if the checksum
+//is verified by NIC already.
+static VOID lwipCopyFrame(struct pbuf* p, __u8* pFrame, DWORD dwRxOffload)
+{
+	struct pbuf* q = NULL;
+	u16_t l4_start = 0, l4_end = 0;
+	u16_t pos = 0, head = 0, body = 0;
+	u16_t ip_hlen = 0, ip_len = 0;
+	u32_t acc = 0;
+	u8_t swapped = 0;
+	u8_t* iph = NULL;
+
+#if LWIP_CHECKSUM_ON_COPY
+	//Locate transport data of IPv4 packet,VLAN tagged frame is not considered.
+	iph = pFrame + SIZEOF_ETH_HDR;
+	if (!(dwRxOffload & ETH_RX_CSUM_OK) &&
+		(p->tot_len >= SIZEOF_ETH_HDR + IP_HLEN) &&
+		(pFrame[12] == 0x08) && (pFrame[13] == 0x00) &&
+		((iph[0] >> 4) == 4) &&
+		(((iph[6] & 0x3F) | iph[7]) == 0) && //No MF flag and offset.
+		((iph[9] == IP_PROTO_TCP) || (iph[9] == IP_PROTO_UDP)))
+	{
+		ip_hlen = (iph[0] & 0x0F) * 4;
+		ip_len = (iph[2] << 8) + iph[3];
+		if ((ip_hlen >= IP_HLEN) && (ip_len > ip_hlen) &&
+			(SIZEOF_ETH_HDR + ip_len <= p->tot_len))
+		{
+			l4_start = SIZEOF_ETH_HDR + ip_hlen;
+			l4_end = SIZEOF_ETH_HDR + ip_len;
+		}
+	}
+#endif
+	for (q = p; q != NULL; q = q->next)
+	{
+		//Bytes before and in the transport data range,in this pbuf.
+		head = 0;
+		body = 0;
+		if (pos < l4_start)
+		{
+			head = l4_start - pos;
+		}
+		if (head > q->len)
+		{
+			head = q->len;
+		}
+		if (pos + head < l4_end)
+		{
+			body = l4_end - (pos + head);
+			if (body > q->len - head)
+			{
+				body = q->len - head;
+			}
+		}
+		memcpy((u8_t*)q->payload, &pFrame[pos], head);
+#if LWIP_CHECKSUM_ON_COPY
+		if (body)
+		{
+			acc += LWIP_CHKSUM_COPY((u8_t*)q->payload + head, &pFrame[pos + head], body);
+			acc = FOLD_U32T(acc);
+			if (body & 1)
+			{
+				swapped = 1 - swapped;
+				acc = SWAP_BYTES_IN_WORD(acc);
+			}
+		}
+#endif
+		memcpy((u8_t*)q->payload + head + body, &pFrame[pos + head + body],
+			q->len - head - body);
+		pos += q->len;
+	}
+#if LWIP_CHECKSUM_ON_COPY
+	if (l4_end)
+	{
+		if (swapped)
+		{
+			acc = SWAP_BYTES_IN_WORD(acc);
+		}
+		p->rx_chksum = (u16_t)acc;
+		p->rx_chksum_len = l4_end - l4_start;
+		p->flags |= PBUF_FLAG_RX_CHKSUM;
+	}
+#endif
+}
+
 //Delivery a Ethernet Frame to this protocol,a dedicated L3 interface is also provided.
 BOOL lwipDeliveryFrame(__ETHERNET_BUFFER* pEthBuff, LPVOID pL3Interface)
 {
 	struct netif* pIf = (struct netif*)pL3Interface;
-	struct pbuf*  p, *q;
-	int i = 0;
+	struct pbuf*  p;
+	__u8* pFrame = NULL;
 
 	if ((NULL == pEthBuff) | (NULL == pL3Interface))
 	{
@@ -213,20 +539,39 @@ BOOL lwipDeliveryFrame(__ETHERNET_BUFFER* pEthBuff, LPVOID pL3Interface)
 	{
 		BUG();
 	}
+#if LWIP_SUPPORT_CUSTOM_PBUF
+	if (pEthBuff->pLoanFrame)
+	{
+		if (lwipDeliveryLoanFrame(pEthBuff, pIf))
+		{
+			return TRUE;
+		}
+		//Fall back to copy.
+	}
+#endif
 	p = pbuf_alloc(PBUF_RAW, pEthBuff->act_length, PBUF_POOL);
 	if (NULL == p)
 	{
 		_hx_printf("  %s:allocate pbuf object failed.\r\n", __func__);
 		return FALSE;
 	}
-	i = 0;
-	for (q = p; q != NULL; q = q->next)
+	pFrame = ETH_FRAME_DATA(pEthBuff);
+	lwipCopyFrame(p, pFrame, pEthBuff->dwRxOffload);
+	if (pEthBuff->dwRxOffload & ETH_RX_CSUM_OK)
+	{
+		p->flags |= PBUF_FLAG_RX_CSUM_OK;
+	}
+	//Delivery the packet to IP layer,it's our duty to release it if failed.
+	if (ERR_OK != pIf->input(p, pIf))
+	{
+		pbuf_free(p);
+		return FALSE;
+	}
+	//Loaned Ethernet Buffer is owned by us once delivered.
+	if (pEthBuff->pLoanFrame)
 	{
-		memcpy((u8_t*)q->payload, &pEthBuff->Buffer[i], q->len);
-		i = i + q->len;
+		EthernetManager.DestroyEthernetBuffer(pEthBuff);
 	}
-	//Delivery the packet to IP layer.
-	pIf->input(p, pIf);
 	return TRUE;
 }
 
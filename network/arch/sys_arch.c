@@ -143,12 +143,12 @@ err_t sys_mbox_new(sys_mbox_t* mbox,int size)
 		OBJECT_TYPE_MAILBOX);
 	if(NULL == pMailbox)
 	{
-		return 0;
+		return ERR_MEM;
 	}
 	if(!pMailbox->Initialize(pMailbox))
 	{
 		ObjectManager.DestroyObject(&ObjectManager,pMailbox);  //Destroy it.
-		return 0;
+		return ERR_MEM;
 	}
 
 	//Set mailbox size accordingly.
@@ -159,7 +159,7 @@ err_t sys_mbox_new(sys_mbox_t* mbox,int size)
 	if(!((__MAIL_BOX*)pMailbox)->SetMailboxSize(pMailbox,size))
 	{
 		ObjectManager.DestroyObject(&ObjectManager,pMailbox);
-		return 0;
+		return ERR_MEM;
 	}
 
 	//Return the new created mailbox object.
@@ -245,6 +245,97 @@ err_t sys_sem_new(sys_sem_t* sem,u8_t count)
 	return ERR_OK;
 }
 
+#if !LWIP_COMPAT_MUTEX
+//Create a new mutex object.
+err_t sys_mutex_new(sys_mutex_t* mutex)
+{
+	__MUTEX*  pMutex = (__MUTEX*)ObjectManager.CreateObject(&ObjectManager,
+		NULL,
+		OBJECT_TYPE_MUTEX);
+	if(NULL == pMutex)
+	{
+		return ERR_MEM;
+	}
+	if(!pMutex->Initialize((__COMMON_OBJECT*)pMutex))
+	{
+		ObjectManager.DestroyObject(&ObjectManager,(__COMMON_OBJECT*)pMutex);
+		return ERR_MEM;
+	}
+	mutex->pMutex          = (__COMMON_OBJECT*)pMutex;
+	mutex->pOwner          = NULL;
+	mutex->dwOwnerPriority = 0;
+	mutex->bRaised         = FALSE;
+	return ERR_OK;
+}
+
+//Lock a mutex object.
+//The owner runs at tcpip thread's priority at least until it unlocks the mutex.
+//With LWIP_TCPIP_CORE_LOCKING,application threads of any priority lock the
+//TCP/IP core,a low priority one holding it must not be preempted by middle
+//priority threads while tcpip thread or a high priority thread waits for it.
+void sys_mutex_lock(sys_mutex_t* mutex)
+{
+	__MUTEX*                 pMutex   = (__MUTEX*)mutex->pMutex;
+	__KERNEL_THREAD_OBJECT*  pThread  = KernelThreadManager.lpCurrentKernelThread;
+	DWORD                    dwPriority;
+
+	pMutex->WaitForThisObject((__COMMON_OBJECT*)pMutex);
+	mutex->pOwner  = pThread;
+	mutex->bRaised = FALSE;
+	if(NULL == pThread)  //Called in process of system initialization.
+	{
+		return;
+	}
+	dwPriority = KernelThreadManager.GetThreadPriority((__COMMON_OBJECT*)pThread);
+	if(dwPriority < TCPIP_THREAD_PRIO)
+	{
+		mutex->dwOwnerPriority = dwPriority;
+		mutex->bRaised         = TRUE;
+		KernelThreadManager.SetThreadPriority((__COMMON_OBJECT*)pThread,TCPIP_THREAD_PRIO);
+	}
+}
+
+//Unlock a mutex object and restore the owner's priority.
+void sys_mutex_unlock(sys_mutex_t* mutex)
+{
+	__MUTEX*                 pMutex     = (__MUTEX*)mutex->pMutex;
+	__KERNEL_THREAD_OBJECT*  pOwner     = mutex->pOwner;
+	DWORD                    dwPriority = mutex->dwOwnerPriority;
+	BOOL                     bRaised    = mutex->bRaised;
+
+	mutex->pOwner  = NULL;
+	mutex->bRaised = FALSE;
+	pMutex->ReleaseMutex((__COMMON_OBJECT*)pMutex);
+	//Restore after releasing,so the owner can not be preempted while it still
+	//holds the mutex.
+	if(bRaised)
+	{
+		KernelThreadManager.SetThreadPriority((__COMMON_OBJECT*)pOwner,dwPriority);
+	}
+}
+
+//Destroy a mutex object.
+void sys_mutex_free(sys_mutex_t* mutex)
+{
+	ObjectManager.DestroyObject(&ObjectManager,mutex->pMutex);
+}
+
+//Check if a mutex object is valid.
+int sys_mutex_valid(sys_mutex_t* mutex)
+{
+	return mutex->pMutex ? 1 : 0;
+}
+
+//Set a mutex object to invalid.
+void sys_mutex_set_invalid(sys_mutex_t* mutex)
+{
+	if(mutex)
+	{
+		mutex->pMutex = NULL;
+	}
+}
+#endif  //!LWIP_COMPAT_MUTEX
+
 //Get system tick counter.
 u32_t sys_now(void)
 {
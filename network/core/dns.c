@@ -42,9 +42,12 @@
  * DNS.C
  *
  * The lwIP DNS resolver functions are used to lookup a host name and
- * map it to a numerical IP address. It maintains a list of resolved
- * hostnames that can be queried with the dns_lookup() function.
- * New hostnames can be resolved using the dns_query() function.
+ * map it to a numerical IP address. It maintains a hashed cache of resolved
+ * hostnames (with up to DNS_MAX_ADDRS_PER_NAME addresses each, or with the
+ * fact that they don't exist) that can be queried with the dns_lookup()
+ * function, entries expire with the TTL of the answer. New hostnames can be
+ * resolved using the dns_enqueue() function, lookups of a name that is
+ * being queried already wait for the same query.
  *
  * The lwIP version of the resolver also adds a non-blocking version of
  * gethostbyname() that will work with a raw API application. This function
@@ -120,7 +123,12 @@
 #define DNS_STATE_UNUSED          0
 #define DNS_STATE_NEW             1
 #define DNS_STATE_ASKING          2
-#define DNS_STATE_DONE            3
+#define DNS_STATE_DONE            3   /* answered, callbacks are being called */
+
+/* DNS cache entry states */
+#define DNS_CACHE_UNUSED          0
+#define DNS_CACHE_POSITIVE        1
+#define DNS_CACHE_NEGATIVE        2   /* name does not exist or has no A record */
 
 #ifdef PACK_STRUCT_USE_INCLUDES
 #  include "arch/bpstruct.h"
@@ -164,20 +172,45 @@ struct dns_answer {
 };
 #define SIZEOF_DNS_ANSWER 10
 
-/** DNS table entry */
+/** DNS table entry, a query in flight */
 struct dns_table_entry {
   u8_t  state;
   u8_t  numdns;
   u8_t  tmr;
   u8_t  retries;
-  u8_t  seqno;
   u8_t  err;
-  u32_t ttl;
   char name[DNS_MAX_NAME_LENGTH];
-  ip_addr_t ipaddr;
-  /* pointer to callback on DNS query done */
+};
+
+/** A caller waiting for a query in flight */
+struct dns_req_entry {
+  /* pointer to callback on DNS query done, NULL if the entry is free */
   dns_found_callback found;
   void *arg;
+  /* index of the query in dns_table */
+  u8_t idx;
+};
+
+/** DNS cache entry */
+struct dns_cache_entry {
+  /* next entry in the same hash bucket */
+  struct dns_cache_entry *next;
+  u32_t hash;
+  u8_t  state;
+  u8_t  numaddrs;
+  /* address dns_lookup hands out next */
+  u8_t  nextaddr;
+  /* looked up since it has been resolved */
+  u8_t  used;
+  /* a query to refresh it has been sent */
+  u8_t  prefetched;
+  /* seconds to live, and the TTL it has been resolved with */
+  u32_t ttl;
+  u32_t ttl_orig;
+  /* value of dns_cache_stamp when last used */
+  u32_t stamp;
+  ip_addr_t addrs[DNS_MAX_ADDRS_PER_NAME];
+  char name[DNS_MAX_NAME_LENGTH];
 };
 
 #if DNS_LOCAL_HOSTLIST
@@ -210,6 +243,9 @@ static void dns_init_local();
 /* forward declarations */
 static void dns_recv(void *s, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port);
 static void dns_check_entries(void);
+static void dns_cache_tmr(void);
+static void dns_cache_flush(void);
+static err_t dns_enqueue(const char *name, dns_found_callback found, void *callback_arg);
 
 /*-----------------------------------------------------------------------------
  * Globales
@@ -217,8 +253,11 @@ static void dns_check_entries(void);
 
 /* DNS variables */
 static struct udp_pcb        *dns_pcb;
-static u8_t                   dns_seqno;
 static struct dns_table_entry dns_table[DNS_TABLE_SIZE];
+static struct dns_req_entry   dns_requests[DNS_MAX_REQUESTS];
+static struct dns_cache_entry dns_cache[DNS_CACHE_SIZE];
+static struct dns_cache_entry *dns_cache_hash[DNS_CACHE_HASH_SIZE];
+static u32_t                  dns_cache_stamp;
 static ip_addr_t              dns_servers[DNS_MAX_SERVERS];
 /** Contiguous buffer for processing responses */
 static u8_t                   dns_payload_buffer[LWIP_MEM_ALIGN_BUFFER(DNS_MSG_SIZE)];
@@ -274,6 +313,10 @@ dns_setserver(u8_t numdns, ip_addr_t *dnsserver)
 {
   if ((numdns < DNS_MAX_SERVERS) && (dns_pcb != NULL) &&
       (dnsserver != NULL) && !ip_addr_isany(dnsserver)) {
+    if (!ip_addr_cmp(&dns_servers[numdns], dnsserver)) {
+      /* answers of the previous server may not hold for the new one */
+      dns_cache_flush();
+    }
     dns_servers[numdns] = (*dnsserver);
   }
 }
@@ -305,6 +348,7 @@ dns_tmr(void)
   if (dns_pcb != NULL) {
     LWIP_DEBUGF(DNS_DEBUG, ("dns_tmr: dns_check_entries\n"));
     dns_check_entries();
+    dns_cache_tmr();
   }
 }
 
@@ -434,48 +478,321 @@ dns_local_addhost(const char *hostname, const ip_addr_t *addr)
 #endif /* DNS_LOCAL_HOSTLIST */
 
 /**
- * Look up a hostname in the array of known hostnames.
+ * Hash a hostname for the cache index, case insensitive as DNS names are.
+ */
+static u32_t
+dns_hash_name(const char *name)
+{
+  u32_t hash = 2166136261UL;
+  char c;
+
+  while ((c = *name++) != 0) {
+    if ((c >= 'A') && (c <= 'Z')) {
+      c += 'a' - 'A';
+    }
+    hash = (hash ^ (u8_t)c) * 16777619UL;
+  }
+  return hash;
+}
+
+/**
+ * Compare two hostnames case insensitively.
+ *
+ * @return 0: names equal; 1: names differ
+ */
+static u8_t
+dns_name_cmp(const char *name1, const char *name2)
+{
+  char c1, c2;
+
+  do {
+    c1 = *name1++;
+    c2 = *name2++;
+    if ((c1 >= 'A') && (c1 <= 'Z')) {
+      c1 += 'a' - 'A';
+    }
+    if ((c2 >= 'A') && (c2 <= 'Z')) {
+      c2 += 'a' - 'A';
+    }
+    if (c1 != c2) {
+      return 1;
+    }
+  } while (c1 != 0);
+  return 0;
+}
+
+/**
+ * Find the cache entry of a hostname.
  *
- * @note This function only looks in the internal array of known
- * hostnames, it does not send out a query for the hostname if none
+ * @param name the hostname to look up
+ * @param hash dns_hash_name(name)
+ * @return the cache entry or NULL if the name is not cached
+ */
+static struct dns_cache_entry *
+dns_cache_find(const char *name, u32_t hash)
+{
+  struct dns_cache_entry *entry;
+
+  for (entry = dns_cache_hash[hash & (DNS_CACHE_HASH_SIZE - 1)]; entry != NULL; entry = entry->next) {
+    if ((entry->hash == hash) && (dns_name_cmp(entry->name, name) == 0)) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Remove an entry from the cache.
+ */
+static void
+dns_cache_remove(struct dns_cache_entry *entry)
+{
+  struct dns_cache_entry **pprev = &dns_cache_hash[entry->hash & (DNS_CACHE_HASH_SIZE - 1)];
+
+  while (*pprev != NULL) {
+    if (*pprev == entry) {
+      *pprev = entry->next;
+      break;
+    }
+    pprev = &(*pprev)->next;
+  }
+  entry->next  = NULL;
+  entry->state = DNS_CACHE_UNUSED;
+}
+
+/**
+ * Remove all entries from the cache.
+ */
+static void
+dns_cache_flush(void)
+{
+  u16_t i;
+
+  for (i = 0; i < DNS_CACHE_SIZE; ++i) {
+    dns_cache[i].state = DNS_CACHE_UNUSED;
+    dns_cache[i].next  = NULL;
+  }
+  for (i = 0; i < DNS_CACHE_HASH_SIZE; ++i) {
+    dns_cache_hash[i] = NULL;
+  }
+}
+
+/**
+ * Store the answer for a hostname in the cache, replacing the entry of the
+ * name if there is one, or else an unused or the least recently used entry.
+ *
+ * @param name the hostname that was resolved
+ * @param addrs the addresses of the name
+ * @param numaddrs number of addresses, 0 to cache that the name has no address
+ * @param ttl seconds the answer may be cached
+ */
+static void
+dns_cache_add(const char *name, ip_addr_t *addrs, u8_t numaddrs, u32_t ttl)
+{
+  struct dns_cache_entry *entry, *victim = NULL;
+  u32_t hash = dns_hash_name(name);
+  size_t namelen;
+  u16_t i;
+
+  entry = dns_cache_find(name, hash);
+  if (ttl == 0) {
+    /* not to be cached, and a stale answer must not be used any more */
+    if (entry != NULL) {
+      dns_cache_remove(entry);
+    }
+    return;
+  }
+
+  if (entry == NULL) {
+    for (i = 0; i < DNS_CACHE_SIZE; ++i) {
+      entry = &dns_cache[i];
+      if (entry->state == DNS_CACHE_UNUSED) {
+        victim = entry;
+        break;
+      }
+      if ((victim == NULL) ||
+          ((u32_t)(dns_cache_stamp - entry->stamp) > (u32_t)(dns_cache_stamp - victim->stamp))) {
+        victim = entry;
+      }
+    }
+    entry = victim;
+    if (entry->state != DNS_CACHE_UNUSED) {
+      LWIP_DEBUGF(DNS_DEBUG, ("dns_cache_add: \"%s\": evicted\n", entry->name));
+      dns_cache_remove(entry);
+    }
+    entry->hash = hash;
+    namelen = LWIP_MIN(strlen(name), DNS_MAX_NAME_LENGTH-1);
+    MEMCPY(entry->name, name, namelen);
+    entry->name[namelen] = 0;
+    entry->next = dns_cache_hash[hash & (DNS_CACHE_HASH_SIZE - 1)];
+    dns_cache_hash[hash & (DNS_CACHE_HASH_SIZE - 1)] = entry;
+  }
+
+  LWIP_DEBUGF(DNS_DEBUG, ("dns_cache_add: \"%s\": %"U16_F" addresses, ttl %"U32_F"\n",
+              name, (u16_t)numaddrs, ttl));
+  entry->state = (numaddrs > 0) ? DNS_CACHE_POSITIVE : DNS_CACHE_NEGATIVE;
+  entry->numaddrs = numaddrs;
+  if (numaddrs > 0) {
+    MEMCPY(entry->addrs, addrs, numaddrs * sizeof(ip_addr_t));
+  }
+  /* the first address is handed out to the callers waiting for the answer */
+  entry->nextaddr   = (numaddrs > 1) ? 1 : 0;
+  entry->used       = 0;
+  entry->prefetched = 0;
+  entry->ttl        = ttl;
+  entry->ttl_orig   = ttl;
+  entry->stamp      = dns_cache_stamp++;
+}
+
+/**
+ * Age the cache entries, called every second: expired entries are removed
+ * and queries are sent to refresh the ones in use before they expire.
+ */
+static void
+dns_cache_tmr(void)
+{
+  struct dns_cache_entry *entry;
+  u16_t i;
+
+  for (i = 0; i < DNS_CACHE_SIZE; ++i) {
+    entry = &dns_cache[i];
+    if (entry->state == DNS_CACHE_UNUSED) {
+      continue;
+    }
+    if (--entry->ttl == 0) {
+      LWIP_DEBUGF(DNS_DEBUG, ("dns_cache_tmr: \"%s\": expired\n", entry->name));
+      dns_cache_remove(entry);
+      continue;
+    }
+#if DNS_PREFETCH
+    if ((entry->state == DNS_CACHE_POSITIVE) && entry->used && !entry->prefetched &&
+        (entry->ttl <= entry->ttl_orig / 10)) {
+      /* nobody waits for the answer, it just replaces this entry; tried
+         again next time if no query can be sent now */
+      if (dns_enqueue(entry->name, NULL, NULL) == ERR_INPROGRESS) {
+        LWIP_DEBUGF(DNS_DEBUG, ("dns_cache_tmr: \"%s\": prefetch\n", entry->name));
+        entry->prefetched = 1;
+      }
+    }
+#endif /* DNS_PREFETCH */
+  }
+}
+
+/**
+ * Look up a hostname in the local host-list and in the cache of known
+ * hostnames. The addresses of a name are handed out in turn, so
+ * connections are spread over them.
+ *
+ * @note This function does not send out a query for the hostname if none
  * was found. The function dns_enqueue() can be used to send a query
  * for a hostname.
  *
  * @param name the hostname to look up
- * @return the hostname's IP address, as u32_t (instead of ip_addr_t to
- *         better check for failure: != IPADDR_NONE) or IPADDR_NONE if the hostname
- *         was not found in the cached dns_table.
+ * @param addr where to store the hostname's IP address
+ * @return ERR_OK if the address was found, ERR_VAL if the hostname is
+ *         cached as not existing or ERR_ARG if it is not known
  */
-static u32_t
-dns_lookup(const char *name)
+static err_t
+dns_lookup(const char *name, ip_addr_t *addr)
 {
-  u8_t i;
+  struct dns_cache_entry *entry;
 #if DNS_LOCAL_HOSTLIST || defined(DNS_LOOKUP_LOCAL_EXTERN)
-  u32_t addr;
+  u32_t local_addr;
 #endif /* DNS_LOCAL_HOSTLIST || defined(DNS_LOOKUP_LOCAL_EXTERN) */
 #if DNS_LOCAL_HOSTLIST
-  if ((addr = dns_lookup_local(name)) != IPADDR_NONE) {
-    return addr;
+  if ((local_addr = dns_lookup_local(name)) != IPADDR_NONE) {
+    ip4_addr_set_u32(addr, local_addr);
+    return ERR_OK;
   }
 #endif /* DNS_LOCAL_HOSTLIST */
 #ifdef DNS_LOOKUP_LOCAL_EXTERN
-  if((addr = DNS_LOOKUP_LOCAL_EXTERN(name)) != IPADDR_NONE) {
-    return addr;
+  if((local_addr = DNS_LOOKUP_LOCAL_EXTERN(name)) != IPADDR_NONE) {
+    ip4_addr_set_u32(addr, local_addr);
+    return ERR_OK;
   }
 #endif /* DNS_LOOKUP_LOCAL_EXTERN */
 
-  /* Walk through name list, return entry if found. If not, return NULL. */
-  for (i = 0; i < DNS_TABLE_SIZE; ++i) {
-    if ((dns_table[i].state == DNS_STATE_DONE) &&
-        (strcmp(name, dns_table[i].name) == 0)) {
-      LWIP_DEBUGF(DNS_DEBUG, ("dns_lookup: \"%s\": found = ", name));
-      ip_addr_debug_print(DNS_DEBUG, &(dns_table[i].ipaddr));
-      LWIP_DEBUGF(DNS_DEBUG, ("\n"));
-      return ip4_addr_get_u32(&dns_table[i].ipaddr);
+  entry = dns_cache_find(name, dns_hash_name(name));
+  if (entry == NULL) {
+    return ERR_ARG;
+  }
+  entry->stamp = dns_cache_stamp++;
+  if (entry->state == DNS_CACHE_NEGATIVE) {
+    LWIP_DEBUGF(DNS_DEBUG, ("dns_lookup: \"%s\": cached as not existing\n", name));
+    return ERR_VAL;
+  }
+  entry->used = 1;
+  ip_addr_copy(*addr, entry->addrs[entry->nextaddr]);
+  if (++entry->nextaddr >= entry->numaddrs) {
+    entry->nextaddr = 0;
+  }
+  LWIP_DEBUGF(DNS_DEBUG, ("dns_lookup: \"%s\": found = ", name));
+  ip_addr_debug_print(DNS_DEBUG, addr);
+  LWIP_DEBUGF(DNS_DEBUG, ("\n"));
+  return ERR_OK;
+}
+
+/**
+ * Get all cached addresses of a hostname, to be called in the tcpip thread
+ * after dns_gethostbyname succeeded for it. The address dns_gethostbyname
+ * returned comes first.
+ *
+ * @param hostname the hostname that was resolved
+ * @param addrs where to store the addresses
+ * @param maxaddrs number of elements of addrs
+ * @return number of addresses stored, 0 if the hostname is not cached
+ */
+u8_t
+dns_getaddrs(const char *hostname, ip_addr_t *addrs, u8_t maxaddrs)
+{
+  struct dns_cache_entry *entry;
+  u8_t i, idx;
+
+  if ((hostname == NULL) || (addrs == NULL)) {
+    return 0;
+  }
+  entry = dns_cache_find(hostname, dns_hash_name(hostname));
+  if ((entry == NULL) || (entry->state != DNS_CACHE_POSITIVE)) {
+    return 0;
+  }
+  /* start with the address dns_lookup handed out last */
+  idx = (entry->nextaddr > 0) ? (entry->nextaddr - 1) : (entry->numaddrs - 1);
+  for (i = 0; (i < entry->numaddrs) && (i < maxaddrs); ++i) {
+    ip_addr_copy(addrs[i], entry->addrs[idx]);
+    if (++idx >= entry->numaddrs) {
+      idx = 0;
     }
   }
+  return i;
+}
 
-  return IPADDR_NONE;
+/**
+ * Call the callbacks of all callers waiting for a query, then free the
+ * query's entry in dns_table.
+ *
+ * @param idx index of the query in dns_table
+ * @param addr the resolved address, or NULL if the name could not be resolved
+ */
+static void
+dns_call_found(u8_t idx, ip_addr_t *addr)
+{
+  struct dns_table_entry *pEntry = &dns_table[idx];
+  dns_found_callback found;
+  void *arg;
+  u8_t r;
+
+  /* callbacks may look up names again: don't let them join this query or
+     take its entry while its name is passed to them */
+  pEntry->state = DNS_STATE_DONE;
+  for (r = 0; r < DNS_MAX_REQUESTS; ++r) {
+    if ((dns_requests[r].found != NULL) && (dns_requests[r].idx == idx)) {
+      found = dns_requests[r].found;
+      arg   = dns_requests[r].arg;
+      dns_requests[r].found = NULL;
+      (*found)(pEntry->name, addr, arg);
+    }
+  }
+  pEntry->state = DNS_STATE_UNUSED;
 }
 
 #if DNS_DOES_NAME_CHECK
@@ -669,12 +986,9 @@ dns_check_entry(u8_t i)
             break;
           } else {
             LWIP_DEBUGF(DNS_DEBUG, ("dns_check_entry: \"%s\": timeout\n", pEntry->name));
-            /* call specified callback function if provided */
-            if (pEntry->found)
-              (*pEntry->found)(pEntry->name, NULL, pEntry->arg);
-            /* flush this entry */
-            pEntry->state   = DNS_STATE_UNUSED;
-            pEntry->found   = NULL;
+            /* call the waiting callers and flush this entry, timeouts are
+               not cached */
+            dns_call_found(i, NULL);
             break;
           }
         }
@@ -692,16 +1006,7 @@ dns_check_entry(u8_t i)
       break;
     }
 
-    case DNS_STATE_DONE: {
-      /* if the time to live is nul */
-      if (--pEntry->ttl == 0) {
-        LWIP_DEBUGF(DNS_DEBUG, ("dns_check_entry: \"%s\": flush\n", pEntry->name));
-        /* flush this entry */
-        pEntry->state = DNS_STATE_UNUSED;
-        pEntry->found = NULL;
-      }
-      break;
-    }
+    case DNS_STATE_DONE:
     case DNS_STATE_UNUSED:
       /* nothing to do */
       break;
@@ -724,6 +1029,44 @@ dns_check_entries(void)
   }
 }
 
+/**
+ * Get the TTL of a negative answer from the SOA record in the authority
+ * section: the lower one of the record's TTL and its MINIMUM field
+ * (RFC 2308 - 5. Caching Negative Answers).
+ *
+ * @param pHostname start of the authority section
+ * @param pEnd end of the DNS message
+ * @param nauthrr number of records in the authority section
+ * @return seconds the negative answer may be cached
+ */
+static u32_t
+dns_negative_ttl(char *pHostname, char *pEnd, u16_t nauthrr)
+{
+  struct dns_answer ans;
+  u32_t ttl, minimum;
+  u16_t len;
+
+  while ((nauthrr > 0) && (pHostname < pEnd)) {
+    pHostname = (char *) dns_parse_name((unsigned char *)pHostname);
+    if (pHostname + SIZEOF_DNS_ANSWER > pEnd) {
+      break;
+    }
+    SMEMCPY(&ans, pHostname, SIZEOF_DNS_ANSWER);
+    pHostname += SIZEOF_DNS_ANSWER;
+    len = htons(ans.len);
+    /* SOA record data: MNAME, RNAME and 5 32-bit values, MINIMUM is the last */
+    if ((ans.type == PP_HTONS(DNS_RRTYPE_SOA)) && (ans.cls == PP_HTONS(DNS_RRCLASS_IN)) &&
+        (len >= 2 + 5 * 4) && (pHostname + len <= pEnd)) {
+      SMEMCPY(&minimum, pHostname + len - 4, sizeof(minimum));
+      ttl = LWIP_MIN(ntohl(ans.ttl), ntohl(minimum));
+      return LWIP_MIN(ttl, DNS_MAX_NEG_TTL);
+    }
+    pHostname += len;
+    --nauthrr;
+  }
+  return DNS_NEG_TTL;
+}
+
 /**
  * Receive input function for DNS response packets arriving for the dns UDP pcb.
  *
@@ -733,11 +1076,14 @@ static void
 dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
 {
   u16_t i;
-  char *pHostname;
+  char *pHostname, *pEnd;
   struct dns_hdr *hdr;
   struct dns_answer ans;
   struct dns_table_entry *pEntry;
   u16_t nquestions, nanswers;
+  ip_addr_t addrs[DNS_MAX_ADDRS_PER_NAME];
+  u8_t numaddrs = 0;
+  u32_t ttl = DNS_MAX_TTL;
 
   LWIP_UNUSED_ARG(arg);
   LWIP_UNUSED_ARG(pcb);
@@ -752,7 +1098,7 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t
   }
 
   /* is the dns message big enough ? */
-  if (p->tot_len < (SIZEOF_DNS_HDR + SIZEOF_DNS_QUERY + SIZEOF_DNS_ANSWER)) {
+  if (p->tot_len < (SIZEOF_DNS_HDR + SIZEOF_DNS_QUERY)) {
     LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: pbuf too small\n"));
     /* free pbuf and return */
     goto memerr;
@@ -762,21 +1108,23 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t
   if (pbuf_copy_partial(p, dns_payload, p->tot_len, 0) == p->tot_len) {
     /* The ID in the DNS header should be our entry into the name table. */
     hdr = (struct dns_hdr*)dns_payload;
+    pEnd = (char *)dns_payload + p->tot_len;
     i = htons(hdr->id);
     if (i < DNS_TABLE_SIZE) {
       pEntry = &dns_table[i];
       if(pEntry->state == DNS_STATE_ASKING) {
-        /* This entry is now completed. */
-        pEntry->state = DNS_STATE_DONE;
-        pEntry->err   = hdr->flags2 & DNS_FLAG2_ERR_MASK;
+        pEntry->err = hdr->flags2 & DNS_FLAG2_ERR_MASK;
 
-        /* We only care about the question(s) and the answers. The authrr
-           and the extrarr are simply discarded. */
+        /* We only care about the question(s) and the answers, and about the
+           authority records of negative answers. The extrarr are simply
+           discarded. */
         nquestions = htons(hdr->numquestions);
         nanswers   = htons(hdr->numanswers);
 
-        /* Check for error. If so, call callback to inform. */
-        if (((hdr->flags1 & DNS_FLAG1_RESPONSE) == 0) || (pEntry->err != 0) || (nquestions != 1)) {
+        /* Check for error. If so, call callback to inform. A name error is
+           an answer too, it is cached. */
+        if (((hdr->flags1 & DNS_FLAG1_RESPONSE) == 0) || (nquestions != 1) ||
+            ((pEntry->err != DNS_FLAG2_ERR_NONE) && (pEntry->err != DNS_FLAG2_ERR_NAME))) {
           LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": error in flags\n", pEntry->name));
           /* call callback to indicate error, clean up memory and return */
           goto responseerr;
@@ -794,36 +1142,53 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t
         /* Skip the name in the "question" part */
         pHostname = (char *) dns_parse_name((unsigned char *)dns_payload + SIZEOF_DNS_HDR) + SIZEOF_DNS_QUERY;
 
-        while (nanswers > 0) {
+        /* Collect the addresses, the lowest TTL of them is used */
+        while ((nanswers > 0) && (pHostname < pEnd)) {
           /* skip answer resource record's host name */
           pHostname = (char *) dns_parse_name((unsigned char *)pHostname);
+          if (pHostname + SIZEOF_DNS_ANSWER > pEnd) {
+            break;
+          }
 
           /* Check for IP address type and Internet class. Others are discarded. */
           SMEMCPY(&ans, pHostname, SIZEOF_DNS_ANSWER);
           if((ans.type == PP_HTONS(DNS_RRTYPE_A)) && (ans.cls == PP_HTONS(DNS_RRCLASS_IN)) &&
              (ans.len == PP_HTONS(sizeof(ip_addr_t))) ) {
-            /* read the answer resource record's TTL, and maximize it if needed */
-            pEntry->ttl = ntohl(ans.ttl);
-            if (pEntry->ttl > DNS_MAX_TTL) {
-              pEntry->ttl = DNS_MAX_TTL;
+            if (pHostname + SIZEOF_DNS_ANSWER + sizeof(ip_addr_t) > pEnd) {
+              break;
             }
-            /* read the IP address after answer resource record's header */
-            SMEMCPY(&(pEntry->ipaddr), (pHostname+SIZEOF_DNS_ANSWER), sizeof(ip_addr_t));
-            LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": response = ", pEntry->name));
-            ip_addr_debug_print(DNS_DEBUG, (&(pEntry->ipaddr)));
-            LWIP_DEBUGF(DNS_DEBUG, ("\n"));
-            /* call specified callback function if provided */
-            if (pEntry->found) {
-              (*pEntry->found)(pEntry->name, &pEntry->ipaddr, pEntry->arg);
+            if (numaddrs < DNS_MAX_ADDRS_PER_NAME) {
+              /* read the IP address after answer resource record's header */
+              SMEMCPY(&addrs[numaddrs], (pHostname+SIZEOF_DNS_ANSWER), sizeof(ip_addr_t));
+              /* read the answer resource record's TTL, and minimize it if needed */
+              ttl = LWIP_MIN(ttl, ntohl(ans.ttl));
+              numaddrs++;
             }
-            /* deallocate memory and return */
-            goto memerr;
-          } else {
-            pHostname = pHostname + SIZEOF_DNS_ANSWER + htons(ans.len);
           }
+          pHostname = pHostname + SIZEOF_DNS_ANSWER + htons(ans.len);
           --nanswers;
         }
-        LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": error in response\n", pEntry->name));
+
+        if (numaddrs > 0) {
+          LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": response = ", pEntry->name));
+          ip_addr_debug_print(DNS_DEBUG, (&addrs[0]));
+          LWIP_DEBUGF(DNS_DEBUG, (", %"U16_F" addresses\n", (u16_t)numaddrs));
+          /* cache the answer before the callbacks, they may look it up */
+          dns_cache_add(pEntry->name, addrs, numaddrs, ttl);
+          dns_call_found((u8_t)i, &addrs[0]);
+          /* deallocate memory and return */
+          goto memerr;
+        }
+
+        if (nanswers == 0) {
+          /* the whole answer section was parsed: the name does not exist
+             or has no address, remember that for a while */
+          LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": no such name\n", pEntry->name));
+          dns_cache_add(pEntry->name, NULL, 0,
+            dns_negative_ttl(pHostname, pEnd, htons(hdr->numauthrr)));
+        } else {
+          LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": error in response\n", pEntry->name));
+        }
         /* call callback to indicate error, clean up memory and return */
         goto responseerr;
       }
@@ -834,77 +1199,90 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t
   goto memerr;
 
 responseerr:
-  /* ERROR: call specified callback function with NULL as name to indicate an error */
-  if (pEntry->found) {
-    (*pEntry->found)(pEntry->name, NULL, pEntry->arg);
-  }
-  /* flush this entry */
-  pEntry->state = DNS_STATE_UNUSED;
-  pEntry->found = NULL;
+  /* ERROR: call the callbacks with NULL as address to indicate an error,
+     and flush this entry */
+  dns_call_found((u8_t)i, NULL);
 
 memerr:
-  /* free pbuf */
+  /* free pbuf and return */
   pbuf_free(p);
   return;
 }
 
 /**
- * Queues a new hostname to resolve and sends out a DNS query for that hostname
+ * Queues a new hostname to resolve and sends out a DNS query for that
+ * hostname, or lets the caller wait for the query already sent for it.
  *
  * @param name the hostname that is to be queried
- * @param found a callback founction to be called on success, failure or timeout
+ * @param found a callback founction to be called on success, failure or timeout,
+ *              NULL if nobody waits for the answer
  * @param callback_arg argument to pass to the callback function
  * @return @return a err_t return code.
  */
 static err_t
 dns_enqueue(const char *name, dns_found_callback found, void *callback_arg)
 {
-  u8_t i;
-  u8_t lseq, lseqi;
-  struct dns_table_entry *pEntry = NULL;
+  u8_t i, r;
+  struct dns_table_entry *pEntry;
+  struct dns_req_entry *pReq = NULL;
   size_t namelen;
 
-  /* search an unused entry, or the oldest one */
-  lseq = lseqi = 0;
+  /* get a place for the caller first, a query nobody would wait for is
+     useless */
+  if (found != NULL) {
+    for (r = 0; r < DNS_MAX_REQUESTS; ++r) {
+      if (dns_requests[r].found == NULL) {
+        pReq = &dns_requests[r];
+        break;
+      }
+    }
+    if (pReq == NULL) {
+      LWIP_DEBUGF(DNS_DEBUG, ("dns_enqueue: \"%s\": DNS requests table is full\n", name));
+      return ERR_MEM;
+    }
+  }
+
+  /* is this name queried already? then wait for the same answer */
   for (i = 0; i < DNS_TABLE_SIZE; ++i) {
     pEntry = &dns_table[i];
-    /* is it an unused entry ? */
-    if (pEntry->state == DNS_STATE_UNUSED)
-      break;
-
-    /* check if this is the oldest completed entry */
-    if (pEntry->state == DNS_STATE_DONE) {
-      if ((dns_seqno - pEntry->seqno) > lseq) {
-        lseq = dns_seqno - pEntry->seqno;
-        lseqi = i;
+    if (((pEntry->state == DNS_STATE_NEW) || (pEntry->state == DNS_STATE_ASKING)) &&
+        (dns_name_cmp(name, pEntry->name) == 0)) {
+      LWIP_DEBUGF(DNS_DEBUG, ("dns_enqueue: \"%s\": wait for DNS entry %"U16_F"\n", name, (u16_t)(i)));
+      if (pReq != NULL) {
+        pReq->found = found;
+        pReq->arg   = callback_arg;
+        pReq->idx   = i;
       }
+      return ERR_INPROGRESS;
     }
   }
 
-  /* if we don't have found an unused entry, use the oldest completed one */
-  if (i == DNS_TABLE_SIZE) {
-    if ((lseqi >= DNS_TABLE_SIZE) || (dns_table[lseqi].state != DNS_STATE_DONE)) {
-      /* no entry can't be used now, table is full */
-      LWIP_DEBUGF(DNS_DEBUG, ("dns_enqueue: \"%s\": DNS entries table is full\n", name));
-      return ERR_MEM;
-    } else {
-      /* use the oldest completed one */
-      i = lseqi;
-      pEntry = &dns_table[i];
+  /* search an unused entry, answered ones are in the cache */
+  for (i = 0; i < DNS_TABLE_SIZE; ++i) {
+    if (dns_table[i].state == DNS_STATE_UNUSED) {
+      break;
     }
   }
+  if (i == DNS_TABLE_SIZE) {
+    /* no entry can't be used now, table is full */
+    LWIP_DEBUGF(DNS_DEBUG, ("dns_enqueue: \"%s\": DNS entries table is full\n", name));
+    return ERR_MEM;
+  }
+  pEntry = &dns_table[i];
 
   /* use this entry */
   LWIP_DEBUGF(DNS_DEBUG, ("dns_enqueue: \"%s\": use DNS entry %"U16_F"\n", name, (u16_t)(i)));
 
   /* fill the entry */
   pEntry->state = DNS_STATE_NEW;
-  pEntry->seqno = dns_seqno++;
-  pEntry->found = found;
-  pEntry->arg   = callback_arg;
   namelen = LWIP_MIN(strlen(name), DNS_MAX_NAME_LENGTH-1);
   MEMCPY(pEntry->name, name, namelen);
   pEntry->name[namelen] = 0;
+  if (pReq != NULL) {
+    pReq->found = found;
+    pReq->arg   = callback_arg;
+    pReq->idx   = i;
+  }
 
   /* force to send query without waiting timer */
   dns_check_entry(i);
@@ -919,9 +1297,12 @@ dns_enqueue(const char *name, dns_found_callback found, void *callback_arg)
  *
  * Returns immediately with one of err_t return codes:
  * - ERR_OK if hostname is a valid IP address string or the host
- *   name is already in the local names table.
+ *   name is already in the local names table or in the cache.
  * - ERR_INPROGRESS enqueue a request to be sent to the DNS server
- *   for resolution if no errors are present.
+ *   for resolution if no errors are present, or wait for the
+ *   query of the same name already sent.
+ * - ERR_VAL: the host name is cached as not existing
+ * - ERR_MEM: too many queries or callers waiting for them
  * - ERR_ARG: dns client not initialized or invalid hostname
  *
  * @param hostname the hostname that is to be queried
@@ -937,6 +1318,7 @@ dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback foun
                   void *callback_arg)
 {
   u32_t ipaddr;
+  err_t err;
   /* not initialized or no valid server yet, or invalid addr pointer
    * or invalid hostname or invalid hostname length */
   if ((dns_pcb == NULL) || (addr == NULL) ||
@@ -954,15 +1336,17 @@ dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback foun
 
   /* host name already in octet notation? set ip addr and return ERR_OK */
   ipaddr = ipaddr_addr(hostname);
-  if (ipaddr == IPADDR_NONE) {
-    /* already have this address cached? */
-    ipaddr = dns_lookup(hostname);
-  }
   if (ipaddr != IPADDR_NONE) {
     ip4_addr_set_u32(addr, ipaddr);
     return ERR_OK;
   }
 
+  /* already have this address (or its absence) cached? */
+  err = dns_lookup(hostname, addr);
+  if (err != ERR_ARG) {
+    return err;
+  }
+
   /* queue query with specified callback */
   return dns_enqueue(hostname, found, callback_arg);
 }
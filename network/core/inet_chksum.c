@@ -52,7 +52,7 @@
  * #define LWIP_CHKSUM <your_checksum_routine> 
  *
  * Or you can select from the implementations below by defining
- * LWIP_CHKSUM_ALGORITHM to 1, 2 or 3.
+ * LWIP_CHKSUM_ALGORITHM to 1, 2, 3 or 4(x86 only).
  */
 
 #ifndef LWIP_CHKSUM
@@ -256,6 +256,141 @@ lwip_standard_chksum(void *dataptr, int len)
 }
 #endif
 
+#if (LWIP_CHKSUM_ALGORITHM == 4)
+/**
+ * Sum 32 bytes of data each round by an unrolled add-with-carry chain, the
+ * carry is added back at the end of each round.
+ *
+ * @param sum initial value of the sum
+ * @param pl start of data, should be 4 bytes aligned for best performance
+ * @param blocks number of 32 bytes blocks to be summed, must not be 0
+ * @return 32 bits sum, with all carries added back
+ */
+static u32_t
+lwip_x86_sum32(u32_t sum, const u32_t *pl, int blocks)
+{
+#ifdef __GCC__
+  __asm__ __volatile__(
+    "1:                    \n\t"
+    "addl  0(%1),  %0      \n\t"
+    "adcl  4(%1),  %0      \n\t"
+    "adcl  8(%1),  %0      \n\t"
+    "adcl  12(%1), %0      \n\t"
+    "adcl  16(%1), %0      \n\t"
+    "adcl  20(%1), %0      \n\t"
+    "adcl  24(%1), %0      \n\t"
+    "adcl  28(%1), %0      \n\t"
+    "adcl  $0,     %0      \n\t"
+    "addl  $32,    %1      \n\t"
+    "decl  %2              \n\t"
+    "jnz   1b              \n\t"
+    : "+r"(sum), "+r"(pl), "+r"(blocks)
+    :
+    : "cc", "memory");
+#else
+  __asm{
+    mov eax, sum
+    mov esi, pl
+    mov ecx, blocks
+  __SUM_LOOP:
+    add eax, dword ptr [esi]
+    adc eax, dword ptr [esi + 4]
+    adc eax, dword ptr [esi + 8]
+    adc eax, dword ptr [esi + 12]
+    adc eax, dword ptr [esi + 16]
+    adc eax, dword ptr [esi + 20]
+    adc eax, dword ptr [esi + 24]
+    adc eax, dword ptr [esi + 28]
+    adc eax, 0
+    add esi, 32
+    dec ecx
+    jnz __SUM_LOOP
+    mov sum, eax
+  }
+#endif
+  return sum;
+}
+#endif /* (LWIP_CHKSUM_ALGORITHM == 4) */
+
+#if (LWIP_CHKSUM_ALGORITHM == 4) /* Alternative version #4 */
+/**
+ * x86 optimized checksum routine. Head and tail bytes are treated as
+ * version #3 does, the bulk of data is summed 32 bytes each round by
+ * lwip_x86_sum32, without checking carry in C for each word.
+ *
+ * @arg start of buffer to be checksummed. May be an odd byte address.
+ * @len number of bytes in the buffer to be checksummed.
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+
+static u16_t
+lwip_standard_chksum(void *dataptr, int len)
+{
+  u8_t *pb = (u8_t *)dataptr;
+  u16_t *ps, t = 0;
+  u32_t *pl;
+  u32_t sum = 0, tmp;
+  /* starts at odd byte address? */
+  int odd = ((mem_ptr_t)pb & 1);
+
+  if (odd && len > 0) {
+    ((u8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  ps = (u16_t *)pb;
+
+  if (((mem_ptr_t)ps & 3) && len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+
+  pl = (u32_t *)ps;
+
+  if (len >= 32) {
+    sum = lwip_x86_sum32(sum, pl, len >> 5);
+    pl += (len >> 5) * 8;
+    len &= 31;
+  }
+
+  while (len > 3) {
+    tmp = sum + *pl++;
+    if (tmp < sum) {
+      tmp++;                    /* add back carry */
+    }
+    sum = tmp;
+    len -= 4;
+  }
+
+  /* make room in upper bits */
+  sum = FOLD_U32T(sum);
+
+  ps = (u16_t *)pl;
+
+  /* 16-bit aligned word remaining? */
+  if (len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+
+  /* dangling tail byte remaining? */
+  if (len > 0) {                /* include odd byte */
+    ((u8_t *)&t)[0] = *(u8_t *)ps;
+  }
+
+  sum += t;                     /* add end bytes */
+
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+
+  if (odd) {
+    sum = SWAP_BYTES_IN_WORD(sum);
+  }
+
+  return (u16_t)sum;
+}
+#endif
+
 /* inet_chksum_pseudo:
  *
  * Calculates the pseudo Internet checksum used by TCP and UDP for a pbuf chain.
@@ -316,6 +451,86 @@ inet_chksum_pseudo(struct pbuf *p,
   return (u16_t)~(acc & 0xffffUL);
 }
 
+#if LWIP_CHECKSUM_ON_COPY
+/* inet_chksum_pseudo_input:
+ *
+ * Same as inet_chksum_pseudo, but for received packets only: the sum of the
+ * ip data part may have been generated while the packet was copied from the
+ * NIC (see PBUF_FLAG_RX_CHKSUM), it's used instead of summing the pbuf chain
+ * again. The sum is consumed, so a pbuf sent back later is checksummed fully.
+ *
+ * @param p chain of pbufs over that a checksum should be calculated (ip data part)
+ * @param src source ip address (used for checksum of pseudo header)
+ * @param dst destination ip address (used for checksum of pseudo header)
+ * @param proto ip protocol (used for checksum of pseudo header)
+ * @param proto_len length of the ip data part (used for checksum of pseudo header)
+ * @return checksum (as u16_t) to be saved directly in the protocol header
+ */
+u16_t
+inet_chksum_pseudo_input(struct pbuf *p,
+       ip_addr_t *src, ip_addr_t *dest,
+       u8_t proto, u16_t proto_len)
+{
+  u32_t acc;
+  u32_t addr;
+
+  if (!(p->flags & PBUF_FLAG_RX_CHKSUM) || (p->rx_chksum_len != proto_len)) {
+    p->flags &= ~PBUF_FLAG_RX_CHKSUM;
+    return inet_chksum_pseudo(p, src, dest, proto, proto_len);
+  }
+  p->flags &= ~PBUF_FLAG_RX_CHKSUM;
+
+  acc = p->rx_chksum;
+  addr = ip4_addr_get_u32(src);
+  acc += (addr & 0xffffUL);
+  acc += ((addr >> 16) & 0xffffUL);
+  addr = ip4_addr_get_u32(dest);
+  acc += (addr & 0xffffUL);
+  acc += ((addr >> 16) & 0xffffUL);
+  acc += (u32_t)htons((u16_t)proto);
+  acc += (u32_t)htons(proto_len);
+
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return (u16_t)~(acc & 0xffffUL);
+}
+#endif /* LWIP_CHECKSUM_ON_COPY */
+
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+/* inet_chksum_pseudo_hdr:
+ *
+ * Calculates the sum of the pseudo header only, it's not inverted. It's
+ * saved in the checksum field of a packet whose checksum is left to the
+ * NIC, the NIC adds the sum of the ip data part and inverts the result.
+ *
+ * @param src source ip address
+ * @param dst destination ip address
+ * @param proto ip protocol
+ * @param proto_len length of the ip data part, 0 for TSO packets
+ * @return sum (as u16_t) to be saved directly in the protocol header
+ */
+u16_t
+inet_chksum_pseudo_hdr(ip_addr_t *src, ip_addr_t *dest,
+       u8_t proto, u16_t proto_len)
+{
+  u32_t acc;
+  u32_t addr;
+
+  addr = ip4_addr_get_u32(src);
+  acc = (addr & 0xffffUL);
+  acc += ((addr >> 16) & 0xffffUL);
+  addr = ip4_addr_get_u32(dest);
+  acc += (addr & 0xffffUL);
+  acc += ((addr >> 16) & 0xffffUL);
+  acc += (u32_t)htons((u16_t)proto);
+  acc += (u32_t)htons(proto_len);
+
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return (u16_t)(acc & 0xffffUL);
+}
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+
 /* inet_chksum_pseudo:
  *
  * Calculates the pseudo Internet checksum used by TCP and UDP for a pbuf chain.
@@ -448,3 +663,137 @@ lwip_chksum_copy(void *dst, const void *src, u16_t len)
   return LWIP_CHKSUM(dst, len);
 }
 #endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 1) */
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2) /* Version #2 */
+/**
+ * x86 optimized: data is summed while being copied, 32 bytes each round by
+ * an unrolled chain of load, add-with-carry and store, so it's only read
+ * once. x86 tolerates unaligned access, so neither dst nor src is aligned
+ * first; the sum is the same since it only depends on the byte order.
+ */
+u16_t
+lwip_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  u8_t *pd = (u8_t *)dst;
+  const u8_t *ps = (const u8_t *)src;
+  u32_t sum = 0, tmp;
+  u16_t t = 0;
+  int blocks = len >> 5;
+
+  if (blocks > 0) {
+#ifdef __GCC__
+    __asm__ __volatile__(
+      "1:                    \n\t"
+      "movl  0(%2),  %%eax   \n\t"
+      "movl  4(%2),  %%edx   \n\t"
+      "addl  %%eax,  %0      \n\t"
+      "movl  %%eax,  0(%1)   \n\t"
+      "adcl  %%edx,  %0      \n\t"
+      "movl  %%edx,  4(%1)   \n\t"
+      "movl  8(%2),  %%eax   \n\t"
+      "movl  12(%2), %%edx   \n\t"
+      "adcl  %%eax,  %0      \n\t"
+      "movl  %%eax,  8(%1)   \n\t"
+      "adcl  %%edx,  %0      \n\t"
+      "movl  %%edx,  12(%1)  \n\t"
+      "movl  16(%2), %%eax   \n\t"
+      "movl  20(%2), %%edx   \n\t"
+      "adcl  %%eax,  %0      \n\t"
+      "movl  %%eax,  16(%1)  \n\t"
+      "adcl  %%edx,  %0      \n\t"
+      "movl  %%edx,  20(%1)  \n\t"
+      "movl  24(%2), %%eax   \n\t"
+      "movl  28(%2), %%edx   \n\t"
+      "adcl  %%eax,  %0      \n\t"
+      "movl  %%eax,  24(%1)  \n\t"
+      "adcl  %%edx,  %0      \n\t"
+      "movl  %%edx,  28(%1)  \n\t"
+      "adcl  $0,     %0      \n\t"
+      "addl  $32,    %1      \n\t"
+      "addl  $32,    %2      \n\t"
+      "decl  %3              \n\t"
+      "jnz   1b              \n\t"
+      : "+r"(sum), "+r"(pd), "+r"(ps), "+r"(blocks)
+      :
+      : "eax", "edx", "cc", "memory");
+#else
+    __asm{
+      mov edi, pd
+      mov esi, ps
+      mov ecx, blocks
+      mov ebx, sum
+    __COPY_LOOP:
+      mov eax, dword ptr [esi]
+      mov edx, dword ptr [esi + 4]
+      add ebx, eax
+      mov dword ptr [edi], eax
+      adc ebx, edx
+      mov dword ptr [edi + 4], edx
+      mov eax, dword ptr [esi + 8]
+      mov edx, dword ptr [esi + 12]
+      adc ebx, eax
+      mov dword ptr [edi + 8], eax
+      adc ebx, edx
+      mov dword ptr [edi + 12], edx
+      mov eax, dword ptr [esi + 16]
+      mov edx, dword ptr [esi + 20]
+      adc ebx, eax
+      mov dword ptr [edi + 16], eax
+      adc ebx, edx
+      mov dword ptr [edi + 20], edx
+      mov eax, dword ptr [esi + 24]
+      mov edx, dword ptr [esi + 28]
+      adc ebx, eax
+      mov dword ptr [edi + 24], eax
+      adc ebx, edx
+      mov dword ptr [edi + 28], edx
+      adc ebx, 0
+      add esi, 32
+      add edi, 32
+      dec ecx
+      jnz __COPY_LOOP
+      mov sum, ebx
+      mov pd, edi
+      mov ps, esi
+    }
+#endif
+    len &= 31;
+  }
+
+  while (len > 3) {
+    tmp = *(const u32_t *)ps;
+    *(u32_t *)pd = tmp;
+    sum += tmp;
+    if (sum < tmp) {
+      sum++;                    /* add back carry */
+    }
+    ps += 4;
+    pd += 4;
+    len -= 4;
+  }
+
+  /* make room in upper bits */
+  sum = FOLD_U32T(sum);
+
+  if (len > 1) {
+    t = *(const u16_t *)ps;
+    *(u16_t *)pd = t;
+    sum += t;
+    ps += 2;
+    pd += 2;
+    len -= 2;
+  }
+
+  /* dangling tail byte remaining? */
+  t = 0;
+  if (len > 0) {
+    *pd = *ps;
+    ((u8_t *)&t)[0] = *ps;
+  }
+  sum += t;
+
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+  return (u16_t)sum;
+}
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
@@ -99,9 +99,18 @@
 #if (LWIP_TCP && (MEMP_NUM_TCP_PCB<=0))
   #error "If you want to use TCP, you have to define MEMP_NUM_TCP_PCB>=1 in your lwipopts.h"
 #endif
-#if (LWIP_TCP && (TCP_WND > 0xffff))
+#if (LWIP_TCP && !LWIP_WND_SCALE && (TCP_WND > 0xffff))
   #error "If you want to use TCP, TCP_WND must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
 #endif
+#if (LWIP_TCP && !LWIP_WND_SCALE && (TCP_SND_BUF > 0xffff))
+  #error "TCP_SND_BUF must fit in an u16_t without LWIP_WND_SCALE, reduce it in your lwipopts.h"
+#endif
+#if (LWIP_TCP && LWIP_WND_SCALE && (TCP_RCV_SCALE > 14))
+  #error "TCP_RCV_SCALE must not exceed 14 (RFC 7323)"
+#endif
+#if (LWIP_TCP && LWIP_WND_SCALE && (TCP_WND > (0xffffUL << TCP_RCV_SCALE)))
+  #error "TCP_WND is too large to be announced with TCP_RCV_SCALE, increase TCP_RCV_SCALE in your lwipopts.h"
+#endif
 #if (LWIP_TCP && (TCP_SND_QUEUELEN > 0xffff))
   #error "If you want to use TCP, TCP_SND_QUEUELEN must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
 #endif
@@ -114,6 +123,9 @@
 #if (LWIP_TCP && TCP_LISTEN_BACKLOG && (TCP_DEFAULT_LISTEN_BACKLOG < 0) || (TCP_DEFAULT_LISTEN_BACKLOG > 0xff))
   #error "If you want to use TCP backlog, TCP_DEFAULT_LISTEN_BACKLOG must fit into an u8_t"
 #endif
+#if (LWIP_TCP && TCP_PCB_HASH && (((TCP_CONN_HASH_SIZE & (TCP_CONN_HASH_SIZE - 1)) != 0) || ((TCP_LISTEN_HASH_SIZE & (TCP_LISTEN_HASH_SIZE - 1)) != 0) || (TCP_CONN_HASH_SIZE > 0x10000)))
+  #error "TCP_CONN_HASH_SIZE and TCP_LISTEN_HASH_SIZE must be powers of 2, TCP_CONN_HASH_SIZE must not be greater than 0x10000"
+#endif
 #if (LWIP_IGMP && (MEMP_NUM_IGMP_GROUP<=1))
   #error "If you want to use IGMP, you have to define MEMP_NUM_IGMP_GROUP>1 in your lwipopts.h"
 #endif
@@ -169,6 +181,12 @@
 #if (DNS_LOCAL_HOSTLIST && !DNS_LOCAL_HOSTLIST_IS_DYNAMIC && !(defined(DNS_LOCAL_HOSTLIST_INIT)))
   #error "you have to define define DNS_LOCAL_HOSTLIST_INIT {{'host1', 0x123}, {'host2', 0x234}} to initialize DNS_LOCAL_HOSTLIST"
 #endif
+#if LWIP_DNS && ((DNS_CACHE_HASH_SIZE & (DNS_CACHE_HASH_SIZE - 1)) != 0)
+  #error "DNS_CACHE_HASH_SIZE must be a power of 2"
+#endif
+#if LWIP_DNS && ((DNS_TABLE_SIZE > 255) || (DNS_MAX_ADDRS_PER_NAME < 1) || (DNS_MAX_ADDRS_PER_NAME > 255) || (DNS_CACHE_SIZE < 1))
+  #error "DNS_TABLE_SIZE and DNS_MAX_ADDRS_PER_NAME must fit in u8_t, DNS_MAX_ADDRS_PER_NAME and DNS_CACHE_SIZE must be at least 1"
+#endif
 #if PPP_SUPPORT && !PPPOS_SUPPORT & !PPPOE_SUPPORT
   #error "PPP_SUPPORT needs either PPPOS_SUPPORT or PPPOE_SUPPORT turned on"
 #endif
@@ -181,12 +199,18 @@
 #if LWIP_TCPIP_CORE_LOCKING_INPUT && !LWIP_TCPIP_CORE_LOCKING
   #error "When using LWIP_TCPIP_CORE_LOCKING_INPUT, LWIP_TCPIP_CORE_LOCKING must be enabled, too"
 #endif
+#if LWIP_NETCONN_UDP_RING && ((UDP_RECV_RING_SIZE & (UDP_RECV_RING_SIZE - 1)) || (UDP_RECV_RING_SIZE > 0x8000))
+  #error "UDP_RECV_RING_SIZE must be a power of 2 not greater than 0x8000"
+#endif
 #if LWIP_TCP && LWIP_NETIF_TX_SINGLE_PBUF && !TCP_OVERSIZE
   #error "LWIP_NETIF_TX_SINGLE_PBUF needs TCP_OVERSIZE enabled to create single-pbuf TCP packets"
 #endif
 #if IP_FRAG && IP_FRAG_USES_STATIC_BUF && LWIP_NETIF_TX_SINGLE_PBUF
   #error "LWIP_NETIF_TX_SINGLE_PBUF does not work with IP_FRAG_USES_STATIC_BUF==1 as that creates pbuf queues"
 #endif
+#if LWIP_TCP_TSO && (!LWIP_CHECKSUM_CTRL_PER_NETIF || !LWIP_SUPPORT_CUSTOM_PBUF)
+  #error "LWIP_TCP_TSO needs LWIP_CHECKSUM_CTRL_PER_NETIF and custom pbufs (IP_FRAG with LWIP_NETIF_TX_SINGLE_PBUF==0)"
+#endif
 
 
 /* Compile-time checks for deprecated options.
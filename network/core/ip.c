@@ -293,7 +293,8 @@ ip_input(struct pbuf *p, struct netif *inp)
 
   /* verify checksum */
 #if CHECKSUM_CHECK_IP
-  if (inet_chksum(iphdr, iphdr_hlen) != 0) {
+  if (((p->flags & PBUF_FLAG_RX_CSUM_OK) == 0) &&
+      (inet_chksum(iphdr, iphdr_hlen) != 0)) {
 
     LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
       ("Checksum (0x%"X16_F") failed, IP packet dropped.\n", inet_chksum(iphdr, iphdr_hlen)));
@@ -444,6 +445,8 @@ ip_input(struct pbuf *p, struct netif *inp)
     if (p == NULL) {
       return ERR_OK;
     }
+    /* the NIC did not check the transport data of the whole packet */
+    p->flags &= ~PBUF_FLAG_RX_CSUM_OK;
     iphdr = (struct ip_hdr *)p->payload;
 #else /* IP_REASSEMBLY == 0, no packet fragment reassembly code present */
     pbuf_free(p);
@@ -717,8 +720,13 @@ err_t ip_output_if_opt(struct pbuf *p, ip_addr_t *src, ip_addr_t *dest,
 #endif /* LWIP_IGMP */
 #endif /* ENABLE_LOOPBACK */
 #if IP_FRAG
-  /* don't fragment if interface has mtu set to 0 [loopif] */
+  /* don't fragment if interface has mtu set to 0 [loopif],
+     or the packet is to be segmented by the NIC */
+#if LWIP_TCP_TSO
+  if (netif->mtu && (p->tot_len > netif->mtu) && !(p->flags & PBUF_FLAG_TSO)) {
+#else /* LWIP_TCP_TSO */
   if (netif->mtu && (p->tot_len > netif->mtu)) {
+#endif /* LWIP_TCP_TSO */
     return ip_frag(p, netif, dest);
   }
 #endif /* IP_FRAG */
@@ -785,7 +793,7 @@ ip_output(struct pbuf *p, ip_addr_t *src, ip_addr_t *dest,
  */
 err_t
 ip_output_hinted(struct pbuf *p, ip_addr_t *src, ip_addr_t *dest,
-          u8_t ttl, u8_t tos, u8_t proto, u8_t *addr_hint)
+          u8_t ttl, u8_t tos, u8_t proto, u16_t *addr_hint)
 {
   struct netif *netif;
   err_t err;
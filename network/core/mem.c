@@ -177,8 +177,13 @@ struct mem {
  * If so, make sure the memory at that location is big enough (see below on
  * how that space is calculated). */
 #ifndef LWIP_RAM_HEAP_POINTER
+#ifdef LWIP_POOL_MEMORY_ALLOC
+/** the heap, allocated by LWIP_POOL_MEMORY_ALLOC in mem_init */
+static u8_t *ram_heap;
+#else /* LWIP_POOL_MEMORY_ALLOC */
 /** the heap. we need one struct mem at the end and some room for alignment */
 u8_t ram_heap[MEM_SIZE_ALIGNED + (2*SIZEOF_STRUCT_MEM) + MEM_ALIGNMENT];
+#endif /* LWIP_POOL_MEMORY_ALLOC */
 #define LWIP_RAM_HEAP_POINTER ram_heap
 #endif /* LWIP_RAM_HEAP_POINTER */
 
@@ -275,6 +280,10 @@ mem_init(void)
   LWIP_ASSERT("Sanity check alignment",
     (SIZEOF_STRUCT_MEM & (MEM_ALIGNMENT-1)) == 0);
 
+#ifdef LWIP_POOL_MEMORY_ALLOC
+  ram_heap = (u8_t *)LWIP_POOL_MEMORY_ALLOC(MEM_SIZE_ALIGNED + (2*SIZEOF_STRUCT_MEM) + MEM_ALIGNMENT);
+  LWIP_ASSERT("failed to allocate ram heap", ram_heap != NULL);
+#endif /* LWIP_POOL_MEMORY_ALLOC */
   /* align the heap */
   ram = (u8_t *)LWIP_MEM_ALIGN(LWIP_RAM_HEAP_POINTER);
   /* initialize the start of the heap */
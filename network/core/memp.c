@@ -164,6 +164,17 @@ static u8_t *const memp_bases[] = {
 #include "lwip/memp_std.h"
 };
 
+#elif defined(LWIP_POOL_MEMORY_ALLOC) /* MEMP_SEPARATE_POOLS */
+
+/** Size of memory used by the pools (all pools in one big block). */
+static const u32_t memp_memory_size = MEM_ALIGNMENT - 1
+#define LWIP_MEMPOOL(name,num,size,desc) + ( (num) * (MEMP_SIZE + MEMP_ALIGN_SIZE(size) ) )
+#include "lwip/memp_std.h"
+;
+
+/** The memory used by the pools, allocated by LWIP_POOL_MEMORY_ALLOC in memp_init. */
+static u8_t *memp_memory;
+
 #else /* MEMP_SEPARATE_POOLS */
 
 /** This is the actual memory used by the pools (all pools in one big block). */
@@ -347,6 +358,10 @@ memp_init(void)
   }
 
 #if !MEMP_SEPARATE_POOLS
+#ifdef LWIP_POOL_MEMORY_ALLOC
+  memp_memory = (u8_t *)LWIP_POOL_MEMORY_ALLOC(memp_memory_size);
+  LWIP_ASSERT("failed to allocate memp memory", memp_memory != NULL);
+#endif /* LWIP_POOL_MEMORY_ALLOC */
   memp = (struct memp *)LWIP_MEM_ALIGN(memp_memory);
 #endif /* !MEMP_SEPARATE_POOLS */
   /* for every pool: */
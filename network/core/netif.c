@@ -74,6 +74,9 @@
 
 struct netif *netif_list;
 struct netif *netif_default;
+/** Bumped whenever the result of ip_route() may change, so routes cached
+    by the socket layer can be validated cheaply. */
+u32_t netif_route_gen;
 
 #if LWIP_HAVE_LOOPIF
 static struct netif loop_netif;
@@ -175,6 +178,14 @@ netif_add(struct netif *netif, ip_addr_t *ipaddr, ip_addr_t *netmask,
 #if LWIP_NETIF_HWADDRHINT
   netif->addr_hint = NULL;
 #endif /* LWIP_NETIF_HWADDRHINT*/
+#if LWIP_ARP
+  netif->arp_hint = 0;
+#endif /* LWIP_ARP */
+  NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_ENABLE_ALL);
+#if LWIP_TCP_TSO
+  netif->tso_max = 0;
+  netif->tso_max_pbufs = 0;
+#endif /* LWIP_TCP_TSO */
 #if ENABLE_LOOPBACK && LWIP_LOOPBACK_MAX_PBUFS
   netif->loop_cnt_current = 0;
 #endif /* ENABLE_LOOPBACK && LWIP_LOOPBACK_MAX_PBUFS */
@@ -189,6 +200,7 @@ netif_add(struct netif *netif, ip_addr_t *ipaddr, ip_addr_t *netmask,
   /* add this netif to the list */
   netif->next = netif_list;
   netif_list = netif;
+  netif_route_gen++;
   snmp_inc_iflist();
 
 #if LWIP_IGMP
@@ -252,6 +264,13 @@ netif_remove(struct netif *netif)
 
   snmp_delete_ipaddridx_tree(netif);
 
+#if LWIP_ARP
+  /* drop the addresses resolved on it */
+  if (netif->flags & NETIF_FLAG_ETHARP) {
+    etharp_cleanup_netif(netif);
+  }
+#endif /* LWIP_ARP */
+
   /*  is it the first netif? */
   if (netif_list == netif) {
     netif_list = netif->next;
@@ -267,6 +286,7 @@ netif_remove(struct netif *netif)
     if (tmpNetif == NULL)
       return; /*  we didn't find any netif today */
   }
+  netif_route_gen++;
   snmp_dec_iflist();
   /* this netif is default? */
   if (netif_default == netif) {
@@ -361,6 +381,7 @@ netif_set_ipaddr(struct netif *netif, ip_addr_t *ipaddr)
   snmp_delete_iprteidx_tree(0,netif);
   /* set new IP address to netif */
   ip_addr_set(&(netif->ip_addr), ipaddr);
+  netif_route_gen++;
   snmp_insert_ipaddridx_tree(netif);
   snmp_insert_iprteidx_tree(0,netif);
 
@@ -407,6 +428,7 @@ netif_set_netmask(struct netif *netif, ip_addr_t *netmask)
   snmp_delete_iprteidx_tree(0, netif);
   /* set new netmask to netif */
   ip_addr_set(&(netif->netmask), netmask);
+  netif_route_gen++;
   snmp_insert_iprteidx_tree(0, netif);
   LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("netif: netmask of interface %c%c set to %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
     netif->name[0], netif->name[1],
@@ -433,6 +455,7 @@ netif_set_default(struct netif *netif)
     snmp_insert_iprteidx_tree(1, netif);
   }
   netif_default = netif;
+  netif_route_gen++;
   LWIP_DEBUGF(NETIF_DEBUG, ("netif: setting default interface %c%c\n",
            netif ? netif->name[0] : '\'', netif ? netif->name[1] : '\''));
 }
@@ -450,6 +473,7 @@ void netif_set_up(struct netif *netif)
 {
   if (!(netif->flags & NETIF_FLAG_UP)) {
     netif->flags |= NETIF_FLAG_UP;
+    netif_route_gen++;
     
 #if LWIP_SNMP
     snmp_get_sysuptime(&netif->ts);
@@ -487,6 +511,7 @@ void netif_set_down(struct netif *netif)
 {
   if (netif->flags & NETIF_FLAG_UP) {
     netif->flags &= ~NETIF_FLAG_UP;
+    netif_route_gen++;
 #if LWIP_SNMP
     snmp_get_sysuptime(&netif->ts);
 #endif
@@ -636,6 +661,10 @@ netif_loop_output(struct netif *netif, struct pbuf *p,
     snmp_inc_ifoutdiscards(stats_if);
     return err;
   }
+  /* checksums left to the NIC are never filled in, don't check them */
+  if (p->flags & PBUF_FLAG_TX_CSUM) {
+    r->flags |= PBUF_FLAG_RX_CSUM_OK;
+  }
 
   /* Put the packet on a linked list which gets emptied through calling
      netif_poll(). */
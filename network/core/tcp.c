@@ -97,6 +97,19 @@ struct tcp_pcb ** const tcp_pcb_lists[] = {&tcp_listen_pcbs.pcbs, &tcp_bound_pcb
 /** Only used for temporary storage. */
 struct tcp_pcb *tcp_tmp_pcb;
 
+#if TCP_PCB_HASH
+/** Active and TIME-WAIT PCBs hashed on the 4-tuple */
+struct tcp_pcb *tcp_conn_hash_tbl[TCP_CONN_HASH_SIZE];
+/** LISTEN PCBs hashed on the local port */
+struct tcp_pcb_listen *tcp_listen_hash_tbl[TCP_LISTEN_HASH_SIZE];
+/** PCB the last incoming segment was demultiplexed to */
+struct tcp_pcb *tcp_last_hit;
+#endif /* TCP_PCB_HASH */
+#if TCP_PCB_INDEX
+/** Number of PCBs in tcp_tw_pcbs */
+u16_t tcp_tw_count;
+#endif /* TCP_PCB_INDEX */
+
 /** Timer counter to handle calling slow-timer from tcp_tmr() */ 
 static u8_t tcp_timer;
 static u16_t tcp_new_port(void);
@@ -140,7 +153,8 @@ tcp_close_shutdown(struct tcp_pcb *pcb, u8_t rst_on_unacked_data)
   err_t err;
 
   if (rst_on_unacked_data && (pcb->state != LISTEN)) {
-    if ((pcb->refused_data != NULL) || (pcb->rcv_wnd != TCP_WND)) {
+    if ((pcb->refused_data != NULL) ||
+        ((pcb->state > SYN_SENT) && (pcb->rcv_wnd != pcb->rcv_wnd_max))) {
       /* Not all data received by application, send RST to tell the remote
          side about this. */
       LWIP_ASSERT("pcb->flags & TF_RXCLOSED", pcb->flags & TF_RXCLOSED);
@@ -518,6 +532,8 @@ tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog)
   lpcb->so_options |= SOF_ACCEPTCONN;
   lpcb->ttl = pcb->ttl;
   lpcb->tos = pcb->tos;
+  lpcb->rcv_wnd_max = pcb->rcv_wnd_max;
+  lpcb->snd_buf_max = pcb->snd_buf_max;
   ip_addr_copy(lpcb->local_ip, pcb->local_ip);
   if (pcb->local_port != 0) {
     TCP_RMV(&tcp_bound_pcbs, pcb);
@@ -544,7 +560,7 @@ u32_t tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
 {
   u32_t new_right_edge = pcb->rcv_nxt + pcb->rcv_wnd;
 
-  if (TCP_SEQ_GEQ(new_right_edge, pcb->rcv_ann_right_edge + LWIP_MIN((TCP_WND / 2), pcb->mss))) {
+  if (TCP_SEQ_GEQ(new_right_edge, pcb->rcv_ann_right_edge + LWIP_MIN((pcb->rcv_wnd_max / 2), pcb->mss))) {
     /* we can advertise more window */
     pcb->rcv_ann_wnd = pcb->rcv_wnd;
     return new_right_edge - pcb->rcv_ann_right_edge;
@@ -556,8 +572,10 @@ u32_t tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
     } else {
       /* keep the right edge of window constant */
       u32_t new_rcv_ann_wnd = pcb->rcv_ann_right_edge - pcb->rcv_nxt;
+#if !LWIP_WND_SCALE
       LWIP_ASSERT("new_rcv_ann_wnd <= 0xffff", new_rcv_ann_wnd <= 0xffff);
-      pcb->rcv_ann_wnd = (u16_t)new_rcv_ann_wnd;
+#endif /* !LWIP_WND_SCALE */
+      pcb->rcv_ann_wnd = (tcpwnd_size_t)new_rcv_ann_wnd;
     }
     return 0;
   }
@@ -574,29 +592,30 @@ u32_t tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
 void
 tcp_recved(struct tcp_pcb *pcb, u16_t len)
 {
-  int wnd_inflation;
-
-  LWIP_ASSERT("tcp_recved: len would wrap rcv_wnd\n",
-              len <= 0xffff - pcb->rcv_wnd );
+  u32_t wnd_inflation;
 
-  pcb->rcv_wnd += len;
-  if (pcb->rcv_wnd > TCP_WND) {
-    pcb->rcv_wnd = TCP_WND;
+  /* rcv_wnd may be shrunk below what the application still has to read
+     (tcp_setrcvbuf), so clamp instead of asserting */
+  if ((tcpwnd_size_t)(pcb->rcv_wnd + len) < pcb->rcv_wnd ||
+      (tcpwnd_size_t)(pcb->rcv_wnd + len) > pcb->rcv_wnd_max) {
+    pcb->rcv_wnd = pcb->rcv_wnd_max;
+  } else {
+    pcb->rcv_wnd += len;
   }
 
   wnd_inflation = tcp_update_rcv_ann_wnd(pcb);
 
-  /* If the change in the right edge of window is significant (default
-   * watermark is TCP_WND/4), then send an explicit update now.
+  /* If the change in the right edge of window is significant (a quarter
+   * of the receive buffer), then send an explicit update now.
    * Otherwise wait for a packet to be sent in the normal course of
    * events (or more window to be available later) */
-  if (wnd_inflation >= TCP_WND_UPDATE_THRESHOLD) {
+  if (wnd_inflation >= LWIP_MIN(TCP_WND_UPDATE_THRESHOLD, pcb->rcv_wnd_max / 4)) {
     tcp_ack_now(pcb);
     tcp_output(pcb);
   }
 
-  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: recveived %"U16_F" bytes, wnd %"U16_F" (%"U16_F").\n",
-         len, pcb->rcv_wnd, TCP_WND - pcb->rcv_wnd));
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: recveived %"U16_F" bytes, wnd %"TCPWNDSIZE_F" (%"TCPWNDSIZE_F").\n",
+         len, pcb->rcv_wnd, pcb->rcv_wnd_max - pcb->rcv_wnd));
 }
 
 /**
@@ -705,10 +724,12 @@ tcp_connect(struct tcp_pcb *pcb, ip_addr_t *ipaddr, u16_t port,
   pcb->snd_nxt = iss;
   pcb->lastack = iss - 1;
   pcb->snd_lbb = iss - 1;
-  pcb->rcv_wnd = TCP_WND;
-  pcb->rcv_ann_wnd = TCP_WND;
+  /* Until the peer agrees to window scaling, the window must fit the
+     16 bit header field. */
+  pcb->rcv_wnd = TCPWND_MIN16(pcb->rcv_wnd_max);
+  pcb->rcv_ann_wnd = pcb->rcv_wnd;
   pcb->rcv_ann_right_edge = pcb->rcv_nxt;
-  pcb->snd_wnd = TCP_WND;
+  pcb->snd_wnd = TCPWND_MIN16(TCP_WND);
   /* As initial send MSS, we use TCP_MSS but limit it to 536.
      The send MSS is updated when an MSS option is received. */
   pcb->mss = (TCP_MSS > 536) ? 536 : TCP_MSS;
@@ -716,7 +737,7 @@ tcp_connect(struct tcp_pcb *pcb, ip_addr_t *ipaddr, u16_t port,
   pcb->mss = tcp_eff_send_mss(pcb->mss, ipaddr);
 #endif /* TCP_CALCULATE_EFF_SEND_MSS */
   pcb->cwnd = 1;
-  pcb->ssthresh = pcb->mss * 10;
+  pcb->ssthresh = pcb->snd_buf_max;
 #if LWIP_CALLBACK_API
   pcb->connected = connected;
 #else /* LWIP_CALLBACK_API */  
@@ -750,7 +771,7 @@ void
 tcp_slowtmr(void)
 {
   struct tcp_pcb *pcb, *prev;
-  u16_t eff_wnd;
+  tcpwnd_size_t eff_wnd;
   u8_t pcb_remove;      /* flag if a PCB should be removed */
   u8_t pcb_reset;       /* flag if a RST should be sent when removing */
   err_t err;
@@ -820,8 +841,8 @@ tcp_slowtmr(void)
             pcb->ssthresh = (pcb->mss << 1);
           }
           pcb->cwnd = pcb->mss;
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"U16_F
-                                       " ssthresh %"U16_F"\n",
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"TCPWNDSIZE_F
+                                       " ssthresh %"TCPWNDSIZE_F"\n",
                                        pcb->cwnd, pcb->ssthresh));
  
           /* The following needs to be called AFTER cwnd is set to one
@@ -916,6 +937,7 @@ tcp_slowtmr(void)
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_active_pcbs", tcp_active_pcbs == pcb);
         tcp_active_pcbs = pcb->next;
       }
+      TCP_INDEX_REMOVE(&tcp_active_pcbs, pcb);
 
       TCP_EVENT_ERR(pcb->errf, pcb->callback_arg, ERR_ABRT);
       if (pcb_reset) {
@@ -973,6 +995,7 @@ tcp_slowtmr(void)
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_tw_pcbs", tcp_tw_pcbs == pcb);
         tcp_tw_pcbs = pcb->next;
       }
+      TCP_INDEX_REMOVE(&tcp_tw_pcbs, pcb);
       pcb2 = pcb;
       pcb = pcb->next;
       memp_free(MEMP_TCP_PCB, pcb2);
@@ -1068,6 +1091,88 @@ tcp_setprio(struct tcp_pcb *pcb, u8_t prio)
   pcb->prio = prio;
 }
 
+/**
+ * Sets the send buffer size of a pcb (SO_SNDBUF).
+ * Data already queued is kept, the buffer does not shrink below it.
+ *
+ * @param pcb the tcp_pcb (may be a listen pcb) to change
+ * @param size new send buffer size in bytes
+ */
+void
+tcp_setsndbuf(struct tcp_pcb *pcb, u32_t size)
+{
+  tcpwnd_size_t used;
+
+  if (size > (tcpwnd_size_t)~0) {
+    size = (tcpwnd_size_t)~0;
+  }
+  if (pcb->state == LISTEN) {
+    pcb->snd_buf_max = (tcpwnd_size_t)size;
+    return;
+  }
+  used = pcb->snd_buf_max - pcb->snd_buf;
+  if (size < used) {
+    size = used;
+  }
+  pcb->snd_buf = (tcpwnd_size_t)(size - used);
+  pcb->snd_buf_max = (tcpwnd_size_t)size;
+}
+
+/**
+ * Sets the receive buffer size of a pcb (SO_RCVBUF), which is the largest
+ * window announced to the peer.
+ * Once the SYN has been exchanged, the size is limited by the window
+ * scaling the peer agreed to.
+ *
+ * @param pcb the tcp_pcb (may be a listen pcb) to change
+ * @param size new receive buffer size in bytes
+ */
+void
+tcp_setrcvbuf(struct tcp_pcb *pcb, u32_t size)
+{
+  u32_t limit;
+
+#if LWIP_WND_SCALE
+  limit = (u32_t)0xffff << TCP_RCV_SCALE;
+  if ((pcb->state > SYN_SENT) && !(pcb->flags & TF_WND_SCALE)) {
+    limit = 0xffff;
+  }
+#else /* LWIP_WND_SCALE */
+  limit = 0xffff;
+#endif /* LWIP_WND_SCALE */
+  if (size > limit) {
+    size = limit;
+  }
+  if (pcb->state == LISTEN) {
+    /* listen pcbs only carry the common members */
+    pcb->rcv_wnd_max = size;
+    return;
+  }
+  if (pcb->state <= SYN_SENT) {
+    /* Nothing received yet, and whether the peer scales windows is not
+       known before its SYN arrives */
+    pcb->rcv_wnd_max = size;
+    pcb->rcv_wnd = TCPWND_MIN16(size);
+    pcb->rcv_ann_wnd = pcb->rcv_wnd;
+    return;
+  }
+
+  /* Move the available window by the same amount; data not yet read
+     stays accounted for */
+  if (size >= pcb->rcv_wnd_max) {
+    pcb->rcv_wnd += size - pcb->rcv_wnd_max;
+  } else if (pcb->rcv_wnd > pcb->rcv_wnd_max - size) {
+    pcb->rcv_wnd -= pcb->rcv_wnd_max - size;
+  } else {
+    pcb->rcv_wnd = 0;
+  }
+  pcb->rcv_wnd_max = size;
+  if (tcp_update_rcv_ann_wnd(pcb) >= pcb->rcv_wnd_max / 4) {
+    tcp_ack_now(pcb);
+    tcp_output(pcb);
+  }
+}
+
 #if TCP_QUEUE_OOSEQ
 /**
  * Returns a copy of the given TCP segment.
@@ -1209,9 +1314,11 @@ tcp_alloc(u8_t prio)
     memset(pcb, 0, sizeof(struct tcp_pcb));
     pcb->prio = prio;
     pcb->snd_buf = TCP_SND_BUF;
+    pcb->snd_buf_max = TCP_SND_BUF;
     pcb->snd_queuelen = 0;
-    pcb->rcv_wnd = TCP_WND;
-    pcb->rcv_ann_wnd = TCP_WND;
+    pcb->rcv_wnd_max = TCP_WND;
+    pcb->rcv_wnd = TCPWND_MIN16(TCP_WND);
+    pcb->rcv_ann_wnd = pcb->rcv_wnd;
     pcb->tos = 0;
     pcb->ttl = TCP_TTL;
     /* As initial send MSS, we use TCP_MSS but limit it to 536.
@@ -1455,6 +1562,121 @@ tcp_pcb_remove(struct tcp_pcb **pcblist, struct tcp_pcb *pcb)
   LWIP_ASSERT("tcp_pcb_remove: tcp_pcbs_sane()", tcp_pcbs_sane());
 }
 
+#if TCP_PCB_HASH
+/**
+ * Hashes the 4-tuple of a connection to a bucket of tcp_conn_hash_tbl.
+ * Ports are in host byte order.
+ *
+ * @return index of the bucket
+ */
+u16_t
+tcp_conn_hash(ip_addr_t *local_ip, u16_t local_port,
+              ip_addr_t *remote_ip, u16_t remote_port)
+{
+  u32_t h;
+
+  h = ip4_addr_get_u32(remote_ip) ^ ip4_addr_get_u32(local_ip);
+  h = (h * 0x9E3779B1UL) ^ (((u32_t)remote_port << 16) | local_port);
+  h *= 0x9E3779B1UL;
+  return (u16_t)((h >> 16) & (TCP_CONN_HASH_SIZE - 1));
+}
+#endif /* TCP_PCB_HASH */
+
+#if TCP_PCB_INDEX
+/**
+ * Called by TCP_REG after a PCB has been put on a list: enters it into
+ * the hash table of that list and enforces TCP_MAX_TIME_WAIT.
+ *
+ * @param pcbs the PCB list pcb has been put on
+ * @param pcb the PCB just registered
+ */
+void
+tcp_pcb_index_add(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+#if TCP_PCB_HASH
+  u16_t idx;
+
+  if (pcbs == &tcp_listen_pcbs.pcbs) {
+    idx = TCP_LISTEN_HASH(pcb->local_port);
+    ((struct tcp_pcb_listen *)pcb)->hash_next = tcp_listen_hash_tbl[idx];
+    tcp_listen_hash_tbl[idx] = (struct tcp_pcb_listen *)pcb;
+  } else if ((pcbs == &tcp_active_pcbs) || (pcbs == &tcp_tw_pcbs)) {
+    idx = tcp_conn_hash(&pcb->local_ip, pcb->local_port,
+                        &pcb->remote_ip, pcb->remote_port);
+    pcb->hash_next = tcp_conn_hash_tbl[idx];
+    tcp_conn_hash_tbl[idx] = pcb;
+  }
+#endif /* TCP_PCB_HASH */
+
+  if (pcbs == &tcp_tw_pcbs) {
+    tcp_tw_count++;
+#if TCP_MAX_TIME_WAIT
+    if (tcp_tw_count > TCP_MAX_TIME_WAIT) {
+      /* Free the oldest TIME-WAIT pcb other than the one just registered,
+         the caller may still be using that one. */
+      struct tcp_pcb *twpcb, *inactive = NULL;
+      u32_t inactivity = 0;
+
+      for (twpcb = tcp_tw_pcbs; twpcb != NULL; twpcb = twpcb->next) {
+        if ((twpcb != pcb) && ((u32_t)(tcp_ticks - twpcb->tmr) >= inactivity)) {
+          inactivity = tcp_ticks - twpcb->tmr;
+          inactive = twpcb;
+        }
+      }
+      if (inactive != NULL) {
+        LWIP_DEBUGF(TCP_DEBUG, ("tcp_pcb_index_add: TIME-WAIT limit reached, killing %p (%"U32_F")\n",
+               (void *)inactive, inactivity));
+        tcp_abort(inactive);
+      }
+    }
+#endif /* TCP_MAX_TIME_WAIT */
+  }
+}
+
+/**
+ * Called by TCP_RMV after a PCB has been taken off a list: removes it
+ * from the hash table of that list.
+ *
+ * @param pcbs the PCB list pcb has been taken off
+ * @param pcb the PCB just removed
+ */
+void
+tcp_pcb_index_remove(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+#if TCP_PCB_HASH
+  struct tcp_pcb **pp;
+  struct tcp_pcb_listen **lpp;
+
+  if (tcp_last_hit == pcb) {
+    tcp_last_hit = NULL;
+  }
+  if (pcbs == &tcp_listen_pcbs.pcbs) {
+    lpp = &tcp_listen_hash_tbl[TCP_LISTEN_HASH(pcb->local_port)];
+    for (; *lpp != NULL; lpp = &(*lpp)->hash_next) {
+      if (*lpp == (struct tcp_pcb_listen *)pcb) {
+        *lpp = (*lpp)->hash_next;
+        break;
+      }
+    }
+  } else if ((pcbs == &tcp_active_pcbs) || (pcbs == &tcp_tw_pcbs)) {
+    pp = &tcp_conn_hash_tbl[tcp_conn_hash(&pcb->local_ip, pcb->local_port,
+                                          &pcb->remote_ip, pcb->remote_port)];
+    for (; *pp != NULL; pp = &(*pp)->hash_next) {
+      if (*pp == pcb) {
+        *pp = pcb->hash_next;
+        break;
+      }
+    }
+  }
+  pcb->hash_next = NULL;
+#endif /* TCP_PCB_HASH */
+
+  if ((pcbs == &tcp_tw_pcbs) && (tcp_tw_count > 0)) {
+    tcp_tw_count--;
+  }
+}
+#endif /* TCP_PCB_INDEX */
+
 /**
  * Calculates a new initial sequence number for new connections.
  *
@@ -75,10 +75,21 @@ struct tcp_pcb *tcp_input_pcb;
 static err_t tcp_process(struct tcp_pcb *pcb);
 static void tcp_receive(struct tcp_pcb *pcb);
 static void tcp_parseopt(struct tcp_pcb *pcb);
+static void tcp_syn_wnd_scale(struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK
+static void tcp_parse_sack(struct tcp_pcb *pcb, u8_t *blocks, u8_t num);
+#endif /* LWIP_TCP_SACK */
 
 static err_t tcp_listen_input(struct tcp_pcb_listen *pcb);
 static err_t tcp_timewait_input(struct tcp_pcb *pcb);
 
+/** Does the segment in tcphdr/iphdr belong to the connection of pcb? */
+#define TCP_PCB_MATCHES_SEG(pcb) \
+  (((pcb)->remote_port == tcphdr->src) && \
+   ((pcb)->local_port == tcphdr->dest) && \
+   ip_addr_cmp(&((pcb)->remote_ip), &current_iphdr_src) && \
+   ip_addr_cmp(&((pcb)->local_ip), &current_iphdr_dest))
+
 /**
  * The initial input processing of TCP. It verifies the TCP header, demultiplexes
  * the segment between the PCBs and passes it on to tcp_process(), which implements
@@ -91,12 +102,17 @@ static err_t tcp_timewait_input(struct tcp_pcb *pcb);
 void
 tcp_input(struct pbuf *p, struct netif *inp)
 {
-  struct tcp_pcb *pcb, *prev;
+  struct tcp_pcb *pcb, *twpcb;
   struct tcp_pcb_listen *lpcb;
-#if SO_REUSE
+#if !TCP_PCB_HASH
+  struct tcp_pcb *prev;
+#endif /* !TCP_PCB_HASH */
+#if !TCP_PCB_HASH && SO_REUSE
   struct tcp_pcb *lpcb_prev = NULL;
+#endif /* !TCP_PCB_HASH && SO_REUSE */
+#if TCP_PCB_HASH || SO_REUSE
   struct tcp_pcb_listen *lpcb_any = NULL;
-#endif /* SO_REUSE */
+#endif /* TCP_PCB_HASH || SO_REUSE */
   u8_t hdrlen;
   err_t err;
 
@@ -134,9 +150,10 @@ tcp_input(struct pbuf *p, struct netif *inp)
   }
 
 #if CHECKSUM_CHECK_TCP
-  /* Verify TCP checksum. */
-  if (inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
-      IP_PROTO_TCP, p->tot_len) != 0) {
+  /* Verify TCP checksum, unless the NIC did it. */
+  if (((p->flags & PBUF_FLAG_RX_CSUM_OK) == 0) &&
+      (inet_chksum_pseudo_input(p, ip_current_src_addr(), ip_current_dest_addr(),
+      IP_PROTO_TCP, p->tot_len) != 0)) {
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packet discarded due to failing checksum 0x%04"X16_F"\n",
         inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
       IP_PROTO_TCP, p->tot_len)));
@@ -175,18 +192,39 @@ tcp_input(struct pbuf *p, struct netif *inp)
   tcplen = p->tot_len + ((flags & (TCP_FIN | TCP_SYN)) ? 1 : 0);
 
   /* Demultiplex an incoming segment. First, we check if it is destined
-     for an active connection. */
+     for an active connection or one in TIME-WAIT. */
+  twpcb = NULL;
+#if TCP_PCB_HASH
+  /* Segments of a connection mostly arrive back to back, so try the pcb
+     the last one went to before hashing. */
+  pcb = tcp_last_hit;
+  if ((pcb == NULL) || !TCP_PCB_MATCHES_SEG(pcb)) {
+    pcb = tcp_conn_hash_tbl[tcp_conn_hash(&current_iphdr_dest, tcphdr->dest,
+                                          &current_iphdr_src, tcphdr->src)];
+    for(; pcb != NULL; pcb = pcb->hash_next) {
+      LWIP_ASSERT("tcp_input: hashed pcb->state != CLOSED", pcb->state != CLOSED);
+      LWIP_ASSERT("tcp_input: hashed pcb->state != LISTEN", pcb->state != LISTEN);
+      if (TCP_PCB_MATCHES_SEG(pcb)) {
+        break;
+      }
+    }
+  }
+  if (pcb != NULL) {
+    if (pcb->state == TIME_WAIT) {
+      twpcb = pcb;
+      pcb = NULL;
+    } else {
+      tcp_last_hit = pcb;
+    }
+  }
+#else /* TCP_PCB_HASH */
   prev = NULL;
 
-  
   for(pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
     LWIP_ASSERT("tcp_input: active pcb->state != CLOSED", pcb->state != CLOSED);
     LWIP_ASSERT("tcp_input: active pcb->state != TIME-WAIT", pcb->state != TIME_WAIT);
     LWIP_ASSERT("tcp_input: active pcb->state != LISTEN", pcb->state != LISTEN);
-    if (pcb->remote_port == tcphdr->src &&
-       pcb->local_port == tcphdr->dest &&
-       ip_addr_cmp(&(pcb->remote_ip), &current_iphdr_src) &&
-       ip_addr_cmp(&(pcb->local_ip), &current_iphdr_dest)) {
+    if (TCP_PCB_MATCHES_SEG(pcb)) {
 
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
@@ -206,24 +244,60 @@ tcp_input(struct pbuf *p, struct netif *inp)
   if (pcb == NULL) {
     /* If it did not go to an active connection, we check the connections
        in the TIME-WAIT state. */
-    for(pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
-      LWIP_ASSERT("tcp_input: TIME-WAIT pcb->state == TIME-WAIT", pcb->state == TIME_WAIT);
-      if (pcb->remote_port == tcphdr->src &&
-         pcb->local_port == tcphdr->dest &&
-         ip_addr_cmp(&(pcb->remote_ip), &current_iphdr_src) &&
-         ip_addr_cmp(&(pcb->local_ip), &current_iphdr_dest)) {
-        /* We don't really care enough to move this PCB to the front
-           of the list since we are not very likely to receive that
-           many segments for connections in TIME-WAIT. */
-        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
-        tcp_timewait_input(pcb);
-        pbuf_free(p);
-        return;
+    for(twpcb = tcp_tw_pcbs; twpcb != NULL; twpcb = twpcb->next) {
+      LWIP_ASSERT("tcp_input: TIME-WAIT pcb->state == TIME-WAIT", twpcb->state == TIME_WAIT);
+      if (TCP_PCB_MATCHES_SEG(twpcb)) {
+        break;
       }
     }
+  }
+#endif /* TCP_PCB_HASH */
+
+  if (twpcb != NULL) {
+#if TCP_TW_RECYCLE
+    /* A new SYN from the same peer with a higher sequence number than
+       the old connection used reopens it (RFC 1122, 4.2.2.13): drop the
+       TIME-WAIT pcb and hand the SYN over to the listener. */
+    if (((flags & (TCP_SYN | TCP_ACK | TCP_RST)) == TCP_SYN) &&
+        TCP_SEQ_GT(seqno, twpcb->rcv_nxt)) {
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: SYN recycles TIME_WAITing connection.\n"));
+      tcp_pcb_remove(&tcp_tw_pcbs, twpcb);
+      memp_free(MEMP_TCP_PCB, twpcb);
+    } else
+#endif /* TCP_TW_RECYCLE */
+    {
+      /* We don't really care enough to move this PCB to the front
+         of the list since we are not very likely to receive that
+         many segments for connections in TIME-WAIT. */
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
+      tcp_timewait_input(twpcb);
+      pbuf_free(p);
+      return;
+    }
+  }
 
+  if (pcb == NULL) {
     /* Finally, if we still did not get a match, we check all PCBs that
        are LISTENing for incoming connections. */
+#if TCP_PCB_HASH
+    /* A listener bound to the destination address takes precedence over
+       one bound to IP_ADDR_ANY. */
+    for(lpcb = tcp_listen_hash_tbl[TCP_LISTEN_HASH(tcphdr->dest)]; lpcb != NULL; lpcb = lpcb->hash_next) {
+      if (lpcb->local_port == tcphdr->dest) {
+        if (ip_addr_cmp(&(lpcb->local_ip), &current_iphdr_dest)) {
+          /* found an exact match */
+          break;
+        } else if ((lpcb_any == NULL) && ip_addr_isany(&(lpcb->local_ip))) {
+          /* found an ANY-match */
+          lpcb_any = lpcb;
+        }
+      }
+    }
+    if (lpcb == NULL) {
+      lpcb = lpcb_any;
+    }
+    if (lpcb != NULL) {
+#else /* TCP_PCB_HASH */
     prev = NULL;
     for(lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
       if (lpcb->local_port == tcphdr->dest) {
@@ -265,6 +339,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
               /* put this listening pcb at the head of the listening list */
         tcp_listen_pcbs.listen_pcbs = lpcb;
       }
+#endif /* TCP_PCB_HASH */
     
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
       tcp_listen_input(lpcb);
@@ -338,8 +413,11 @@ tcp_input(struct pbuf *p, struct netif *inp)
         /* If the application has registered a "sent" function to be
            called when new send buffer space is available, we call it
            now. */
-        if (pcb->acked > 0) {
-          TCP_EVENT_SENT(pcb, pcb->acked, err);
+        while (pcb->acked > 0) {
+          /* the sent callback takes an u16_t, a scaled window may ack more */
+          u16_t acked16 = TCPWND_MIN16(pcb->acked);
+          pcb->acked -= acked16;
+          TCP_EVENT_SENT(pcb, acked16, err);
           if (err == ERR_ABRT) {
             goto aborted;
           }
@@ -376,7 +454,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
         if (recv_flags & TF_GOT_FIN) {
           /* correct rcv_wnd as the application won't call tcp_recved()
              for the FIN's seqno */
-          if (pcb->rcv_wnd != TCP_WND) {
+          if (pcb->rcv_wnd < pcb->rcv_wnd_max) {
             pcb->rcv_wnd++;
           }
           TCP_EVENT_CLOSED(pcb, err);
@@ -482,7 +560,6 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     npcb->rcv_nxt = seqno + 1;
     npcb->rcv_ann_right_edge = npcb->rcv_nxt;
     npcb->snd_wnd = tcphdr->wnd;
-    npcb->ssthresh = npcb->snd_wnd;
     npcb->snd_wl1 = seqno - 1;/* initialise to seqno-1 to force window update */
     npcb->callback_arg = pcb->callback_arg;
 #if LWIP_CALLBACK_API
@@ -490,12 +567,19 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
 #endif /* LWIP_CALLBACK_API */
     /* inherit socket options */
     npcb->so_options = pcb->so_options & SOF_INHERITED;
+    /* inherit buffer sizes */
+    npcb->snd_buf = npcb->snd_buf_max = pcb->snd_buf_max;
+    npcb->rcv_wnd_max = pcb->rcv_wnd_max;
+    npcb->rcv_wnd = npcb->rcv_ann_wnd = TCPWND_MIN16(pcb->rcv_wnd_max);
+    /* slow start until the first loss, the send buffer bounds the flight */
+    npcb->ssthresh = npcb->snd_buf_max;
     /* Register the new PCB so that we can begin receiving segments
        for it. */
     TCP_REG(&tcp_active_pcbs, npcb);
 
     /* Parse any options in the SYN. */
     tcp_parseopt(npcb);
+    tcp_syn_wnd_scale(npcb);
 #if TCP_CALCULATE_EFF_SEND_MSS
     npcb->mss = tcp_eff_send_mss(npcb->mss, &(npcb->remote_ip));
 #endif /* TCP_CALCULATE_EFF_SEND_MSS */
@@ -635,14 +719,15 @@ tcp_process(struct tcp_pcb *pcb)
       pcb->snd_wnd = tcphdr->wnd;
       pcb->snd_wl1 = seqno - 1; /* initialise to seqno - 1 to force window update */
       pcb->state = ESTABLISHED;
+      tcp_syn_wnd_scale(pcb);
 
 #if TCP_CALCULATE_EFF_SEND_MSS
       pcb->mss = tcp_eff_send_mss(pcb->mss, &(pcb->remote_ip));
 #endif /* TCP_CALCULATE_EFF_SEND_MSS */
 
-      /* Set ssthresh again after changing pcb->mss (already set in tcp_connect
-       * but for the default value of pcb->mss) */
-      pcb->ssthresh = pcb->mss * 10;
+      /* Slow start until the first loss, the send buffer bounds the
+       * data in flight anyway */
+      pcb->ssthresh = pcb->snd_buf_max;
 
       pcb->cwnd = ((pcb->cwnd == 1) ? (pcb->mss * 2) : pcb->mss);
       LWIP_ASSERT("pcb->snd_queuelen > 0", (pcb->snd_queuelen > 0));
@@ -681,7 +766,7 @@ tcp_process(struct tcp_pcb *pcb)
     if (flags & TCP_ACK) {
       /* expected ACK number? */
       if (TCP_SEQ_BETWEEN(ackno, pcb->lastack+1, pcb->snd_nxt)) {
-        u16_t old_cwnd;
+        tcpwnd_size_t old_cwnd;
         pcb->state = ESTABLISHED;
         LWIP_DEBUGF(TCP_DEBUG, ("TCP connection established %"U16_F" -> %"U16_F".\n", inseg.tcphdr->src, inseg.tcphdr->dest));
 #if LWIP_CALLBACK_API
@@ -853,24 +938,30 @@ tcp_receive(struct tcp_pcb *pcb)
   u32_t right_wnd_edge;
   u16_t new_tot_len;
   int found_dupack = 0;
+#if LWIP_TCP_SACK
+  int sack_partial = 0;
+#endif /* LWIP_TCP_SACK */
 
   if (flags & TCP_ACK) {
+    /* The window field of segments other than SYNs is scaled */
+    tcpwnd_size_t snd_wnd = SND_WND_SCALE(pcb, tcphdr->wnd);
+
     right_wnd_edge = pcb->snd_wnd + pcb->snd_wl2;
 
     /* Update window. */
     if (TCP_SEQ_LT(pcb->snd_wl1, seqno) ||
        (pcb->snd_wl1 == seqno && TCP_SEQ_LT(pcb->snd_wl2, ackno)) ||
-       (pcb->snd_wl2 == ackno && tcphdr->wnd > pcb->snd_wnd)) {
-      pcb->snd_wnd = tcphdr->wnd;
+       (pcb->snd_wl2 == ackno && snd_wnd > pcb->snd_wnd)) {
+      pcb->snd_wnd = snd_wnd;
       pcb->snd_wl1 = seqno;
       pcb->snd_wl2 = ackno;
       if (pcb->snd_wnd > 0 && pcb->persist_backoff > 0) {
           pcb->persist_backoff = 0;
       }
-      LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"U16_F"\n", pcb->snd_wnd));
+      LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"TCPWNDSIZE_F"\n", pcb->snd_wnd));
 #if TCP_WND_DEBUG
     } else {
-      if (pcb->snd_wnd != tcphdr->wnd) {
+      if (pcb->snd_wnd != snd_wnd) {
         LWIP_DEBUGF(TCP_WND_DEBUG, 
                     ("tcp_receive: no window update lastack %"U32_F" ackno %"
                      U32_F" wl1 %"U32_F" seqno %"U32_F" wl2 %"U32_F"\n",
@@ -916,9 +1007,16 @@ tcp_receive(struct tcp_pcb *pcb)
               if (pcb->dupacks > 3) {
                 /* Inflate the congestion window, but not if it means that
                    the value overflows. */
-                if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
+                if ((tcpwnd_size_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
                   pcb->cwnd += pcb->mss;
                 }
+#if LWIP_TCP_SACK
+                /* Each further dupack may have SACKed more data: repair
+                   the holes the peer reports before the RTO fires */
+                if ((pcb->flags & (TF_INFR | TF_SACK)) == (TF_INFR | TF_SACK)) {
+                  tcp_rexmit_sack(pcb);
+                }
+#endif /* LWIP_TCP_SACK */
               } else if (pcb->dupacks == 3) {
                 /* Do fast retransmit */
                 tcp_rexmit_fast(pcb);
@@ -935,12 +1033,29 @@ tcp_receive(struct tcp_pcb *pcb)
     } else if (TCP_SEQ_BETWEEN(ackno, pcb->lastack+1, pcb->snd_nxt)){
       /* We come here when the ACK acknowledges new data. */
 
+      /* Update the send buffer space. Diff between the two can never
+         exceed the send window. */
+      pcb->acked = (tcpwnd_size_t)(ackno - pcb->lastack);
+
       /* Reset the "IN Fast Retransmit" flag, since we are no longer
          in fast retransmit. Also reset the congestion window to the
          slow start threshold. */
       if (pcb->flags & TF_INFR) {
-        pcb->flags &= ~TF_INFR;
-        pcb->cwnd = pcb->ssthresh;
+#if LWIP_TCP_SACK
+        if ((pcb->flags & TF_SACK) && TCP_SEQ_LT(ackno, pcb->recover)) {
+          /* Partial ACK: stay in recovery, deflate the window by the
+             amount acked and keep repairing holes (RFC 6675) */
+          if (pcb->cwnd > pcb->acked) {
+            pcb->cwnd -= pcb->acked;
+          }
+          pcb->cwnd += pcb->mss;
+          sack_partial = 1;
+        } else
+#endif /* LWIP_TCP_SACK */
+        {
+          pcb->flags &= ~TF_INFR;
+          pcb->cwnd = pcb->ssthresh;
+        }
       }
 
       /* Reset the number of retransmissions. */
@@ -949,9 +1064,6 @@ tcp_receive(struct tcp_pcb *pcb)
       /* Reset the retransmission time-out. */
       pcb->rto = (pcb->sa >> 3) + pcb->sv;
 
-      /* Update the send buffer space. Diff between the two can never exceed 64K? */
-      pcb->acked = (u16_t)(ackno - pcb->lastack);
-
       pcb->snd_buf += pcb->acked;
 
       /* Reset the fast retransmit variables. */
@@ -960,18 +1072,18 @@ tcp_receive(struct tcp_pcb *pcb)
 
       /* Update the congestion control variables (cwnd and
          ssthresh). */
-      if (pcb->state >= ESTABLISHED) {
+      if ((pcb->state >= ESTABLISHED) && !(pcb->flags & TF_INFR)) {
         if (pcb->cwnd < pcb->ssthresh) {
-          if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
+          if ((tcpwnd_size_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
             pcb->cwnd += pcb->mss;
           }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"U16_F"\n", pcb->cwnd));
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
         } else {
-          u16_t new_cwnd = (pcb->cwnd + pcb->mss * pcb->mss / pcb->cwnd);
+          tcpwnd_size_t new_cwnd = (pcb->cwnd + pcb->mss * pcb->mss / pcb->cwnd);
           if (new_cwnd > pcb->cwnd) {
             pcb->cwnd = new_cwnd;
           }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"U16_F"\n", pcb->cwnd));
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
         }
       }
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_receive: ACK for %"U32_F", unacked->seqno %"U32_F":%"U32_F"\n",
@@ -1019,6 +1131,11 @@ tcp_receive(struct tcp_pcb *pcb)
         pcb->rtime = 0;
 
       pcb->polltmr = 0;
+#if LWIP_TCP_SACK
+      if (sack_partial) {
+        tcp_rexmit_sack(pcb);
+      }
+#endif /* LWIP_TCP_SACK */
     } else {
       /* Fix bug bug #21582: out of sequence ACK, didn't really ack anything */
       pcb->acked = 0;
@@ -1478,11 +1595,75 @@ tcp_receive(struct tcp_pcb *pcb)
   }
 }
 
+/**
+ * Finishes window scale negotiation after the peer's SYN has been parsed.
+ * Without the option on both sides, the receive window must fit the
+ * 16 bit header field.
+ *
+ * @param pcb the tcp_pcb which received a SYN
+ */
+static void
+tcp_syn_wnd_scale(struct tcp_pcb *pcb)
+{
+#if LWIP_WND_SCALE
+  if (!(pcb->flags & TF_WND_SCALE)) {
+    pcb->snd_scale = 0;
+    pcb->rcv_scale = 0;
+    pcb->rcv_wnd_max = TCPWND_MIN16(pcb->rcv_wnd_max);
+  }
+  /* nothing has been received yet, open the whole window */
+  pcb->rcv_wnd = pcb->rcv_wnd_max;
+  pcb->rcv_ann_wnd = pcb->rcv_wnd_max;
+#else /* LWIP_WND_SCALE */
+  LWIP_UNUSED_ARG(pcb);
+#endif /* LWIP_WND_SCALE */
+}
+
+#if LWIP_TCP_SACK
+/**
+ * Marks the unacked segments covered by the SACK blocks of the incoming
+ * segment, tcp_rexmit_sack() uses them to find the holes to repair.
+ *
+ * @param pcb the tcp_pcb for which a segment arrived
+ * @param blocks the first SACK block (left and right edge, big endian)
+ * @param num number of blocks
+ */
+static void
+tcp_parse_sack(struct tcp_pcb *pcb, u8_t *blocks, u8_t num)
+{
+  struct tcp_seg *seg;
+  u32_t left, right, seg_seqno;
+
+  for (; num > 0; num--, blocks += 8) {
+    left  = ((u32_t)blocks[0] << 24) | ((u32_t)blocks[1] << 16) |
+            ((u32_t)blocks[2] << 8)  | blocks[3];
+    right = ((u32_t)blocks[4] << 24) | ((u32_t)blocks[5] << 16) |
+            ((u32_t)blocks[6] << 8)  | blocks[7];
+    /* ignore blocks below the cumulative ack (D-SACK) or beyond snd_nxt */
+    if (!TCP_SEQ_LT(left, right) || TCP_SEQ_LEQ(right, ackno) ||
+        TCP_SEQ_GT(right, pcb->snd_nxt)) {
+      continue;
+    }
+    for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+      seg_seqno = ntohl(seg->tcphdr->seqno);
+      if (TCP_SEQ_GEQ(seg_seqno, right)) {
+        break;
+      }
+      if (TCP_SEQ_GEQ(seg_seqno, left) &&
+          TCP_SEQ_LEQ(seg_seqno + TCP_TCPLEN(seg), right)) {
+        seg->flags |= TF_SEG_SACKED;
+      }
+    }
+  }
+}
+#endif /* LWIP_TCP_SACK */
+
 /**
  * Parses the options contained in the incoming segment. 
  *
  * Called from tcp_listen_input() and tcp_process().
- * Currently, only the MSS option is supported!
+ * Supports MSS, timestamps, window scale and SACK; the latter two are
+ * only negotiated in SYN segments.
  *
  * @param pcb the tcp_pcb for which a segment arrived
  */
@@ -1527,6 +1708,50 @@ tcp_parseopt(struct tcp_pcb *pcb)
         /* Advance to next option */
         c += 0x04;
         break;
+#if LWIP_WND_SCALE
+      case 0x03:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: WND_SCALE\n"));
+        if (opts[c + 1] != 0x03 || c + 0x03 > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        /* Only honoured in a SYN, RFC 7323 limits the shift to 14 */
+        if ((flags & TCP_SYN) && !(pcb->flags & TF_WND_SCALE)) {
+          pcb->snd_scale = LWIP_MIN(opts[c + 2], 14);
+          pcb->rcv_scale = TCP_RCV_SCALE;
+          pcb->flags |= TF_WND_SCALE;
+        }
+        c += 0x03;
+        break;
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+      case 0x04:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK_PERM\n"));
+        if (opts[c + 1] != 0x02 || c + 0x02 > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        if (flags & TCP_SYN) {
+          pcb->flags |= TF_SACK;
+        }
+        c += 0x02;
+        break;
+      case 0x05:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK\n"));
+        if (opts[c + 1] < 0x0A || ((opts[c + 1] - 2) & 7) != 0 ||
+            c + opts[c + 1] > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        if ((pcb->flags & TF_SACK) && !(flags & TCP_SYN) && (flags & TCP_ACK)) {
+          tcp_parse_sack(pcb, &opts[c + 2], (u8_t)((opts[c + 1] - 2) >> 3));
+        }
+        c += opts[c + 1];
+        break;
+#endif /* LWIP_TCP_SACK */
 #if LWIP_TCP_TIMESTAMPS
       case 0x08:
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: TS\n"));
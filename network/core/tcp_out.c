@@ -76,7 +76,12 @@
 #endif
 
 /* Forward declarations.*/
-static void tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb);
+static void tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb,
+                               struct netif *netif);
+#if LWIP_TCP_TSO
+static u16_t tcp_output_tso(struct tcp_seg *seg, struct tcp_pcb *pcb,
+                            struct netif *netif, u32_t wnd);
+#endif /* LWIP_TCP_TSO */
 
 /** Allocate a pbuf and create a tcphdr at p->payload, used for output
  * functions other than the default tcp_output -> tcp_output_segment
@@ -103,7 +108,7 @@ tcp_output_alloc_header(struct tcp_pcb *pcb, u16_t optlen, u16_t datalen,
     tcphdr->seqno = seqno_be;
     tcphdr->ackno = htonl(pcb->rcv_nxt);
     TCPH_HDRLEN_FLAGS_SET(tcphdr, (5 + optlen / 4), TCP_ACK);
-    tcphdr->wnd = htons(pcb->rcv_ann_wnd);
+    tcphdr->wnd = htons(TCPWND_MIN16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
     tcphdr->chksum = 0;
     tcphdr->urgp = 0;
 
@@ -303,7 +308,7 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
 
   /* fail on too much data */
   if (len > pcb->snd_buf) {
-    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | 3, ("tcp_write: too much data (len=%"U16_F" > snd_buf=%"U16_F")\n",
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | 3, ("tcp_write: too much data (len=%"U16_F" > snd_buf=%"TCPWNDSIZE_F")\n",
       len, pcb->snd_buf));
     pcb->flags |= TF_NAGLEMEMERR;
     return ERR_MEM;
@@ -735,9 +740,22 @@ tcp_enqueue_flags(struct tcp_pcb *pcb, u8_t flags)
 
   if (flags & TCP_SYN) {
     optflags = TF_SEG_OPTS_MSS;
+    /* Offer window scaling and SACK in our SYN, a SYN|ACK only echoes
+       what the peer offered */
+#if LWIP_WND_SCALE
+    if ((pcb->state != SYN_RCVD) || (pcb->flags & TF_WND_SCALE)) {
+      optflags |= TF_SEG_OPTS_WND_SCALE;
+    }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+    if ((pcb->state != SYN_RCVD) || (pcb->flags & TF_SACK)) {
+      optflags |= TF_SEG_OPTS_SACK_PERM;
+    }
+#endif /* LWIP_TCP_SACK */
   }
 #if LWIP_TCP_TIMESTAMPS
-  if ((pcb->flags & TF_TIMESTAMP)) {
+  if ((pcb->flags & TF_TIMESTAMP) ||
+      ((flags & TCP_SYN) && (pcb->state != SYN_RCVD))) {
     optflags |= TF_SEG_OPTS_TS;
   }
 #endif /* LWIP_TCP_TIMESTAMPS */
@@ -828,6 +846,42 @@ tcp_build_timestamp_option(struct tcp_pcb *pcb, u32_t *opts)
 }
 #endif
 
+#if LWIP_TCP_SACK && TCP_QUEUE_OOSEQ
+/* Collect the out-of-sequence data held in pcb->ooseq into SACK blocks
+ * (left edge, right edge pairs in host byte order). Adjacent segments
+ * are merged, blocks are reported in sequence order.
+ *
+ * @param pcb tcp_pcb
+ * @param blocks where to store the edges, 2 * max entries
+ * @param max maximal number of blocks
+ * @return number of blocks stored
+ */
+static u8_t
+tcp_build_sack_blocks(struct tcp_pcb *pcb, u32_t *blocks, u8_t max)
+{
+  struct tcp_seg *seg;
+  u32_t left, right;
+  u8_t num = 0;
+
+  for (seg = pcb->ooseq; (seg != NULL) && (num < max); ) {
+    left = seg->tcphdr->seqno;
+    right = left + TCP_TCPLEN(seg);
+    for (seg = seg->next; seg != NULL; seg = seg->next) {
+      if (TCP_SEQ_GT(seg->tcphdr->seqno, right)) {
+        break;
+      }
+      if (TCP_SEQ_GT(seg->tcphdr->seqno + TCP_TCPLEN(seg), right)) {
+        right = seg->tcphdr->seqno + TCP_TCPLEN(seg);
+      }
+    }
+    blocks[num * 2] = left;
+    blocks[num * 2 + 1] = right;
+    num++;
+  }
+  return num;
+}
+#endif /* LWIP_TCP_SACK && TCP_QUEUE_OOSEQ */
+
 /** Send an ACK without data.
  *
  * @param pcb Protocol control block for the TCP connection to send the ACK
@@ -838,12 +892,29 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   struct pbuf *p;
   struct tcp_hdr *tcphdr;
   u8_t optlen = 0;
+#if LWIP_TCP_SACK
+  u32_t sack_blocks[TCP_SACK_MAX_BLOCKS * 2];
+  u8_t sack_num = 0;
+  u8_t sack_max = TCP_SACK_MAX_BLOCKS;
+#endif /* LWIP_TCP_SACK */
 
 #if LWIP_TCP_TIMESTAMPS
   if (pcb->flags & TF_TIMESTAMP) {
     optlen = LWIP_TCP_OPT_LENGTH(TF_SEG_OPTS_TS);
+#if LWIP_TCP_SACK
+    sack_max = TCP_SACK_MAX_BLOCKS - 1;
+#endif /* LWIP_TCP_SACK */
   }
 #endif
+#if LWIP_TCP_SACK && TCP_QUEUE_OOSEQ
+  if ((pcb->flags & TF_SACK) && (pcb->ooseq != NULL)) {
+    sack_num = tcp_build_sack_blocks(pcb, sack_blocks, sack_max);
+    if (sack_num > 0) {
+      /* NOP, NOP, kind, length followed by the blocks */
+      optlen += 4 + sack_num * 8;
+    }
+  }
+#endif /* LWIP_TCP_SACK && TCP_QUEUE_OOSEQ */
 
   p = tcp_output_alloc_header(pcb, optlen, 0, htonl(pcb->snd_nxt));
   if (p == NULL) {
@@ -864,6 +935,16 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
     tcp_build_timestamp_option(pcb, (u32_t *)(tcphdr + 1));
   }
 #endif 
+#if LWIP_TCP_SACK
+  if (sack_num > 0) {
+    u32_t *opts = (u32_t *)(void *)((u8_t *)(tcphdr + 1) + optlen - 4 - sack_num * 8);
+    u8_t i;
+    *opts++ = htonl(0x01010500UL | (2 + sack_num * 8));
+    for (i = 0; i < sack_num * 2; i++) {
+      *opts++ = htonl(sack_blocks[i]);
+    }
+  }
+#endif /* LWIP_TCP_SACK */
 
 #if CHECKSUM_GEN_TCP
   tcphdr->chksum = inet_chksum_pseudo(p, &(pcb->local_ip), &(pcb->remote_ip),
@@ -893,6 +974,10 @@ tcp_output(struct tcp_pcb *pcb)
 {
   struct tcp_seg *seg, *useg;
   u32_t wnd, snd_nxt;
+  struct netif *netif = NULL;
+#if LWIP_TCP_TSO
+  u16_t tso_left = 0;
+#endif /* LWIP_TCP_TSO */
 #if TCP_CWND_DEBUG
   s16_t i = 0;
 #endif /* TCP_CWND_DEBUG */
@@ -921,6 +1006,13 @@ tcp_output(struct tcp_pcb *pcb)
      return tcp_send_empty_ack(pcb);
   }
 
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+  /* find the outgoing netif once, to know what it offloads */
+  if (seg != NULL) {
+    netif = ip_route(&(pcb->remote_ip));
+  }
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+
   /* useg should point to last segment on unacked queue */
   useg = pcb->unacked;
   if (useg != NULL) {
@@ -935,13 +1027,13 @@ tcp_output(struct tcp_pcb *pcb)
 #endif /* TCP_OUTPUT_DEBUG */
 #if TCP_CWND_DEBUG
   if (seg == NULL) {
-    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"U16_F
-                                 ", cwnd %"U16_F", wnd %"U32_F
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F
+                                 ", cwnd %"TCPWNDSIZE_F", wnd %"U32_F
                                  ", seg == NULL, ack %"U32_F"\n",
                                  pcb->snd_wnd, pcb->cwnd, wnd, pcb->lastack));
   } else {
     LWIP_DEBUGF(TCP_CWND_DEBUG, 
-                ("tcp_output: snd_wnd %"U16_F", cwnd %"U16_F", wnd %"U32_F
+                ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F
                  ", effwnd %"U32_F", seq %"U32_F", ack %"U32_F"\n",
                  pcb->snd_wnd, pcb->cwnd, wnd,
                  ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len,
@@ -959,13 +1051,21 @@ tcp_output(struct tcp_pcb *pcb)
      * - if FIN was already enqueued for this PCB (SYN is always alone in a segment -
      *   either seg->next != NULL or pcb->unacked == NULL;
      *   RST is no sent using tcp_write/tcp_output.
+     * - if the segment was already sent in a TSO packet
      */
+#if LWIP_TCP_TSO
+    if ((tso_left == 0) && (tcp_do_output_nagle(pcb) == 0) &&
+      ((pcb->flags & (TF_NAGLEMEMERR | TF_FIN)) == 0)) {
+      break;
+    }
+#else /* LWIP_TCP_TSO */
     if((tcp_do_output_nagle(pcb) == 0) &&
       ((pcb->flags & (TF_NAGLEMEMERR | TF_FIN)) == 0)){
       break;
     }
+#endif /* LWIP_TCP_TSO */
 #if TCP_CWND_DEBUG
-    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"U16_F", cwnd %"U16_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
                             pcb->snd_wnd, pcb->cwnd, wnd,
                             ntohl(seg->tcphdr->seqno) + seg->len -
                             pcb->lastack,
@@ -980,7 +1080,16 @@ tcp_output(struct tcp_pcb *pcb)
       pcb->flags &= ~(TF_ACK_DELAY | TF_ACK_NOW);
     }
 
-    tcp_output_segment(seg, pcb);
+#if LWIP_TCP_TSO
+    if (tso_left == 0 && netif != NULL && netif->tso_max != 0) {
+      tso_left = tcp_output_tso(seg, pcb, netif, wnd);
+    }
+    if (tso_left > 0) {
+      /* sent in a TSO packet, only queue it on the unacked list */
+      tso_left--;
+    } else
+#endif /* LWIP_TCP_TSO */
+    tcp_output_segment(seg, pcb, netif);
     snd_nxt = ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
     if (TCP_SEQ_LT(pcb->snd_nxt, snd_nxt)) {
       pcb->snd_nxt = snd_nxt;
@@ -1041,14 +1150,22 @@ tcp_output(struct tcp_pcb *pcb)
  *
  * @param seg the tcp_seg to send
  * @param pcb the tcp_pcb for the TCP connection used to send the segment
+ * @param netif the netif to send through, NULL to look it up in ip_output()
  */
 static void
-tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
+tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb,
+                   struct netif *netif)
 {
   u16_t len;
-  struct netif *netif;
   u32_t *opts;
 
+  /* The pbuf of this segment is still referenced by the netif driver when
+     sent by scatter-gather and not finished yet, since the header is changed
+     below, we must not continue in this case. */
+  if (seg->p->ref != 1) {
+    return;
+  }
+
   /** @bug Exclude retransmitted segments from this count. */
   snmp_inc_tcpoutsegs();
 
@@ -1056,8 +1173,13 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
    wnd fields remain. */
   seg->tcphdr->ackno = htonl(pcb->rcv_nxt);
 
-  /* advertise our receive window size in this TCP segment */
-  seg->tcphdr->wnd = htons(pcb->rcv_ann_wnd);
+  /* advertise our receive window size in this TCP segment,
+     the window in a SYN is never scaled */
+  if (TCPH_FLAGS(seg->tcphdr) & TCP_SYN) {
+    seg->tcphdr->wnd = htons(TCPWND_MIN16(pcb->rcv_ann_wnd));
+  } else {
+    seg->tcphdr->wnd = htons(TCPWND_MIN16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
+  }
 
   pcb->rcv_ann_right_edge = pcb->rcv_nxt + pcb->rcv_ann_wnd;
 
@@ -1066,9 +1188,28 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   LWIP_ASSERT("seg->tcphdr not aligned", ((mem_ptr_t)seg->tcphdr % MEM_ALIGNMENT) == 0);
   opts = (u32_t *)(void *)(seg->tcphdr + 1);
   if (seg->flags & TF_SEG_OPTS_MSS) {
-    TCP_BUILD_MSS_OPTION(*opts);
+    u16_t mss;
+#if TCP_CALCULATE_EFF_SEND_MSS
+    /* advertise what the MTU of the outgoing interface can carry */
+    mss = tcp_eff_send_mss(TCP_MSS, &pcb->remote_ip);
+#else /* TCP_CALCULATE_EFF_SEND_MSS */
+    mss = TCP_MSS;
+#endif /* TCP_CALCULATE_EFF_SEND_MSS */
+    TCP_BUILD_MSS_OPTION(*opts, mss);
     opts += 1;
   }
+#if LWIP_WND_SCALE
+  if (seg->flags & TF_SEG_OPTS_WND_SCALE) {
+    TCP_BUILD_WND_SCALE_OPTION(*opts);
+    opts += 1;
+  }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+  if (seg->flags & TF_SEG_OPTS_SACK_PERM) {
+    TCP_BUILD_SACK_PERM_OPTION(*opts);
+    opts += 1;
+  }
+#endif /* LWIP_TCP_SACK */
 #if LWIP_TCP_TIMESTAMPS
   pcb->ts_lastacksent = pcb->rcv_nxt;
 
@@ -1087,9 +1228,11 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   /* If we don't have a local IP address, we get one by
      calling ip_route(). */
   if (ip_addr_isany(&(pcb->local_ip))) {
-    netif = ip_route(&(pcb->remote_ip));
     if (netif == NULL) {
-      return;
+      netif = ip_route(&(pcb->remote_ip));
+      if (netif == NULL) {
+        return;
+      }
     }
     ip_addr_copy(pcb->local_ip, netif->ip_addr);
   }
@@ -1112,48 +1255,70 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   seg->p->payload = seg->tcphdr;
 
   seg->tcphdr->chksum = 0;
+  seg->p->flags &= ~PBUF_FLAG_TX_CSUM;
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+  if (!NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP)) {
+    /* leave the checksum to the NIC */
+    seg->tcphdr->chksum = inet_chksum_pseudo_hdr(&(pcb->local_ip),
+           &(pcb->remote_ip), IP_PROTO_TCP, seg->p->tot_len);
+    seg->p->flags |= PBUF_FLAG_TX_CSUM;
+  } else
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+  {
 #if CHECKSUM_GEN_TCP
 #if TCP_CHECKSUM_ON_COPY
-  {
-    u32_t acc;
+    {
+      u32_t acc;
 #if TCP_CHECKSUM_ON_COPY_SANITY_CHECK
-    u16_t chksum_slow = inet_chksum_pseudo(seg->p, &(pcb->local_ip),
-           &(pcb->remote_ip),
-           IP_PROTO_TCP, seg->p->tot_len);
+      u16_t chksum_slow = inet_chksum_pseudo(seg->p, &(pcb->local_ip),
+             &(pcb->remote_ip),
+             IP_PROTO_TCP, seg->p->tot_len);
 #endif /* TCP_CHECKSUM_ON_COPY_SANITY_CHECK */
-    if ((seg->flags & TF_SEG_DATA_CHECKSUMMED) == 0) {
-      LWIP_ASSERT("data included but not checksummed",
-        seg->p->tot_len == (TCPH_HDRLEN(seg->tcphdr) * 4));
-    }
+      if ((seg->flags & TF_SEG_DATA_CHECKSUMMED) == 0) {
+        LWIP_ASSERT("data included but not checksummed",
+          seg->p->tot_len == (TCPH_HDRLEN(seg->tcphdr) * 4));
+      }
 
-    /* rebuild TCP header checksum (TCP header changes for retransmissions!) */
-    acc = inet_chksum_pseudo_partial(seg->p, &(pcb->local_ip),
-             &(pcb->remote_ip),
-             IP_PROTO_TCP, seg->p->tot_len, TCPH_HDRLEN(seg->tcphdr) * 4);
-    /* add payload checksum */
-    if (seg->chksum_swapped) {
-      seg->chksum = SWAP_BYTES_IN_WORD(seg->chksum);
-      seg->chksum_swapped = 0;
-    }
-    acc += (u16_t)~(seg->chksum);
-    seg->tcphdr->chksum = FOLD_U32T(acc);
+      /* rebuild TCP header checksum (TCP header changes for retransmissions!) */
+      acc = inet_chksum_pseudo_partial(seg->p, &(pcb->local_ip),
+               &(pcb->remote_ip),
+               IP_PROTO_TCP, seg->p->tot_len, TCPH_HDRLEN(seg->tcphdr) * 4);
+      /* add payload checksum */
+      if (seg->chksum_swapped) {
+        seg->chksum = SWAP_BYTES_IN_WORD(seg->chksum);
+        seg->chksum_swapped = 0;
+      }
+      acc += (u16_t)~(seg->chksum);
+      seg->tcphdr->chksum = FOLD_U32T(acc);
 #if TCP_CHECKSUM_ON_COPY_SANITY_CHECK
-    if (chksum_slow != seg->tcphdr->chksum) {
-      LWIP_DEBUGF(TCP_DEBUG | LWIP_DBG_LEVEL_WARNING,
-                  ("tcp_output_segment: calculated checksum is %"X16_F" instead of %"X16_F"\n",
-                  seg->tcphdr->chksum, chksum_slow));
-      seg->tcphdr->chksum = chksum_slow;
-    }
+      if (chksum_slow != seg->tcphdr->chksum) {
+        LWIP_DEBUGF(TCP_DEBUG | LWIP_DBG_LEVEL_WARNING,
+                    ("tcp_output_segment: calculated checksum is %"X16_F" instead of %"X16_F"\n",
+                    seg->tcphdr->chksum, chksum_slow));
+        seg->tcphdr->chksum = chksum_slow;
+      }
 #endif /* TCP_CHECKSUM_ON_COPY_SANITY_CHECK */
-  }
+    }
 #else /* TCP_CHECKSUM_ON_COPY */
-  seg->tcphdr->chksum = inet_chksum_pseudo(seg->p, &(pcb->local_ip),
-         &(pcb->remote_ip),
-         IP_PROTO_TCP, seg->p->tot_len);
+    seg->tcphdr->chksum = inet_chksum_pseudo(seg->p, &(pcb->local_ip),
+           &(pcb->remote_ip),
+           IP_PROTO_TCP, seg->p->tot_len);
 #endif /* TCP_CHECKSUM_ON_COPY */
 #endif /* CHECKSUM_GEN_TCP */
+  }
   TCP_STATS_INC(tcp.xmit);
 
+  if (netif != NULL) {
+#if LWIP_NETIF_HWADDRHINT
+    netif->addr_hint = &(pcb->addr_hint);
+#endif /* LWIP_NETIF_HWADDRHINT*/
+    ip_output_if(seg->p, &(pcb->local_ip), &(pcb->remote_ip), pcb->ttl, pcb->tos,
+        IP_PROTO_TCP, netif);
+#if LWIP_NETIF_HWADDRHINT
+    netif->addr_hint = NULL;
+#endif /* LWIP_NETIF_HWADDRHINT*/
+    return;
+  }
 #if LWIP_NETIF_HWADDRHINT
   ip_output_hinted(seg->p, &(pcb->local_ip), &(pcb->remote_ip), pcb->ttl, pcb->tos,
       IP_PROTO_TCP, &(pcb->addr_hint));
@@ -1163,6 +1328,203 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
 #endif /* LWIP_NETIF_HWADDRHINT*/
 }
 
+#if LWIP_TCP_TSO
+/**
+ * Free a pbuf of a TSO packet, releasing the segment data it references.
+ */
+static void
+tcp_tso_pbuf_free(struct pbuf *p)
+{
+  struct tcp_tso_pbuf *tp = (struct tcp_tso_pbuf *)p;
+  LWIP_ASSERT("tp != NULL", tp != NULL);
+  LWIP_ASSERT("tp->original != NULL", tp->original != NULL);
+  pbuf_free(tp->original);
+  memp_free(MEMP_TCP_TSO_PBUF, tp);
+}
+
+/**
+ * Count the pbufs holding the data of a segment.
+ *
+ * @param seg the segment
+ * @param off offset of the data in seg->p
+ * @param len length of the data
+ * @return number of pbufs the data spans
+ */
+static u16_t
+tcp_tso_pbuf_count(struct tcp_seg *seg, u16_t off, u16_t len)
+{
+  struct pbuf *q;
+  u16_t n = 0;
+
+  for (q = seg->p; (q != NULL) && (off >= q->len); q = q->next) {
+    off -= q->len;
+  }
+  for (; (q != NULL) && (len > 0); q = q->next) {
+    len -= LWIP_MIN(len, q->len - off);
+    off = 0;
+    n++;
+  }
+  return n;
+}
+
+/**
+ * Append pbufs referencing the data of a segment to a TSO packet, the pbufs
+ * holding the data are referenced until the packet is sent out.
+ *
+ * @param p the TSO packet
+ * @param seg the segment
+ * @param off offset of the data in seg->p
+ * @param len length of the data
+ * @return ERR_OK, or ERR_MEM if out of TCP_TSO_PBUF
+ */
+static err_t
+tcp_tso_pbuf_chain(struct pbuf *p, struct tcp_seg *seg, u16_t off, u16_t len)
+{
+  struct tcp_tso_pbuf *tp;
+  struct pbuf *q, *r;
+  u16_t n;
+
+  for (q = seg->p; off >= q->len; q = q->next) {
+    off -= q->len;
+  }
+  for (; len > 0; q = q->next) {
+    n = LWIP_MIN(len, q->len - off);
+    tp = (struct tcp_tso_pbuf *)memp_malloc(MEMP_TCP_TSO_PBUF);
+    if (tp == NULL) {
+      return ERR_MEM;
+    }
+    r = pbuf_alloced_custom(PBUF_RAW, n, PBUF_REF, &tp->pc,
+      (u8_t *)q->payload + off, n);
+    LWIP_ASSERT("r != NULL", r != NULL);
+    pbuf_ref(q);
+    tp->original = q;
+    tp->pc.custom_free_function = tcp_tso_pbuf_free;
+    pbuf_cat(p, r);
+    len -= n;
+    off = 0;
+  }
+  return ERR_OK;
+}
+
+/**
+ * Called by tcp_output() to send consecutive full sized segments in one
+ * packet, which is cut into the original segments again by the NIC. Only
+ * the header is copied, the packet references the data of the segments,
+ * which are left as they are for retransmission and SACK.
+ *
+ * @param seg the first tcp_seg to send
+ * @param pcb the tcp_pcb for the TCP connection used to send the segments
+ * @param netif the netif to send through, netif->tso_max must not be 0
+ * @param wnd the window the segments must fit into
+ * @return number of segments sent, 0 if nothing was sent
+ */
+static u16_t
+tcp_output_tso(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif,
+               u32_t wnd)
+{
+  struct tcp_seg *s;
+  struct tcp_hdr *tcphdr;
+  struct pbuf *p;
+  u16_t hdrlen, mss, num, i, off, npbufs, n;
+  u32_t len, seqno;
+  u8_t flags = 0;
+
+  /* The header of seg is changed below, see tcp_output_segment(). */
+  if (seg->p->ref != 1 || ip_addr_isany(&(pcb->local_ip))) {
+    return 0;
+  }
+  hdrlen = TCP_HLEN + LWIP_TCP_OPT_LENGTH(seg->flags);
+  mss = pcb->mss - LWIP_TCP_OPT_LENGTH(seg->flags);
+  seqno = ntohl(seg->tcphdr->seqno);
+
+  /* count the full sized data segments fitting into window and packet,
+     the header takes one pbuf */
+  num = 0;
+  len = 0;
+  npbufs = 1;
+  for (s = seg; s != NULL; s = s->next) {
+    if ((s->len != mss) ||
+        (LWIP_TCP_OPT_LENGTH(s->flags) != LWIP_TCP_OPT_LENGTH(seg->flags)) ||
+        ((TCPH_FLAGS(s->tcphdr) & (TCP_SYN | TCP_FIN | TCP_RST)) != 0) ||
+        (ntohl(s->tcphdr->seqno) != seqno + len) ||
+        (seqno + len + mss - pcb->lastack > wnd) ||
+        (IP_HLEN + hdrlen + len + mss > netif->tso_max)) {
+      break;
+    }
+    off = (u16_t)((u8_t *)s->tcphdr - (u8_t *)s->p->payload) + hdrlen;
+    n = tcp_tso_pbuf_count(s, off, mss);
+    if ((netif->tso_max_pbufs != 0) && (npbufs + n > netif->tso_max_pbufs)) {
+      break;
+    }
+    npbufs += n;
+    len += mss;
+    num++;
+  }
+  if (num < 2) {
+    return 0;
+  }
+  p = pbuf_alloc(PBUF_IP, hdrlen, PBUF_RAM);
+  if (p == NULL) {
+    /* send them one by one */
+    return 0;
+  }
+  for (s = seg, i = 0; i < num; s = s->next, i++) {
+    off = (u16_t)((u8_t *)s->tcphdr - (u8_t *)s->p->payload) + hdrlen;
+    if (tcp_tso_pbuf_chain(p, s, off, mss) != ERR_OK) {
+      /* releases the data referenced so far, send them one by one */
+      pbuf_free(p);
+      return 0;
+    }
+  }
+
+  /* fill in the header of seg as tcp_output_segment() does */
+  seg->tcphdr->ackno = htonl(pcb->rcv_nxt);
+  seg->tcphdr->wnd = htons(TCPWND_MIN16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
+  pcb->rcv_ann_right_edge = pcb->rcv_nxt + pcb->rcv_ann_wnd;
+#if LWIP_TCP_TIMESTAMPS
+  pcb->ts_lastacksent = pcb->rcv_nxt;
+  if (seg->flags & TF_SEG_OPTS_TS) {
+    tcp_build_timestamp_option(pcb, (u32_t *)(void *)(seg->tcphdr + 1));
+  }
+#endif /* LWIP_TCP_TIMESTAMPS */
+  if (pcb->rtime == -1) {
+    pcb->rtime = 0;
+  }
+  if (pcb->rttest == 0) {
+    pcb->rttest = tcp_ticks;
+    pcb->rtseq = seqno;
+  }
+
+  /* copy the header of seg */
+  MEMCPY(p->payload, seg->tcphdr, hdrlen);
+  tcphdr = (struct tcp_hdr *)p->payload;
+  for (s = seg, i = 0; i < num; s = s->next, i++) {
+    flags |= TCPH_FLAGS(s->tcphdr);
+    snmp_inc_tcpoutsegs();
+  }
+  /* the NIC sets PSH in the last segment only */
+  TCPH_SET_FLAG(tcphdr, flags & TCP_PSH);
+  tcphdr->chksum = inet_chksum_pseudo_hdr(&(pcb->local_ip), &(pcb->remote_ip),
+         IP_PROTO_TCP, 0);
+  p->flags |= PBUF_FLAG_TX_CSUM | PBUF_FLAG_TSO;
+  p->tso_mss = mss;
+
+  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_output_tso: %"U32_F":%"U32_F" in %"U16_F" segments, %"U16_F" pbufs\n",
+          seqno, seqno + len, num, npbufs));
+  TCP_STATS_INC(tcp.xmit);
+#if LWIP_NETIF_HWADDRHINT
+  netif->addr_hint = &(pcb->addr_hint);
+#endif /* LWIP_NETIF_HWADDRHINT*/
+  ip_output_if(p, &(pcb->local_ip), &(pcb->remote_ip), pcb->ttl, pcb->tos,
+      IP_PROTO_TCP, netif);
+#if LWIP_NETIF_HWADDRHINT
+  netif->addr_hint = NULL;
+#endif /* LWIP_NETIF_HWADDRHINT*/
+  pbuf_free(p);
+  return num;
+}
+#endif /* LWIP_TCP_TSO */
+
 /**
  * Send a TCP RESET packet (empty segment with RST flag set) either to
  * abort a connection or to show that there is no matching local connection
@@ -1204,7 +1566,7 @@ tcp_rst(u32_t seqno, u32_t ackno,
   tcphdr->seqno = htonl(seqno);
   tcphdr->ackno = htonl(ackno);
   TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN/4, TCP_RST | TCP_ACK);
-  tcphdr->wnd = PP_HTONS(TCP_WND);
+  tcphdr->wnd = PP_HTONS(TCPWND_MIN16(TCP_WND));
   tcphdr->chksum = 0;
   tcphdr->urgp = 0;
 
@@ -1237,7 +1599,15 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
   }
 
   /* Move all unacked segments to the head of the unsent queue */
-  for (seg = pcb->unacked; seg->next != NULL; seg = seg->next);
+  for (seg = pcb->unacked; seg->next != NULL; seg = seg->next) {
+#if LWIP_TCP_SACK
+    /* the peer may discard SACKed data, so after a timeout resend all */
+    seg->flags &= ~(TF_SEG_SACKED | TF_SEG_SACK_REXMIT);
+#endif /* LWIP_TCP_SACK */
+  }
+#if LWIP_TCP_SACK
+  seg->flags &= ~(TF_SEG_SACKED | TF_SEG_SACK_REXMIT);
+#endif /* LWIP_TCP_SACK */
   /* concatenate unsent queue after unacked queue */
   seg->next = pcb->unsent;
   /* unsent queue is the concatenated queue (of unacked, unsent) */
@@ -1312,6 +1682,16 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
                  "), fast retransmit %"U32_F"\n",
                  (u16_t)pcb->dupacks, pcb->lastack,
                  ntohl(pcb->unacked->tcphdr->seqno)));
+#if LWIP_TCP_SACK
+    {
+      /* a new recovery may repair every hole once more */
+      struct tcp_seg *seg;
+      for (seg = pcb->unacked->next; seg != NULL; seg = seg->next) {
+        seg->flags &= ~TF_SEG_SACK_REXMIT;
+      }
+      pcb->unacked->flags |= TF_SEG_SACK_REXMIT;
+    }
+#endif /* LWIP_TCP_SACK */
     tcp_rexmit(pcb);
 
     /* Set ssthresh to half of the minimum of the current
@@ -1333,9 +1713,75 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
     
     pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
     pcb->flags |= TF_INFR;
+#if LWIP_TCP_SACK
+    pcb->recover = pcb->snd_nxt;
+#endif /* LWIP_TCP_SACK */
   } 
 }
 
+#if LWIP_TCP_SACK
+/** Number of SACKed segments above a hole before it is taken as lost */
+#define TCP_SACK_DUPTHRESH  3
+
+/**
+ * Retransmit the first segment the peer's SACK blocks show to be lost,
+ * a simplified form of the RFC 6675 loss rule: a segment is lost if it
+ * is not SACKed itself but TCP_SACK_DUPTHRESH later segments are.
+ * Each segment is retransmitted at most once per recovery.
+ *
+ * Called by tcp_receive() during fast recovery.
+ *
+ * @param pcb the tcp_pcb for which to repair a hole
+ */
+void
+tcp_rexmit_sack(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+  struct tcp_seg **prev_seg, **cur_seg;
+  u16_t sacked = 0;
+
+  /* SACKed segments still ahead while walking the queue */
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked++;
+    }
+  }
+
+  for (prev_seg = &pcb->unacked; (seg = *prev_seg) != NULL; prev_seg = &seg->next) {
+    if (sacked < TCP_SACK_DUPTHRESH) {
+      return;
+    }
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked--;
+    } else if (!(seg->flags & TF_SEG_SACK_REXMIT)) {
+      break;
+    }
+  }
+  if (seg == NULL) {
+    return;
+  }
+  LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_rexmit_sack: retransmit %"U32_F"\n",
+                             ntohl(seg->tcphdr->seqno)));
+
+  /* Move the lost segment to the unsent queue, keeping it sorted */
+  *prev_seg = seg->next;
+  seg->flags |= TF_SEG_SACK_REXMIT;
+  cur_seg = &(pcb->unsent);
+  while (*cur_seg &&
+    TCP_SEQ_LT(ntohl((*cur_seg)->tcphdr->seqno), ntohl(seg->tcphdr->seqno))) {
+      cur_seg = &((*cur_seg)->next );
+  }
+  seg->next = *cur_seg;
+  *cur_seg = seg;
+
+  /* Don't take any rtt measurements after retransmitting. */
+  pcb->rttest = 0;
+
+  snmp_inc_tcpretranssegs();
+  /* tcp_input() calls tcp_output() when done with the segment */
+}
+#endif /* LWIP_TCP_SACK */
+
 
 /**
  * Send keepalive packets to keep a connection active although
@@ -252,8 +252,8 @@ udp_input(struct pbuf *p, struct netif *inp)
 #endif /* LWIP_UDPLITE */
     {
 #if CHECKSUM_CHECK_UDP
-      if (udphdr->chksum != 0) {
-        if (inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
+      if ((udphdr->chksum != 0) && ((p->flags & PBUF_FLAG_RX_CSUM_OK) == 0)) {
+        if (inet_chksum_pseudo_input(p, ip_current_src_addr(), ip_current_dest_addr(),
                                IP_PROTO_UDP, p->tot_len) != 0) {
           LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
                       ("udp_input: UDP datagram discarded due to failing checksum\n"));
@@ -630,8 +630,17 @@ udp_sendto_if_chksum(struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *dst_ip,
     udphdr->len = htons(q->tot_len);
     /* calculate checksum */
 #if CHECKSUM_GEN_UDP
+    q->flags &= ~PBUF_FLAG_TX_CSUM;
     if ((pcb->flags & UDP_FLAGS_NOCHKSUM) == 0) {
       u16_t udpchksum;
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+      /* leave it to the NIC, unless the datagram is to be fragmented */
+      if (!NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP) &&
+          (q->tot_len + IP_HLEN <= netif->mtu)) {
+        udpchksum = inet_chksum_pseudo_hdr(src_ip, dst_ip, IP_PROTO_UDP, q->tot_len);
+        q->flags |= PBUF_FLAG_TX_CSUM;
+      } else
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
 #if LWIP_CHECKSUM_ON_COPY
       if (have_chksum) {
         u32_t acc;
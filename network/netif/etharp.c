@@ -49,6 +49,7 @@
 
 #include "lwip/ip_addr.h"
 #include "lwip/def.h"
+#include "lwip/mem.h"
 #include "lwip/ip.h"
 #include "lwip/stats.h"
 #include "lwip/snmp.h"
@@ -99,21 +100,51 @@ struct etharp_entry {
 #endif /* ARP_QUEUEING */
   ip_addr_t ipaddr;
   struct eth_addr ethaddr;
-#if LWIP_SNMP
+  /** netif the address was resolved on */
   struct netif *netif;
-#endif /* LWIP_SNMP */
+  /** arp_ticks when the entry was created or last updated */
+  u32_t ctime;
+  /** next entry in the same hash bucket, or on the free list */
+  u16_t next_hash;
+  /** neighbours on the pending or stable age list */
+  u16_t prev_age;
+  u16_t next_age;
   u8_t state;
-  u8_t ctime;
+#if ARP_QUEUEING
+  /** number of packets on q */
+  u8_t q_len;
+#endif /* ARP_QUEUEING */
 #if ETHARP_SUPPORT_STATIC_ENTRIES
   u8_t static_entry;
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
 };
 
-static struct etharp_entry arp_table[ARP_TABLE_SIZE];
+/** Index of no entry, ends hash chains and lists */
+#define ARP_IDX_NONE 0xFFFF
 
-#if !LWIP_NETIF_HWADDRHINT
-static u8_t etharp_cached_entry;
-#endif /* !LWIP_NETIF_HWADDRHINT */
+/** A list of entries ordered by ctime, the oldest one at head. Entries are
+ *  appended when their state is set, so etharp_tmr() only visits the heads
+ *  of the lists instead of scanning the whole table. */
+struct etharp_age_list {
+  u16_t head;
+  u16_t tail;
+};
+
+/** The ARP table is allocated from the heap and doubled when it's full,
+ *  up to ARP_TABLE_MAX_SIZE entries. */
+static struct etharp_entry *arp_table;
+static u16_t arp_table_size;
+/** Hash buckets, heads of chains linked by next_hash */
+static u16_t arp_hash[ARP_HASH_SIZE];
+/** Empty entries, linked by next_hash */
+static u16_t arp_free;
+/** Pending entries and stable entries (except static ones) */
+static struct etharp_age_list arp_pending;
+static struct etharp_age_list arp_stable;
+/** Incremented by etharp_tmr(), the age of an entry is arp_ticks - ctime */
+static u32_t arp_ticks;
+/** Counters shown by etharp_get_table_stats() */
+static struct etharp_table_stats arp_stats;
 
 /** Try hard to create a new entry - we want the IP address to appear in
     the cache (even if this means removing an active entry or so). */
@@ -121,19 +152,31 @@ static u8_t etharp_cached_entry;
 #define ETHARP_FLAG_FIND_ONLY    2
 #define ETHARP_FLAG_STATIC_ENTRY 4
 
+/** The entry last resolved is remembered per netif, and per pcb if
+ *  LWIP_NETIF_HWADDRHINT is enabled. */
 #if LWIP_NETIF_HWADDRHINT
-#define ETHARP_SET_HINT(netif, hint)  if (((netif) != NULL) && ((netif)->addr_hint != NULL))  \
-                                      *((netif)->addr_hint) = (hint);
+#define ETHARP_SET_HINT(netif, hint)  do { (netif)->arp_hint = (hint); \
+                                        if ((netif)->addr_hint != NULL) \
+                                          *((netif)->addr_hint) = (hint); } while(0)
 #else /* LWIP_NETIF_HWADDRHINT */
-#define ETHARP_SET_HINT(netif, hint)  (etharp_cached_entry = (hint))
+#define ETHARP_SET_HINT(netif, hint)  ((netif)->arp_hint = (hint))
 #endif /* LWIP_NETIF_HWADDRHINT */
 
 static err_t update_arp_entry(struct netif *netif, ip_addr_t *ipaddr, struct eth_addr *ethaddr, u8_t flags);
 
 
 /* Some checks, instead of etharp_init(): */
-#if (LWIP_ARP && (ARP_TABLE_SIZE > 0x7f))
-  #error "ARP_TABLE_SIZE must fit in an s8_t, you have to reduce it in your lwipopts.h"
+#if (LWIP_ARP && (ARP_TABLE_MAX_SIZE > 0x7fff))
+  #error "ARP_TABLE_MAX_SIZE must fit in an s16_t, you have to reduce it in your lwipopts.h"
+#endif
+#if (LWIP_ARP && (ARP_TABLE_MAX_SIZE < ARP_TABLE_SIZE))
+  #error "ARP_TABLE_MAX_SIZE must not be less than ARP_TABLE_SIZE"
+#endif
+#if (LWIP_ARP && ((ARP_HASH_SIZE & (ARP_HASH_SIZE - 1)) != 0))
+  #error "ARP_HASH_SIZE must be a power of 2"
+#endif
+#if (LWIP_ARP && ARP_QUEUEING && (ARP_QUEUE_LEN > 0xff))
+  #error "ARP_QUEUE_LEN must fit in an u8_t"
 #endif
 
 
@@ -164,10 +207,86 @@ free_etharp_q(struct etharp_q_entry *q)
 
 #endif /* ARP_QUEUEING */
 
+/** Hash bucket of an IP address; the host part varies most on a segment,
+ *  so all bytes are folded into the low bits. */
+static u16_t
+etharp_hash(ip_addr_t *ipaddr)
+{
+  u32_t h = ip4_addr_get_u32(ipaddr);
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return (u16_t)(h & (ARP_HASH_SIZE - 1));
+}
+
+/** The age list an entry belongs to by its state, NULL for none */
+static struct etharp_age_list *
+etharp_age_list(u16_t i)
+{
+  if (arp_table[i].state == ETHARP_STATE_PENDING) {
+    return &arp_pending;
+  }
+  if ((arp_table[i].state == ETHARP_STATE_STABLE)
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+      && (arp_table[i].static_entry == 0)
+#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+     ) {
+    return &arp_stable;
+  }
+  return NULL;
+}
+
+/** Remove an entry from its age list, before its state is changed */
+static void
+etharp_age_remove(u16_t i)
+{
+  struct etharp_age_list *list = etharp_age_list(i);
+  struct etharp_entry *e = &arp_table[i];
+
+  if (list == NULL) {
+    return;
+  }
+  if (e->prev_age != ARP_IDX_NONE) {
+    arp_table[e->prev_age].next_age = e->next_age;
+  } else {
+    list->head = e->next_age;
+  }
+  if (e->next_age != ARP_IDX_NONE) {
+    arp_table[e->next_age].prev_age = e->prev_age;
+  } else {
+    list->tail = e->prev_age;
+  }
+  e->prev_age = ARP_IDX_NONE;
+  e->next_age = ARP_IDX_NONE;
+}
+
+/** Restart the life time of an entry, and append it to the age list of
+ *  its (new) state */
+static void
+etharp_age_insert(u16_t i)
+{
+  struct etharp_age_list *list = etharp_age_list(i);
+  struct etharp_entry *e = &arp_table[i];
+
+  e->ctime = arp_ticks;
+  if (list == NULL) {
+    return;
+  }
+  e->next_age = ARP_IDX_NONE;
+  e->prev_age = list->tail;
+  if (list->tail != ARP_IDX_NONE) {
+    arp_table[list->tail].next_age = i;
+  } else {
+    list->head = i;
+  }
+  list->tail = i;
+}
+
 /** Clean up ARP table entries */
 static void
-free_entry(int i)
+free_entry(u16_t i)
 {
+  u16_t *pi;
+
   /* remove from SNMP ARP index tree */
   snmp_delete_arpidx_tree(arp_table[i].netif, &arp_table[i].ipaddr);
   /* and empty packet queue */
@@ -177,223 +296,288 @@ free_entry(int i)
     free_etharp_q(arp_table[i].q);
     arp_table[i].q = NULL;
   }
+#if ARP_QUEUEING
+  arp_table[i].q_len = 0;
+#endif /* ARP_QUEUEING */
+  etharp_age_remove(i);
+  /* unlink from its hash chain */
+  pi = &arp_hash[etharp_hash(&arp_table[i].ipaddr)];
+  while (*pi != i) {
+    LWIP_ASSERT("entry is in its hash chain", *pi != ARP_IDX_NONE);
+    pi = &arp_table[*pi].next_hash;
+  }
+  *pi = arp_table[i].next_hash;
   /* recycle entry for re-use */      
   arp_table[i].state = ETHARP_STATE_EMPTY;
 #if ETHARP_SUPPORT_STATIC_ENTRIES
   arp_table[i].static_entry = 0;
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+  arp_table[i].next_hash = arp_free;
+  arp_free = i;
 #ifdef LWIP_DEBUG
   /* for debugging, clean out the complete entry */
   arp_table[i].ctime = 0;
-#if LWIP_SNMP
   arp_table[i].netif = NULL;
-#endif /* LWIP_SNMP */
   ip_addr_set_zero(&arp_table[i].ipaddr);
   arp_table[i].ethaddr = ethzero;
 #endif /* LWIP_DEBUG */
 }
 
+/**
+ * Double the ARP table, up to ARP_TABLE_MAX_SIZE entries. The entries keep
+ * their indices, so hash chains, age lists and address hints stay valid.
+ *
+ * @return 1 if free entries were added, 0 otherwise
+ */
+static u8_t
+etharp_grow(void)
+{
+  struct etharp_entry *table;
+  u32_t size;
+  u16_t i;
+
+  if (arp_table_size >= ARP_TABLE_MAX_SIZE) {
+    return 0;
+  }
+  size = (arp_table_size == 0) ? ARP_TABLE_SIZE : 2 * (u32_t)arp_table_size;
+  if (size > ARP_TABLE_MAX_SIZE) {
+    size = ARP_TABLE_MAX_SIZE;
+  }
+  table = (struct etharp_entry *)mem_malloc((mem_size_t)(size * sizeof(struct etharp_entry)));
+  if (table == NULL) {
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_grow: out of memory for %"U32_F" entries\n", size));
+    return 0;
+  }
+  if (arp_table != NULL) {
+    MEMCPY(table, arp_table, arp_table_size * sizeof(struct etharp_entry));
+    mem_free(arp_table);
+  }
+  memset(&table[arp_table_size], 0, (size - arp_table_size) * sizeof(struct etharp_entry));
+  /* put the new entries on the free list, lowest index first */
+  for (i = (u16_t)size; i > arp_table_size; i--) {
+    table[i - 1].state = ETHARP_STATE_EMPTY;
+    table[i - 1].prev_age = ARP_IDX_NONE;
+    table[i - 1].next_age = ARP_IDX_NONE;
+    table[i - 1].next_hash = arp_free;
+    arp_free = i - 1;
+  }
+  LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_grow: %"U16_F" -> %"U32_F" entries\n", arp_table_size, size));
+  arp_table = table;
+  arp_table_size = (u16_t)size;
+  return 1;
+}
+
+/**
+ * Initialize the ARP table with ARP_TABLE_SIZE entries.
+ */
+void
+etharp_init(void)
+{
+  u16_t i;
+
+  for (i = 0; i < ARP_HASH_SIZE; ++i) {
+    arp_hash[i] = ARP_IDX_NONE;
+  }
+  arp_free = ARP_IDX_NONE;
+  arp_pending.head = arp_pending.tail = ARP_IDX_NONE;
+  arp_stable.head = arp_stable.tail = ARP_IDX_NONE;
+  /* retried by find_entry() if it fails here */
+  etharp_grow();
+}
+
 /**
  * Clears expired entries in the ARP table.
  *
  * This function should be called every ETHARP_TMR_INTERVAL milliseconds (5 seconds),
  * in order to expire entries in the ARP table.
+ *
+ * The age lists are ordered by time of update, so only the expired entries
+ * at their heads are visited.
  */
 void
 etharp_tmr(void)
 {
-  u8_t i;
+  u16_t i;
 
   LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer\n"));
+  ++arp_ticks;
   /* remove expired entries from the ARP table */
-  for (i = 0; i < ARP_TABLE_SIZE; ++i) {
-    u8_t state = arp_table[i].state;
-    if (state != ETHARP_STATE_EMPTY
-#if ETHARP_SUPPORT_STATIC_ENTRIES
-      && (arp_table[i].static_entry == 0)
-#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
-      ) {
-      arp_table[i].ctime++;
-      if ((arp_table[i].ctime >= ARP_MAXAGE) ||
-          ((arp_table[i].state == ETHARP_STATE_PENDING)  &&
-           (arp_table[i].ctime >= ARP_MAXPENDING))) {
-        /* pending or stable entry has become old! */
-        LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer: expired %s entry %"U16_F".\n",
-             arp_table[i].state == ETHARP_STATE_STABLE ? "stable" : "pending", (u16_t)i));
-        /* clean up entries that have just been expired */
-        free_entry(i);
-      }
-#if ARP_QUEUEING
-      /* still pending entry? (not expired) */
-      if (arp_table[i].state == ETHARP_STATE_PENDING) {
-        /* resend an ARP query here? */
-      }
-#endif /* ARP_QUEUEING */
-    }
+  while (((i = arp_pending.head) != ARP_IDX_NONE) &&
+         ((u32_t)(arp_ticks - arp_table[i].ctime) >= ARP_MAXPENDING)) {
+    LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer: expired pending entry %"U16_F".\n", i));
+    free_entry(i);
+    arp_stats.expired++;
+  }
+  while (((i = arp_stable.head) != ARP_IDX_NONE) &&
+         ((u32_t)(arp_ticks - arp_table[i].ctime) >= ARP_MAXAGE)) {
+    LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer: expired stable entry %"U16_F".\n", i));
+    free_entry(i);
+    arp_stats.expired++;
   }
 }
 
 /**
  * Search the ARP table for a matching or new entry.
  * 
- * If an IP address is given, return a pending or stable ARP entry that matches
- * the address. If no match is found, create a new entry with this address set,
- * but in state ETHARP_EMPTY. The caller must check and possibly change the
- * state of the returned entry.
- * 
- * If ipaddr is NULL, return a initialized new entry in state ETHARP_EMPTY.
+ * Return a pending or stable ARP entry that matches the address, it's
+ * looked up in its hash bucket. If no match is found, create a new entry
+ * with this address set, but in state ETHARP_EMPTY. The caller must check
+ * and possibly change the state of the returned entry, and insert it to
+ * its age list.
  * 
- * In all cases, attempt to create new entries from an empty entry. If no
- * empty entries are available and ETHARP_FLAG_TRY_HARD flag is set, recycle
- * old entries. Heuristic choose the least important entry for recycling.
+ * New entries are taken from the empty entries, the table is grown if
+ * there are none. If it can't grow and ETHARP_FLAG_TRY_HARD flag is set,
+ * recycle old entries: the oldest stable entry, then the oldest pending
+ * entry without and with queued packets.
  *
  * @param ipaddr IP address to find in ARP cache, or to add if not found.
  * @param flags @see definition of ETHARP_FLAG_*
- * @param netif netif related to this address (used for NETIF_HWADDRHINT)
  *  
  * @return The ARP entry index that matched or is created, ERR_MEM if no
  * entry is found or could be recycled.
  */
-static s8_t
+static s16_t
 find_entry(ip_addr_t *ipaddr, u8_t flags)
 {
-  s8_t old_pending = ARP_TABLE_SIZE, old_stable = ARP_TABLE_SIZE;
-  s8_t empty = ARP_TABLE_SIZE;
-  u8_t i = 0, age_pending = 0, age_stable = 0;
-  /* oldest entry with packets on queue */
-  s8_t old_queue = ARP_TABLE_SIZE;
-  /* its age */
-  u8_t age_queue = 0;
-
-  /**
-   * a) do a search through the cache, remember candidates
-   * b) select candidate entry
-   * c) create new entry
-   */
-
-  /* a) in a single search sweep, do all of this
-   * 1) remember the first empty entry (if any)
-   * 2) remember the oldest stable entry (if any)
-   * 3) remember the oldest pending entry without queued packets (if any)
-   * 4) remember the oldest pending entry with queued packets (if any)
-   * 5) search for a matching IP entry, either pending or stable
-   *    until 5 matches, or all entries are searched for.
-   */
-
-  for (i = 0; i < ARP_TABLE_SIZE; ++i) {
-    u8_t state = arp_table[i].state;
-    /* no empty entry found yet and now we do find one? */
-    if ((empty == ARP_TABLE_SIZE) && (state == ETHARP_STATE_EMPTY)) {
-      LWIP_DEBUGF(ETHARP_DEBUG, ("find_entry: found empty entry %"U16_F"\n", (u16_t)i));
-      /* remember first empty entry */
-      empty = i;
-    } else if (state != ETHARP_STATE_EMPTY) {
-      LWIP_ASSERT("state == ETHARP_STATE_PENDING || state == ETHARP_STATE_STABLE",
-        state == ETHARP_STATE_PENDING || state == ETHARP_STATE_STABLE);
-      /* if given, does IP address match IP address in ARP entry? */
-      if (ipaddr && ip_addr_cmp(ipaddr, &arp_table[i].ipaddr)) {
-        LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: found matching entry %"U16_F"\n", (u16_t)i));
-        /* found exact IP address match, simply bail out */
-        return i;
-      }
-      /* pending entry? */
-      if (state == ETHARP_STATE_PENDING) {
-        /* pending with queued packets? */
-        if (arp_table[i].q != NULL) {
-          if (arp_table[i].ctime >= age_queue) {
-            old_queue = i;
-            age_queue = arp_table[i].ctime;
-          }
-        } else
-        /* pending without queued packets? */
-        {
-          if (arp_table[i].ctime >= age_pending) {
-            old_pending = i;
-            age_pending = arp_table[i].ctime;
-          }
-        }
-      /* stable entry? */
-      } else if (state == ETHARP_STATE_STABLE) {
-#if ETHARP_SUPPORT_STATIC_ENTRIES
-        /* don't record old_stable for static entries since they never expire */
-        if (arp_table[i].static_entry == 0)
-#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
-        {
-          /* remember entry with oldest stable entry in oldest, its age in maxtime */
-          if (arp_table[i].ctime >= age_stable) {
-            old_stable = i;
-            age_stable = arp_table[i].ctime;
-          }
-        }
-      }
+  u16_t i, h;
+
+  LWIP_ASSERT("ipaddr != NULL", ipaddr != NULL);
+  h = etharp_hash(ipaddr);
+  for (i = arp_hash[h]; i != ARP_IDX_NONE; i = arp_table[i].next_hash) {
+    if (ip_addr_cmp(ipaddr, &arp_table[i].ipaddr)) {
+      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: found matching entry %"U16_F"\n", i));
+      /* found exact IP address match, simply bail out */
+      return (s16_t)i;
     }
   }
   /* { we have no match } => try to create a new entry */
-   
+
   /* don't create new entry, only search? */
-  if (((flags & ETHARP_FLAG_FIND_ONLY) != 0) ||
-      /* or no empty entry found and not allowed to recycle? */
-      ((empty == ARP_TABLE_SIZE) && ((flags & ETHARP_FLAG_TRY_HARD) == 0))) {
-    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: no empty entry found and not allowed to recycle\n"));
-    return (s8_t)ERR_MEM;
+  if ((flags & ETHARP_FLAG_FIND_ONLY) != 0) {
+    return (s16_t)ERR_MEM;
   }
-  
-  /* b) choose the least destructive entry to recycle:
-   * 1) empty entry
-   * 2) oldest stable entry
-   * 3) oldest pending entry without queued packets
-   * 4) oldest pending entry with queued packets
-   * 
-   * { ETHARP_FLAG_TRY_HARD is set at this point }
-   */ 
-
-  /* 1) empty entry available? */
-  if (empty < ARP_TABLE_SIZE) {
-    i = empty;
-    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: selecting empty entry %"U16_F"\n", (u16_t)i));
-  } else {
-    /* 2) found recyclable stable entry? */
-    if (old_stable < ARP_TABLE_SIZE) {
-      /* recycle oldest stable*/
-      i = old_stable;
-      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: selecting oldest stable entry %"U16_F"\n", (u16_t)i));
-      /* no queued packets should exist on stable entries */
-      LWIP_ASSERT("arp_table[i].q == NULL", arp_table[i].q == NULL);
-    /* 3) found recyclable pending entry without queued packets? */
-    } else if (old_pending < ARP_TABLE_SIZE) {
-      /* recycle oldest pending */
-      i = old_pending;
-      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: selecting oldest pending entry %"U16_F" (without queue)\n", (u16_t)i));
-    /* 4) found recyclable pending entry with queued packets? */
-    } else if (old_queue < ARP_TABLE_SIZE) {
-      /* recycle oldest pending (queued packets are free in free_entry) */
-      i = old_queue;
-      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: selecting oldest pending entry %"U16_F", freeing packet queue %p\n", (u16_t)i, (void *)(arp_table[i].q)));
-      /* no empty or recyclable entries found */
-    } else {
+
+  if ((arp_free == ARP_IDX_NONE) && !etharp_grow()) {
+    /* not allowed to recycle? */
+    if ((flags & ETHARP_FLAG_TRY_HARD) == 0) {
+      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: no empty entry found and not allowed to recycle\n"));
+      return (s16_t)ERR_MEM;
+    }
+    /* choose the least destructive entry to recycle */
+    i = arp_stable.head;
+    if (i == ARP_IDX_NONE) {
+      for (i = arp_pending.head; i != ARP_IDX_NONE; i = arp_table[i].next_age) {
+        if (arp_table[i].q == NULL) {
+          break;
+        }
+      }
+      if (i == ARP_IDX_NONE) {
+        /* queued packets are freed in free_entry */
+        i = arp_pending.head;
+      }
+    }
+    if (i == ARP_IDX_NONE) {
       LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: no empty or recyclable entries found\n"));
-      return (s8_t)ERR_MEM;
+      return (s16_t)ERR_MEM;
     }
-
-    /* { empty or recyclable entry found } */
-    LWIP_ASSERT("i < ARP_TABLE_SIZE", i < ARP_TABLE_SIZE);
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("find_entry: recycling %s entry %"U16_F"\n",
+      arp_table[i].state == ETHARP_STATE_STABLE ? "stable" : "pending", i));
     free_entry(i);
+    arp_stats.recycled++;
   }
 
-  LWIP_ASSERT("i < ARP_TABLE_SIZE", i < ARP_TABLE_SIZE);
+  /* take an empty entry and hash it */
+  i = arp_free;
   LWIP_ASSERT("arp_table[i].state == ETHARP_STATE_EMPTY",
     arp_table[i].state == ETHARP_STATE_EMPTY);
+  arp_free = arp_table[i].next_hash;
+  ip_addr_copy(arp_table[i].ipaddr, *ipaddr);
+  arp_table[i].next_hash = arp_hash[h];
+  arp_hash[h] = i;
+  arp_table[i].ctime = arp_ticks;
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+  arp_table[i].static_entry = 0;
+#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+  return (s16_t)i;
+}
+
+/**
+ * Remove all entries resolved on a netif, called when it is removed.
+ *
+ * @param netif the netif being removed
+ */
+void
+etharp_cleanup_netif(struct netif *netif)
+{
+  u16_t i;
 
-  /* IP address given? */
-  if (ipaddr != NULL) {
-    /* set IP address */
-    ip_addr_copy(arp_table[i].ipaddr, *ipaddr);
+  for (i = 0; i < arp_table_size; ++i) {
+    if ((arp_table[i].state != ETHARP_STATE_EMPTY) && (arp_table[i].netif == netif)) {
+      free_entry(i);
+    }
   }
-  arp_table[i].ctime = 0;
+}
+
+/**
+ * Get the counters and size of the ARP table.
+ *
+ * @param stats filled with the statistics
+ */
+void
+etharp_get_table_stats(struct etharp_table_stats *stats)
+{
+  u16_t i;
+
+  *stats = arp_stats;
+  stats->size = arp_table_size;
+  stats->max_size = ARP_TABLE_MAX_SIZE;
+  stats->pending = 0;
+  stats->stable = 0;
+  for (i = 0; i < arp_table_size; ++i) {
+    if (arp_table[i].state == ETHARP_STATE_PENDING) {
+      stats->pending++;
+    } else if (arp_table[i].state == ETHARP_STATE_STABLE) {
+      stats->stable++;
+    }
+  }
+}
+
+/**
+ * Copy the entries in use out of the ARP table.
+ *
+ * @param info array to fill
+ * @param max elements of info
+ * @return number of entries copied
+ */
+u16_t
+etharp_get_entries(struct etharp_entry_info *info, u16_t max)
+{
+  u16_t i, n = 0;
+
+  for (i = 0; (i < arp_table_size) && (n < max); ++i) {
+    struct etharp_entry *e = &arp_table[i];
+    if (e->state == ETHARP_STATE_EMPTY) {
+      continue;
+    }
+    ip_addr_copy(info[n].ipaddr, e->ipaddr);
+    ETHADDR32_COPY(&info[n].ethaddr, &e->ethaddr);
+    info[n].ifname[0] = (e->netif != NULL) ? e->netif->name[0] : '-';
+    info[n].ifname[1] = (e->netif != NULL) ? e->netif->name[1] : '-';
+    info[n].age = arp_ticks - e->ctime;
+    info[n].state = (e->state == ETHARP_STATE_PENDING) ? ETHARP_INFO_PENDING : ETHARP_INFO_STABLE;
 #if ETHARP_SUPPORT_STATIC_ENTRIES
-  arp_table[i].static_entry = 0;
+    if (e->static_entry) {
+      info[n].state = ETHARP_INFO_STATIC;
+    }
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
-  return (err_t)i;
+#if ARP_QUEUEING
+    info[n].queued = e->q_len;
+#else /* ARP_QUEUEING */
+    info[n].queued = (e->q != NULL) ? 1 : 0;
+#endif /* ARP_QUEUEING */
+    n++;
+  }
+  return n;
 }
 
 /**
@@ -442,7 +626,7 @@ etharp_send_ip(struct netif *netif, struct pbuf *p, struct eth_addr *src, struct
 static err_t
 update_arp_entry(struct netif *netif, ip_addr_t *ipaddr, struct eth_addr *ethaddr, u8_t flags)
 {
-  s8_t i;
+  s16_t i;
   LWIP_ASSERT("netif->hwaddr_len == ETHARP_HWADDR_LEN", netif->hwaddr_len == ETHARP_HWADDR_LEN);
   LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("update_arp_entry: %"U16_F".%"U16_F".%"U16_F".%"U16_F" - %02"X16_F":%02"X16_F":%02"X16_F":%02"X16_F":%02"X16_F":%02"X16_F"\n",
     ip4_addr1_16(ipaddr), ip4_addr2_16(ipaddr), ip4_addr3_16(ipaddr), ip4_addr4_16(ipaddr),
@@ -462,6 +646,8 @@ update_arp_entry(struct netif *netif, ip_addr_t *ipaddr, struct eth_addr *ethadd
     return (err_t)i;
   }
 
+  /* leave the age list of its old state */
+  etharp_age_remove(i);
 #if ETHARP_SUPPORT_STATIC_ENTRIES
   if (flags & ETHARP_FLAG_STATIC_ENTRY) {
     /* record static type */
@@ -471,19 +657,17 @@ update_arp_entry(struct netif *netif, ip_addr_t *ipaddr, struct eth_addr *ethadd
 
   /* mark it stable */
   arp_table[i].state = ETHARP_STATE_STABLE;
+  /* reset time stamp, it's the youngest stable entry now */
+  etharp_age_insert(i);
 
-#if LWIP_SNMP
   /* record network interface */
   arp_table[i].netif = netif;
-#endif /* LWIP_SNMP */
   /* insert in SNMP ARP index tree */
   snmp_insert_arpidx_tree(netif, &arp_table[i].ipaddr);
 
   LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("update_arp_entry: updating stable entry %"S16_F"\n", (s16_t)i));
   /* update address */
   ETHADDR32_COPY(&arp_table[i].ethaddr, ethaddr);
-  /* reset time stamp */
-  arp_table[i].ctime = 0;
   /* this is where we will send out queued packets! */
 #if ARP_QUEUEING
   while (arp_table[i].q != NULL) {
@@ -496,6 +680,7 @@ update_arp_entry(struct netif *netif, ip_addr_t *ipaddr, struct eth_addr *ethadd
     p = q->p;
     /* now queue entry can be freed */
     memp_free(MEMP_ARP_QUEUE, q);
+    arp_table[i].q_len--;
 #else /* ARP_QUEUEING */
   if (arp_table[i].q != NULL) {
     struct pbuf *p = arp_table[i].q;
@@ -546,7 +731,7 @@ etharp_add_static_entry(ip_addr_t *ipaddr, struct eth_addr *ethaddr)
 err_t
 etharp_remove_static_entry(ip_addr_t *ipaddr)
 {
-  s8_t i;
+  s16_t i;
   LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_remove_static_entry: %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
     ip4_addr1_16(ipaddr), ip4_addr2_16(ipaddr), ip4_addr3_16(ipaddr), ip4_addr4_16(ipaddr)));
 
@@ -563,7 +748,7 @@ etharp_remove_static_entry(ip_addr_t *ipaddr)
     return ERR_ARG;
   }
   /* entry found, free it */
-  free_entry(i);
+  free_entry((u16_t)i);
   return ERR_OK;
 }
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
@@ -578,12 +763,13 @@ etharp_remove_static_entry(ip_addr_t *ipaddr)
  * @param eth_ret points to return pointer
  * @param ip_ret points to return pointer
  * @return table index if found, -1 otherwise
+ * @note the returned pointers are valid until the table grows
  */
-s8_t
+s16_t
 etharp_find_addr(struct netif *netif, ip_addr_t *ipaddr,
          struct eth_addr **eth_ret, ip_addr_t **ip_ret)
 {
-  s8_t i;
+  s16_t i;
 
   LWIP_ASSERT("eth_ret != NULL && ip_ret != NULL",
     eth_ret != NULL && ip_ret != NULL);
@@ -893,24 +1079,28 @@ etharp_output(struct netif *netif, struct pbuf *q, ip_addr_t *ipaddr)
         }
       }
     }
+    {
+      /* the entry last used on this netif */
+      u16_t etharp_cached_entry = netif->arp_hint;
 #if LWIP_NETIF_HWADDRHINT
-    if (netif->addr_hint != NULL) {
-      /* per-pcb cached entry was given */
-      u8_t etharp_cached_entry = *(netif->addr_hint);
-      if (etharp_cached_entry < ARP_TABLE_SIZE) {
+      if (netif->addr_hint != NULL) {
+        /* per-pcb cached entry was given */
+        etharp_cached_entry = *(netif->addr_hint);
+      }
 #endif /* LWIP_NETIF_HWADDRHINT */
-        if ((arp_table[etharp_cached_entry].state == ETHARP_STATE_STABLE) &&
-            (ip_addr_cmp(ipaddr, &arp_table[etharp_cached_entry].ipaddr))) {
-          /* the per-pcb-cached entry is stable and the right one! */
-          ETHARP_STATS_INC(etharp.cachehit);
-          return etharp_send_ip(netif, q, (struct eth_addr*)(netif->hwaddr),
-            &arp_table[etharp_cached_entry].ethaddr);
-        }
-#if LWIP_NETIF_HWADDRHINT
+      if ((etharp_cached_entry < arp_table_size) &&
+          (arp_table[etharp_cached_entry].state == ETHARP_STATE_STABLE) &&
+          (ip_addr_cmp(ipaddr, &arp_table[etharp_cached_entry].ipaddr))) {
+        /* the cached entry is stable and the right one! */
+        ETHARP_STATS_INC(etharp.cachehit);
+        arp_stats.hits++;
+        arp_stats.hint_hits++;
+        return etharp_send_ip(netif, q, (struct eth_addr*)(netif->hwaddr),
+          &arp_table[etharp_cached_entry].ethaddr);
       }
     }
-#endif /* LWIP_NETIF_HWADDRHINT */
-    /* queue on destination Ethernet address belonging to ipaddr */
+    /* look up the hash table, or queue on destination Ethernet address
+       belonging to ipaddr */
     return etharp_query(netif, ipaddr, q);
   }
 
@@ -958,7 +1148,7 @@ etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q)
 {
   struct eth_addr * srcaddr = (struct eth_addr *)netif->hwaddr;
   err_t result = ERR_MEM;
-  s8_t i; /* ARP entry index */
+  s16_t i; /* ARP entry index */
 
   /* non-unicast address? */
   if (ip_addr_isbroadcast(ipaddr, netif) ||
@@ -984,6 +1174,8 @@ etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q)
   /* mark a fresh entry as pending (we just sent a request) */
   if (arp_table[i].state == ETHARP_STATE_EMPTY) {
     arp_table[i].state = ETHARP_STATE_PENDING;
+    arp_table[i].netif = netif;
+    etharp_age_insert(i);
   }
 
   /* { i is either a STABLE or (new or existing) PENDING entry } */
@@ -995,6 +1187,7 @@ etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q)
   if ((arp_table[i].state == ETHARP_STATE_PENDING) || (q == NULL)) {
     /* try to resolve it; send out ARP request */
     result = etharp_request(netif, ipaddr);
+    arp_stats.requests++;
     if (result != ERR_OK) {
       /* ARP request couldn't be sent */
       /* We don't re-send arp request in etharp_tmr, but we still queue packets,
@@ -1011,7 +1204,8 @@ etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q)
   /* stable entry? */
   if (arp_table[i].state == ETHARP_STATE_STABLE) {
     /* we have a valid IP->Ethernet address mapping */
-    ETHARP_SET_HINT(netif, i);
+    ETHARP_SET_HINT(netif, (u16_t)i);
+    arp_stats.hits++;
     /* send the packet */
     result = etharp_send_ip(netif, q, srcaddr, &(arp_table[i].ethaddr));
   /* pending entry? (either just created or already pending */
@@ -1019,6 +1213,16 @@ etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q)
     /* entry is still pending, queue the given packet 'q' */
     struct pbuf *p;
     int copy_needed = 0;
+    arp_stats.misses++;
+#if ARP_QUEUEING
+    if (arp_table[i].q_len >= ARP_QUEUE_LEN) {
+      /* don't let one unresolved address take all queue entries */
+      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_query: queue of ARP entry %"S16_F" is full\n", i));
+      ETHARP_STATS_INC(etharp.memerr);
+      arp_stats.queue_drops++;
+      return ERR_MEM;
+    }
+#endif /* ARP_QUEUEING */
     /* IF q includes a PBUF_REF, PBUF_POOL or PBUF_RAM, we have no choice but
      * to copy the whole queue into a new PBUF_RAM (see bug #11400) 
      * PBUF_ROMs can be left as they are, since ROM must not get changed. */
@@ -1038,6 +1242,8 @@ etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q)
         if (pbuf_copy(p, q) != ERR_OK) {
           pbuf_free(p);
           p = NULL;
+        } else {
+          PBUF_COPY_OFFLOAD(p, q);
         }
       }
     } else {
@@ -1067,11 +1273,13 @@ etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q)
           /* queue did not exist, first item in queue */
           arp_table[i].q = new_entry;
         }
+        arp_table[i].q_len++;
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_query: queued packet %p on ARP entry %"S16_F"\n", (void *)q, (s16_t)i));
         result = ERR_OK;
       } else {
         /* the pool MEMP_ARP_QUEUE is empty */
         pbuf_free(p);
+        arp_stats.queue_drops++;
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_query: could not queue a copy of PBUF_REF packet %p (out of memory)\n", (void *)q));
         result = ERR_MEM;
       }
@@ -1080,6 +1288,7 @@ etharp_query(struct netif *netif, ip_addr_t *ipaddr, struct pbuf *q)
       if (arp_table[i].q != NULL) {
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_query: dropped previously queued packet %p for ARP entry %"S16_F"\n", (void *)q, (s16_t)i));
         pbuf_free(arp_table[i].q);
+        arp_stats.queue_drops++;
       }
       arp_table[i].q = p;
       result = ERR_OK;
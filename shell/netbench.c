@@ -0,0 +1,896 @@
+//***********************************************************************/
+//    Author                    : Garry
+//    Original Date             : 19 OCT,2026
+//    Module Name               : netbench.c
+//    Module Funciton           :
+//    Description               :
+//                                Network benchmark tools of network diagnostic
+//                                application:TCP/UDP bulk throughput(iperf),
+//                                request/response latency(rrtest),and raw frame
+//                                generator at Ethernet Manager level(pktgen).
+//                                They work over lwIP's loopback interface as
+//                                well as real or emulated NICs.
+//    Last modified Author      :
+//    Last modified Date        :
+//    Last modified Content     :
+//                                1.
+//                                2.
+//    Lines number              :
+//    Extra comment             :
+//***********************************************************************/
+
+#ifndef __STDAFX_H__
+#include <StdAfx.h>
+#endif
+
+#include "lwip/ip_addr.h"
+#include "lwip/sockets.h"
+#include "lwip/inet.h"
+#include "ethmgr.h"
+
+#include "kapi.h"
+#include "shell.h"
+#include "network.h"
+#include "string.h"
+#include "stdio.h"
+#include "stdint.h"
+
+
+#define NETBENCH_BUFF_SIZE       8192         //Socket buffer of throughput and latency tests.
+#define NETBENCH_MAX_SAMPLES     4096         //Latency samples kept to calculate percentiles.
+#define NETBENCH_WAIT_CLIENT     60           //Seconds a server waits for it's client.
+#define NETBENCH_UDP_IDLE        3000         //UDP server ends after idle for this long,in ms.
+#define NETBENCH_RR_TIMEOUT      1000         //UDP request is lost without reply in it,in ms.
+#define NETBENCH_UDP_END         0xFFFFFFFF   //Sequence number of end markers.
+#define NETBENCH_END_MARKERS     3            //End markers UDP client sends.
+#define NETBENCH_STALL_TIMEOUT   2000         //pktgen gives up without progress for this long,in ms.
+#define NETBENCH_ETH_TYPE        0x88B5       //IEEE local experimental Ethertype.
+#define NETBENCH_ETH_HDR_LEN     14
+#define NETBENCH_MIN_FRAME       60
+
+static DWORD CyclesPerUs = 0;
+
+static uint64_t NetBenchTsc()
+{
+	__U64    tsc;
+	uint64_t result;
+
+	__GetTsc(&tsc);
+	result = tsc.dwHighPart;
+	result <<= 32;
+	result += tsc.dwLowPart;
+	return result;
+}
+
+//Obtain TSC cycles per micro second.
+static DWORD NetBenchCyclesPerUs()
+{
+	if(0 == CyclesPerUs)
+	{
+		CyclesPerUs = __GetTscCyclesPerUs();
+	}
+	return CyclesPerUs;
+}
+
+//Micro seconds elapsed since start.
+static uint64_t NetBenchElapsed(uint64_t start)
+{
+	return (NetBenchTsc() - start) / CyclesPerUs;
+}
+
+//Show bytes and packets transferred in us micro seconds.
+static VOID NetBenchShowRate(LPSTR pszName,uint64_t bytes,DWORD dwPackets,uint64_t us)
+{
+	DWORD dwKbps = 0;
+	DWORD dwPps  = 0;
+
+	if(us)
+	{
+		dwKbps = (DWORD)((bytes * 8 * 1000) / us);
+		dwPps  = (DWORD)(((uint64_t)dwPackets * 1000000) / us);
+	}
+	_hx_printf("  %s: %u KB in %u ms,%u.%02u Mbit/s",
+		pszName,
+		(DWORD)(bytes / 1024),
+		(DWORD)(us / 1000),
+		dwKbps / 1000,
+		(dwKbps % 1000) / 10);
+	if(dwPackets)
+	{
+		_hx_printf(",%u packets,%u pps",dwPackets,dwPps);
+	}
+	_hx_printf(".\r\n");
+}
+
+//Shell sort of latency samples.
+static VOID NetBenchSortSamples(DWORD* pSamples,DWORD dwNum)
+{
+	DWORD dwGap,i,j,dwVal;
+
+	for(dwGap = dwNum / 2;dwGap > 0;dwGap /= 2)
+	{
+		for(i = dwGap;i < dwNum;i ++)
+		{
+			dwVal = pSamples[i];
+			for(j = i;(j >= dwGap) && (pSamples[j - dwGap] > dwVal);j -= dwGap)
+			{
+				pSamples[j] = pSamples[j - dwGap];
+			}
+			pSamples[j] = dwVal;
+		}
+	}
+}
+
+static DWORD NetBenchPercentile(DWORD* pSamples,DWORD dwNum,DWORD dwPercent)
+{
+	DWORD dwIndex;
+
+	if(0 == dwNum)
+	{
+		return 0;
+	}
+	dwIndex = (dwNum * dwPercent) / 100;
+	if(dwIndex >= dwNum)
+	{
+		dwIndex = dwNum - 1;
+	}
+	return pSamples[dwIndex];
+}
+
+//Create a socket bound to the benchmark port.
+static int NetBenchBind(__NETBENCH_PARAM* pParam)
+{
+	struct sockaddr_in addr;
+	int s = -1;
+
+	s = lwip_socket(AF_INET,pParam->bUdp ? SOCK_DGRAM : SOCK_STREAM,0);
+	if(s < 0)
+	{
+		_hx_printf("  Can not create socket.\r\n");
+		goto __TERMINAL;
+	}
+	memset(&addr,0,sizeof(addr));
+	addr.sin_len         = sizeof(addr);
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(pParam->port);
+	addr.sin_addr.s_addr = INADDR_ANY;
+	if(lwip_bind(s,(struct sockaddr*)&addr,sizeof(addr)) < 0)
+	{
+		_hx_printf("  Can not bind to port %d.\r\n",pParam->port);
+		lwip_close(s);
+		s = -1;
+	}
+
+__TERMINAL:
+	return s;
+}
+
+//Listen on the benchmark port and accept one client.
+static int NetBenchAccept(__NETBENCH_PARAM* pParam)
+{
+	struct sockaddr_in addr;
+	socklen_t          addrlen = sizeof(addr);
+	struct timeval     tv;
+	fd_set             readset;
+	int                s       = -1;
+	int                c       = -1;
+
+	s = NetBenchBind(pParam);
+	if(s < 0)
+	{
+		goto __TERMINAL;
+	}
+	if(lwip_listen(s,1) < 0)
+	{
+		_hx_printf("  Can not listen on port %d.\r\n",pParam->port);
+		goto __TERMINAL;
+	}
+	FD_ZERO(&readset);
+	FD_SET(s,&readset);
+	tv.tv_sec  = NETBENCH_WAIT_CLIENT;
+	tv.tv_usec = 0;
+	if(lwip_select(s + 1,&readset,NULL,NULL,&tv) <= 0)
+	{
+		_hx_printf("  No client connected in %d seconds.\r\n",NETBENCH_WAIT_CLIENT);
+		goto __TERMINAL;
+	}
+	c = lwip_accept(s,(struct sockaddr*)&addr,&addrlen);
+	if(c >= 0)
+	{
+		_hx_printf("  Client %s connected.\r\n",inet_ntoa(addr.sin_addr));
+	}
+
+__TERMINAL:
+	if(s >= 0)
+	{
+		lwip_close(s);
+	}
+	return c;
+}
+
+//Connect to the benchmark server,or only set the default destination for UDP.
+static int NetBenchConnect(__NETBENCH_PARAM* pParam)
+{
+	struct sockaddr_in addr;
+	int s = -1;
+
+	s = lwip_socket(AF_INET,pParam->bUdp ? SOCK_DGRAM : SOCK_STREAM,0);
+	if(s < 0)
+	{
+		_hx_printf("  Can not create socket.\r\n");
+		goto __TERMINAL;
+	}
+	memset(&addr,0,sizeof(addr));
+	addr.sin_len         = sizeof(addr);
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(pParam->port);
+	addr.sin_addr.s_addr = pParam->targetAddr.addr;
+	if(lwip_connect(s,(struct sockaddr*)&addr,sizeof(addr)) < 0)
+	{
+		_hx_printf("  Can not connect to %s:%d.\r\n",
+			inet_ntoa(pParam->targetAddr),pParam->port);
+		lwip_close(s);
+		s = -1;
+	}
+
+__TERMINAL:
+	return s;
+}
+
+//Receive side of TCP throughput test,count bytes until client closes.
+static VOID TcpSink(__NETBENCH_PARAM* pParam,char* pBuffer)
+{
+	uint64_t bytes = 0;
+	uint64_t start = 0;
+	int      c     = -1;
+	int      len   = 0;
+
+	c = NetBenchAccept(pParam);
+	if(c < 0)
+	{
+		return;
+	}
+	start = NetBenchTsc();
+	while((len = lwip_recv(c,pBuffer,NETBENCH_BUFF_SIZE,0)) > 0)
+	{
+		bytes += len;
+	}
+	NetBenchShowRate("TCP received",bytes,0,NetBenchElapsed(start));
+	lwip_close(c);
+}
+
+//Receive side of UDP throughput test,datagrams carry a sequence number in
+//the first 4 bytes to count lost and reordered ones.
+static VOID UdpSink(__NETBENCH_PARAM* pParam,char* pBuffer)
+{
+	uint64_t bytes     = 0;
+	uint64_t start     = 0;
+	uint64_t last      = 0;
+	DWORD    dwRecv    = 0;
+	DWORD    dwLost    = 0;
+	DWORD    dwReorder = 0;
+	u32_t    seq       = 0;
+	u32_t    expected  = 0;
+	int      timeout   = NETBENCH_WAIT_CLIENT * 1000;
+	int      s         = -1;
+	int      len       = 0;
+
+	s = NetBenchBind(pParam);
+	if(s < 0)
+	{
+		return;
+	}
+	lwip_setsockopt(s,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+	while(TRUE)
+	{
+		len = lwip_recv(s,pBuffer,NETBENCH_BUFF_SIZE,0);
+		if(len <= 0)  //Timeout.
+		{
+			break;
+		}
+		if(len < (int)sizeof(u32_t))
+		{
+			continue;
+		}
+		memcpy(&seq,pBuffer,sizeof(seq));
+		seq = ntohl(seq);
+		if(NETBENCH_UDP_END == seq)
+		{
+			break;
+		}
+		if(0 == dwRecv)  //First datagram,shorten the timeout.
+		{
+			start   = NetBenchTsc();
+			timeout = NETBENCH_UDP_IDLE;
+			lwip_setsockopt(s,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+		}
+		last   = NetBenchTsc();
+		bytes += len;
+		dwRecv ++;
+		if(seq >= expected)
+		{
+			dwLost  += seq - expected;
+			expected = seq + 1;
+		}
+		else  //Counted as lost when it's skipped.
+		{
+			dwReorder ++;
+			if(dwLost)
+			{
+				dwLost --;
+			}
+		}
+	}
+	if(0 == dwRecv)
+	{
+		_hx_printf("  No datagram received.\r\n");
+	}
+	else
+	{
+		NetBenchShowRate("UDP received",bytes,dwRecv,(last - start) / CyclesPerUs);
+		_hx_printf("  %u lost,%u out of order.\r\n",dwLost,dwReorder);
+	}
+	lwip_close(s);
+}
+
+//Send side of throughput test,send as fast as possible for the given seconds.
+static VOID BulkSource(__NETBENCH_PARAM* pParam,char* pBuffer)
+{
+	uint64_t bytes     = 0;
+	uint64_t start     = 0;
+	uint64_t end       = 0;
+	DWORD    dwSent    = 0;
+	DWORD    dwFailed  = 0;
+	u32_t    seq       = 0;
+	int      s         = -1;
+	int      len       = 0;
+	int      i;
+
+	s = NetBenchConnect(pParam);
+	if(s < 0)
+	{
+		return;
+	}
+	for(i = 0;i < NETBENCH_BUFF_SIZE;i ++)
+	{
+		pBuffer[i] = (char)i;
+	}
+	_hx_printf("  Sending %s data to %s:%d for %d seconds...\r\n",
+		pParam->bUdp ? "UDP" : "TCP",
+		inet_ntoa(pParam->targetAddr),pParam->port,pParam->dwSeconds);
+	start = NetBenchTsc();
+	end   = start + (uint64_t)pParam->dwSeconds * 1000000 * CyclesPerUs;
+	while(NetBenchTsc() < end)
+	{
+		if(pParam->bUdp)
+		{
+			seq = htonl(dwSent + dwFailed);
+			memcpy(pBuffer,&seq,sizeof(seq));
+		}
+		len = lwip_send(s,pBuffer,pParam->dwLength,0);
+		if(len <= 0)
+		{
+			//Out of buffers,datagram is dropped before reaching the wire.
+			if(pParam->bUdp)
+			{
+				dwFailed ++;
+				continue;
+			}
+			_hx_printf("  Connection broken.\r\n");
+			break;
+		}
+		bytes += len;
+		dwSent ++;
+	}
+	NetBenchShowRate(pParam->bUdp ? "UDP sent" : "TCP sent",bytes,
+		pParam->bUdp ? dwSent : 0,NetBenchElapsed(start));
+	if(pParam->bUdp)
+	{
+		if(dwFailed)
+		{
+			_hx_printf("  %u datagram(s) dropped by sender.\r\n",dwFailed);
+		}
+		seq = htonl(NETBENCH_UDP_END);
+		memcpy(pBuffer,&seq,sizeof(seq));
+		for(i = 0;i < NETBENCH_END_MARKERS;i ++)
+		{
+			lwip_send(s,pBuffer,sizeof(seq),0);
+		}
+	}
+	lwip_close(s);
+}
+
+//Echo side of latency test,return each request to the client.
+static VOID EchoServer(__NETBENCH_PARAM* pParam,char* pBuffer)
+{
+	struct sockaddr_in from;
+	socklen_t          fromlen;
+	DWORD              dwRequests = 0;
+	int                timeout    = NETBENCH_WAIT_CLIENT * 1000;
+	int                s          = -1;
+	int                len        = 0;
+
+	if(pParam->bUdp)
+	{
+		s = NetBenchBind(pParam);
+		if(s < 0)
+		{
+			return;
+		}
+		lwip_setsockopt(s,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+		while(TRUE)
+		{
+			fromlen = sizeof(from);
+			len = lwip_recvfrom(s,pBuffer,NETBENCH_BUFF_SIZE,0,(struct sockaddr*)&from,&fromlen);
+			if(len <= 0)
+			{
+				break;
+			}
+			lwip_sendto(s,pBuffer,len,0,(struct sockaddr*)&from,fromlen);
+			if(0 == dwRequests)
+			{
+				timeout = NETBENCH_UDP_IDLE;
+				lwip_setsockopt(s,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+			}
+			dwRequests ++;
+		}
+	}
+	else
+	{
+		s = NetBenchAccept(pParam);
+		if(s < 0)
+		{
+			return;
+		}
+		while((len = lwip_recv(s,pBuffer,NETBENCH_BUFF_SIZE,0)) > 0)
+		{
+			if(lwip_send(s,pBuffer,len,0) != len)
+			{
+				break;
+			}
+			dwRequests ++;
+		}
+	}
+	_hx_printf("  Echo server finished,%u request(s) served.\r\n",dwRequests);
+	lwip_close(s);
+}
+
+//Server side runs in it's own kernel thread,so client and server can be
+//in the same system over loopback interface.
+static DWORD NetBenchServerThread(LPVOID pData)
+{
+	__NETBENCH_PARAM* pParam  = (__NETBENCH_PARAM*)pData;
+	char*             pBuffer = NULL;
+
+	pBuffer = (char*)KMemAlloc(NETBENCH_BUFF_SIZE,KMEM_SIZE_TYPE_ANY);
+	if(NULL == pBuffer)
+	{
+		_hx_printf("  Out of memory.\r\n");
+		goto __TERMINAL;
+	}
+	if(NETBENCH_TYPE_LATENCY == pParam->dwType)
+	{
+		EchoServer(pParam,pBuffer);
+	}
+	else if(pParam->bUdp)
+	{
+		UdpSink(pParam,pBuffer);
+	}
+	else
+	{
+		TcpSink(pParam,pBuffer);
+	}
+
+__TERMINAL:
+	if(pBuffer)
+	{
+		KMemFree(pBuffer,KMEM_SIZE_TYPE_ANY,0);
+	}
+	KMemFree(pParam,KMEM_SIZE_TYPE_ANY,0);
+	return 0;
+}
+
+static VOID NetBenchStartServer(__NETBENCH_PARAM* pParam)
+{
+	__NETBENCH_PARAM* pCopy = NULL;
+
+	pCopy = (__NETBENCH_PARAM*)KMemAlloc(sizeof(__NETBENCH_PARAM),KMEM_SIZE_TYPE_ANY);
+	if(NULL == pCopy)
+	{
+		_hx_printf("  Out of memory.\r\n");
+		return;
+	}
+	memcpy(pCopy,pParam,sizeof(__NETBENCH_PARAM));
+	if(NULL == CreateKernelThread(
+		0,
+		KERNEL_THREAD_STATUS_READY,
+		PRIORITY_LEVEL_NORMAL,
+		NetBenchServerThread,
+		(LPVOID)pCopy,
+		NULL,
+		"netbench_srv"))
+	{
+		_hx_printf("  Can not create server thread.\r\n");
+		KMemFree(pCopy,KMEM_SIZE_TYPE_ANY,0);
+		return;
+	}
+	_hx_printf("  %s %s server is listening on port %d.\r\n",
+		pParam->bUdp ? "UDP" : "TCP",
+		(NETBENCH_TYPE_LATENCY == pParam->dwType) ? "echo" : "sink",
+		pParam->port);
+}
+
+//Entry point of iperf command.
+void netbench_Throughput(__NETBENCH_PARAM* pParam)
+{
+	char* pBuffer = NULL;
+
+	NetBenchCyclesPerUs();
+	pParam->dwType = NETBENCH_TYPE_THROUGHPUT;
+	if(pParam->bServer)
+	{
+		NetBenchStartServer(pParam);
+		return;
+	}
+	if((0 == pParam->dwLength) || (pParam->dwLength > NETBENCH_BUFF_SIZE))
+	{
+		pParam->dwLength = NETBENCH_BUFF_SIZE;
+	}
+	if(pParam->bUdp && (pParam->dwLength < sizeof(u32_t)))
+	{
+		pParam->dwLength = sizeof(u32_t);
+	}
+	pBuffer = (char*)KMemAlloc(NETBENCH_BUFF_SIZE,KMEM_SIZE_TYPE_ANY);
+	if(NULL == pBuffer)
+	{
+		_hx_printf("  Out of memory.\r\n");
+		return;
+	}
+	BulkSource(pParam,pBuffer);
+	KMemFree(pBuffer,KMEM_SIZE_TYPE_ANY,0);
+}
+
+//Send one request and wait for the whole reply,return FALSE if it's lost.
+static BOOL NetBenchTransact(__NETBENCH_PARAM* pParam,int s,char* pRequest,char* pReply,u32_t seq)
+{
+	u32_t reply_seq;
+	int   done = 0;
+	int   len  = 0;
+
+	if(pParam->bUdp)
+	{
+		seq = htonl(seq);
+		memcpy(pRequest,&seq,sizeof(seq));
+		if(lwip_send(s,pRequest,pParam->dwLength,0) <= 0)
+		{
+			return FALSE;
+		}
+		while(TRUE)
+		{
+			len = lwip_recv(s,pReply,NETBENCH_BUFF_SIZE,0);
+			if(len <= 0)  //Timeout.
+			{
+				return FALSE;
+			}
+			memcpy(&reply_seq,pReply,sizeof(reply_seq));
+			if(reply_seq == seq)  //Drop late replies of lost requests.
+			{
+				return TRUE;
+			}
+		}
+	}
+	while(done < (int)pParam->dwLength)
+	{
+		len = lwip_send(s,pRequest + done,pParam->dwLength - done,0);
+		if(len <= 0)
+		{
+			return FALSE;
+		}
+		done += len;
+	}
+	for(done = 0;done < (int)pParam->dwLength;done += len)
+	{
+		len = lwip_recv(s,pReply + done,pParam->dwLength - done,0);
+		if(len <= 0)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+//Entry point of rrtest command,one request is outstanding at a time and the
+//round trip time of each one is measured.
+void netbench_Latency(__NETBENCH_PARAM* pParam)
+{
+	DWORD*   pSamples  = NULL;
+	char*    pRequest  = NULL;
+	char*    pReply    = NULL;
+	uint64_t start     = 0;
+	uint64_t total     = 0;
+	DWORD    dwDone    = 0;
+	DWORD    dwLost    = 0;
+	DWORD    dwNum     = 0;
+	DWORD    i;
+	int      timeout   = NETBENCH_RR_TIMEOUT;
+	int      nodelay   = 1;
+	int      s         = -1;
+
+	NetBenchCyclesPerUs();
+	pParam->dwType = NETBENCH_TYPE_LATENCY;
+	if(pParam->bServer)
+	{
+		NetBenchStartServer(pParam);
+		return;
+	}
+	if((0 == pParam->dwLength) || (pParam->dwLength > NETBENCH_BUFF_SIZE))
+	{
+		pParam->dwLength = NETBENCH_BUFF_SIZE;
+	}
+	if(pParam->bUdp && (pParam->dwLength < sizeof(u32_t)))
+	{
+		pParam->dwLength = sizeof(u32_t);
+	}
+	pSamples = (DWORD*)KMemAlloc(NETBENCH_MAX_SAMPLES * sizeof(DWORD),KMEM_SIZE_TYPE_ANY);
+	pRequest = (char*)KMemAlloc(NETBENCH_BUFF_SIZE,KMEM_SIZE_TYPE_ANY);
+	pReply   = (char*)KMemAlloc(NETBENCH_BUFF_SIZE,KMEM_SIZE_TYPE_ANY);
+	if((NULL == pSamples) || (NULL == pRequest) || (NULL == pReply))
+	{
+		_hx_printf("  Out of memory.\r\n");
+		goto __TERMINAL;
+	}
+	memset(pRequest,0x5A,NETBENCH_BUFF_SIZE);
+
+	s = NetBenchConnect(pParam);
+	if(s < 0)
+	{
+		goto __TERMINAL;
+	}
+	if(pParam->bUdp)
+	{
+		lwip_setsockopt(s,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+	}
+	else
+	{
+		lwip_setsockopt(s,IPPROTO_TCP,TCP_NODELAY,&nodelay,sizeof(nodelay));
+	}
+	_hx_printf("  %u %s request(s) of %u bytes to %s:%d...\r\n",
+		pParam->dwCount,pParam->bUdp ? "UDP" : "TCP",pParam->dwLength,
+		inet_ntoa(pParam->targetAddr),pParam->port);
+
+	for(i = 0;i < pParam->dwCount;i ++)
+	{
+		start = NetBenchTsc();
+		if(!NetBenchTransact(pParam,s,pRequest,pReply,i))
+		{
+			dwLost ++;
+			if(!pParam->bUdp)  //Connection broken.
+			{
+				break;
+			}
+			continue;
+		}
+		start  = NetBenchTsc() - start;
+		total += start;
+		pSamples[dwDone % NETBENCH_MAX_SAMPLES] = (DWORD)(start / CyclesPerUs);
+		dwDone ++;
+	}
+
+	dwNum = (dwDone < NETBENCH_MAX_SAMPLES) ? dwDone : NETBENCH_MAX_SAMPLES;
+	NetBenchSortSamples(pSamples,dwNum);
+	total /= CyclesPerUs;
+	_hx_printf("  %u transaction(s) in %u ms,%u per second,%u failed.\r\n",
+		dwDone,
+		(DWORD)(total / 1000),
+		total ? (DWORD)(((uint64_t)dwDone * 1000000) / total) : 0,
+		dwLost);
+	_hx_printf("  Round trip(us) min/p50/p90/p99/max: %u/%u/%u/%u/%u\r\n",
+		NetBenchPercentile(pSamples,dwNum,0),
+		NetBenchPercentile(pSamples,dwNum,50),
+		NetBenchPercentile(pSamples,dwNum,90),
+		NetBenchPercentile(pSamples,dwNum,99),
+		NetBenchPercentile(pSamples,dwNum,100));
+
+__TERMINAL:
+	if(s >= 0)
+	{
+		lwip_close(s);
+	}
+	if(pSamples)
+	{
+		KMemFree(pSamples,KMEM_SIZE_TYPE_ANY,0);
+	}
+	if(pRequest)
+	{
+		KMemFree(pRequest,KMEM_SIZE_TYPE_ANY,0);
+	}
+	if(pReply)
+	{
+		KMemFree(pReply,KMEM_SIZE_TYPE_ANY,0);
+	}
+}
+
+//Frames of pktgen sent out by NIC,counted in TxDone of SendFrags.
+static volatile DWORD PktGenTxDone = 0;
+
+//Frame left to TxDone when pktgen stops with frames still in interface,
+//it's freed once PktGenOrphanNum frames are sent.
+static BYTE* PktGenOrphan    = NULL;
+static DWORD PktGenOrphanNum = 0;
+
+static VOID PktGenFrameSent(LPVOID pTxParam)
+{
+	BYTE* pFrame = NULL;
+	DWORD dwFlags;
+
+	__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+	PktGenTxDone ++;
+	if(PktGenOrphan && (PktGenTxDone >= PktGenOrphanNum))
+	{
+		pFrame       = PktGenOrphan;
+		PktGenOrphan = NULL;
+	}
+	__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+	if(pFrame)
+	{
+		KMemFree(pFrame,KMEM_SIZE_TYPE_ANY,0);
+	}
+}
+
+//Entry point of pktgen command,send raw Ethernet frames through an interface
+//without involving lwIP.Frames are handed to NIC directly if it supports
+//SendFrags,otherwise they go through Ethernet core thread by SendFrame.
+void netbench_PktGen(__NETBENCH_PARAM* pParam)
+{
+	__ETHERNET_INTERFACE* pEthInt  = NULL;
+	__ETHERNET_BUFFER*    pEthBuff = NULL;
+	__ETH_TX_FRAG         frag;
+	BYTE*                 pFrame   = NULL;
+	uint64_t              start    = 0;
+	uint64_t              progress = 0;
+	uint64_t              stall    = 0;
+	DWORD                 dwQueued = 0;
+	DWORD                 dwSent   = 0;
+	DWORD                 dwBase   = 0;
+	DWORD                 dwBusy   = 0;
+	DWORD                 dwFlags;
+	DWORD                 i;
+
+	NetBenchCyclesPerUs();
+	if(PktGenOrphan)
+	{
+		_hx_printf("  Frames of last pktgen are still in interface.\r\n");
+		goto __TERMINAL;
+	}
+	for(i = 0;i < (DWORD)EthernetManager.nIntIndex;i ++)
+	{
+		if(0 == strcmp(pParam->ifName,EthernetManager.EthInterfaces[i].ethName))
+		{
+			pEthInt = &EthernetManager.EthInterfaces[i];
+			break;
+		}
+	}
+	if(NULL == pEthInt)
+	{
+		_hx_printf("  Can not find interface %s.\r\n",pParam->ifName);
+		goto __TERMINAL;
+	}
+	if(pParam->dwLength < NETBENCH_MIN_FRAME)
+	{
+		pParam->dwLength = NETBENCH_MIN_FRAME;
+	}
+	if(pParam->dwLength > ETH_DEFAULT_MTU + NETBENCH_ETH_HDR_LEN)
+	{
+		pParam->dwLength = ETH_DEFAULT_MTU + NETBENCH_ETH_HDR_LEN;
+	}
+	pFrame = (BYTE*)KMemAlloc(pParam->dwLength,KMEM_SIZE_TYPE_ANY);
+	if(NULL == pFrame)
+	{
+		_hx_printf("  Out of memory.\r\n");
+		goto __TERMINAL;
+	}
+	//Build the frame,all frames sent are the same.
+	memcpy(pFrame,pParam->dstMac,ETH_MAC_LEN);
+	memcpy(pFrame + ETH_MAC_LEN,pEthInt->ethMac,ETH_MAC_LEN);
+	pFrame[12] = (BYTE)(NETBENCH_ETH_TYPE >> 8);
+	pFrame[13] = (BYTE)(NETBENCH_ETH_TYPE & 0xFF);
+	for(i = NETBENCH_ETH_HDR_LEN;i < pParam->dwLength;i ++)
+	{
+		pFrame[i] = (BYTE)i;
+	}
+
+	_hx_printf("  Sending %u frames of %u bytes through %s(%s)...\r\n",
+		pParam->dwCount,pParam->dwLength,pEthInt->ethName,
+		pEthInt->SendFrags ? "direct" : "core thread");
+	PktGenTxDone = 0;
+	dwBase   = pEthInt->ifState.dwFrameSend;
+	stall    = (uint64_t)NETBENCH_STALL_TIMEOUT * 1000 * CyclesPerUs;
+	start    = NetBenchTsc();
+	progress = start;
+	while(dwQueued < pParam->dwCount)
+	{
+		if(NetBenchTsc() - progress > stall)
+		{
+			_hx_printf("  Interface stalled,stop sending.\r\n");
+			break;
+		}
+		if(pEthInt->SendFrags)
+		{
+			frag.pData  = pFrame;
+			frag.length = pParam->dwLength;
+			if(!EthernetManager.SendFrags(pEthInt,&frag,1,NULL,PktGenFrameSent,NULL))
+			{
+				dwBusy ++;  //Tx ring is full.
+				continue;
+			}
+		}
+		else
+		{
+			//Don't overflow the message queue of Ethernet core thread,
+			//the frame would be lost silently.
+			if(KernelThreadManager.MsgQueueFull((__COMMON_OBJECT*)EthernetManager.EthernetCoreThread))
+			{
+				dwBusy ++;
+				Sleep(0);
+				continue;
+			}
+			pEthBuff = EthernetManager.CreateEthernetBuffer(pEthInt,pParam->dwLength);
+			if(NULL == pEthBuff)
+			{
+				dwBusy ++;
+				Sleep(0);
+				continue;
+			}
+			memcpy(pEthBuff->Buffer,pFrame,pParam->dwLength);
+			memcpy(pEthBuff->dstMAC,pFrame,ETH_MAC_LEN);
+			memcpy(pEthBuff->srcMAC,pFrame + ETH_MAC_LEN,ETH_MAC_LEN);
+			pEthBuff->frame_type = NETBENCH_ETH_TYPE;
+			pEthBuff->act_length = (__u16)pParam->dwLength;
+			EthernetManager.SendFrame(pEthInt,pEthBuff);
+		}
+		dwQueued ++;
+		progress = NetBenchTsc();
+	}
+
+	//Wait until all frames queued leave the interface.
+	progress = NetBenchTsc();
+	while(NetBenchTsc() - progress < stall)
+	{
+		if(pEthInt->SendFrags)
+		{
+			dwSent = PktGenTxDone;
+		}
+		else
+		{
+			dwSent = pEthInt->ifState.dwFrameSend - dwBase;
+		}
+		if(dwSent >= dwQueued)
+		{
+			break;
+		}
+		Sleep(0);
+	}
+	NetBenchShowRate("Frames sent",(uint64_t)dwSent * pParam->dwLength,dwSent,
+		NetBenchElapsed(start));
+	_hx_printf("  %u queued,%u busy retries.\r\n",dwQueued,dwBusy);
+
+__TERMINAL:
+	//Frames may still be referenced by NIC if it stalled,leave the frame
+	//to TxDone of the last one then.
+	if(pFrame && pEthInt->SendFrags)
+	{
+		__ENTER_CRITICAL_SECTION(NULL,dwFlags);
+		if(PktGenTxDone < dwQueued)
+		{
+			PktGenOrphan    = pFrame;
+			PktGenOrphanNum = dwQueued;
+			pFrame          = NULL;
+		}
+		__LEAVE_CRITICAL_SECTION(NULL,dwFlags);
+	}
+	if(pFrame)
+	{
+		KMemFree(pFrame,KMEM_SIZE_TYPE_ANY,0);
+	}
+	return;
+}
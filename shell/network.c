@@ -23,7 +23,13 @@
 #include "lwip/ip_addr.h"
 #include "lwip/netif.h"
 #include "lwip/inet.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "netif/etharp.h"
 #include "ethmgr.h"
+#include "ethcap.h"
 
 #include "kapi.h"
 #include "shell.h"
@@ -46,6 +52,12 @@ static DWORD showint(__CMD_PARA_OBJ*);    //Display ethernet interface's statist
 static DWORD assoc(__CMD_PARA_OBJ*);      //Associate to a specified WiFi SSID.
 static DWORD scan(__CMD_PARA_OBJ*);       //Rescan the WiFi networks.
 static DWORD setif(__CMD_PARA_OBJ*);      //Set a given interface's configurations.
+static DWORD netmem(__CMD_PARA_OBJ*);     //Show usage of lwIP's heap and memory pools.
+static DWORD arp(__CMD_PARA_OBJ*);        //Show ARP table and it's statistics.
+static DWORD iperf(__CMD_PARA_OBJ*);      //TCP/UDP throughput benchmark.
+static DWORD rrtest(__CMD_PARA_OBJ*);     //Request/response latency benchmark.
+static DWORD pktgen(__CMD_PARA_OBJ*);     //Raw ethernet frame generator.
+static DWORD capture(__CMD_PARA_OBJ*);    //Capture frames of ethernet interfaces.
 
 //
 //The following is a map between command and it's handler.
@@ -64,6 +76,12 @@ static struct __FDISK_CMD_MAP{
 	{"assoc",      assoc,     "  assoc    : Associate to a specified WiFi SSID."},
 	{"scan",       scan,      "  scan     : Scan WiFi networks and show result."},
 	{"setif",      setif,     "  setif    : Set IP configurations to a given interface."},
+	{"netmem",     netmem,    "  netmem   : Show usage and high-water marks of lwIP memory pools."},
+	{"arp",        arp,       "  arp      : Show ARP table and it's hit/miss statistics."},
+	{"iperf",      iperf,     "  iperf    : Measure TCP/UDP throughput,iperf [/s | /c ip] [/u] [/p port] [/t secs] [/l len]."},
+	{"rrtest",     rrtest,    "  rrtest   : Measure request/response latency,rrtest [/s | /c ip] [/u] [/p port] [/n count] [/l len]."},
+	{"pktgen",     pktgen,    "  pktgen   : Send raw frames through an interface,pktgen ifname [/n count] [/l len] [/d mac]."},
+	{"capture",    capture,   "  capture  : Capture frames,capture start|stop|show [n]|save file."},
 	{NULL,		   NULL,      NULL}
 };
 
@@ -250,6 +268,275 @@ static DWORD ping(__CMD_PARA_OBJ* lpCmdObj)
 	return dwRetVal;
 }
 
+//Parse parameters shared by benchmark commands,return FALSE if invalid.
+static BOOL ParseBenchParam(__CMD_PARA_OBJ* lpCmdObj,__NETBENCH_PARAM* pParam)
+{
+	BYTE  index = 1;
+	LPSTR pszPara;
+
+	while(index < lpCmdObj->byParameterNum)
+	{
+		pszPara = lpCmdObj->Parameter[index];
+		if(strcmp(pszPara,"/s") == 0)
+		{
+			pParam->bServer = TRUE;
+		}
+		else if(strcmp(pszPara,"/u") == 0)
+		{
+			pParam->bUdp = TRUE;
+		}
+		else if(index + 1 >= lpCmdObj->byParameterNum)
+		{
+			return FALSE;
+		}
+		else
+		{
+			index ++;
+			if(strcmp(pszPara,"/c") == 0)
+			{
+				pParam->targetAddr.addr = inet_addr(lpCmdObj->Parameter[index]);
+			}
+			else if(strcmp(pszPara,"/p") == 0)
+			{
+				pParam->port = (u16_t)atoi(lpCmdObj->Parameter[index]);
+			}
+			else if(strcmp(pszPara,"/t") == 0)
+			{
+				pParam->dwSeconds = atoi(lpCmdObj->Parameter[index]);
+			}
+			else if(strcmp(pszPara,"/l") == 0)
+			{
+				pParam->dwLength = atoi(lpCmdObj->Parameter[index]);
+			}
+			else if(strcmp(pszPara,"/n") == 0)
+			{
+				pParam->dwCount = atoi(lpCmdObj->Parameter[index]);
+			}
+			else
+			{
+				return FALSE;
+			}
+		}
+		index ++;
+	}
+	if(pParam->bServer)
+	{
+		return TRUE;
+	}
+	//Client must specify the server.
+	if((0 == pParam->targetAddr.addr) || (IPADDR_NONE == pParam->targetAddr.addr))
+	{
+		return FALSE;
+	}
+	return TRUE;
+}
+
+//iperf command's implementation.
+static DWORD iperf(__CMD_PARA_OBJ* lpCmdObj)
+{
+	__NETBENCH_PARAM BenchParam;
+
+	memset(&BenchParam,0,sizeof(BenchParam));
+	BenchParam.port      = NETBENCH_DEF_PORT;
+	BenchParam.dwSeconds = 10;
+	BenchParam.dwLength  = 1460;
+	if(!ParseBenchParam(lpCmdObj,&BenchParam))
+	{
+		_hx_printf("  Usage: iperf /s | /c ip [/u] [/p port] [/t secs] [/l len]\r\n");
+		return SHELL_CMD_PARSER_FAILED;
+	}
+	if(0 == BenchParam.dwSeconds)
+	{
+		BenchParam.dwSeconds = 1;
+	}
+	netbench_Throughput(&BenchParam);
+	return SHELL_CMD_PARSER_SUCCESS;
+}
+
+//rrtest command's implementation.
+static DWORD rrtest(__CMD_PARA_OBJ* lpCmdObj)
+{
+	__NETBENCH_PARAM BenchParam;
+
+	memset(&BenchParam,0,sizeof(BenchParam));
+	BenchParam.port     = NETBENCH_DEF_PORT;
+	BenchParam.dwCount  = 1000;
+	BenchParam.dwLength = 64;
+	if(!ParseBenchParam(lpCmdObj,&BenchParam))
+	{
+		_hx_printf("  Usage: rrtest /s | /c ip [/u] [/p port] [/n count] [/l len]\r\n");
+		return SHELL_CMD_PARSER_FAILED;
+	}
+	netbench_Latency(&BenchParam);
+	return SHELL_CMD_PARSER_SUCCESS;
+}
+
+//Convert MAC address in xx:xx:xx:xx:xx:xx form.
+static BOOL ParseMacAddr(LPSTR pszMac,BYTE* pMac)
+{
+	int   i,j;
+	BYTE  digit;
+	CHAR  ch;
+
+	for(i = 0;i < 6;i ++)
+	{
+		pMac[i] = 0;
+		for(j = 0;j < 2;j ++)
+		{
+			ch = *pszMac ++;
+			if((ch >= '0') && (ch <= '9'))
+			{
+				digit = ch - '0';
+			}
+			else if((ch >= 'a') && (ch <= 'f'))
+			{
+				digit = ch - 'a' + 10;
+			}
+			else if((ch >= 'A') && (ch <= 'F'))
+			{
+				digit = ch - 'A' + 10;
+			}
+			else
+			{
+				return FALSE;
+			}
+			pMac[i] = (pMac[i] << 4) + digit;
+		}
+		if((i < 5) && (*pszMac ++ != ':'))
+		{
+			return FALSE;
+		}
+	}
+	return (0 == *pszMac);
+}
+
+//pktgen command's implementation.
+static DWORD pktgen(__CMD_PARA_OBJ* lpCmdObj)
+{
+	__NETBENCH_PARAM BenchParam;
+	BYTE             index = 2;
+
+	if(lpCmdObj->byParameterNum < 2)
+	{
+		goto __USAGE;
+	}
+	memset(&BenchParam,0,sizeof(BenchParam));
+	memset(BenchParam.dstMac,0xFF,sizeof(BenchParam.dstMac));  //Broadcast by default.
+	BenchParam.dwCount  = 100000;
+	BenchParam.dwLength = 60;
+	strncpy(BenchParam.ifName,lpCmdObj->Parameter[1],sizeof(BenchParam.ifName) - 1);
+
+	while(index < lpCmdObj->byParameterNum)
+	{
+		if(index + 1 >= lpCmdObj->byParameterNum)
+		{
+			goto __USAGE;
+		}
+		if(strcmp(lpCmdObj->Parameter[index],"/n") == 0)
+		{
+			BenchParam.dwCount = atoi(lpCmdObj->Parameter[index + 1]);
+		}
+		else if(strcmp(lpCmdObj->Parameter[index],"/l") == 0)
+		{
+			BenchParam.dwLength = atoi(lpCmdObj->Parameter[index + 1]);
+		}
+		else if(strcmp(lpCmdObj->Parameter[index],"/d") == 0)
+		{
+			if(!ParseMacAddr(lpCmdObj->Parameter[index + 1],BenchParam.dstMac))
+			{
+				goto __USAGE;
+			}
+		}
+		else
+		{
+			goto __USAGE;
+		}
+		index += 2;
+	}
+	netbench_PktGen(&BenchParam);
+	return SHELL_CMD_PARSER_SUCCESS;
+
+__USAGE:
+	_hx_printf("  Usage: pktgen ifname [/n count] [/l len] [/d xx:xx:xx:xx:xx:xx]\r\n");
+	return SHELL_CMD_PARSER_FAILED;
+}
+
+//capture command's implementation.
+static DWORD capture(__CMD_PARA_OBJ* lpCmdObj)
+{
+	DWORD  dwSlots   = 0;
+	DWORD  dwSnapLen = 0;
+	BOOL   bWrap     = FALSE;
+	BYTE   index     = 2;
+
+	if(lpCmdObj->byParameterNum < 2)
+	{
+		goto __USAGE;
+	}
+	if(strcmp(lpCmdObj->Parameter[1],"stop") == 0)
+	{
+		EthCaptureStop();
+		EthCaptureShow(0);
+		return SHELL_CMD_PARSER_SUCCESS;
+	}
+	if(strcmp(lpCmdObj->Parameter[1],"show") == 0)
+	{
+		EthCaptureShow((lpCmdObj->byParameterNum > 2) ? atoi(lpCmdObj->Parameter[2]) : 20);
+		return SHELL_CMD_PARSER_SUCCESS;
+	}
+	if(strcmp(lpCmdObj->Parameter[1],"save") == 0)
+	{
+		//Target could be a file or a device,such as \\.\COM2.
+		if(lpCmdObj->byParameterNum < 3)
+		{
+			goto __USAGE;
+		}
+		EthCaptureSave(lpCmdObj->Parameter[2]);
+		return SHELL_CMD_PARSER_SUCCESS;
+	}
+	if(strcmp(lpCmdObj->Parameter[1],"start") != 0)
+	{
+		goto __USAGE;
+	}
+
+	//Options go first,the rest is filter expression.
+	while(index < lpCmdObj->byParameterNum)
+	{
+		if(strcmp(lpCmdObj->Parameter[index],"/w") == 0)
+		{
+			bWrap = TRUE;
+		}
+		else if((strcmp(lpCmdObj->Parameter[index],"/n") == 0) && (index + 1 < lpCmdObj->byParameterNum))
+		{
+			dwSlots = atoi(lpCmdObj->Parameter[++ index]);
+		}
+		else if((strcmp(lpCmdObj->Parameter[index],"/s") == 0) && (index + 1 < lpCmdObj->byParameterNum))
+		{
+			dwSnapLen = atoi(lpCmdObj->Parameter[++ index]);
+		}
+		else
+		{
+			break;
+		}
+		index ++;
+	}
+	if(!EthCaptureStart(dwSlots,dwSnapLen,bWrap,&lpCmdObj->Parameter[index],
+		lpCmdObj->byParameterNum - index))
+	{
+		return SHELL_CMD_PARSER_FAILED;
+	}
+	_hx_printf("  Capture started.\r\n");
+	return SHELL_CMD_PARSER_SUCCESS;
+
+__USAGE:
+	_hx_printf("  Usage: capture start [/n slots] [/s snaplen] [/w] [filter]\r\n");
+	_hx_printf("         capture stop | show [n] | save file\r\n");
+	_hx_printf("  Filter: ip arp ip6 tcp udp icmp in out,proto n,ether proto n,\r\n");
+	_hx_printf("          ether [src|dst] mac,[src|dst] host ip,[src|dst] port n,\r\n");
+	_hx_printf("          greater n,less n,combined by and,or,not and ( ).\r\n");
+	return SHELL_CMD_PARSER_FAILED;
+}
+
 //setif command's implementation.
 static DWORD setif(__CMD_PARA_OBJ* lpCmdObj)
 {
@@ -534,3 +821,149 @@ static DWORD scan(__CMD_PARA_OBJ* lpCmdObj)
 	EthernetManager.Rescan(NULL);
 	return NET_CMD_SUCCESS;
 }
+
+#if LWIP_STATS && MEMP_STATS
+//Description of each lwIP memory pool.
+static const char* MempNames[] = {
+#define LWIP_MEMPOOL(name,num,size,desc) desc,
+#include "lwip/memp_std.h"
+};
+#endif
+
+//Show usage of lwIP's heap and memory pools,the high-water mark is the most
+//elements ever used,and failures count the allocations when it's exhausted.
+static DWORD netmem(__CMD_PARA_OBJ* lpCmdObj)
+{
+#if LWIP_STATS && MEMP_STATS
+	int i;
+
+	_hx_printf("  %-16s %8s %8s %8s %8s\r\n", "Pool", "Total", "Used", "Max", "Fails");
+	_hx_printf("  ---------------- -------- -------- -------- --------\r\n");
+#if MEM_STATS
+	_hx_printf("  %-16s %8u %8u %8u %8u\r\n", "HEAP",
+		(unsigned int)lwip_stats.mem.avail,
+		(unsigned int)lwip_stats.mem.used,
+		(unsigned int)lwip_stats.mem.max,
+		(unsigned int)lwip_stats.mem.err);
+#endif
+	for (i = 0; i < MEMP_MAX; i++)
+	{
+		_hx_printf("  %-16s %8u %8u %8u %8u\r\n", MempNames[i],
+			(unsigned int)lwip_stats.memp[i].avail,
+			(unsigned int)lwip_stats.memp[i].used,
+			(unsigned int)lwip_stats.memp[i].max,
+			(unsigned int)lwip_stats.memp[i].err);
+	}
+#else
+	_hx_printf("  Memory pool statistics is not enabled in lwIP.\r\n");
+#endif
+	return SHELL_CMD_PARSER_SUCCESS;
+}
+
+//Copy of ARP table,it's taken in tcpip thread since the table may change
+//or grow there at any time.
+typedef struct tag__ARP_SNAPSHOT{
+	struct etharp_table_stats  stats;
+	struct etharp_entry_info*  pEntries;
+	u16_t                      nMax;
+	u16_t                      nNum;
+	sys_sem_t                  sem;
+}__ARP_SNAPSHOT;
+
+//Called in tcpip thread to take the snapshot.
+static void arp_snapshot(void* ctx)
+{
+	__ARP_SNAPSHOT* pSnap = (__ARP_SNAPSHOT*)ctx;
+
+	etharp_get_table_stats(&pSnap->stats);
+	pSnap->nNum = etharp_get_entries(pSnap->pEntries, pSnap->nMax);
+	sys_sem_signal(&pSnap->sem);
+}
+
+//arp command,show all entries of ARP table,and how often an address is
+//resolved from it when sending.
+static DWORD arp(__CMD_PARA_OBJ* lpCmdObj)
+{
+	__ARP_SNAPSHOT snap;
+	struct etharp_entry_info* pInfo = NULL;
+	struct etharp_table_stats* pStats = &snap.stats;
+	const char* state = NULL;
+	u32_t lookups = 0, ratio = 0;
+	int i;
+
+	memset(&snap, 0, sizeof(snap));
+	snap.nMax = ARP_TABLE_MAX_SIZE;
+	snap.pEntries = (struct etharp_entry_info*)KMemAlloc(
+		snap.nMax * sizeof(struct etharp_entry_info), KMEM_SIZE_TYPE_ANY);
+	if (NULL == snap.pEntries)
+	{
+		_hx_printf("  Out of memory.\r\n");
+		goto __TERMINAL;
+	}
+	if (ERR_OK != sys_sem_new(&snap.sem, 0))
+	{
+		_hx_printf("  Can not create semaphore.\r\n");
+		goto __TERMINAL;
+	}
+	if (ERR_OK != tcpip_callback(arp_snapshot, &snap))
+	{
+		_hx_printf("  Can not reach tcpip thread.\r\n");
+		sys_sem_free(&snap.sem);
+		goto __TERMINAL;
+	}
+	sys_sem_wait(&snap.sem);
+	sys_sem_free(&snap.sem);
+
+	_hx_printf("  %-16s %-18s %-3s %-8s %8s %6s\r\n", "Address", "MAC", "If", "State", "Age(s)", "Queued");
+	_hx_printf("  ---------------- ------------------ --- -------- -------- ------\r\n");
+	for (i = 0; i < snap.nNum; i++)
+	{
+		pInfo = &snap.pEntries[i];
+		switch (pInfo->state)
+		{
+		case ETHARP_INFO_PENDING:
+			state = "pending";
+			break;
+		case ETHARP_INFO_STATIC:
+			state = "static";
+			break;
+		default:
+			state = "stable";
+			break;
+		}
+		_hx_printf("  %-16s %02X:%02X:%02X:%02X:%02X:%02X  %c%c  %-8s %8u %6u\r\n",
+			inet_ntoa(pInfo->ipaddr),
+			pInfo->ethaddr.addr[0], pInfo->ethaddr.addr[1], pInfo->ethaddr.addr[2],
+			pInfo->ethaddr.addr[3], pInfo->ethaddr.addr[4], pInfo->ethaddr.addr[5],
+			pInfo->ifname[0], pInfo->ifname[1], state,
+			(unsigned int)(pInfo->age * (ARP_TMR_INTERVAL / 1000)),
+			(unsigned int)pInfo->queued);
+	}
+
+	lookups = pStats->hits + pStats->misses;
+	if (lookups > 0xFFFFFFFF / 100)
+	{
+		ratio = pStats->hits / (lookups / 100);
+	}
+	else if (lookups)
+	{
+		ratio = pStats->hits * 100 / lookups;
+	}
+	_hx_printf("\r\n  Table size  : %u/%u entries,%u stable,%u pending.\r\n",
+		(unsigned int)pStats->size, (unsigned int)pStats->max_size,
+		(unsigned int)pStats->stable, (unsigned int)pStats->pending);
+	_hx_printf("  Hits        : %u(%u by last used entry),misses : %u,hit ratio : %u%%.\r\n",
+		(unsigned int)pStats->hits, (unsigned int)pStats->hint_hits,
+		(unsigned int)pStats->misses,
+		(unsigned int)ratio);
+	_hx_printf("  Requests    : %u,expired : %u,recycled : %u,queue drops : %u.\r\n",
+		(unsigned int)pStats->requests, (unsigned int)pStats->expired,
+		(unsigned int)pStats->recycled, (unsigned int)pStats->queue_drops);
+
+__TERMINAL:
+	if (snap.pEntries)
+	{
+		KMemFree(snap.pEntries, KMEM_SIZE_TYPE_ANY, 0);
+	}
+	return SHELL_CMD_PARSER_SUCCESS;
+}
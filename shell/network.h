@@ -32,6 +32,31 @@ typedef struct{
 //Entry point of ping command.
 void ping_Entry(void *arg);
 
+//Benchmark types of netbench tools.
+#define NETBENCH_TYPE_THROUGHPUT  1    //Bulk transfer,iperf command.
+#define NETBENCH_TYPE_LATENCY     2    //Request/response,rrtest command.
+
+#define NETBENCH_DEF_PORT         5001
+
+//Transfer benchmark parameters to netbench routines.
+typedef struct{
+	ip_addr_t   targetAddr;
+	u16_t       port;
+	BOOL        bServer;
+	BOOL        bUdp;
+	DWORD       dwType;
+	DWORD       dwSeconds;    //Duration of throughput test.
+	DWORD       dwLength;     //Bytes of each send,request or frame.
+	DWORD       dwCount;      //Requests or frames to send.
+	char        ifName[32];   //Interface pktgen sends through.
+	BYTE        dstMac[6];    //Destination MAC of pktgen's frames.
+}__NETBENCH_PARAM;
+
+//Entry points of benchmark commands,implemented in netbench.c.
+void netbench_Throughput(__NETBENCH_PARAM* pParam);
+void netbench_Latency(__NETBENCH_PARAM* pParam);
+void netbench_PktGen(__NETBENCH_PARAM* pParam);
+
 //Flags for command processing result.
 #define NET_CMD_TERMINAL     0x00000001
 #define NET_CMD_INVALID      0x00000002
@@ -94,6 +94,7 @@ __declspec(align(4)) struct ehci_hcor {
 #define STS_ASS		(1 << 15)
 #define	STS_PSS		(1 << 14)
 #define STS_HALT	(1 << 12)
+#define STS_IAA		(1 << 5)		/* interrupted on async advance */
 	uint32_t or_usbintr;
 #define INTR_UE         (1 << 0)                /* USB interrupt enable */
 #define INTR_UEE        (1 << 1)                /* USB error interrupt enable */
@@ -136,6 +137,7 @@ struct ehci_hcor {
 #define STS_ASS		(1 << 15)
 #define	STS_PSS		(1 << 14)
 #define STS_HALT	(1 << 12)
+#define STS_IAA		(1 << 5)		/* interrupted on async advance */
 	uint32_t or_usbintr;
 #define INTR_UE         (1 << 0)                /* USB interrupt enable */
 #define INTR_UEE        (1 << 1)                /* USB error interrupt enable */
@@ -427,8 +429,30 @@ struct ehci_ctrl {
 	//Interrupt queue list pending on this EHCI Controller.
 	struct int_queue* pIntQueueFirst;
 	struct int_queue* pIntQueueLast;
+
+	//Asynchronous(control and bulk) transfers run concurrently,each one
+	//links its own QH into the async schedule.hAsyncMutex only serializes
+	//linking and unlinking QHs,pAsyncXfers lists the transfers in flight,
+	//which are woken up by the interrupt handler on completion.
+	//hAsyncEvent is set by the interrupt handler on async advance,it's
+	//NULL if the interrupt is not available,transfers are polled then.
+	HANDLE hAsyncMutex;
+	HANDLE hAsyncEvent;
+	struct ehci_async_xfer* pAsyncXfers;
+	int nAsyncXfers;                     //QHs linked to async schedule.
+	volatile unsigned long ulIaaNum;     //Async advance interrupts.
+};
+
+//Asynchronous transfer in flight,the submitting thread sleeps on hEvent.
+struct ehci_async_xfer {
+	struct ehci_async_xfer* pNext;
+	HANDLE hEvent;
 };
 
+//Maximal milliseconds to sleep before re-checking asynchronous transfer's
+//status,in case of interrupt lost.
+#define EHCI_ASYNC_WAIT_SLICE 10
+
 /**
 * ehci_set_controller_info() - Set up private data for the controller
 *
@@ -67,6 +67,7 @@ unsigned long EHCIIntHandler(LPVOID pParam)
 {
 	__COMMON_USB_CONTROLLER* pCommCtrl = (__COMMON_USB_CONTROLLER*)pParam;
 	struct ehci_ctrl* pUsbCtrl = NULL;
+	struct ehci_async_xfer* pXfer = NULL;
 	unsigned long ulResult = 0;
 	unsigned long status = 0;
 	unsigned long pciStatus = 0;
@@ -85,7 +86,12 @@ unsigned long EHCIIntHandler(LPVOID pParam)
 	if (status & INTR_AAE)
 	{
 		ulResult++;
-		//Handler of AAE.
+		//QH unlinked from async schedule could be released now.
+		pUsbCtrl->ulIaaNum++;
+		if (pUsbCtrl->hAsyncEvent)
+		{
+			SetEvent(pUsbCtrl->hAsyncEvent);
+		}
 	}
 	if (status & INTR_PCE)
 	{
@@ -105,8 +111,23 @@ unsigned long EHCIIntHandler(LPVOID pParam)
 	if (status & INTR_UE)
 	{
 		ulResult++;
-		OnXferCompletion(pUsbCtrl);
-		_hx_printf("%s: USB transfer complete interrupt,status = %X.\r\n", __func__, status);
+		if (pUsbCtrl->pIntQueueFirst)
+		{
+			OnXferCompletion(pUsbCtrl);
+		}
+		debug("%s: USB transfer complete interrupt,status = %X.\r\n", __func__, status);
+	}
+	//Wake up all threads waiting for asynchronous transfers,each one checks
+	//its own qTD to find if the transfer is over.
+	if (status & (INTR_UE | INTR_UEE))
+	{
+		for (pXfer = pUsbCtrl->pAsyncXfers; pXfer; pXfer = pXfer->pNext)
+		{
+			if (pXfer->hEvent)
+			{
+				SetEvent(pXfer->hEvent);
+			}
+		}
 	}
 	if (status & INTR_UEE)
 	{
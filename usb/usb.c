@@ -406,6 +406,26 @@ int usb_maxpacket(struct usb_device *dev, unsigned long pipe)
 		return dev->epmaxpacketin[((pipe >> 15) & 0xf)];
 }
 
+/*
+* returns the max bytes one bulk transfer can carry on the controller
+* the device attached to, 0 if not limited, -1 if unknown
+*/
+long usb_get_max_xfer_size(struct usb_device *dev)
+{
+	__COMMON_USB_CONTROLLER* pUsbCtrl = NULL;
+
+	if (NULL == dev)
+	{
+		return -1;
+	}
+	pUsbCtrl = (__COMMON_USB_CONTROLLER*)dev->controller;
+	if (NULL == pUsbCtrl->ctrlOps.get_max_xfer_size)
+	{
+		return -1;
+	}
+	return (long)pUsbCtrl->ctrlOps.get_max_xfer_size(dev);
+}
+
 /*
 * The routine usb_set_maxpacket_ep() is extracted from the loop of routine
 * usb_set_maxpacket(), because the optimizer of GCC 4.x chokes on this routine
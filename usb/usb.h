@@ -298,6 +298,7 @@ typedef struct tag__USB_CONTROLLER_OPERATIONS{
 	void* (*poll_int_queue)(struct usb_device *dev, struct int_queue *queue);
 	unsigned long (*get_ctrl_status)(void* common_ctrl,DWORD ctrlFlags);
 	unsigned long (*InterruptHandler)(LPVOID pCommCtrl);  //Interrupt handler of the USB controller.
+	unsigned long (*get_max_xfer_size)(struct usb_device *dev);  //Bytes one bulk transfer can carry,0 means no limit.
 }__USB_CONTROLLER_OPERATIONS;
 
 //Flags used to indicate which register to return when get_ctrl_status invoked.
@@ -434,6 +435,9 @@ int usb_submit_int_msg(struct usb_device *dev, unsigned long pipe,
 	void *buffer, int transfer_len, int interval);
 int usb_disable_asynch(int disable);
 int usb_maxpacket(struct usb_device *dev, unsigned long pipe);
+//Maximal bytes of one bulk transfer the controller can handle,0 if unlimited and
+//-1 if the controller does not tell.
+long usb_get_max_xfer_size(struct usb_device *dev);
 int usb_get_configuration_no(struct usb_device *dev, unsigned char *buffer,
 	int cfgno);
 int usb_get_report(struct usb_device *dev, int ifnum, unsigned char type,
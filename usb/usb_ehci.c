@@ -364,8 +364,137 @@ void ehci_update_endpt2_dev_n_port(struct usb_device *udev,struct QH *qh)
 		QH_ENDPT2_HUBADDR(parent_devnum));
 }
 
+/*
+* Wait for the controller to advance the async schedule after a QH is
+* unlinked,so that it holds no reference to the QH any more and the QH
+* could be released. Called with hAsyncMutex held.
+*/
+static int ehci_async_advance(struct ehci_ctrl *ctrl)
+{
+	unsigned long iaa = ctrl->ulIaaNum;
+	unsigned long ts;
+	uint32_t cmd;
+
+	if (ctrl->hAsyncEvent)
+		ResetEvent(ctrl->hAsyncEvent);
+	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
+	ehci_writel(&ctrl->hcor->or_usbcmd, cmd | CMD_IAAD);
+
+	ts = get_timer(0);
+	do {
+		/* Acknowledged by the interrupt handler if it's enabled. */
+		if (ctrl->ulIaaNum != iaa)
+			return 0;
+		if (ehci_readl(&ctrl->hcor->or_usbsts) & STS_IAA) {
+			ehci_writel(&ctrl->hcor->or_usbsts, STS_IAA);
+			return 0;
+		}
+		if (ctrl->hAsyncEvent)
+			WaitForThisObjectEx(ctrl->hAsyncEvent, 1);
+		else
+			udelay(5);
+	} while (get_timer(ts) < 100);
+	return -1;
+}
+
+/*
+* Link a transfer's QH right after the head of async schedule,the schedule
+* is enabled by the first QH linked.
+*/
+static int ehci_link_async(struct ehci_ctrl *ctrl, struct QH *qh,
+	struct ehci_async_xfer *xfer)
+{
+	DWORD dwFlags;
+	uint32_t cmd, usbsts;
+	int ret = 0;
+
+	WaitForThisObject(ctrl->hAsyncMutex);
+	qh->qh_link = ctrl->qh_list.qh_link;
+	flush_dcache_range((unsigned long)qh, ALIGN_END_ADDR(struct QH, qh, 1));
+	ctrl->qh_list.qh_link = cpu_to_hc32((unsigned long)qh | QH_LINK_TYPE_QH);
+	flush_dcache_range((unsigned long)&ctrl->qh_list,
+		ALIGN_END_ADDR(struct QH, &ctrl->qh_list, 1));
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	xfer->pNext = ctrl->pAsyncXfers;
+	ctrl->pAsyncXfers = xfer;
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+
+	if (ctrl->nAsyncXfers++ == 0) {
+		/* Set async. queue head pointer. */
+		ehci_writel(&ctrl->hcor->or_asynclistaddr,
+			(unsigned long)&ctrl->qh_list);
+		usbsts = ehci_readl(&ctrl->hcor->or_usbsts);
+		ehci_writel(&ctrl->hcor->or_usbsts, (usbsts & 0x3f));
+
+		/* Enable async. schedule. */
+		cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
+		cmd |= CMD_ASE;
+		ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
+
+		ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS,
+			STS_ASS, 100 * 1000);
+		if (ret < 0)
+			printf("EHCI fail timeout STS_ASS set\r\n");
+	}
+	ReleaseMutex(ctrl->hAsyncMutex);
+	return ret;
+}
+
+/*
+* Unlink a transfer's QH from async schedule,the schedule is disabled when
+* the last QH is unlinked,otherwise wait for async advance since other
+* transfers are still in progress.
+*/
+static int ehci_unlink_async(struct ehci_ctrl *ctrl, struct QH *qh,
+	struct ehci_async_xfer *xfer)
+{
+	struct ehci_async_xfer **pp;
+	struct QH *prev = &ctrl->qh_list;
+	uint32_t link = cpu_to_hc32((unsigned long)qh | QH_LINK_TYPE_QH);
+	DWORD dwFlags;
+	uint32_t cmd;
+	int ret = 0;
+
+	__ENTER_CRITICAL_SECTION(NULL, dwFlags);
+	for (pp = &ctrl->pAsyncXfers; *pp; pp = &(*pp)->pNext) {
+		if (*pp == xfer) {
+			*pp = xfer->pNext;
+			break;
+		}
+	}
+	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
+
+	WaitForThisObject(ctrl->hAsyncMutex);
+	/* QHs in the ring are all linked by transfers in flight. */
+	while (prev->qh_link != link)
+		prev = (struct QH *)(hc32_to_cpu(prev->qh_link) & ~0x1f);
+	prev->qh_link = qh->qh_link;
+	flush_dcache_range((unsigned long)prev,
+		ALIGN_END_ADDR(struct QH, prev, 1));
+
+	if (--ctrl->nAsyncXfers == 0) {
+		/* Disable async schedule. */
+		cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
+		cmd &= ~CMD_ASE;
+		ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
+
+		ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS, 0,
+			100 * 1000);
+		if (ret < 0)
+			_hx_printf("EHCI fail timeout STS_ASS reset\r\n");
+	}
+	else {
+		ret = ehci_async_advance(ctrl);
+		if (ret < 0)
+			_hx_printf("EHCI fail timeout on async advance\r\n");
+	}
+	ReleaseMutex(ctrl->hAsyncMutex);
+	return ret;
+}
+
 static int
-ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
+__ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
 int length, struct devrequest *req)
 {
 	ALLOC_ALIGN_BUFFER(struct QH, qh, 1, USB_DMA_MINALIGN);
@@ -375,13 +504,16 @@ int length, struct devrequest *req)
 	volatile struct qTD *vtd;
 	unsigned long ts;
 	uint32_t *tdp;
-	uint32_t endpt, maxpacket, token, usbsts;
+	uint32_t endpt, maxpacket, token;
 	uint32_t c, toggle;
-	uint32_t cmd;
+	struct ehci_async_xfer xfer;
 	int timeout;
 	int ret = 0;
 	struct ehci_ctrl *ctrl = ehci_get_ctrl(dev);
 
+	xfer.pNext = NULL;
+	xfer.hEvent = NULL;
+
 	debug("dev=%p, pipe=%lx, buffer=%p, length=%d, req=%p\r\n", dev, pipe,
 		buffer, length, req);
 	if (req != NULL)
@@ -560,7 +692,7 @@ int length, struct devrequest *req)
 				cpu_to_hc32(QT_NEXT_TERMINATE);
 			token = QT_TOKEN_DT(toggle) |
 				QT_TOKEN_TOTALBYTES(xfr_bytes) |
-				QT_TOKEN_IOC(req == NULL) | QT_TOKEN_CPAGE(0) |
+				QT_TOKEN_IOC(0) | QT_TOKEN_CPAGE(0) |
 				QT_TOKEN_CERR(3) |
 				QT_TOKEN_PID(usb_pipein(pipe) ?
 			QT_TOKEN_PID_IN : QT_TOKEN_PID_OUT) |
@@ -584,6 +716,15 @@ int length, struct devrequest *req)
 			buf_ptr += xfr_bytes;
 			left_length -= xfr_bytes;
 		} while (left_length > 0);
+
+		/*
+		* Only the last data qTD of a bulk transfer raises interrupt,
+		* short packet or error terminates the transfer also raises
+		* interrupt regardless of IOC.
+		*/
+		if (req == NULL)
+			qtd[qtd_counter - 1].qt_token |=
+				cpu_to_hc32(QT_TOKEN_IOC(1));
 	}
 
 	if (req != NULL) {
@@ -607,30 +748,16 @@ int length, struct devrequest *req)
 		tdp = &qtd[qtd_counter++].qt_next;
 	}
 
-	ctrl->qh_list.qh_link = cpu_to_hc32((unsigned long)qh | QH_LINK_TYPE_QH);
-
 	/* Flush dcache */
-	flush_dcache_range((unsigned long)&ctrl->qh_list,
-		ALIGN_END_ADDR(struct QH, &ctrl->qh_list, 1));
-	flush_dcache_range((unsigned long)qh, ALIGN_END_ADDR(struct QH, qh, 1));
 	flush_dcache_range((unsigned long)qtd,
 		ALIGN_END_ADDR(struct qTD, qtd, qtd_count));
 
-	/* Set async. queue head pointer. */
-	ehci_writel(&ctrl->hcor->or_asynclistaddr, (unsigned long)&ctrl->qh_list);
-
-	usbsts = ehci_readl(&ctrl->hcor->or_usbsts);
-	ehci_writel(&ctrl->hcor->or_usbsts, (usbsts & 0x3f));
-
-	/* Enable async. schedule. */
-	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
-	cmd |= CMD_ASE;
-	ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
-
-	ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS, STS_ASS,
-		100 * 1000);
-	if (ret < 0) {
-		printf("EHCI fail timeout STS_ASS set\r\n");
+	if (ctrl->hAsyncEvent) {
+		/* Keep polling if the event can not be created. */
+		xfer.hEvent = CreateEvent(FALSE);
+	}
+	if (ehci_link_async(ctrl, qh, &xfer) < 0) {
+		ehci_unlink_async(ctrl, qh, &xfer);
 		goto fail;
 	}
 
@@ -652,6 +779,14 @@ int length, struct devrequest *req)
 		token = hc32_to_cpu(vtd->qt_token);
 		if (!(QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE))
 			break;
+		if (xfer.hEvent)
+		{
+			//Sleep until the completion interrupt,instead of spinning.
+			//The event is reset before checking the token again,so no
+			//wakeup is lost.
+			WaitForThisObjectEx(xfer.hEvent, EHCI_ASYNC_WAIT_SLICE);
+			ResetEvent(xfer.hEvent);
+		}
 		WATCHDOG_RESET();
 	} while (get_timer(ts) < (ulong)timeout);
 
@@ -672,18 +807,11 @@ int length, struct devrequest *req)
 	if (QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE)
 		printf("EHCI timed out on TD - token=%#x\r\n", token);
 
-	/* Disable async schedule. */
-	cmd = ehci_readl(&ctrl->hcor->or_usbcmd);
-	cmd &= ~CMD_ASE;
-	ehci_writel(&ctrl->hcor->or_usbcmd, cmd);
-
-	ret = handshake((uint32_t *)&ctrl->hcor->or_usbsts, STS_ASS, 0,
-		100 * 1000);
-	if (ret < 0) {
-		_hx_printf("EHCI fail timeout STS_ASS reset\r\n");
+	if (ehci_unlink_async(ctrl, qh, &xfer) < 0)
 		goto fail;
-	}
 
+	invalidate_dcache_range((unsigned long)qh,
+		ALIGN_END_ADDR(struct QH, qh, 1));
 	token = hc32_to_cpu(qh->qh_overlay.qt_token);
 	if (!(QT_TOKEN_GET_STATUS(token) & QT_TOKEN_STATUS_ACTIVE)) {
 		debug("TOKEN=%#x\r\n", token);
@@ -724,14 +852,27 @@ int length, struct devrequest *req)
 #endif
 	}
 
+	if (xfer.hEvent)
+		DestroyEvent(xfer.hEvent);
 	free(qtd);
 	return (dev->status != USB_ST_NOT_PROC) ? 0 : -1;
 
 fail:
+	if (xfer.hEvent)
+		DestroyEvent(xfer.hEvent);
 	free(qtd);
 	return -1;
 }
 
+//Asynchronous transfers on different endpoints of a controller proceed
+//concurrently,each one links its own QH to async schedule.
+static int
+ehci_submit_async(struct usb_device *dev, unsigned long pipe, void *buffer,
+int length, struct devrequest *req)
+{
+	return __ehci_submit_async(dev, pipe, buffer, length, req);
+}
+
 static int ehci_submit_root(struct usb_device *dev, unsigned long pipe,
 	void *buffer, int length, struct devrequest *req)
 {
@@ -1168,6 +1309,14 @@ static int ehci_common_init(struct ehci_ctrl *ctrl, uint tweaks)
 		_hx_printf("%s:failed to create MUTEX object.\r\n", __func__);
 		return -1;
 	}
+	ctrl->hAsyncMutex = CreateMutex();
+	if (NULL == ctrl->hAsyncMutex)
+	{
+		_hx_printf("%s:failed to create MUTEX object.\r\n", __func__);
+		return -1;
+	}
+	ctrl->pAsyncXfers = NULL;
+	ctrl->nAsyncXfers = 0;
 
 	debug("%s: start EHCI controller now...\r\n", __func__);
 	/* Start the host controller. */
@@ -1217,8 +1366,32 @@ static int ehci_common_init(struct ehci_ctrl *ctrl, uint tweaks)
 #ifndef CONFIG_DM_USB
 int _ehci_usb_lowlevel_stop(int index)
 {
-	ehci_shutdown(&ehcic[index]);
-	return ehci_hcd_stop(index);
+	struct ehci_ctrl *ctrl = &ehcic[index];
+	int ret;
+
+	ehci_shutdown(ctrl);
+	ret = ehci_hcd_stop(index);
+
+	//Release the synchronization objects created by ehci_common_init and
+	//lowlevel init,they are created again when the controller restarts.
+	if (ctrl->hAsyncEvent)
+	{
+		DestroyEvent(ctrl->hAsyncEvent);
+		ctrl->hAsyncEvent = NULL;
+	}
+	if (ctrl->hAsyncMutex)
+	{
+		DestroyMutex(ctrl->hAsyncMutex);
+		ctrl->hAsyncMutex = NULL;
+	}
+	if (ctrl->hMutex)
+	{
+		DestroyMutex(ctrl->hMutex);
+		ctrl->hMutex = NULL;
+	}
+	ctrl->pAsyncXfers = NULL;
+	ctrl->nAsyncXfers = 0;
+	return ret;
 }
 
 //Declaration of several EHCI controller manipulation routines.
@@ -1272,6 +1445,13 @@ static unsigned long _get_ctrl_status(void* common_ctrl,DWORD ctrlFlag)
 	return -1;
 }
 
+//qTDs are allocated according to transfer length in ehci_submit_async,so
+//there is no limitation on bulk transfer size.
+static unsigned long _get_max_xfer_size(struct usb_device *dev)
+{
+	return 0;
+}
+
 //Create a common USB controller and initialize it according to EHCI.
 static __COMMON_USB_CONTROLLER* CreateUsbCtrl(__PHYSICAL_DEVICE* pPhyDev,LPVOID pCtrl)
 {
@@ -1286,6 +1466,7 @@ static __COMMON_USB_CONTROLLER* CreateUsbCtrl(__PHYSICAL_DEVICE* pPhyDev,LPVOID
 	ctrlOps.usb_reset_root_port = NULL;
 	ctrlOps.get_ctrl_status = _get_ctrl_status;
 	ctrlOps.InterruptHandler = EHCIIntHandler;
+	ctrlOps.get_max_xfer_size = _get_max_xfer_size;
 
 	return USBManager.CreateUsbCtrl(&ctrlOps,USB_CONTROLLER_EHCI,pPhyDev,pCtrl);
 }
@@ -1358,6 +1539,14 @@ int _ehci_usb_lowlevel_init(int index, enum usb_init_type init, void **controlle
 		goto done;
 	}
 
+#ifndef USB_EHCI_DISABLE_INTERRUPT
+	//Wait asynchronous transfers by interrupt if it's connected.
+	if (((__COMMON_USB_CONTROLLER*)*controller)->IntObject)
+	{
+		ctrl->hAsyncEvent = CreateEvent(FALSE);
+	}
+#endif
+
 	ctrl->rootdev = 0;
 done:
 	return rc;
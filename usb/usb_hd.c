@@ -30,6 +30,7 @@
 #include "usb.h"
 #include "scsi.h"
 #include "usbdev_storage.h"
+#include "blkqueue.h"
 
 //Only available when the USB Storage function is enabled.
 #ifdef CONFIG_USB_STORAGE
@@ -47,76 +48,136 @@ extern unsigned long usb_stor_write(int device, lbaint_t blknr, lbaint_t blkcnt,
 	_hx_printf("%s failed:dwStartSect = %d,dwSectNum = %d,pBuffer = 0x%X,dev = %d.\r\n", \
     __func__,dwStartSect,dwSectNum,pBuffer,dev);
 
+//DMA is cache coherent under x86,and both EHCI's qTD and xHCI's TRB take
+//buffer address in byte granularity,so caller's buffer is always used to
+//transfer directly.Other platforms must not let DMA buffer share cache line
+//with others,misaligned requests are transferred through a bounce buffer.
+#ifdef __I386__
+#define USB_DMA_ALIGNED(p) TRUE
+#else
+#define USB_DMA_ALIGNED(p) ((unsigned int)(p) == __ALIGN(((unsigned int)(p)), DEFAULT_CACHE_LINE_SIZE))
+#endif
+
+//Sectors of bounce buffer,larger request is bounced in several chunks.
+#define USB_BOUNCE_SECTORS 128
+
+//Bounce buffer of each USB storage device,allocated when first used.
+//Requests to one device are serialized by it's request queue.
+static BYTE* s_pBounceBuff[USB_MAX_STOR_DEV] = { 0 };
+
+static BYTE* __usbGetBounceBuffer(int dev)
+{
+	if (dev >= USB_MAX_STOR_DEV)
+	{
+		return NULL;
+	}
+	if (NULL == s_pBounceBuff[dev])
+	{
+		s_pBounceBuff[dev] = _hx_aligned_malloc(USB_BOUNCE_SECTORS * USB_STORAGE_SECTOR_SIZE,
+			DEFAULT_CACHE_LINE_SIZE);
+	}
+	return s_pBounceBuff[dev];
+}
+
 //Local wraps of sector level reading and writing for USB device.
 static unsigned long __usbReadSector(int dev, DWORD dwStartSect, DWORD dwSectNum, BYTE* pBuffer)
 {
-	BYTE* pAlignedBuff = NULL;
+	BYTE* pBounce = NULL;
+	DWORD dwChunk = 0;
 	unsigned long ret = 0;
 
-	if ((unsigned int)pBuffer != __ALIGN(((unsigned int)pBuffer), DEFAULT_CACHE_LINE_SIZE))
-	{
-		//Should allocate a buffer aligned with cache line.
-		pAlignedBuff = _hx_aligned_malloc(dwSectNum * USB_STORAGE_SECTOR_SIZE, DEFAULT_CACHE_LINE_SIZE);
-		if (NULL == pAlignedBuff)
-		{
-			return ret;
-		}
-	}
-	if (pAlignedBuff)
+	if (USB_DMA_ALIGNED(pBuffer))
 	{
-		ret = usb_stor_read(dev, dwStartSect, dwSectNum, pAlignedBuff);
-		if (ret)
-		{
-			memcpy(pBuffer, pAlignedBuff, dwSectNum * USB_STORAGE_SECTOR_SIZE);
-		}
-		aligned_free(pAlignedBuff);
+		//Transfer into caller's buffer directly.
+		ret = usb_stor_read(dev, dwStartSect, dwSectNum, pBuffer);
 		if (!ret)
 		{
 			__USB_SECTOR_RW_DEBUG;
 		}
 		return ret;
 	}
-	//pBuffer is cache line aligned,just use it.
-	ret = usb_stor_read(dev, dwStartSect, dwSectNum, pBuffer);
-	if (!ret)
+	pBounce = __usbGetBounceBuffer(dev);
+	if (NULL == pBounce)
 	{
-		__USB_SECTOR_RW_DEBUG;
+		return ret;
+	}
+	while (dwSectNum)
+	{
+		dwChunk = (dwSectNum > USB_BOUNCE_SECTORS) ? USB_BOUNCE_SECTORS : dwSectNum;
+		if (usb_stor_read(dev, dwStartSect, dwChunk, pBounce) != dwChunk)
+		{
+			__USB_SECTOR_RW_DEBUG;
+			return 0;
+		}
+		memcpy(pBuffer, pBounce, dwChunk * USB_STORAGE_SECTOR_SIZE);
+		dwStartSect += dwChunk;
+		dwSectNum -= dwChunk;
+		pBuffer += dwChunk * USB_STORAGE_SECTOR_SIZE;
+		ret += dwChunk;
 	}
 	return ret;
 }
 
 static unsigned long __usbWriteSector(int dev, DWORD dwStartSect, DWORD dwSectNum, BYTE* pBuffer)
 {
-	BYTE* pAlignedBuff = NULL;
+	BYTE* pBounce = NULL;
+	DWORD dwChunk = 0;
 	unsigned long ret = 0;
 
-	if ((unsigned int)pBuffer != __ALIGN(((unsigned int)pBuffer), DEFAULT_CACHE_LINE_SIZE))
+	if (USB_DMA_ALIGNED(pBuffer))
 	{
-		//Should allocate a buffer aligned with cache line.
-		pAlignedBuff = _hx_aligned_malloc(dwSectNum * USB_STORAGE_SECTOR_SIZE, DEFAULT_CACHE_LINE_SIZE);
-		if (NULL == pAlignedBuff)
+		//Transfer from caller's buffer directly.
+		ret = usb_stor_write(dev, dwStartSect, dwSectNum, pBuffer);
+		if (!ret)
 		{
-			return ret;
+			__USB_SECTOR_RW_DEBUG;
 		}
+		return ret;
 	}
-	if (pAlignedBuff)
+	pBounce = __usbGetBounceBuffer(dev);
+	if (NULL == pBounce)
 	{
-		memcpy(pAlignedBuff,pBuffer,dwSectNum * USB_STORAGE_SECTOR_SIZE);
-		ret = usb_stor_write(dev, dwStartSect, dwSectNum, pAlignedBuff);
-		aligned_free(pAlignedBuff);
-		if (!ret)
+		return ret;
+	}
+	while (dwSectNum)
+	{
+		dwChunk = (dwSectNum > USB_BOUNCE_SECTORS) ? USB_BOUNCE_SECTORS : dwSectNum;
+		memcpy(pBounce, pBuffer, dwChunk * USB_STORAGE_SECTOR_SIZE);
+		if (usb_stor_write(dev, dwStartSect, dwChunk, pBounce) != dwChunk)
 		{
 			__USB_SECTOR_RW_DEBUG;
+			return 0;
 		}
-		return ret;
+		dwStartSect += dwChunk;
+		dwSectNum -= dwChunk;
+		pBuffer += dwChunk * USB_STORAGE_SECTOR_SIZE;
+		ret += dwChunk;
+	}
+	return ret;
+}
+
+//Request queue of each USB storage device.
+static __BLK_QUEUE* s_pUsbQueue[USB_MAX_STOR_DEV] = { 0 };
+
+//Batch dispatch routine of the request queue.
+static BOOL UsbQueueDispatch(LPVOID pDiskParam, BOOL bWrite, DWORD dwStartSector,
+	DWORD dwSectorNum, BYTE* pBuffer)
+{
+	if (bWrite)
+	{
+		return __usbWriteSector((int)pDiskParam, dwStartSector, dwSectorNum, pBuffer) ? TRUE : FALSE;
 	}
-	//pBuffer is aligned,just use it.
-	ret = usb_stor_write(dev, dwStartSect, dwSectNum, pBuffer);
-	if (!ret)
+	return __usbReadSector((int)pDiskParam, dwStartSector, dwSectorNum, pBuffer) ? TRUE : FALSE;
+}
+
+//Transfer sectors through the device's request queue if there is.
+static unsigned long __usbTransfer(int dev, BOOL bWrite, DWORD dwStartSect, DWORD dwSectNum, BYTE* pBuffer)
+{
+	if ((dev < USB_MAX_STOR_DEV) && s_pUsbQueue[dev])
 	{
-		__USB_SECTOR_RW_DEBUG;
+		return BlkQueueSubmit(s_pUsbQueue[dev], bWrite, dwStartSect, dwSectNum, pBuffer);
 	}
-	return ret;
+	return UsbQueueDispatch((LPVOID)dev, bWrite, dwStartSect, dwSectNum, pBuffer);
 }
 
 //For each extension partition in hard disk,this function travels the
@@ -393,7 +454,7 @@ static DWORD DeviceRead(__COMMON_OBJECT* lpDrv,
 	pPe->dwCurrPos += dwResult;  //Adjust current pointer.
 	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
 	//Now issue read command to read data from device.
-	if (!__usbReadSector(pPe->nDiskNum, dwStart, dwResult, (BYTE*)lpDrcb->lpOutputBuffer))  //Can not read data.
+	if (!__usbTransfer(pPe->nDiskNum, FALSE, dwStart, dwResult, (BYTE*)lpDrcb->lpOutputBuffer))  //Can not read data.
 	{
 		dwResult = 0;
 		goto __TERMINAL;
@@ -452,7 +513,7 @@ static DWORD __CtrlSectorRead(__COMMON_OBJECT* lpDrv,__COMMON_OBJECT* lpDev,__DR
 	dwStartSector += pPe->dwStartSector;
 	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
 	//Now issue the reading command.
-	return __usbReadSector(pPe->nDiskNum, dwStartSector, dwSectorNum, (BYTE*)lpDrcb->lpOutputBuffer);
+	return __usbTransfer(pPe->nDiskNum, FALSE, dwStartSector, dwSectorNum, (BYTE*)lpDrcb->lpOutputBuffer);
 }
 
 static DWORD __CtrlSectorWrite(__COMMON_OBJECT* lpDrv,__COMMON_OBJECT* lpDev,__DRCB* lpDrcb)
@@ -489,7 +550,7 @@ static DWORD __CtrlSectorWrite(__COMMON_OBJECT* lpDrv,__COMMON_OBJECT* lpDev,__D
 	dwStartSector = psii->dwStartSector + pPe->dwStartSector;
 	__LEAVE_CRITICAL_SECTION(NULL, dwFlags);
 	//Now issue the reading command.
-	return __usbWriteSector(pPe->nDiskNum, dwStartSector, dwSectorNum, (BYTE*)psii->lpBuffer);
+	return __usbTransfer(pPe->nDiskNum, TRUE, dwStartSector, dwSectorNum, (BYTE*)psii->lpBuffer);
 }
 
 //DeviceCtrl for USBHD driver.
@@ -543,6 +604,7 @@ BOOL USBStorage_DriverEntry(__DRIVER_OBJECT* lpDrvObj)
 	__PARTITION_EXTENSION *pPe = NULL;
 	UCHAR Buff[USB_STORAGE_SECTOR_SIZE];
 	BOOL bResult = FALSE;
+	CHAR szQueueName[BLKQ_NAME_LEN];
 	int i = 0;
 
 	//Try to scan all USB storage device(s) in system.
@@ -566,6 +628,14 @@ BOOL USBStorage_DriverEntry(__DRIVER_OBJECT* lpDrvObj)
 			return FALSE;
 		}
 
+		//Create request queue for the device,sector access works without it.
+		if (i < USB_MAX_STOR_DEV)
+		{
+			_hx_sprintf(szQueueName, "usb%d", i);
+			s_pUsbQueue[i] = BlkQueueCreate(szQueueName, (LPVOID)i, UsbQueueDispatch,
+				USB_STORAGE_SECTOR_SIZE, 0);
+		}
+
 		//Analy the MBR of USB HD and establish each partition object if there is.
 		InitPartitions(i, (BYTE*)&Buff[0], lpDrvObj);
 		bResult = TRUE;
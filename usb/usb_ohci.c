@@ -2094,6 +2094,7 @@ static __COMMON_USB_CONTROLLER* CreateUsbCtrl(LPVOID pCtrl)
 	ctrlOps.poll_int_queue = poll_int_queue;
 	ctrlOps.usb_reset_root_port = NULL;
 	ctrlOps.get_ctrl_status = NULL;
+	ctrlOps.get_max_xfer_size = NULL;
 
 	return USBManager.CreateUsbCtrl(&ctrlOps, USB_CONTROLLER_OHCI,NULL,pCtrl);
 }
@@ -184,21 +184,39 @@ struct us_data {
 	ccb		*srb;			/* current srb */
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
+	unsigned short	max_xfer_blk;		/* blocks one command carries */
 };
 
-#ifdef CONFIG_USB_EHCI
 /*
-* The U-Boot EHCI driver can handle any transfer length as long as there is
-* enough free heap space left, but the SCSI READ(10) and WRITE(10) commands are
-* limited to 65535 blocks.
+* The SCSI READ(10) and WRITE(10) commands are limited to 65535 blocks,
+* below that the transfer size is only limited by the host controller,
+* which reports how many bytes its TDs/TRBs can carry in one bulk
+* transfer. Controllers that do not report it use the conservative
+* default.
 */
 #define USB_MAX_XFER_BLK	65535
-#else
-#define USB_MAX_XFER_BLK	20
-#endif
+#define USB_DEFAULT_XFER_BLK	20
 
 static struct us_data usb_stor[USB_MAX_STOR_DEV];
 
+/*
+* blocks one READ(10)/WRITE(10) carries, derived from the host
+* controller's bulk transfer capacity
+*/
+static unsigned short usb_stor_get_max_xfer_blk(struct usb_device *dev,
+	u32 blksz)
+{
+	long size = usb_get_max_xfer_size(dev);
+
+	if (size < 0 || blksz == 0)
+		return USB_DEFAULT_XFER_BLK;
+	if (size == 0 || size / blksz > USB_MAX_XFER_BLK)
+		return USB_MAX_XFER_BLK;
+	if (size / blksz == 0)
+		return 1;
+	return (unsigned short)(size / blksz);
+}
+
 #define USB_STOR_TRANSPORT_GOOD	   0
 #define USB_STOR_TRANSPORT_FAILED -1
 #define USB_STOR_TRANSPORT_ERROR  -2
@@ -1163,12 +1181,12 @@ unsigned long usb_stor_read(int device, lbaint_t blknr,
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > USB_MAX_XFER_BLK)
-			smallblks = USB_MAX_XFER_BLK;
+		if (blks > ss->max_xfer_blk)
+			smallblks = ss->max_xfer_blk;
 		else
 			smallblks = (unsigned short)blks;
 	retry_it:
-		if (smallblks == USB_MAX_XFER_BLK)
+		if (smallblks == ss->max_xfer_blk)
 			usb_show_progress();
 		srb->datalen = usb_dev_desc[device].blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1184,14 +1202,20 @@ unsigned long usb_stor_read(int device, lbaint_t blknr,
 		blks -= smallblks;
 		buf_addr += srb->datalen;
 	} while (blks != 0);
-	ss->flags &= ~USB_READY;
+	/* the device stays ready as long as commands succeed, so the next
+	* command skips the settle delay after its CBW
+	*/
+	if (blks == 0)
+		ss->flags |= USB_READY;
+	else
+		ss->flags &= ~USB_READY;
 
 	//debug("usb_read: end startblk " LBAF
 	//	", blccnt %x buffer %" PRIxPTR "\r\n",
 	//	start, smallblks, buf_addr);
 
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= USB_MAX_XFER_BLK)
+	if (blkcnt >= ss->max_xfer_blk)
 		debug("\r\n");
 	return blkcnt;
 }
@@ -1234,12 +1258,12 @@ unsigned long usb_stor_write(int device, lbaint_t blknr,
 		*/
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > USB_MAX_XFER_BLK)
-			smallblks = USB_MAX_XFER_BLK;
+		if (blks > ss->max_xfer_blk)
+			smallblks = ss->max_xfer_blk;
 		else
 			smallblks = (unsigned short)blks;
 	retry_it:
-		if (smallblks == USB_MAX_XFER_BLK)
+		if (smallblks == ss->max_xfer_blk)
 			usb_show_progress();
 		srb->datalen = usb_dev_desc[device].blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1255,13 +1279,19 @@ unsigned long usb_stor_write(int device, lbaint_t blknr,
 		blks -= smallblks;
 		buf_addr += srb->datalen;
 	} while (blks != 0);
-	ss->flags &= ~USB_READY;
+	/* the device stays ready as long as commands succeed, so the next
+	* command skips the settle delay after its CBW
+	*/
+	if (blks == 0)
+		ss->flags |= USB_READY;
+	else
+		ss->flags &= ~USB_READY;
 
 	//debug("usb_write: end startblk " LBAF ", blccnt %x buffer %"
 	//	PRIxPTR "\r\n", start, smallblks, buf_addr);
 
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= USB_MAX_XFER_BLK)
+	if (blkcnt >= ss->max_xfer_blk)
 		debug("\r\n");
 	return blkcnt;
 
@@ -1408,6 +1438,7 @@ struct us_data *ss)
 		ss->irqmaxp = usb_maxpacket(dev, ss->irqpipe);
 		dev->irq_handle = usb_stor_irq;
 	}
+	ss->max_xfer_blk = USB_DEFAULT_XFER_BLK;
 	dev->privptr = (void *)ss;
 	return 1;
 }
@@ -1495,6 +1526,8 @@ int usb_stor_get_info(struct usb_device *dev, struct us_data *ss,
 	dev_desc->blksz = blksz;
 	dev_desc->log2blksz = LOG2(dev_desc->blksz);
 	dev_desc->type = perq;
+	ss->max_xfer_blk = usb_stor_get_max_xfer_blk(dev, blksz);
+	debug("max transfer blocks: %d\r\n", ss->max_xfer_blk);
 	debug("address %d\r\n", dev_desc->target);
 	debug("partype: %d\r\n", dev_desc->part_type);
 
@@ -174,6 +174,7 @@ static __COMMON_USB_CONTROLLER* CreateUsbCtrl(__USB_CONTROLLER_OPERATIONS* ops,D
 	pUsbCtrl->ctrlOps.usb_reset_root_port = ops->usb_reset_root_port;
 	pUsbCtrl->ctrlOps.get_ctrl_status = ops->get_ctrl_status;
 	pUsbCtrl->ctrlOps.InterruptHandler = ops->InterruptHandler;
+	pUsbCtrl->ctrlOps.get_max_xfer_size = ops->get_max_xfer_size;
 
 	//Save private data of the user specified.
 	pUsbCtrl->pUsbCtrl = priv;
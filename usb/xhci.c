@@ -534,7 +534,13 @@ int _xhci_alloc_device(struct usb_device *udev)
 #ifndef CONFIG_DM_USB
 int usb_alloc_device(struct usb_device *udev)
 {
-	return _xhci_alloc_device(udev);
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	int ret;
+
+	WaitForThisObject(ctrl->hMutex);
+	ret = _xhci_alloc_device(udev);
+	ReleaseMutex(ctrl->hMutex);
+	return ret;
 }
 #endif
 
@@ -1040,20 +1046,31 @@ static int xhci_lowlevel_stop(struct xhci_ctrl *ctrl)
 static int submit_control_msg(struct usb_device *udev, unsigned long pipe,
 	void *buffer, int length, struct devrequest *setup)
 {
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
 	struct usb_device *hop = udev;
+	int ret;
 
 	if (hop->parent)
 		while (hop->parent->parent)
 			hop = hop->parent;
 
-	return _xhci_submit_control_msg(udev, pipe, buffer, length, setup,
+	WaitForThisObject(ctrl->hMutex);
+	ret = _xhci_submit_control_msg(udev, pipe, buffer, length, setup,
 		hop->portnr);
+	ReleaseMutex(ctrl->hMutex);
+	return ret;
 }
 
 static int submit_bulk_msg(struct usb_device *udev, unsigned long pipe, void *buffer,
 	int length)
 {
-	return _xhci_submit_bulk_msg(udev, pipe, buffer, length);
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	int ret;
+
+	WaitForThisObject(ctrl->hMutex);
+	ret = _xhci_submit_bulk_msg(udev, pipe, buffer, length);
+	ReleaseMutex(ctrl->hMutex);
+	return ret;
 }
 
 static int submit_int_msg(struct usb_device *udev, unsigned long pipe, void *buffer,
@@ -1062,8 +1079,18 @@ static int submit_int_msg(struct usb_device *udev, unsigned long pipe, void *buf
 	return _xhci_submit_int_msg(udev, pipe, buffer, length, interval);
 }
 
-//Create a common USB controller object to unify the OHCI USB controller.
-static __COMMON_USB_CONTROLLER* CreateUsbCtrl(LPVOID pCtrl)
+/*
+* One bulk transfer must fit in one transfer ring segment,each TRB carries
+* at most TRB_MAX_BUFF_SIZE bytes and the link TRB plus one TRB for a
+* misaligned head are reserved.
+*/
+static unsigned long get_max_xfer_size(struct usb_device *udev)
+{
+	return (TRBS_PER_SEGMENT - 2) * TRB_MAX_BUFF_SIZE;
+}
+
+//Create a common USB controller object to unify the xHCI USB controller.
+static __COMMON_USB_CONTROLLER* CreateUsbCtrl(__PHYSICAL_DEVICE* pPhyDev, LPVOID pCtrl)
 {
 	__USB_CONTROLLER_OPERATIONS ctrlOps;
 
@@ -1075,8 +1102,32 @@ static __COMMON_USB_CONTROLLER* CreateUsbCtrl(LPVOID pCtrl)
 	ctrlOps.poll_int_queue = NULL;
 	ctrlOps.usb_reset_root_port = NULL;
 	ctrlOps.get_ctrl_status = NULL;
+	ctrlOps.get_max_xfer_size = get_max_xfer_size;
+	ctrlOps.InterruptHandler = xhci_int_handler;
+
+	return USBManager.CreateUsbCtrl(&ctrlOps, USB_CONTROLLER_XHCI, pPhyDev, pCtrl);
+}
+
+/*
+* Switch the event ring from polling to interrupt, called after the
+* interrupt of the controller is connected.
+*/
+static int xhci_enable_interrupt(struct xhci_ctrl *ctrl)
+{
+	u32 reg;
 
-	return USBManager.CreateUsbCtrl(&ctrlOps, USB_CONTROLLER_XHCI,NULL,pCtrl);
+	ctrl->hEvent = CreateEvent(FALSE);
+	if (NULL == ctrl->hEvent)
+		return -ENOMEM;
+
+	xhci_writel(&ctrl->ir_set->irq_control,
+		XHCI_IMOD_INTERVAL & ER_IRQ_INTERVAL_MASK);
+	reg = xhci_readl(&ctrl->ir_set->irq_pending);
+	xhci_writel(&ctrl->ir_set->irq_pending, ER_IRQ_ENABLE(reg));
+	reg = xhci_readl(&ctrl->hcor->or_usbcmd);
+	xhci_writel(&ctrl->hcor->or_usbcmd, reg | CMD_EIE);
+	debug("xHCI: event ring is serviced by interrupt now.\r\n");
+	return 0;
 }
 
 /**
@@ -1091,11 +1142,12 @@ int _xhci_usb_lowlevel_init(int index, enum usb_init_type init, void **controlle
 	struct xhci_hccr *hccr;
 	struct xhci_hcor *hcor;
 	struct xhci_ctrl *ctrl;
+	__PHYSICAL_DEVICE *pPhyDev = NULL;
 	int ret;
 
 	*controller = NULL;
 
-	ret = xhci_hcd_init(index, &hccr, (struct xhci_hcor **)&hcor);
+	ret = xhci_hcd_init(index, &hccr, (struct xhci_hcor **)&hcor, &pPhyDev);
 	if (ret != 0)
 	{
 		debug("xHCI: Host controller init failed[%d].\r\n", ret);
@@ -1112,6 +1164,10 @@ int _xhci_usb_lowlevel_init(int index, enum usb_init_type init, void **controlle
 
 	ctrl->hccr = hccr;
 	ctrl->hcor = hcor;
+	ctrl->hEvent = NULL;
+	ctrl->hMutex = CreateMutex();
+	if (NULL == ctrl->hMutex)
+		return -ENOMEM;
 
 	ret = xhci_lowlevel_init(ctrl);
 
@@ -1119,13 +1175,20 @@ int _xhci_usb_lowlevel_init(int index, enum usb_init_type init, void **controlle
 		debug("xHCI: xHCI lowlevel init failed[%d].\r\n", ret);
 		ctrl->hccr = NULL;
 		ctrl->hcor = NULL;
+		DestroyMutex(ctrl->hMutex);
+		ctrl->hMutex = NULL;
 	}
 	else {
-		*controller = CreateUsbCtrl(&xhcic[index]);
+		*controller = CreateUsbCtrl(pPhyDev, &xhcic[index]);
 		if (!*controller)
 		{
 			ret = -1;
 		}
+		else if (((__COMMON_USB_CONTROLLER*)*controller)->IntObject)
+		{
+			//Keep polling if interrupt can not be enabled.
+			xhci_enable_interrupt(ctrl);
+		}
 		//*controller = &xhcic[index];
 	}
 
@@ -1147,6 +1210,14 @@ int _xhci_usb_lowlevel_stop(int index)
 		xhci_lowlevel_stop(ctrl);
 		xhci_hcd_stop(index);
 		xhci_cleanup(ctrl);
+		if (ctrl->hEvent) {
+			DestroyEvent(ctrl->hEvent);
+			ctrl->hEvent = NULL;
+		}
+		if (ctrl->hMutex) {
+			DestroyMutex(ctrl->hMutex);
+			ctrl->hMutex = NULL;
+		}
 	}
 
 	return 0;
@@ -44,7 +44,15 @@ int _xhci_usb_lowlevel_stop(int index);
 #define MAX_EP_CTX_NUM		31
 #define XHCI_ALIGNMENT		64
 /* Generic timeout for XHCI events */
-#define XHCI_TIMEOUT		100 //5000
+#define XHCI_TIMEOUT		5000
+/*
+* Waiting threads sleep on the controller's event when the event ring is
+* serviced by interrupt, and re-check the ring at least every slice in case
+* an interrupt is lost.
+*/
+#define XHCI_WAIT_SLICE		10
+/* Interrupt moderation interval, in 250ns units (40us) */
+#define XHCI_IMOD_INTERVAL	160
 /* Max number of USB devices for any host controller - limit in section 6.1 */
 #define MAX_HC_SLOTS            256
 /* Section 5.3.3 - MaxPorts */
@@ -1154,7 +1162,7 @@ static inline void xhci_writeq(__le64 volatile *regs, const u64 val)
 }
 
 int xhci_hcd_init(int index, struct xhci_hccr **ret_hccr,
-struct xhci_hcor **ret_hcor);
+struct xhci_hcor **ret_hcor, __PHYSICAL_DEVICE **ret_dev);
 void xhci_hcd_stop(int index);
 
 
@@ -1251,9 +1259,18 @@ struct xhci_ctrl {
 	struct xhci_erst_entry entry[ERST_NUM_SEGS];
 	struct xhci_virt_device *devs[MAX_HC_SLOTS];
 	int rootdev;
+
+	//Set by interrupt handler when new events are posted to event ring,
+	//it's NULL if the controller works in polling mode.
+	HANDLE hEvent;
+	//Serializes transfers and commands,since the event ring is consumed by
+	//the thread which issues them.
+	HANDLE hMutex;
+	unsigned long ulIntNum;     //Interrupts raised by the event ring.
 };
 
 unsigned long trb_addr(struct xhci_segment *seg, union xhci_trb *trb);
+unsigned long xhci_int_handler(LPVOID pCommCtrl);
 struct xhci_input_control_ctx
 	*xhci_get_input_control_ctx(struct xhci_container_ctx *ctx);
 struct xhci_slot_ctx *xhci_get_slot_ctx(struct xhci_ctrl *ctrl,
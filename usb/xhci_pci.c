@@ -23,7 +23,7 @@
 static __PHYSICAL_DEVICE* pOldCtrl = NULL;
 
 int xhci_hcd_init(int index, struct xhci_hccr **ret_hccr,
-struct xhci_hcor **ret_hcor)
+struct xhci_hcor **ret_hcor, __PHYSICAL_DEVICE **ret_dev)
 {
 	struct xhci_hccr *hccr;
 	struct xhci_hcor *hcor;
@@ -86,6 +86,7 @@ struct xhci_hcor **ret_hcor)
 
 	*ret_hccr = hccr;
 	*ret_hcor = hcor;
+	*ret_dev = pUsbCtrl;  //Interrupt is connected according to it.
 
 	/* enable busmaster */
 	cmd = pUsbCtrl->ReadDeviceConfig(pUsbCtrl, PCI_CONFIG_OFFSET_COMMAND, 2);
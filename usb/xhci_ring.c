@@ -417,6 +417,35 @@ static int event_ready(struct xhci_ctrl *ctrl)
 	return 1;
 }
 
+/**
+* Interrupt handler of xHCI controller, it only acknowledges the interrupt
+* and wakes up the thread waiting for events, which consumes the event ring.
+*
+* @param pCommCtrl	common USB controller object
+* @return 0 if the interrupt is not raised by this controller
+*/
+unsigned long xhci_int_handler(LPVOID pCommCtrl)
+{
+	__COMMON_USB_CONTROLLER *pCtrl = (__COMMON_USB_CONTROLLER *)pCommCtrl;
+	struct xhci_ctrl *ctrl = (struct xhci_ctrl *)pCtrl->pUsbCtrl;
+	u32 status;
+	u32 pending;
+
+	status = xhci_readl(&ctrl->hcor->or_usbsts);
+	if (!(status & STS_EINT))
+		return 0;	/* interrupt line may be shared */
+
+	/* both EINT and IP are write 1 to clear */
+	xhci_writel(&ctrl->hcor->or_usbsts, STS_EINT);
+	pending = xhci_readl(&ctrl->ir_set->irq_pending);
+	xhci_writel(&ctrl->ir_set->irq_pending, pending | 0x1);
+
+	ctrl->ulIntNum++;
+	if (ctrl->hEvent)
+		SetEvent(ctrl->hEvent);
+	return 1;
+}
+
 /**
 * Waits for a specific type of event and returns it. Discards unexpected
 * events. Caller *must* call xhci_acknowledge_event() after it is finished
@@ -434,8 +463,20 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 	do {
 		union xhci_trb *event = ctrl->event_ring->dequeue;
 
-		if (!event_ready(ctrl))
+		if (!event_ready(ctrl)) {
+			/*
+			* Sleep until the interrupt handler tells new events
+			* are posted, the event is reset before checking the
+			* ring again so no wakeup is lost.
+			*/
+			if (ctrl->hEvent) {
+				ResetEvent(ctrl->hEvent);
+				if (!event_ready(ctrl))
+					WaitForThisObjectEx(ctrl->hEvent,
+						XHCI_WAIT_SLICE);
+			}
 			continue;
+		}
 
 		type = TRB_FIELD_TO_TYPE(le32_to_cpu(event->event_cmd.flags));
 		if (type == expected)